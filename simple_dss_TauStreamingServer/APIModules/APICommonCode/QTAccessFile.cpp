@@ -28,6 +28,11 @@ LastUpdate:  2010-08-16
 #include "OSMemory.h"
 #include "OSHeaders.h"
 
+#if defined(__linux__)
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
 
 
 
@@ -64,60 +69,78 @@ UInt8 QTAccessFile::sWhitespaceAndGreaterThanMask[] =
 char*       QTAccessFile::sQTAccessFileName = "qtaccess";
 Bool16      QTAccessFile::sAllocatedName = false;
 OSMutex*    QTAccessFile::sAccessFileMutex = NULL;//QTAccessFile isn't reentrant
+int         QTAccessFile::sInotifyFD = -1;
+int*        QTAccessFile::sWatches = NULL;
+UInt32      QTAccessFile::sNumWatches = 0;
+OSRefTable* QTAccessFile::sDirTable = NULL;
+OSRefTable* QTAccessFile::sPolicyTable = NULL;
 const int kBuffLen = 512;
 
-void QTAccessFile::Initialize() // called by server at initialize never call again
+#if defined(__linux__)
+static const UInt32 kWatchMask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE
+                                    | IN_MODIFY | IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF;
+#endif
+
+/*
+    An access file parsed once into the lines that matter, in file order.
+    Each line keeps the READ / WRITE of the <Limit> it is in, so that it
+    applies to the same actions as when the text was parsed per request.
+*/
+
+class QTAccessPolicy
 {
-    if (NULL == sAccessFileMutex)
-    {   sAccessFileMutex = NEW OSMutex();
-    }
-}
+    public:
 
-void QTAccessFile::SetAccessFileName(const char *inQTAccessFileName)
+        QTAccessPolicy(StrPtrLen* inAccessFileBuf);
+        ~QTAccessPolicy();
+
+        // Same results as QTAccessFile::AccessAllowed and FindUsersAndGroupsFilesAndAuthScheme on the file text
+        Bool16          AccessAllowed(char* userName, char** groupArray, UInt32 numGroups, QTSS_ActionFlags inFlags, StrPtrLen* ioRealmNameStr);
+        QTSS_AuthScheme GetUsersAndGroupsFilesAndAuthScheme(QTSS_ActionFlags inAction, char** outUsersFilePath, char** outGroupsFilePath);
+
+    private:
+
+        enum
+        {
+            kAuthName           = 0,    //UInt32
+            kAuthUserFile       = 1,    //UInt32
+            kAuthGroupFile      = 2,    //UInt32
+            kAuthScheme         = 3,    //UInt32
+            kRequireValidUser   = 4,    //UInt32
+            kRequireAnyUser     = 5,    //UInt32
+            kRequireUser        = 6,    //UInt32
+            kRequireGroup       = 7     //UInt32
+        };
+
+        struct Rule
+        {
+            UInt32              fType;
+            QTSS_ActionFlags    fLimit;
+            char*               fValue;     // AuthName, AuthUserFile, AuthGroupFile
+            QTSS_AuthScheme     fScheme;    // AuthScheme
+            char**              fNames;     // require user, require group
+            UInt32              fNumNames;
+        };
+
+        Rule*   AddRule(UInt32 inType, QTSS_ActionFlags inLimit);
+        void    AddNames(Rule* inRule, StringParser* inLineParser);
+
+        Rule*   fRules;
+        UInt32  fNumRules;
+        UInt32  fMaxRules;
+};
+
+QTAccessPolicy::QTAccessPolicy(StrPtrLen* inAccessFileBuf)
+:   fRules(NULL), fNumRules(0), fMaxRules(0)
 {
-    OSMutexLocker locker(sAccessFileMutex);
-    if (NULL == inQTAccessFileName)
-    {   Assert(NULL != inQTAccessFileName);
+    if (NULL == inAccessFileBuf || NULL == inAccessFileBuf->Ptr)
         return;
-    }
-    
-    if (sAllocatedName)
-    {   delete [] sQTAccessFileName;
-    }
-    
-    sAllocatedName = true;
-    sQTAccessFileName = NEW char[strlen(inQTAccessFileName)+1];
-    ::strcpy(sQTAccessFileName, inQTAccessFileName);
-    
-}
 
-
-Bool16 QTAccessFile::AccessAllowed  (   char *userName, char**groupArray, UInt32 numGroups, StrPtrLen *accessFileBufPtr,
-                                        QTSS_ActionFlags inFlags,StrPtrLen* ioRealmNameStr 
-                                    )
-{       
-    if (NULL == accessFileBufPtr || NULL == accessFileBufPtr->Ptr || 0 == accessFileBufPtr->Len)
-        return false; // nothing to check
-    if (ioRealmNameStr != NULL && ioRealmNameStr->Ptr != NULL && ioRealmNameStr->Len > 0)
-        ioRealmNameStr->Ptr[0] = 0;
-        
-    StringParser            accessFileParser(accessFileBufPtr);
-    QTSS_ActionFlags        currentFlags = qtssActionFlagsRead; 
+    StringParser            accessFileParser(inAccessFileBuf);
+    QTSS_ActionFlags        currentLimit = qtssActionFlagsRead;
     StrPtrLen               line;
     StrPtrLen               word;
-    Bool16                  haveUserName = false;
-    Bool16                  haveRealmResultBuffer = false;
-    Bool16                  haveGroups = false;
-    
-    if (NULL != userName && 0 != userName[0])
-        haveUserName = true;
-    
-    if (numGroups > 0 && groupArray != NULL)
-        haveGroups = true;
-        
-    if (ioRealmNameStr != NULL && ioRealmNameStr->Ptr != NULL && ioRealmNameStr->Len > 0)
-        haveRealmResultBuffer = true;
-        
+
     while( accessFileParser.GetDataRemaining() != 0 ) 
     {
         accessFileParser.GetThruEOL(&line);  // Read each line  
@@ -133,106 +156,396 @@ Bool16 QTAccessFile::AccessAllowed  (   char *userName, char**groupArray, UInt32
         lineParser.ConsumeUntilWhitespace(&word);
         if ( word.Equal("<Limit") ) // a limit line
         {
-            currentFlags = qtssActionFlagsNoFlags; // clear to no access
+            currentLimit = qtssActionFlagsNoFlags;
             lineParser.ConsumeWhitespace();
-            lineParser.ConsumeUntil( &word, sWhitespaceAndGreaterThanMask); // the flag <limit Read> or <limit Read >
+            lineParser.ConsumeUntil( &word, QTAccessFile::sWhitespaceAndGreaterThanMask); // the flag <limit Read> or <limit Read >
             while (word.Len != 0) // compare each word in the line
             {   
                 if (word.Equal("WRITE")  ) 
-                {   currentFlags |= inFlags & qtssActionFlagsWrite; // accept following lines if inFlags has write
-                }
+                    currentLimit |= qtssActionFlagsWrite;
                 
                 if (word.Equal("READ") ) 
-                {   currentFlags |= inFlags & qtssActionFlagsRead; // accept following lines if inFlags has read
-                }
+                    currentLimit |= qtssActionFlagsRead;
+
                 lineParser.ConsumeWhitespace();
-                lineParser.ConsumeUntil(&word, sWhitespaceAndGreaterThanMask);
+                lineParser.ConsumeUntil(&word, QTAccessFile::sWhitespaceAndGreaterThanMask);
             }
             continue; //done with limit line
         }
         if ( word.Equal("</Limit>") )
-            currentFlags = qtssActionFlagsRead; // set the current access state to the default of read access
+        {   currentLimit = qtssActionFlagsRead; // back to the default of read access
+            continue;
+        }
         
-        if (0 == (currentFlags & inFlags))
-            continue; // ignore lines because inFlags doesn't match the current access state
-            
-        if (haveRealmResultBuffer && word.Equal("AuthName") ) //realm name
+        if ( word.Equal("AuthName") || word.Equal("AuthUserFile") || word.Equal("AuthGroupFile") )
         {   
+            UInt32 theType = kAuthName;
+            if (word.Equal("AuthUserFile"))
+                theType = kAuthUserFile;
+            else if (word.Equal("AuthGroupFile"))
+                theType = kAuthGroupFile;
+
             lineParser.ConsumeWhitespace();
             lineParser.GetThruEOL(&word);
             StringParser::UnQuote(&word);// if the parsed string is surrounded by quotes then remove them.
-            
-            if (ioRealmNameStr->Len <= word.Len) 
-                word.Len = ioRealmNameStr->Len -1; // just copy what we can
-            ::memcpy(ioRealmNameStr->Ptr, word.Ptr,word.Len);
-            ioRealmNameStr->Ptr[word.Len] = 0; 
-            // we don't change the buffer len ioRealmNameStr->Len because we might have another AuthName tag to copy
-            continue; // done with AuthName (realm)
+            this->AddRule(theType, currentLimit)->fValue = word.GetAsCString();
+            continue;
+        }
+
+        if (word.Equal("AuthScheme") )
+        {
+            lineParser.ConsumeWhitespace();
+            lineParser.GetThruEOL(&word);
+            StringParser::UnQuote(&word);
+
+            // any other scheme leaves the one found so far
+            if (word.Equal("basic"))
+                this->AddRule(kAuthScheme, currentLimit)->fScheme = qtssAuthBasic;
+            else if (word.Equal("digest"))
+                this->AddRule(kAuthScheme, currentLimit)->fScheme = qtssAuthDigest;
+            continue;
         }
-        
         
         if (word.Equal("require") )
         {
             lineParser.ConsumeWhitespace();
             lineParser.ConsumeUntilWhitespace(&word);       
 
-            if (haveUserName && word.Equal("valid-user") ) 
-            {   return true; 
-            }
-            
-            if ( word.Equal("any-user")  ) 
-            {   return true; 
+            if (word.Equal("valid-user") ) 
+                (void)this->AddRule(kRequireValidUser, currentLimit);
+            else if ( word.Equal("any-user")  ) 
+                (void)this->AddRule(kRequireAnyUser, currentLimit);
+            else if (word.Equal("user") )
+                this->AddNames(this->AddRule(kRequireUser, currentLimit), &lineParser);
+            else if (word.Equal("group"))
+                this->AddNames(this->AddRule(kRequireGroup, currentLimit), &lineParser);
+            continue;
+        }
+    }
+}
+
+QTAccessPolicy::~QTAccessPolicy()
+{
+    for (UInt32 x = 0; x < fNumRules; x++)
+    {
+        delete [] fRules[x].fValue;
+        for (UInt32 y = 0; y < fRules[x].fNumNames; y++)
+            delete [] fRules[x].fNames[y];
+        delete [] fRules[x].fNames;
+    }
+    delete [] fRules;
+}
+
+QTAccessPolicy::Rule* QTAccessPolicy::AddRule(UInt32 inType, QTSS_ActionFlags inLimit)
+{
+    if (fNumRules == fMaxRules)
+    {
+        fMaxRules = (fMaxRules == 0) ? 8 : fMaxRules * 2;
+        Rule* theRules = NEW Rule[fMaxRules];
+        if (fNumRules > 0)
+            ::memcpy(theRules, fRules, sizeof(Rule) * fNumRules);
+        delete [] fRules;
+        fRules = theRules;
+    }
+
+    Rule* theRule = &fRules[fNumRules++];
+    theRule->fType = inType;
+    theRule->fLimit = inLimit;
+    theRule->fValue = NULL;
+    theRule->fScheme = qtssAuthNone;
+    theRule->fNames = NULL;
+    theRule->fNumNames = 0;
+    return theRule;
+}
+
+void QTAccessPolicy::AddNames(Rule* inRule, StringParser* inLineParser)
+{
+    UInt32      theMaxNames = 0;
+    StrPtrLen   word;
+
+    inLineParser->ConsumeWhitespace();
+    inLineParser->ConsumeUntilWhitespace(&word);
+    while (word.Len != 0) // each word in the line
+    {
+        if (inRule->fNumNames == theMaxNames)
+        {
+            theMaxNames = (theMaxNames == 0) ? 4 : theMaxNames * 2;
+            char** theNames = NEW char*[theMaxNames];
+            if (inRule->fNumNames > 0)
+                ::memcpy(theNames, inRule->fNames, sizeof(char*) * inRule->fNumNames);
+            delete [] inRule->fNames;
+            inRule->fNames = theNames;
+        }
+        inRule->fNames[inRule->fNumNames++] = word.GetAsCString();
+
+        inLineParser->ConsumeWhitespace();
+        inLineParser->ConsumeUntilWhitespace(&word);
+    }
+}
+
+Bool16 QTAccessPolicy::AccessAllowed(char* userName, char** groupArray, UInt32 numGroups, QTSS_ActionFlags inFlags, StrPtrLen* ioRealmNameStr)
+{
+    Bool16 haveUserName = (NULL != userName && 0 != userName[0]);
+    Bool16 haveGroups = (numGroups > 0 && groupArray != NULL);
+    Bool16 haveRealmResultBuffer = (ioRealmNameStr != NULL && ioRealmNameStr->Ptr != NULL && ioRealmNameStr->Len > 0);
+
+    if (haveRealmResultBuffer)
+        ioRealmNameStr->Ptr[0] = 0;
+
+    for (UInt32 x = 0; x < fNumRules; x++)
+    {
+        Rule* theRule = &fRules[x];
+        if (0 == (theRule->fLimit & inFlags))
+            continue; // ignore lines because inFlags doesn't match the current access state
+
+        switch (theRule->fType)
+        {
+            case kAuthName:
+            {
+                if (!haveRealmResultBuffer)
+                    break;
+
+                UInt32 theLen = ::strlen(theRule->fValue);
+                if (ioRealmNameStr->Len <= theLen) 
+                    theLen = ioRealmNameStr->Len -1; // just copy what we can
+                ::memcpy(ioRealmNameStr->Ptr, theRule->fValue, theLen);
+                ioRealmNameStr->Ptr[theLen] = 0; 
+                // we don't change the buffer len ioRealmNameStr->Len because we might have another AuthName tag to copy
+                break;
             }
-    
-            if (!haveUserName)
-                continue;
-                
-            if (word.Equal("user") )
-            {   
-                lineParser.ConsumeWhitespace();
-                lineParser.ConsumeUntilWhitespace(&word);   
-                    
-                while (word.Len != 0) // compare each word in the line
-                {   
-                    if ( word.Equal(userName) ) 
-                    {   return true; 
-                    }
-                    lineParser.ConsumeWhitespace();
-                    lineParser.ConsumeUntilWhitespace(&word);       
+
+            case kRequireValidUser:
+                if (haveUserName)
+                    return true;
+                break;
+
+            case kRequireAnyUser:
+                return true;
+
+            case kRequireUser:
+                if (!haveUserName)
+                    break;
+                for (UInt32 y = 0; y < theRule->fNumNames; y++)
+                {   if (::strcmp(theRule->fNames[y], userName) == 0)
+                        return true;
                 }
-                continue; // done with "require user" line
-            }
-            
-            if (haveGroups && word.Equal("group")) // check if we have groups for the user
-            {
-                lineParser.ConsumeWhitespace();
-                lineParser.ConsumeUntilWhitespace(&word);       
-                
-                while (word.Len != 0) // compare each word in the line
-                {   
-                    for (UInt32 index = 0; index < numGroups; index ++)
-                    {   if(word.Equal(groupArray[index])) 
+                break;
+
+            case kRequireGroup:
+                if (!haveUserName || !haveGroups)
+                    break;
+                for (UInt32 y = 0; y < theRule->fNumNames; y++)
+                {   for (UInt32 index = 0; index < numGroups; index ++)
+                    {   if ((groupArray[index] != NULL) && (::strcmp(theRule->fNames[y], groupArray[index]) == 0))
                             return true;
                     }
-                
-                    lineParser.ConsumeWhitespace();
-                    lineParser.ConsumeUntilWhitespace(&word);
                 }
-                continue; // done with "require group" line
-            }
-                    
-            continue; // done with unparsed "require" line
+                break;
         }
-        
     }
     
     return false; // user or group not found
 }
 
+QTSS_AuthScheme QTAccessPolicy::GetUsersAndGroupsFilesAndAuthScheme(QTSS_ActionFlags inAction, char** outUsersFilePath, char** outGroupsFilePath)
+{
+    QTSS_AuthScheme authScheme = qtssAuthNone;
+    *outUsersFilePath = NULL;
+    *outGroupsFilePath = NULL;
+
+    for (UInt32 x = 0; x < fNumRules; x++)
+    {
+        Rule* theRule = &fRules[x];
+        if (0 == (theRule->fLimit & inAction))
+            continue;
+
+        // The last one found takes precedence
+        if (theRule->fType == kAuthUserFile)
+        {   delete [] *outUsersFilePath;
+            *outUsersFilePath = ::strcpy(NEW char[::strlen(theRule->fValue) + 1], theRule->fValue);
+        }
+        else if (theRule->fType == kAuthGroupFile)
+        {   delete [] *outGroupsFilePath;
+            *outGroupsFilePath = ::strcpy(NEW char[::strlen(theRule->fValue) + 1], theRule->fValue);
+        }
+        else if (theRule->fType == kAuthScheme)
+            authScheme = theRule->fScheme;
+    }
+
+    return authScheme;
+}
+
+/*
+    An entry of sDirTable or sPolicyTable. The key is NEW'd with the entry.
+*/
+
+class QTAccessCacheEntry
+{
+    public:
+
+        QTAccessCacheEntry(StrPtrLen* inKey, char* inAccessFilePath, QTAccessPolicy* inPolicy)
+        :   fKey(NEW char[inKey->Len], inKey->Len),
+            fAccessFilePath(inAccessFilePath),
+            fPolicy(inPolicy)
+        {
+            ::memcpy(fKey.Ptr, inKey->Ptr, inKey->Len);
+            fRef.Set(fKey, this);
+        }
+
+        ~QTAccessCacheEntry()
+        {
+            delete [] fKey.Ptr;
+            delete [] fAccessFilePath;
+            delete fPolicy;
+        }
+
+        OSRef           fRef;
+        StrPtrLen       fKey;
+        char*           fAccessFilePath;    // NULL if the dir has none
+        QTAccessPolicy* fPolicy;
+};
+
+void QTAccessFile::Initialize() // called by server at initialize never call again
+{
+    if (NULL == sAccessFileMutex)
+    {   sAccessFileMutex = NEW OSMutex();
+        sDirTable = NEW OSRefTable();
+        sPolicyTable = NEW OSRefTable();
+#if defined(__linux__)
+        sInotifyFD = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        sWatches = NEW int[kMaxWatches];
+#endif
+    }
+}
+
+void QTAccessFile::SetAccessFileName(const char *inQTAccessFileName)
+{
+    OSMutexLocker locker(sAccessFileMutex);
+    if (NULL == inQTAccessFileName)
+    {   Assert(NULL != inQTAccessFileName);
+        return;
+    }
+    
+    if (sAllocatedName)
+    {   delete [] sQTAccessFileName;
+    }
+    
+    sAllocatedName = true;
+    sQTAccessFileName = NEW char[strlen(inQTAccessFileName)+1];
+    ::strcpy(sQTAccessFileName, inQTAccessFileName);
+    
+    QTAccessFile::FlushCache();
+}
+
+Bool16 QTAccessFile::WatchDir(const char* inDirPath)
+{
+#if defined(__linux__)
+    if ((sInotifyFD == -1) || (inDirPath[0] == '\0') || (sNumWatches == kMaxWatches))
+        return false;
+
+    int theWatch = ::inotify_add_watch(sInotifyFD, inDirPath, kWatchMask);
+    if (theWatch == -1)
+        return false;
+
+    // A dir watched again gives back the same descriptor
+    for (UInt32 x = 0; x < sNumWatches; x++)
+    {
+        if (sWatches[x] == theWatch)
+            return true;
+    }
+    sWatches[sNumWatches++] = theWatch;
+    return true;
+#else
+    return false;
+#endif
+}
+
+void QTAccessFile::CheckForChanges()
+{
+#if defined(__linux__)
+    if (sInotifyFD == -1)
+        return;
+
+    char theBuffer[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    Bool16 haveChange = false;
+    ssize_t theLen = 0;
+    while ((theLen = ::read(sInotifyFD, theBuffer, sizeof(theBuffer))) > 0)
+    {
+        for (char* thePtr = theBuffer; thePtr < theBuffer + theLen; )
+        {
+            struct inotify_event* theEvent = (struct inotify_event*)thePtr;
+            thePtr += sizeof(struct inotify_event) + theEvent->len;
+
+            // Files and dirs other than access files come and go in movie folders all the
+            // time. Only a dir looked in has cached answers, and it is watched itself, so
+            // its removal or renaming shows as an event without a name
+            if ((theEvent->len > 0) && (::strcmp(theEvent->name, sQTAccessFileName) != 0))
+                continue;
+            haveChange = true;
+        }
+    }
+
+    // Start over rather than stop caching once kMaxWatches dirs are watched
+    if (haveChange || (sNumWatches == kMaxWatches))
+        QTAccessFile::FlushCache();
+#endif
+}
+
+void QTAccessFile::FlushCache()
+{
+    OSRefTable* theTables[2] = { sDirTable, sPolicyTable };
+    for (UInt32 x = 0; x < 2; x++)
+    {
+        if (theTables[x] == NULL)
+            continue;
+
+        // UnRegister changes the table, so start a new iteration for each entry
+        while (true)
+        {
+            OSRefHashTableIter theIter(theTables[x]->GetHashTable());
+            if (theIter.IsDone())
+                break;
+            QTAccessCacheEntry* theEntry = (QTAccessCacheEntry*)theIter.GetCurrent()->GetObject();
+            theTables[x]->UnRegister(&theEntry->fRef);
+            delete theEntry;
+        }
+    }
+
+#if defined(__linux__)
+    if (sInotifyFD == -1)
+        return;
+
+    // Nothing is cached now, so the watches go too, and with them whatever
+    // is still queued, such as the IN_IGNORED of each watch removed
+    for (UInt32 x = 0; x < sNumWatches; x++)
+        (void)::inotify_rm_watch(sInotifyFD, sWatches[x]);
+    sNumWatches = 0;
+
+    char theBuffer[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    while (::read(sInotifyFD, theBuffer, sizeof(theBuffer)) > 0)
+        {}
+#endif
+}
+
+Bool16 QTAccessFile::AccessAllowed  (   char *userName, char**groupArray, UInt32 numGroups, StrPtrLen *accessFileBufPtr,
+                                        QTSS_ActionFlags inFlags,StrPtrLen* ioRealmNameStr 
+                                    )
+{       
+    if (NULL == accessFileBufPtr || NULL == accessFileBufPtr->Ptr || 0 == accessFileBufPtr->Len)
+        return false; // nothing to check
+
+    QTAccessPolicy thePolicy(accessFileBufPtr);
+    return thePolicy.AccessAllowed(userName, groupArray, numGroups, inFlags, ioRealmNameStr);
+}
+
 char*  QTAccessFile::GetAccessFile_Copy( const char* movieRootDir, const char* dirPath)
 {   
     OSMutexLocker locker(sAccessFileMutex);
+    return QTAccessFile::FindAccessFile(movieRootDir, dirPath);
+}
 
+char* QTAccessFile::FindAccessFile(const char* movieRootDir, const char* dirPath)
+{
     char* currentDir= NULL;
     char* lastSlash = NULL;
     int movieRootDirLen = ::strlen(movieRootDir);
@@ -246,7 +559,31 @@ char*  QTAccessFile::GetAccessFile_Copy( const char* movieRootDir, const char* d
     if (lastSlash != NULL)
         lastSlash[0] = '\0';
     
-    //check qtaccess files
+    // The answer depends on the movie root dir as well, which follows the dir and a 0 in the key
+    UInt32 theDirLen = ::strlen(currentDir);
+    OSCharArrayDeleter theKeyDeleter(NEW char[theDirLen + 1 + movieRootDirLen]);
+    StrPtrLen theKey(theKeyDeleter.GetObject(), theDirLen + 1 + movieRootDirLen);
+    ::memcpy(theKey.Ptr, currentDir, theDirLen + 1);
+    ::memcpy(theKey.Ptr + theDirLen + 1, movieRootDir, movieRootDirLen);
+
+    QTAccessFile::CheckForChanges();
+    if (sInotifyFD != -1)
+    {
+        OSRef* theRef = sDirTable->Resolve(&theKey);
+        if (theRef != NULL)
+        {
+            char* theAccessFilePath = ((QTAccessCacheEntry*)theRef->GetObject())->fAccessFilePath;
+            sDirTable->Release(theRef);
+            delete[] currentDir;
+            if (theAccessFilePath == NULL)
+                return NULL;
+            return ::strcpy(NEW char[::strlen(theAccessFilePath) + 1], theAccessFilePath);
+        }
+    }
+
+    //check qtaccess files, watching every dir looked in before looking
+    Bool16 isWatched = (sInotifyFD != -1);
+    char* theAccessFilePath = NULL;
     
     while ( true )  //walk backward up the dir tree.
     {
@@ -255,6 +592,9 @@ char*  QTAccessFile::GetAccessFile_Copy( const char* movieRootDir, const char* d
         if ( curLen >= maxLen )
             break;
     
+        if (isWatched)
+            isWatched = QTAccessFile::WatchDir(currentDir);
+
         ::strcat(currentDir, kPathDelimiterString);
         ::strcat(currentDir, sQTAccessFileName);
     
@@ -262,7 +602,8 @@ char*  QTAccessFile::GetAccessFile_Copy( const char* movieRootDir, const char* d
         if( QTSS_OpenFileObject(currentDir, qtssOpenFileNoFlags, &fileObject) == QTSS_NoErr) 
         {
             (void)QTSS_CloseFileObject(fileObject);
-            return currentDir;
+            theAccessFilePath = currentDir;
+            break;
         }
                 
         //strip off the "/qtaccess"
@@ -280,116 +621,81 @@ char*  QTAccessFile::GetAccessFile_Copy( const char* movieRootDir, const char* d
             break;
     }
     
-    delete[] currentDir;
-    return NULL;
+    if (isWatched)
+    {
+        char* theCachedPath = NULL;
+        if (theAccessFilePath != NULL)
+            theCachedPath = ::strcpy(NEW char[::strlen(theAccessFilePath) + 1], theAccessFilePath);
+
+        QTAccessCacheEntry* theEntry = NEW QTAccessCacheEntry(&theKey, theCachedPath, NULL);
+        OS_Error theErr = sDirTable->Register(&theEntry->fRef);
+        Assert(theErr == OS_NoErr);
+    }
+
+    if (theAccessFilePath == NULL)
+        delete[] currentDir;
+    return theAccessFilePath;
+}
+
+QTAccessPolicy* QTAccessFile::GetPolicy(const char* inAccessFilePath, Bool16* outIsCached)
+{
+    *outIsCached = false;
+    StrPtrLen thePath((char*)inAccessFilePath);
+
+    QTAccessFile::CheckForChanges();
+    if (sInotifyFD != -1)
+    {
+        OSRef* theRef = sPolicyTable->Resolve(&thePath);
+        if (theRef != NULL)
+        {
+            QTAccessPolicy* thePolicy = ((QTAccessCacheEntry*)theRef->GetObject())->fPolicy;
+            sPolicyTable->Release(theRef);
+            *outIsCached = true;
+            return thePolicy;
+        }
+    }
+
+    // Only files named like access files are looked for in the inotify events.
+    // Watch the dir before reading, so that no change is missed
+    Bool16 isWatched = false;
+    const char* theFileName = ::strrchr(inAccessFilePath, kPathDelimiterChar);
+    if ((sInotifyFD != -1) && (theFileName != NULL) && (::strcmp(theFileName + 1, sQTAccessFileName) == 0))
+    {
+        OSCharArrayDeleter theDir(::strcpy(NEW char[thePath.Len + 1], inAccessFilePath));
+        theDir.GetObject()[theFileName - inAccessFilePath] = '\0';
+        isWatched = QTAccessFile::WatchDir(theDir.GetObject());
+    }
+
+    StrPtrLen accessFileBuf;
+    (void)QTSSModuleUtils::ReadEntireFile((char*)inAccessFilePath, &accessFileBuf);
+    OSCharArrayDeleter accessFileBufDeleter(accessFileBuf.Ptr);
+    QTAccessPolicy* thePolicy = NEW QTAccessPolicy(&accessFileBuf);
+
+    if (isWatched)
+    {
+        QTAccessCacheEntry* theEntry = NEW QTAccessCacheEntry(&thePath, NULL, thePolicy);
+        OS_Error theErr = sPolicyTable->Register(&theEntry->fRef);
+        Assert(theErr == OS_NoErr);
+        *outIsCached = true;
+    }
+    return thePolicy;
 }
 
 // allocates memory for outUsersFilePath and outGroupsFilePath - remember to delete
 // returns the auth scheme
 QTSS_AuthScheme QTAccessFile::FindUsersAndGroupsFilesAndAuthScheme(char* inAccessFilePath, QTSS_ActionFlags inAction, char** outUsersFilePath, char** outGroupsFilePath)
 {
-    QTSS_AuthScheme authScheme = qtssAuthNone;
-    QTSS_ActionFlags currentFlags = qtssActionFlagsRead;
-    
     if (inAccessFilePath == NULL)
-    return authScheme;
-        
-    *outUsersFilePath = NULL;
-    *outGroupsFilePath = NULL;
-    //Assert(outUsersFilePath == NULL);
-    //Assert(outGroupsFilePath == NULL);
-    
-    StrPtrLen accessFileBuf;
-    (void)QTSSModuleUtils::ReadEntireFile(inAccessFilePath, &accessFileBuf);
-    OSCharArrayDeleter accessFileBufDeleter(accessFileBuf.Ptr);
-    
-    StringParser accessFileParser(&accessFileBuf);
-    StrPtrLen line;
-    StrPtrLen word;
-    
-    while( accessFileParser.GetDataRemaining() != 0 ) 
-    {
-    accessFileParser.GetThruEOL(&line);     // Read each line   
-    StringParser lineParser(&line);
-    lineParser.ConsumeWhitespace();         //skip over leading whitespace
-    if (lineParser.GetDataRemaining() == 0)     // must be an empty line
-        continue;
-
-    char firstChar = lineParser.PeekFast();
-    if ( (firstChar == '#') || (firstChar == '\0') )
-        continue;               //skip over comments and blank lines...
-        
-        lineParser.ConsumeUntilWhitespace(&word);
-               
-        if ( word.Equal("<Limit") ) // a limit line
-    {
-        currentFlags = qtssActionFlagsNoFlags; // clear to no access
-        lineParser.ConsumeWhitespace();
-        lineParser.ConsumeUntil( &word, sWhitespaceAndGreaterThanMask); // the flag <limit Read> or <limit Read >
-        while (word.Len != 0) // compare each word in the line
-        {   
-            if (word.Equal("WRITE")  ) 
-            {   
-               currentFlags |= inAction & qtssActionFlagsWrite; // accept following lines if inFlags has write
-            }
-                
-            if (word.Equal("READ") ) 
-            {   
-               currentFlags |= inAction & qtssActionFlagsRead; // accept following lines if inFlags has read
-            }
-                        
-            lineParser.ConsumeWhitespace();
-            lineParser.ConsumeUntil(&word, sWhitespaceAndGreaterThanMask);
-                }
-                continue; //done with limit line
-        }
+        return qtssAuthNone;
         
-        if ( word.Equal("</Limit>") )
-                currentFlags = qtssActionFlagsRead; // set the current access state to the default of read access
-        
-        if (0 == (currentFlags & inAction))
-            continue; // ignore lines because inFlags doesn't match the current access state
-            
-        if (word.Equal("AuthUserFile") )
-    {
-                lineParser.ConsumeWhitespace();
-                lineParser.GetThruEOL(&word);
-                StringParser::UnQuote(&word);// if the parsed string is surrounded by quotes then remove them.
-        
-                if(*outUsersFilePath != NULL)       // we are encountering the AuthUserFile keyword twice!
-                    delete[] *outUsersFilePath; // The last one found takes precedence...delete the previous path
-                
-                *outUsersFilePath = word.GetAsCString();
-        continue;
-        }
-        
-        if (word.Equal("AuthGroupFile") )
-        {
-            lineParser.ConsumeWhitespace();
-            lineParser.GetThruEOL(&word);
-            StringParser::UnQuote(&word);// if the parsed string is surrounded by quotes then remove them.
+    OSMutexLocker locker(sAccessFileMutex);
 
-            if(*outGroupsFilePath != NULL)      // we are encountering the AuthGroupFile keyword twice!
-                delete[] *outGroupsFilePath;    // The last one found takes precedence...delete the previous path       
-        *outGroupsFilePath = word.GetAsCString();
-        continue;
-        }
-        
-        if (word.Equal("AuthScheme") )
-        {
-            lineParser.ConsumeWhitespace();
-            lineParser.GetThruEOL(&word);
-            StringParser::UnQuote(&word);// if the parsed string is surrounded by quotes then remove them.
+    Bool16 isCached = false;
+    QTAccessPolicy* thePolicy = QTAccessFile::GetPolicy(inAccessFilePath, &isCached);
+    QTSS_AuthScheme authScheme = thePolicy->GetUsersAndGroupsFilesAndAuthScheme(inAction, outUsersFilePath, outGroupsFilePath);
+    if (!isCached)
+        delete thePolicy;
 
-            if (word.Equal("basic"))
-                authScheme = qtssAuthBasic;
-            else if (word.Equal("digest"))
-                authScheme = qtssAuthDigest;
-                
-            continue;
-        }
-    }
-    
     return authScheme;
 }
 
@@ -425,11 +731,13 @@ QTSS_Error QTAccessFile::AuthorizeRequest(QTSS_StandardRTSP_Params* inParams, Bo
     if (NULL == theUserProfile)
         return QTSS_RequestFailed;
 
-    char* accessFilePath = QTAccessFile::GetAccessFile_Copy(movieRootDirStr, pathBuffStr);
+    OSMutexLocker locker(sAccessFileMutex);
+    char* accessFilePath = QTAccessFile::FindAccessFile(movieRootDirStr, pathBuffStr);
     OSCharArrayDeleter accessFilePathDeleter(accessFilePath);
     
     if (NULL == accessFilePath) // we are done nothing to do
-    {   if (QTSS_NoErr != QTSS_SetValue(theRTSPRequest,qtssRTSPReqUserAllowed, 0, &allowNoAccessFiles, sizeof(allowNoAccessFiles)))
+    {   locker.Unlock();
+        if (QTSS_NoErr != QTSS_SetValue(theRTSPRequest,qtssRTSPReqUserAllowed, 0, &allowNoAccessFiles, sizeof(allowNoAccessFiles)))
             return QTSS_RequestFailed; // Bail on the request. The Server will handle the error
         return QTSS_NoErr;
     }
@@ -441,15 +749,16 @@ QTSS_Error QTAccessFile::AuthorizeRequest(QTSS_StandardRTSP_Params* inParams, Bo
     char** groupCharPtrArray =  QTSSModuleUtils::GetGroupsArray_Copy(theUserProfile, &numGroups);
     OSCharPointerArrayDeleter groupCharPtrArrayDeleter(groupCharPtrArray);
     
-    StrPtrLen accessFileBuf;
-    (void)QTSSModuleUtils::ReadEntireFile(accessFilePath, &accessFileBuf);
-    OSCharArrayDeleter accessFileBufDeleter(accessFileBuf.Ptr);
-        
     char realmName[kBuffLen] = { 0 };
     StrPtrLen   realmNameStr(realmName,kBuffLen -1);
     
     //check if this user is allowed to see this movie
-    Bool16 allowRequest = QTAccessFile::AccessAllowed(username, groupCharPtrArray, numGroups,  &accessFileBuf, authorizeAction,&realmNameStr);
+    Bool16 isCached = false;
+    QTAccessPolicy* thePolicy = QTAccessFile::GetPolicy(accessFilePath, &isCached);
+    Bool16 allowRequest = thePolicy->AccessAllowed(username, groupCharPtrArray, numGroups, authorizeAction, &realmNameStr);
+    if (!isCached)
+        delete thePolicy;
+    locker.Unlock();
     
     // Get the auth scheme
     QTSS_AuthScheme theAuthScheme = qtssAuthNone;
@@ -23,9 +23,11 @@ LastUpdate:  2010-08-16
 #include "StrPtrLen.h"
 #include "OSHeaders.h"
 #include "OSMutex.h"
+#include "OSRef.h"
 #include "QTSS.h"
 
 class OSMutex;
+class QTAccessPolicy;
 
 class QTAccessFile
 {
@@ -66,10 +68,30 @@ class QTAccessFile
 
     private:
 
+        enum
+        {
+            kMaxWatches = 1024  //UInt32, dirs under an inotify watch, the caches are emptied at this many
+        };
+
+        // Where the access file of a directory is, and each access file parsed,
+        // are cached until inotify reports a change under a directory looked at.
+        // Without inotify nothing is cached. Call with sAccessFileMutex held.
+        static char*            FindAccessFile(const char* movieRootDir, const char* dirPath);
+        static QTAccessPolicy*  GetPolicy(const char* inAccessFilePath, Bool16* outIsCached);
+        static Bool16           WatchDir(const char* inDirPath);
+        static void             CheckForChanges();
+        static void             FlushCache();
+
 		/* file name to access */
         static char* sQTAccessFileName; // managed by the QTAccess module
         static Bool16 sAllocatedName;
         static OSMutex* sAccessFileMutex;
+
+        static int          sInotifyFD;     // -1 if not caching
+        static int*         sWatches;       // watch descriptors, removed by FlushCache
+        static UInt32       sNumWatches;
+        static OSRefTable*  sDirTable;      // dir + movie root dir -> access file path
+        static OSRefTable*  sPolicyTable;   // access file path -> QTAccessPolicy
 };
 
 #endif //_QT_ACCESS_FILE_H_
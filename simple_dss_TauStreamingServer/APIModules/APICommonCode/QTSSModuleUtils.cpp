@@ -28,6 +28,8 @@ LastUpdate:  2010-08-16
 #include "StrPtrLen.h"
 #include "StringParser.h"
 #include "SafeStdLib.h"
+#include "UserAgentParser.h"
+#include "atomic.h"
 
 #include <netinet/in.h>
 
@@ -40,6 +42,7 @@ QTSS_StreamRef              QTSSModuleUtils::sErrorLog = NULL;
 
 Bool16                      QTSSModuleUtils::sEnableRTSPErrorMsg = false;/* òRTSP Error Message */
 QTSS_ErrorVerbosity         QTSSModuleUtils::sMissingPrefVerbosity = qtssMessageVerbosity;/* û÷ԤֵĴ־, used in QTSServerPrefs::RereadServerPreferences() */
+unsigned int                QTSSModuleUtils::sPlayerProfileID = 0;
 
 /* used in QTSServer::Initialize(),γʼ̬ݳԱ,˴Ϊ˱ڼ¼error log */
 void    QTSSModuleUtils::Initialize(QTSS_TextMessagesObject inMessages,
@@ -1191,30 +1194,32 @@ Bool16 QTSSModuleUtils::FindStringInAttributeList(QTSS_Object inObject, QTSS_Att
 Bool16 QTSSModuleUtils::HavePlayerProfile(QTSS_PrefsObject inPrefObjectToCheck, QTSS_StandardRTSP_Params* inParams, UInt32 feature)
 {
 	/* ȡRTP SessionеqtssCliSesFirstUserAgent */
-    StrPtrLenDel userAgentStr;    	
-    (void)QTSS_GetValueAsString(inParams->inClientSession, qtssCliSesFirstUserAgent, 0, &userAgentStr.Ptr);
-    userAgentStr.Set(userAgentStr.Ptr);//ҵԶɾ
+    StrPtrLen userAgentStr;
+    (void)QTSS_GetValuePtr(inParams->inClientSession, qtssCliSesFirstUserAgent, 0, (void**)&userAgentStr.Ptr, &userAgentStr.Len);
     
-	/* η(ֻ): */
-    switch (feature)
+    // Both player lists are checked the first time a User-Agent is seen, and
+    // the answers kept with it in the User-Agent cache until the prefs change
+    UInt32 theProfileID = sPlayerProfileID;
+    UInt32 theProfile = 0;
+    if (!UserAgentParser::GetProfile(&userAgentStr, inPrefObjectToCheck, theProfileID, &theProfile))
     {
-        case QTSSModuleUtils::kRequiresRTPInfoSeqAndTime:
-        {     
-			//name of player to match against the player's user agent header
-            return QTSSModuleUtils::FindStringInAttributeList(inPrefObjectToCheck,  qtssPrefsPlayersReqRTPHeader, &userAgentStr);
-
-        }
-        break;
+        //name of player to match against the player's user agent header
+        if (QTSSModuleUtils::FindStringInAttributeList(inPrefObjectToCheck, qtssPrefsPlayersReqRTPHeader, &userAgentStr))
+            theProfile |= 1 << QTSSModuleUtils::kRequiresRTPInfoSeqAndTime;
+        if (QTSSModuleUtils::FindStringInAttributeList(inPrefObjectToCheck, qtssPrefsPlayersReqBandAdjust, &userAgentStr))
+            theProfile |= 1 << QTSSModuleUtils::kAdjustBandwidth;
         
-        case QTSSModuleUtils::kAdjustBandwidth:
-        {
-			//name of player to match against the player's user agent header
-            return QTSSModuleUtils::FindStringInAttributeList(inPrefObjectToCheck,  qtssPrefsPlayersReqBandAdjust, &userAgentStr);
-        }
-        break;
+        UserAgentParser::SetProfile(&userAgentStr, inPrefObjectToCheck, theProfileID, theProfile);
     }
     
-    return false;
+    if (feature > QTSSModuleUtils::kAdjustBandwidth)
+        return false;
+    return (theProfile & (1 << feature)) != 0;
+}
+
+void QTSSModuleUtils::PrefsChanged()
+{
+    (void)atomic_add(&sPlayerProfileID, 1);
 }
 
 /****************** IPComponentStrĳԱ *************************/
@@ -227,6 +227,10 @@ class QTSSModuleUtils
 
         static Bool16 HavePlayerProfile(QTSS_PrefsObject inPrefObjectToCheck, QTSS_StandardRTSP_Params* inParams, UInt32 feature);
         
+        // A player's profile is worked out once per User-Agent and prefs object,
+        // and again after any prefs change. used in QTSSPrefs::PrefsChanged()
+        static void PrefsChanged();
+        
     private:
     
         //
@@ -240,6 +244,7 @@ class QTSSModuleUtils
         static QTSS_StreamRef           sErrorLog;//־	
         static Bool16                   sEnableRTSPErrorMsg;/* Enable to send RTSP Error Message? */
         static QTSS_ErrorVerbosity      sMissingPrefVerbosity;/* δ÷ԤֵĴ־ */
+        static unsigned int             sPlayerProfileID;/* goes up on each prefs change */
 };
 
 /* ǱȽIP address֮ϵ */
@@ -100,6 +100,29 @@ void QTSSRollingLog::WriteToLog(char* inLogData, Bool16 allowLogToRoll)
         this->CloseLog( false );
 }
 
+void QTSSRollingLog::WriteBinaryToLog(char* inLogData, UInt32 inLogDataLen, Bool16 allowLogToRoll)
+{
+    OSMutexLocker locker(&fMutex);
+    
+    if (fLogging == false)
+        return;
+     
+    if (sCloseOnWrite && fLog == NULL)
+        this->EnableLog(fAppendDotLog ); //re-open log file before we write
+    
+    if (allowLogToRoll)
+        (void)this->CheckRollLog();
+        
+    if ((fLog != NULL) && (inLogDataLen > 0))
+    {
+        (void)::fwrite(inLogData, 1, inLogDataLen, fLog);
+        ::fflush(fLog);
+    }
+    
+    if (sCloseOnWrite)
+        this->CloseLog( false );
+}
+
 /* ־ļ(ں.log),´־ļ,ٴøݳԱֵ */
 Bool16 QTSSRollingLog::RollLog()
 {
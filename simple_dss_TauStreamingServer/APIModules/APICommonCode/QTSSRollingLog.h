@@ -44,6 +44,10 @@ class QTSSRollingLog : public Task
         // Write a log message
 		/* ׷ӷʽ־ļ,Ƿ־? ַָʽ׷д־ļ,ر־ļ */
         void    WriteToLog(char* inLogData, Bool16 allowLogToRoll);
+
+        //
+        // Write a block of raw bytes, for logs that are not text (may contain '\0').
+        void    WriteBinaryToLog(char* inLogData, UInt32 inLogDataLen, Bool16 allowLogToRoll);
         
         //log rolls automatically based on the configuration criteria,
         //but you may roll the log manually by calling this function.
@@ -434,7 +434,15 @@ enum
     qtssRTPStrClientRTPPort         = 37,   //read      //UInt16            // Port the server is sending RTP packets to for this stream
     qtssRTPStrNetworkMode           = 38,   //read      //QTSS_RTPNetworkMode // unicast or multicast
 
-    qtssRTPStrNumParams             = 39
+    // Send timing statistics
+    qtssRTPStrLatePackets           = 39,   //read      //UInt32            // Number of RTP packets sent after their transmit time.
+    qtssRTPStrMaxLateMsec           = 40,   //read      //UInt32            // Largest lateness in msec of an RTP packet sent on this stream.
+    qtssRTPStrQualityLevelChanges   = 41,   //read      //UInt32            // Number of times the quality level (thinning) of this stream changed.
+    qtssRTPStrOverbufferBlocks      = 42,   //read      //UInt32            // Number of RTP writes refused with QTSS_WouldBlock because the overbuffer window was full.
+    qtssRTPStrFlowControlledPackets = 43,   //read      //UInt32            // Number of RTP packets that could not be sent because of TCP or reliable UDP flow control.
+    qtssRTPStrPacedBlocks           = 44,   //read      //UInt32            // Number of RTP writes refused with QTSS_WouldBlock to pace the stream, see enable_rtp_pacing.
+
+    qtssRTPStrNumParams             = 45
 
 };
 typedef UInt32 QTSS_RTPStreamAttributes;
@@ -639,7 +647,10 @@ enum
     qtssSvrServerPlatform           = 39,   //read      //char array //Platform (OS) of the server
     qtssSvrRTSPServerComment        = 40,   //read      //char array //RTSP comment for the server header    
     qtssSvrNumThinned               = 41,    //r/w      //SInt32    //Number of thinned sessions
-    qtssSvrNumParams                = 42
+    qtssSvrRTSPStateLatency         = 42,    //read     //char array //Latency histograms (in microseconds) of the RTSP request states, one "<state> count= total= avg= p50= p90= p99= p999= max=" line per state
+    qtssSvrModuleRoleLatency        = 43,    //read     //char array //Latency histograms (in microseconds) of every module role invocation, lines are named "<module>/<role>"
+    qtssSvrRTPSendStats             = 44,    //read     //char array //RTP send timing: lateness (msec) and overbuffer window occupancy (bytes) histograms, then a line of thinning / flow control counters
+    qtssSvrNumParams                = 45
 };
 typedef UInt32 QTSS_ServerAttributes;
 
@@ -737,7 +748,15 @@ enum
     qtssPrefsDisableThinning                = 69,   // "disable_thinning" //Bool16 // Usually used for performance testing. Turn off stream thinning from packet loss or stream lateness.
     qtssPrefsPlayersReqRTPHeader            = 70,   // "players_requires_rtp_header_info" //Char array //name of player to match against the player's user agent header
     qtssPrefsPlayersReqBandAdjust           = 71,   // "players_requires_bandwidth_adjustment //Char array //name of player to match against the player's user agent header
-    qtssPrefsNumParams                      = 72
+    qtssPrefsStatsSharedMemoryFile          = 72,   // "stats_shared_memory_file" //Char array //path of the memory mapped live stats block read by ServerStatsReader, empty to disable
+    qtssPrefsTraceLevels                    = 73,   // "trace_levels" //Char array //runtime trace levels per subsystem, e.g. "all=warning,rtsp=debug" (see OSTrace.h)
+    qtssPrefsReliableUDPCongestionControl   = 74,   // "reliable_udp_congestion_control" //Char array //"reno", "ledbat" or "bbr", read when a session is created
+    qtssPrefsEnableRTPPacing                = 75,   // "enable_rtp_pacing" //Bool16 //spread each UDP stream's packets out at a little above its media rate
+    qtssPrefsRTPPacingUseTxTime             = 76,   // "rtp_pacing_use_txtime" //Bool16 //leave short pacing waits to the kernel with SO_TXTIME (Linux, needs the fq qdisc)
+    qtssPrefsEnableRTPSessionGroups         = 77,   // "enable_rtp_session_groups" //Bool16 //send the packets of many sessions from one Task per thread, see RTPSessionGroup
+    qtssPrefsInterleavedSendQueueBytes      = 78,   // "interleaved_send_queue_bytes" //UInt32 //bytes of interleaved RTP a TCP client may have queued on its RTSP connection, 0 drops packets the socket does not take
+    qtssPrefsRTPSocketPairsPerAddress       = 79,   // "rtp_socket_pairs_per_address" //UInt32 //RTP/RTCP socket pairs opened on each local address at startup, that unicast streams are spread over
+    qtssPrefsNumParams                      = 80
 };
 
 typedef UInt32 QTSS_PrefsAttributes;
@@ -1075,6 +1094,7 @@ typedef struct
     QTSS_RTPStreamObject        inRTPStream;
     void*                       inRTCPPacketData;
     UInt32                      inRTCPPacketDataLen;
+    void*                       inRTCPSummary;      //RTCPCompoundSummary* of inRTCPPacketData, see RTCPCompoundParser.h
 } QTSS_RTCPProcess_Params;
 
 typedef struct
@@ -1226,6 +1246,31 @@ time_t  QTSS_MilliSecsTo1970Secs(QTSS_TimeVal inQTSS_MilliSeconds);
 //              QTSS_BadArgument:   Registering for a nonexistent role.
 QTSS_Error QTSS_AddRole(QTSS_Role inRole);
 
+/********************************************************************/
+//  QTSS_AddRoleMethod, QTSS_AddRoleURLPrefix
+//
+//  Only available from QTSS_Register role, after QTSS_AddRole for inRole.
+//  They narrow down the requests a module is invoked for in one of the roles
+//  given an RTSP request: QTSS_RTSPFilter_Role, QTSS_RTSPRoute_Role,
+//  QTSS_RTSPAuthenticate_Role, QTSS_RTSPAuthorize_Role,
+//  QTSS_RTSPPreProcessor_Role, QTSS_RTSPRequest_Role and
+//  QTSS_RTSPPostProcessor_Role. Once a module adds a method for a role, it
+//  is only invoked in that role for requests with one of the methods it added.
+//  Once it adds a URL prefix, only for requests whose path begins with one of
+//  the prefixes it added. The path is qtssRTSPReqFilePath, or for the filter
+//  role, which runs before the request is parsed, the path of the request line
+//  decoded the same way. In the roles that invoke a single module
+//  (QTSS_RTSPAuthenticate_Role, QTSS_RTSPRequest_Role) the first module that
+//  takes the request is invoked. A request that is not a known RTSP method (such as an HTTP GET) only
+//  matches modules that added no method.
+//
+//  Returns:    QTSS_NoErr
+//              QTSS_OutOfState: If this function isn't being called from the Register role
+//              QTSS_BadArgument:   inRole is not one of the roles above or was not added,
+//                                  or inMethod or inURLPrefix is invalid.
+QTSS_Error QTSS_AddRoleMethod(QTSS_Role inRole, QTSS_RTSPMethod inMethod);
+QTSS_Error QTSS_AddRoleURLPrefix(QTSS_Role inRole, const char* inURLPrefix);
+
 
 /*****************************************/
 //  OBJECT CALLBACKS ROUTINES
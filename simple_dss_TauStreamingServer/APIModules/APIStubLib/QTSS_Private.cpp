@@ -86,6 +86,16 @@ QTSS_Error  QTSS_AddRole(QTSS_Role inRole) //
     return (sCallbacks->addr [kAddRoleCallback]) (inRole);  //ָ
 }
 
+QTSS_Error  QTSS_AddRoleMethod(QTSS_Role inRole, QTSS_RTSPMethod inMethod)
+{
+    return (sCallbacks->addr [kAddRoleMethodCallback]) (inRole, inMethod);
+}
+
+QTSS_Error  QTSS_AddRoleURLPrefix(QTSS_Role inRole, const char* inURLPrefix)
+{
+    return (sCallbacks->addr [kAddRoleURLPrefixCallback]) (inRole, inURLPrefix);
+}
+
 // DICTIONARY ROUTINES 
 //QTSS OBJECT CALLBACK ROUNTINES
 
@@ -103,7 +103,9 @@ enum
     kSetIntervalRoleTimerCallback   = 58,
     kLockStdLibCallback             = 59,
     kUnlockStdLibCallback           = 60,
-    kLastCallback                   = 61
+    kAddRoleMethodCallback          = 61,
+    kAddRoleURLPrefixCallback       = 62,
+    kLastCallback                   = 63
 };
 
 typedef struct {
@@ -0,0 +1,252 @@
+/***************************************************************************
+
+Copyright (c) 2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 QTSSAccessLogFormat.h
+Description: Compact binary access log format shared by QTSSAccessLogModule
+             (writer) and AccessLogConverter (reader).
+Comment:
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-19
+LastUpdate:  2026-10-19
+
+****************************************************************************/
+
+/*
+    File layout:
+
+    #Log File Created On: mm/dd/YYYY HH:MM:SS\n    (QTSSRollingLog header, used for time based rolling)
+    record record record ...
+
+    Every record is   UInt8 type | varint payload length | payload
+    so a reader can skip record types it does not know about.
+
+    Integers are either fixed width (big endian) or unsigned LEB128 varints.
+    Strings (URLs, user agents, addresses...) are never written inline in a
+    session record. They are interned: the first time a string is used a
+    kStringDef record assigns it an ID, later records refer to it by ID.
+    ID 0 always means "no value" and is printed as "-". A kStringReset record
+    discards every ID defined so far. A new log file starts with a
+    kStringDef record for every string that is still interned, so each file
+    can be decoded on its own.
+*/
+
+#ifndef _QTSSACCESSLOGFORMAT_H_
+#define _QTSSACCESSLOGFORMAT_H_
+
+#include "OSHeaders.h"
+#include "StringFormatter.h"
+
+class QTSSAccessLogFormat
+{
+    public:
+
+        enum
+        {
+            kVersion                = 1,    //UInt8
+            kMaxStringLen           = 255,  //UInt32, longer strings are truncated before interning
+            kMaxVarIntLen           = 10    //UInt32, bytes needed for a 64 bit varint
+        };
+
+        // record types
+        enum
+        {
+            kFileHeader     = 1,    // char[4] magic, UInt8 version, UInt8 flags, UInt32 time, varint-len server name, varint-len version
+            kStringDef      = 2,    // varint ID, string bytes
+            kStringReset    = 3,    // empty
+            kSessionRecord  = 4,    // see below
+            kRemark         = 5     // UInt32 time, UInt8 remark kind
+        };
+
+        // kFileHeader flags
+        enum
+        {
+            kLogTimeInGMTFlag = 0x01
+        };
+
+        // kRemark kinds
+        enum
+        {
+            kRemarkStartup  = 1,
+            kRemarkShutdown = 2
+        };
+
+        // transport field of kSessionRecord
+        enum
+        {
+            kTransportUnknown   = 0,
+            kTransportUDP       = 1,
+            kTransportTCP       = 2
+        };
+
+        //
+        // kSessionRecord payload, in this order. "id" fields are string IDs.
+        //
+        //  UInt32  date time (seconds since 1970)
+        //  varint  c-ip (id)                   varint  c-dns (id)
+        //  varint  cs-uri-stem (id)            varint  c-starttime
+        //  varint  x-duration                  varint  c-status
+        //  varint  cs(User-Agent) (id)         varint  filelength (secs)
+        //  varint  filesize                    varint  avgbandwidth
+        //  UInt8   transport                   varint  audiocodec (id)
+        //  varint  videocodec (id)             varint  sc-bytes
+        //  varint  cs-bytes                    varint  c-bytes
+        //  varint  s-pkts-sent                 varint  c-pkts-received
+        //  varint  c-pkts-lost-client          varint  c-totalbuffertime
+        //  varint  c-quality                   varint  s-ip (id)
+        //  varint  s-dns (id)                  varint  s-totalclients
+        //  varint  s-cpu-util                  varint  cs-uri-query (id)
+        //  varint  c-username (id)             varint  sc(Realm) (id)
+        //
+        // c-playerid is the client address, the player fields are parsed out
+        // of the user agent and c-rate, protocol and c-buffercount are constant,
+        // so none of them are stored.
+
+        static const char* GetMagic() { return "QTAL"; }
+};
+
+// Appends binary log primitives to a buffer. Like StringFormatter, no
+// bounds checking beyond truncation is done, size the buffer accordingly.
+class QTSSBinaryLogFormatter : public StringFormatter
+{
+    public:
+
+        QTSSBinaryLogFormatter(char *buffer, UInt32 length) : StringFormatter(buffer, length) {}
+        virtual ~QTSSBinaryLogFormatter() {}
+
+        void    PutUInt8(UInt8 inValue)     { PutChar((char)inValue); }
+        inline void PutUInt32(UInt32 inValue);
+        inline void PutVarInt(UInt64 inValue);
+
+        // Writes type, payload length and payload as one record
+        inline void PutRecord(UInt8 inType, char* inPayload, UInt32 inPayloadLen);
+
+        static inline UInt32 GetVarIntLen(UInt64 inValue);
+};
+
+inline void QTSSBinaryLogFormatter::PutUInt32(UInt32 inValue)
+{
+    char theBytes[4];
+    theBytes[0] = (char)((inValue >> 24) & 0xFF);
+    theBytes[1] = (char)((inValue >> 16) & 0xFF);
+    theBytes[2] = (char)((inValue >> 8) & 0xFF);
+    theBytes[3] = (char)(inValue & 0xFF);
+    Put(theBytes, 4);
+}
+
+inline void QTSSBinaryLogFormatter::PutVarInt(UInt64 inValue)
+{
+    char theBytes[QTSSAccessLogFormat::kMaxVarIntLen];
+    UInt32 theLen = 0;
+    do
+    {
+        UInt8 theByte = (UInt8)(inValue & 0x7F);
+        inValue >>= 7;
+        if (inValue != 0)
+            theByte |= 0x80;
+        theBytes[theLen++] = (char)theByte;
+    } while (inValue != 0);
+
+    Put(theBytes, theLen);
+}
+
+inline void QTSSBinaryLogFormatter::PutRecord(UInt8 inType, char* inPayload, UInt32 inPayloadLen)
+{
+    PutUInt8(inType);
+    PutVarInt(inPayloadLen);
+    if (inPayloadLen > 0)
+        Put(inPayload, inPayloadLen);
+}
+
+inline UInt32 QTSSBinaryLogFormatter::GetVarIntLen(UInt64 inValue)
+{
+    UInt32 theLen = 1;
+    while (inValue >= 0x80)
+    {
+        inValue >>= 7;
+        theLen++;
+    }
+    return theLen;
+}
+
+// Reads binary log primitives out of a buffer. Every getter returns false
+// once the buffer is exhausted or the data is malformed.
+class QTSSBinaryLogParser
+{
+    public:
+
+        QTSSBinaryLogParser(char* inBuffer, UInt32 inLength) : fStart((UInt8*)inBuffer), fEnd((UInt8*)inBuffer + inLength) {}
+
+        UInt32  GetDataRemaining()  { return (UInt32)(fEnd - fStart); }
+        char*   GetCurrentPtr()     { return (char*)fStart; }
+
+        Bool16  GetUInt8(UInt8* outValue)
+        {
+            if (fStart >= fEnd)
+                return false;
+            *outValue = *fStart++;
+            return true;
+        }
+
+        Bool16  GetUInt32(UInt32* outValue)
+        {
+            if (this->GetDataRemaining() < 4)
+                return false;
+            *outValue = ((UInt32)fStart[0] << 24) | ((UInt32)fStart[1] << 16) | ((UInt32)fStart[2] << 8) | (UInt32)fStart[3];
+            fStart += 4;
+            return true;
+        }
+
+        Bool16  GetVarInt(UInt64* outValue)
+        {
+            UInt64 theValue = 0;
+            for (UInt32 theShift = 0; (fStart < fEnd) && (theShift < 64); theShift += 7)
+            {
+                UInt8 theByte = *fStart++;
+                theValue |= ((UInt64)(theByte & 0x7F)) << theShift;
+                if ((theByte & 0x80) == 0)
+                {
+                    *outValue = theValue;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // Fails (bad record) if the value doesn't fit in 32 bits
+        Bool16  GetVarInt(UInt32* outValue)
+        {
+            UInt64 theValue = 0;
+            if (!this->GetVarInt(&theValue) || (theValue > 0xFFFFFFFFULL))
+                return false;
+            *outValue = (UInt32)theValue;
+            return true;
+        }
+
+        // Points outBytes at the next inLength bytes
+        Bool16  GetBytes(StrPtrLen* outBytes, UInt32 inLength)
+        {
+            if (this->GetDataRemaining() < inLength)
+                return false;
+            outBytes->Set((char*)fStart, inLength);
+            fStart += inLength;
+            return true;
+        }
+
+        // Reads a record header and points outPayload at the record's payload
+        Bool16  GetRecord(UInt8* outType, StrPtrLen* outPayload)
+        {
+            UInt32 theLen = 0;
+            if (!this->GetUInt8(outType) || !this->GetVarInt(&theLen))
+                return false;
+            return this->GetBytes(outPayload, theLen);
+        }
+
+    private:
+
+        UInt8*  fStart;
+        UInt8*  fEnd;
+};
+
+#endif //_QTSSACCESSLOGFORMAT_H_
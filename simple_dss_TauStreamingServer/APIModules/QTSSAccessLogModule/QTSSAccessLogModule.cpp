@@ -27,6 +27,9 @@ LastUpdate:  2010-08-18
 #include "StrPtrLen.h"
 #include "UserAgentParser.h"
 #include "Task.h"
+#include "OSHashTable.h"
+#include "OSArrayObjectDeleter.h"
+#include "QTSSAccessLogFormat.h"
 
 #define TESTUNIXTIME 0
 
@@ -43,6 +46,9 @@ static QTSS_PrefsObject     sServerPrefs = NULL;
  
 static UInt32   sDefaultMaxLogBytes         = 10240000;
 static UInt32   sDefaultRollInterval        = 7;
+static char*    sDefaultLogFormat           = "text";
+static char*    sBinaryLogFormat            = "binary";
+static char*    sBinaryLogSuffix            = ".bin";
 static char*    sVoidField                  = "-";
 static Bool16   sStartedUp                  = false;
 static Bool16   sDefaultLogTimeInGMT        = true;//ĬʱGTMʱ
@@ -54,6 +60,7 @@ static Bool16   sLogEnabled     = true;
 static UInt32   sMaxLogBytes        = 51200000;
 static UInt32   sRollInterval       = 7;
 static Bool16   sLogTimeInGMT       = true;
+static Bool16   sLogBinary          = false;
 
 static OSMutex*             sLogMutex   = NULL;//Log module isn't reentrant
 static QTSSAccessLog*       sAccessLog  = NULL;
@@ -61,6 +68,9 @@ static QTSS_ServerObject    sServer     = NULL;
 static QTSS_ModulePrefsObject sPrefs   	= NULL;
 static LogCheckTask* sLogCheckTask = NULL;
 
+class AccessLogStringTable;
+static AccessLogStringTable* sStringTable = NULL;
+
 // This header conforms to the W3C "Extended Log File Format". 
 // (See "http://www.w3.org/TR/WD-logfile.html" for details.)
 // The final remark filed of the log header tells us if the logged times are in GMT or in system local time.
@@ -94,15 +104,109 @@ class QTSSAccessLog : public QTSSRollingLog
 {
     public:
     
-        QTSSAccessLog() : QTSSRollingLog() { this->SetTaskName("QTSSAccessLog");  }
+        QTSSAccessLog(Bool16 isBinary) : QTSSRollingLog(), fIsBinary(isBinary) { this->SetTaskName("QTSSAccessLog");  }
         virtual ~QTSSAccessLog() {}
     
-        virtual char* GetLogName() { return QTSSModuleUtils::GetStringAttribute(sPrefs, "request_logfile_name", sDefaultLogName); }
+        virtual char* GetLogName();
         virtual char* GetLogDir()  { return QTSSModuleUtils::GetStringAttribute(sPrefs, "request_logfile_dir", sDefaultLogDir); }
         virtual UInt32 GetRollIntervalInDays()  { return sRollInterval; }
         virtual UInt32 GetMaxLogBytes()         { return sMaxLogBytes; }
         virtual time_t WriteLogHeader(FILE *inFile);
+        
+        // binary logs use the QTSSAccessLogFormat.h records instead of W3C text lines
+        Bool16 IsBinary() { return fIsBinary; }
+        
+    private:
+    
+        Bool16 fIsBinary;
+};
+
+// An interned string of the binary log, see QTSSAccessLogFormat.h
+class AccessLogString
+{
+    public:
+    
+        AccessLogString(StrPtrLen* inString, UInt32 inHashValue, UInt32 inID)
+            : fString(inString->GetAsCString(), inString->Len), fHashValue(inHashValue), fID(inID), fNextHashEntry(NULL) {}
+        ~AccessLogString() { delete [] fString.Ptr; }
+        
+        StrPtrLen           fString;
+        UInt32              fHashValue;
+        UInt32              fID;
+        AccessLogString*    fNextHashEntry;
+};
+
+class AccessLogStringKey
+{
+    public:
+    
+        AccessLogStringKey(StrPtrLen* inString) : fStringP(inString), fHashValue(HashString(inString)) {}
+        AccessLogStringKey(AccessLogString* inElem) : fStringP(&inElem->fString), fHashValue(inElem->fHashValue) {}
+        ~AccessLogStringKey() {}
+        
+        UInt32 GetHashKey() { return fHashValue; }
+        
+        friend int operator ==(const AccessLogStringKey &key1, const AccessLogStringKey &key2)
+        {
+            return key1.fStringP->Equal(*key2.fStringP);
+        }
+        
+        static UInt32 HashString(StrPtrLen* inString)
+        {
+            UInt8* theData = (UInt8*)inString->Ptr;
+            UInt32 theHash = inString->Len;
+            for (UInt32 x = 0; x < inString->Len; x++)
+                theHash = (theHash * 31) + theData[x];
+            return theHash;
+        }
+        
+    private:
+    
+        StrPtrLen*  fStringP;
+        UInt32      fHashValue;
+};
+
+typedef OSHashTable<AccessLogString, AccessLogStringKey> AccessLogStringHashTable;
+
+// Maps the URLs, user agents, addresses... of the binary log to small IDs so each
+// distinct string is written once per log file. Bounded: when full it is cleared
+// and a kStringReset record tells readers to forget the old IDs.
+class AccessLogStringTable
+{
+    public:
+    
+        enum
+        {
+            kTableSize              = 1024, //UInt32
+            kMaxStrings             = 4096, //UInt32
+            kMaxStringsPerRecord    = 16    //UInt32
+        };
+        
+        AccessLogStringTable() : fTable(kTableSize), fNextID(1) {}
+        ~AccessLogStringTable() { this->Clear(); }
+        
+        // Call before interning the strings of one record. Makes sure all of them fit,
+        // clearing the table (and writing a kStringReset record to ioDefs) if they don't.
+        void    BeginRecord(QTSSBinaryLogFormatter* ioDefs);
+        
+        // Returns the ID of inString, writing a kStringDef record to ioDefs if the
+        // string is new. Empty strings are always ID 0.
+        UInt32  Intern(StrPtrLen* inString, QTSSBinaryLogFormatter* ioDefs);
+        
+        // kStringDef records for every interned string, written at the top of each new
+        // log file. Caller must delete [] the result.
+        char*   GetDefinitions(UInt32* outLen);
+        
+    private:
     
+        void    Clear();
+        static void PutDefinition(AccessLogString* inString, QTSSBinaryLogFormatter* ioDefs);
+        
+        // LogRequest is serialized by sLogMutex, but log rolling (and so GetDefinitions)
+        // also runs from the QTSSRollingLog task
+        OSMutex                     fMutex;
+        AccessLogStringHashTable    fTable;
+        UInt32                      fNextID;
 };
 
 // FUNCTION PROTOTYPES
@@ -119,6 +223,12 @@ static QTSS_Error   LogRequest( QTSS_ClientSessionObject inClientSession,
 static void             CheckAccessLogState(Bool16 forceEnabled);
 static QTSS_Error   RollAccessLog(QTSS_ServiceFunctionArgsPtr inArgs);
 static void         ReplaceSpaces(StrPtrLen *sourcePtr, StrPtrLen *destPtr, char *replaceStr);
+static QTSS_Error   LogBinaryRequest(QTSS_ClientSessionObject inClientSession, QTSS_CliSesClosingReason *inCloseReasonPtr);
+static void         GetStreamStats( QTSS_ClientSessionObject inClientSession, StrPtrLen* ioVideoPayloadName, StrPtrLen* ioAudioPayloadName,
+                                    StrPtrLen** outTransportType, UInt32* outPacketsReceived, UInt32* outPacketsLost, UInt32* outBufferTime);
+static UInt32*      GetLogStatusCode(QTSS_ClientSessionObject inClientSession, QTSS_CliSesClosingReason *inCloseReasonPtr);
+static UInt32       GetQualityLevel(UInt32* inPacketsSent, UInt32 inPacketsReceived, UInt32 inPacketsLost);
+static void         WriteBinaryRemark(UInt8 inRemarkKind);
 
 static QTSS_Error   StateChange(QTSS_StateChange_Params* stateChangeParams);
 static void         WriteStartupMessage();
@@ -157,6 +267,7 @@ QTSS_Error QTSSAccessLogModuleDispatch(QTSS_Role inRole, QTSS_RoleParamPtr inPar
 QTSS_Error Register(QTSS_Register_Params* inParams)
 {
     sLogMutex = NEW OSMutex();
+    sStringTable = NEW AccessLogStringTable();
     
     // Do role & service setup
     
@@ -210,6 +321,10 @@ QTSS_Error RereadPrefs()
     QTSSModuleUtils::GetAttribute(sPrefs, "request_logtime_in_gmt",     qtssAttrDataTypeBool16,
                                 &sLogTimeInGMT, &sDefaultLogTimeInGMT, sizeof(sLogTimeInGMT));
 
+    OSCharArrayDeleter theLogFormat(QTSSModuleUtils::GetStringAttribute(sPrefs, "request_logfile_format", sDefaultLogFormat));
+    sLogBinary = (::strcmp(theLogFormat.GetObject(), sBinaryLogFormat) == 0);
+
+    OSMutexLocker locker(sLogMutex);
     CheckAccessLogState(false);
 
     return QTSS_NoErr;
@@ -345,8 +460,6 @@ QTSS_Error LogRequest( QTSS_ClientSessionObject inClientSession,
                             QTSS_RTSPSessionObject inRTSPSession, QTSS_CliSesClosingReason *inCloseReasonPtr)
 {
     static StrPtrLen sUnknownStr(sVoidField);
-    static StrPtrLen sTCPStr("TCP");
-    static StrPtrLen sUDPStr("UDP");
     
     //Fetch the URL, user agent, movielength & movie bytes to log out of the RTP session
     enum {  
@@ -381,6 +494,9 @@ QTSS_Error LogRequest( QTSS_ClientSessionObject inClientSession,
     CheckAccessLogState(false);
     if (sAccessLog == NULL)
         return QTSS_NoErr;
+    
+    if (sAccessLog->IsBinary())
+        return LogBinaryRequest(inClientSession, inCloseReasonPtr);
         
     //if logging is on, then log the request... first construct a timestamp
     char theDateBuffer[QTSSRollingLog::kMaxDateBufferSizeInBytes];
@@ -530,134 +646,16 @@ QTSS_Error LogRequest( QTSS_ClientSessionObject inClientSession,
 
     UInt32 qualityLevel = 0;
     UInt32 clientBufferTime = 0;
-    UInt32 theStreamIndex = 0;
-    Bool16* isTCPPtr = NULL;
-    QTSS_RTPStreamObject theRTPStreamObject = NULL;
     
-    for (   UInt32 theStreamObjectLen = sizeof(theRTPStreamObject);
-            QTSS_GetValue(inClientSession, qtssCliSesStreamObjects, theStreamIndex, (void*)&theRTPStreamObject, &theStreamObjectLen) == QTSS_NoErr;
-            theStreamIndex++, theStreamObjectLen = sizeof(theRTPStreamObject))
-    {
-        
-        UInt32* streamPacketsReceived = NULL;
-        UInt32* streamPacketsLost = NULL;
-        (void)QTSS_GetValuePtr(theRTPStreamObject, qtssRTPStrTotPacketsRecv, 0, (void**)&streamPacketsReceived, &theLen);
-        (void)QTSS_GetValuePtr(theRTPStreamObject, qtssRTPStrTotalLostPackets, 0, (void**)&streamPacketsLost, &theLen);
-        
-        // Add up packets received and packets lost to come up with a session wide total
-        if (streamPacketsReceived != NULL)
-            clientPacketsReceived += *streamPacketsReceived;
-        if (streamPacketsLost != NULL)
-            clientPacketsLost += *streamPacketsLost;
-        
-        // Identify the video and audio codec types
-        QTSS_RTPPayloadType* thePayloadType = NULL;
-        (void)QTSS_GetValuePtr(theRTPStreamObject, qtssRTPStrPayloadType, 0, (void**)&thePayloadType, &theLen);
-        if (thePayloadType != NULL)
-        {
-            if (*thePayloadType == qtssVideoPayloadType)
-                (void)QTSS_GetValue(theRTPStreamObject, qtssRTPStrPayloadName, 0, videoPayloadName.Ptr, &videoPayloadName.Len);
-            else if (*thePayloadType == qtssAudioPayloadType)   
-                (void)QTSS_GetValue(theRTPStreamObject, qtssRTPStrPayloadName, 0, audioPayloadName.Ptr, &audioPayloadName.Len);
-        }
-        
-        // If any one of the streams is being delivered over UDP instead of TCP,
-        // report in the log that the transport type for this session was UDP.
-        if (isTCPPtr == NULL)
-        {   
-            (void)QTSS_GetValuePtr(theRTPStreamObject, qtssRTPStrIsTCP, 0, (void**)&isTCPPtr, &theLen);
-            if (isTCPPtr != NULL)
-            {   if (*isTCPPtr == false)
-                    theTransportType = &sUDPStr;
-                else
-                    theTransportType = &sTCPStr;
-            }
-        }
-        
-        Float32* clientBufferTimePtr = NULL;
-        (void)QTSS_GetValuePtr(theRTPStreamObject, qtssRTPStrBufferDelayInSecs, 0, (void**)&clientBufferTimePtr, &theLen);
-        if  ( (clientBufferTimePtr != NULL) && (*clientBufferTimePtr != 0) )
-        {   if ( *clientBufferTimePtr  > clientBufferTime)
-                clientBufferTime = (UInt32) (*clientBufferTimePtr + .5); // round up to full seconds
-        }
-        
-    }
+    GetStreamStats(inClientSession, &videoPayloadName, &audioPayloadName, &theTransportType,
+                    &clientPacketsReceived, &clientPacketsLost, &clientBufferTime);
     
     // Add the client buffer time to our client start latency (in whole seconds).
     startPlayTimeInSecs += clientBufferTime;
 
-    if (*rtpPacketsSent == 0) // no packets sent
-        qualityLevel = 0; // no quality
-    else
-    {
-        if ( (clientPacketsReceived == 0) && (clientPacketsLost == 0) ) // no info from client 
-            qualityLevel = 100; //so assume 100
-        else
-        {   
-            float qualityPercent =  (float) clientPacketsReceived / (float) (clientPacketsReceived + clientPacketsLost);
-            qualityPercent += (float).005; // round up
-            qualityLevel = (UInt32) ( (float) 100.0 * qualityPercent); // average of sum of packet counts for all streams
-        }
-    }
+    qualityLevel = GetQualityLevel(rtpPacketsSent, clientPacketsReceived, clientPacketsLost);
     
-    //we may not have an RTSP request. Assume that the status code is 504 timeout, if there is an RTSP
-    //request, though, we can find out what the real status code of the response is
-    static UInt32 sTimeoutCode = 504;   
-    UInt32* theStatusCode = &sTimeoutCode;
-    theLen = sizeof(UInt32);
-    (void)QTSS_GetValuePtr(inClientSession, qtssCliRTSPReqRealStatusCode, 0, (void **) &theStatusCode, &theLen);
-//  qtss_printf("qtssCliRTSPReqRealStatusCode = %lu \n", *theStatusCode);
-        
-    
-    if (inCloseReasonPtr) do
-    {
-        if (*theStatusCode < 300) // it was a succesful RTSP request but...
-        {   
-            if (*inCloseReasonPtr == qtssCliSesCloseTimeout) // there was a timeout
-            {   
-                    *theStatusCode = sTimeoutCode;
-//                  qtss_printf(" log timeout ");
-                    break;
-            }
-
-            if (*inCloseReasonPtr == qtssCliSesCloseClientTeardown) // there was a teardown
-            {
-            
-                static QTSS_CliSesClosingReason sReason = qtssCliSesCloseClientTeardown;
-                QTSS_CliSesClosingReason* theReasonPtr = &sReason;
-                theLen = sizeof(QTSS_CliSesTeardownReason);
-                (void)QTSS_GetValuePtr(inClientSession, qtssCliTeardownReason, 0, (void **) &theReasonPtr, &theLen);
-//              qtss_printf("qtssCliTeardownReason = %lu \n", *theReasonPtr);
-
-                if (*theReasonPtr == qtssCliSesTearDownClientRequest) //  the client asked for a tear down
-                {
-//                  qtss_printf(" client requests teardown  ");
-                    break;
-                }
-                
-                if (*theReasonPtr == qtssCliSesTearDownUnsupportedMedia) //  An error occured while streaming the file.
-                {   
-                        *theStatusCode = 415;
-//                      qtss_printf(" log UnsupportedMedia ");
-                        break;
-                }
-                if (*theReasonPtr == qtssCliSesTearDownBroadcastEnded) //  a broadcaster stopped broadcasting
-                {   
-                        *theStatusCode = 452;
-//                      qtss_printf(" log broadcast removed ");
-                        break;
-                }
-    
-                *theStatusCode = 500; // some unknown reason for cancelling the connection
-            }
-            
-//          qtss_printf("return status ");
-            // just use the qtssCliRTSPReqRealStatusCode for the reason
-        }
-                
-    } while (false);
-
-//  qtss_printf(" = %lu \n", *theStatusCode);
+    UInt32* theStatusCode = GetLogStatusCode(inClientSession, inCloseReasonPtr);
 
         
     // Find out what time it is
@@ -814,14 +812,385 @@ QTSS_Error LogRequest( QTSS_ClientSessionObject inClientSession,
 }
 
 
+
+void GetStreamStats(    QTSS_ClientSessionObject inClientSession, StrPtrLen* ioVideoPayloadName, StrPtrLen* ioAudioPayloadName,
+                        StrPtrLen** outTransportType, UInt32* outPacketsReceived, UInt32* outPacketsLost, UInt32* outBufferTime)
+{
+    static StrPtrLen sTCPStr("TCP");
+    static StrPtrLen sUDPStr("UDP");
+    
+    // clientPacketsReceived, clientPacketsLost, videoPayloadName and audioPayloadName
+    // are all stored on a per-stream basis, so let's iterate through all the streams,
+    // finding this information
+
+    UInt32 theLen = 0;
+    UInt32 theStreamIndex = 0;
+    Bool16* isTCPPtr = NULL;
+    QTSS_RTPStreamObject theRTPStreamObject = NULL;
+    
+    for (   UInt32 theStreamObjectLen = sizeof(theRTPStreamObject);
+            QTSS_GetValue(inClientSession, qtssCliSesStreamObjects, theStreamIndex, (void*)&theRTPStreamObject, &theStreamObjectLen) == QTSS_NoErr;
+            theStreamIndex++, theStreamObjectLen = sizeof(theRTPStreamObject))
+    {
+        
+        UInt32* streamPacketsReceived = NULL;
+        UInt32* streamPacketsLost = NULL;
+        (void)QTSS_GetValuePtr(theRTPStreamObject, qtssRTPStrTotPacketsRecv, 0, (void**)&streamPacketsReceived, &theLen);
+        (void)QTSS_GetValuePtr(theRTPStreamObject, qtssRTPStrTotalLostPackets, 0, (void**)&streamPacketsLost, &theLen);
+        
+        // Add up packets received and packets lost to come up with a session wide total
+        if (streamPacketsReceived != NULL)
+            *outPacketsReceived += *streamPacketsReceived;
+        if (streamPacketsLost != NULL)
+            *outPacketsLost += *streamPacketsLost;
+        
+        // Identify the video and audio codec types
+        QTSS_RTPPayloadType* thePayloadType = NULL;
+        (void)QTSS_GetValuePtr(theRTPStreamObject, qtssRTPStrPayloadType, 0, (void**)&thePayloadType, &theLen);
+        if (thePayloadType != NULL)
+        {
+            if (*thePayloadType == qtssVideoPayloadType)
+                (void)QTSS_GetValue(theRTPStreamObject, qtssRTPStrPayloadName, 0, ioVideoPayloadName->Ptr, &ioVideoPayloadName->Len);
+            else if (*thePayloadType == qtssAudioPayloadType)   
+                (void)QTSS_GetValue(theRTPStreamObject, qtssRTPStrPayloadName, 0, ioAudioPayloadName->Ptr, &ioAudioPayloadName->Len);
+        }
+        
+        // If any one of the streams is being delivered over UDP instead of TCP,
+        // report in the log that the transport type for this session was UDP.
+        if (isTCPPtr == NULL)
+        {   
+            (void)QTSS_GetValuePtr(theRTPStreamObject, qtssRTPStrIsTCP, 0, (void**)&isTCPPtr, &theLen);
+            if (isTCPPtr != NULL)
+            {   if (*isTCPPtr == false)
+                    *outTransportType = &sUDPStr;
+                else
+                    *outTransportType = &sTCPStr;
+            }
+        }
+        
+        Float32* clientBufferTimePtr = NULL;
+        (void)QTSS_GetValuePtr(theRTPStreamObject, qtssRTPStrBufferDelayInSecs, 0, (void**)&clientBufferTimePtr, &theLen);
+        if  ( (clientBufferTimePtr != NULL) && (*clientBufferTimePtr != 0) )
+        {   if ( *clientBufferTimePtr  > *outBufferTime)
+                *outBufferTime = (UInt32) (*clientBufferTimePtr + .5); // round up to full seconds
+        }
+        
+    }
+}
+
+UInt32 GetQualityLevel(UInt32* inPacketsSent, UInt32 inPacketsReceived, UInt32 inPacketsLost)
+{
+    UInt32 qualityLevel = 0;
+    
+    if ((inPacketsSent == NULL) || (*inPacketsSent == 0)) // no packets sent
+        qualityLevel = 0; // no quality
+    else
+    {
+        if ( (inPacketsReceived == 0) && (inPacketsLost == 0) ) // no info from client 
+            qualityLevel = 100; //so assume 100
+        else
+        {   
+            float qualityPercent =  (float) inPacketsReceived / (float) (inPacketsReceived + inPacketsLost);
+            qualityPercent += (float).005; // round up
+            qualityLevel = (UInt32) ( (float) 100.0 * qualityPercent); // average of sum of packet counts for all streams
+        }
+    }
+    return qualityLevel;
+}
+
+UInt32* GetLogStatusCode(QTSS_ClientSessionObject inClientSession, QTSS_CliSesClosingReason *inCloseReasonPtr)
+{
+    UInt32 theLen = 0;
+    
+    //we may not have an RTSP request. Assume that the status code is 504 timeout, if there is an RTSP
+    //request, though, we can find out what the real status code of the response is
+    static UInt32 sTimeoutCode = 504;   
+    UInt32* theStatusCode = &sTimeoutCode;
+    theLen = sizeof(UInt32);
+    (void)QTSS_GetValuePtr(inClientSession, qtssCliRTSPReqRealStatusCode, 0, (void **) &theStatusCode, &theLen);
+//  qtss_printf("qtssCliRTSPReqRealStatusCode = %lu \n", *theStatusCode);
+        
+    
+    if (inCloseReasonPtr) do
+    {
+        if (*theStatusCode < 300) // it was a succesful RTSP request but...
+        {   
+            if (*inCloseReasonPtr == qtssCliSesCloseTimeout) // there was a timeout
+            {   
+                    *theStatusCode = sTimeoutCode;
+//                  qtss_printf(" log timeout ");
+                    break;
+            }
+
+            if (*inCloseReasonPtr == qtssCliSesCloseClientTeardown) // there was a teardown
+            {
+            
+                static QTSS_CliSesClosingReason sReason = qtssCliSesCloseClientTeardown;
+                QTSS_CliSesClosingReason* theReasonPtr = &sReason;
+                theLen = sizeof(QTSS_CliSesTeardownReason);
+                (void)QTSS_GetValuePtr(inClientSession, qtssCliTeardownReason, 0, (void **) &theReasonPtr, &theLen);
+//              qtss_printf("qtssCliTeardownReason = %lu \n", *theReasonPtr);
+
+                if (*theReasonPtr == qtssCliSesTearDownClientRequest) //  the client asked for a tear down
+                {
+//                  qtss_printf(" client requests teardown  ");
+                    break;
+                }
+                
+                if (*theReasonPtr == qtssCliSesTearDownUnsupportedMedia) //  An error occured while streaming the file.
+                {   
+                        *theStatusCode = 415;
+//                      qtss_printf(" log UnsupportedMedia ");
+                        break;
+                }
+                if (*theReasonPtr == qtssCliSesTearDownBroadcastEnded) //  a broadcaster stopped broadcasting
+                {   
+                        *theStatusCode = 452;
+//                      qtss_printf(" log broadcast removed ");
+                        break;
+                }
+    
+                *theStatusCode = 500; // some unknown reason for cancelling the connection
+            }
+            
+//          qtss_printf("return status ");
+            // just use the qtssCliRTSPReqRealStatusCode for the reason
+        }
+                
+    } while (false);
+
+    return theStatusCode;
+}
+
+QTSS_Error LogBinaryRequest(QTSS_ClientSessionObject inClientSession, QTSS_CliSesClosingReason *inCloseReasonPtr)
+{
+    // Called by LogRequest with sLogMutex held. Nothing is formatted here: values are
+    // fetched by pointer where possible, strings are interned and the date, player fields
+    // and W3C layout are all left to AccessLogConverter.
+    enum
+    {
+        kDefsBufferSize     = AccessLogStringTable::kMaxStringsPerRecord * (QTSSAccessLogFormat::kMaxStringLen + 8),
+        kRecordBufferSize   = 512,
+        kPayloadNameSize    = 32
+    };
+    static StrPtrLen sTCPStr("TCP");
+    
+    UInt32 theLen = 0;
+    time_t theLogTime = ::time(NULL);
+    SInt64 curTime = QTSS_Milliseconds();
+    
+    Float32* packetLossPercent = NULL;
+    Float64* movieDuration = NULL;
+    UInt64* movieSizeInBytes = NULL;
+    UInt32* movieAverageBitRatePtr = NULL;
+    SInt64* theCreateTime = NULL;
+    SInt64* thePlayTime = NULL;
+    UInt32* rtpBytesSent = NULL;
+    UInt32* rtcpBytesRecv = NULL;
+    UInt32* rtpPacketsSent = NULL;
+    
+    (void)QTSS_GetValuePtr(inClientSession, qtssCliSesPacketLossPercent, 0, (void**)&packetLossPercent, &theLen);
+    (void)QTSS_GetValuePtr(inClientSession, qtssCliSesMovieDurationInSecs, 0, (void**)&movieDuration, &theLen);
+    (void)QTSS_GetValuePtr(inClientSession, qtssCliSesMovieSizeInBytes, 0, (void**)&movieSizeInBytes, &theLen);
+    (void)QTSS_GetValuePtr(inClientSession, qtssCliSesMovieAverageBitRate, 0, (void**)&movieAverageBitRatePtr, &theLen);
+    (void)QTSS_GetValuePtr(inClientSession, qtssCliSesCreateTimeInMsec, 0, (void**)&theCreateTime, &theLen);
+    (void)QTSS_GetValuePtr(inClientSession, qtssCliSesFirstPlayTimeInMsec, 0, (void**)&thePlayTime, &theLen);
+    (void)QTSS_GetValuePtr(inClientSession, qtssCliSesRTPBytesSent, 0, (void**)&rtpBytesSent, &theLen);
+    (void)QTSS_GetValuePtr(inClientSession, qtssCliSesRTPPacketsSent, 0, (void**)&rtpPacketsSent, &theLen);
+    (void)QTSS_GetValuePtr(inClientSession, qtssCliSesRTCPBytesRecv, 0, (void**)&rtcpBytesRecv, &theLen);
+    
+    UInt32 startPlayTimeInSecs = 0;
+    if (theCreateTime != NULL && thePlayTime != NULL)
+        startPlayTimeInSecs = (UInt32)(((*theCreateTime - *thePlayTime)/1000)+0.5);
+    
+    // see LogRequest for this estimate
+    UInt32 clientBytesRecv = 0;
+    if ((rtcpBytesRecv != NULL) && (packetLossPercent != NULL))
+        clientBytesRecv = (UInt32)((*rtcpBytesRecv * (100.0 - *packetLossPercent))/100.0);
+    
+    char videoPayloadNameBuf[kPayloadNameSize] = { 0 };
+    StrPtrLen videoPayloadName(videoPayloadNameBuf, kPayloadNameSize - 1);
+    char audioPayloadNameBuf[kPayloadNameSize] = { 0 };
+    StrPtrLen audioPayloadName(audioPayloadNameBuf, kPayloadNameSize - 1);
+    StrPtrLen* theTransportType = NULL;
+    UInt32 clientPacketsReceived = 0;
+    UInt32 clientPacketsLost = 0;
+    UInt32 clientBufferTime = 0;
+    
+    GetStreamStats(inClientSession, &videoPayloadName, &audioPayloadName, &theTransportType,
+                    &clientPacketsReceived, &clientPacketsLost, &clientBufferTime);
+    startPlayTimeInSecs += clientBufferTime;
+    
+    // GetStreamStats leaves the payload names untouched (and their Len at the buffer size) when there is no such stream
+    if (videoPayloadNameBuf[0] == '\0')
+        videoPayloadName.Len = 0;
+    if (audioPayloadNameBuf[0] == '\0')
+        audioPayloadName.Len = 0;
+    
+    UInt8 theTransport = QTSSAccessLogFormat::kTransportUnknown;
+    if (theTransportType != NULL)
+        theTransport = theTransportType->Equal(sTCPStr) ? (UInt8) QTSSAccessLogFormat::kTransportTCP : (UInt8) QTSSAccessLogFormat::kTransportUDP;
+    
+    UInt32* theStatusCode = GetLogStatusCode(inClientSession, inCloseReasonPtr);
+    
+    UInt32 numCurClients = 0;
+    theLen = sizeof(numCurClients);
+    (void)QTSS_GetValue(sServer, qtssRTPSvrCurConn, 0, &numCurClients, &theLen);
+    
+    StrPtrLen remoteAddr, remoteDNS, url, userAgent, localIPAddr, localDNS, urlQry, userName, urlRealm;
+    (void)QTSS_GetValuePtr(inClientSession, qtssCliRTSPSessRemoteAddrStr, 0, (void**)&remoteAddr.Ptr, &remoteAddr.Len);
+    (void)QTSS_GetValuePtr(inClientSession, qtssCliSesHostName, 0, (void**)&remoteDNS.Ptr, &remoteDNS.Len);
+    (void)QTSS_GetValuePtr(inClientSession, qtssCliSesPresentationURL, 0, (void**)&url.Ptr, &url.Len);
+    (void)QTSS_GetValuePtr(inClientSession, qtssCliSesFirstUserAgent, 0, (void**)&userAgent.Ptr, &userAgent.Len);
+    (void)QTSS_GetValuePtr(inClientSession, qtssCliRTSPSessLocalAddrStr, 0, (void**)&localIPAddr.Ptr, &localIPAddr.Len);
+    (void)QTSS_GetValuePtr(inClientSession, qtssCliRTSPSessLocalDNS, 0, (void**)&localDNS.Ptr, &localDNS.Len);
+    (void)QTSS_GetValuePtr(inClientSession, qtssCliSesReqQueryString, 0, (void**)&urlQry.Ptr, &urlQry.Len);
+    (void)QTSS_GetValuePtr(inClientSession, qtssCliRTSPSesUserName, 0, (void**)&userName.Ptr, &userName.Len);
+    (void)QTSS_GetValuePtr(inClientSession, qtssCliRTSPSesURLRealm, 0, (void**)&urlRealm.Ptr, &urlRealm.Len);
+    
+    char theDefsBuffer[kDefsBufferSize];
+    QTSSBinaryLogFormatter theDefs(theDefsBuffer, kDefsBufferSize);
+    char theRecordBuffer[kRecordBufferSize];
+    QTSSBinaryLogFormatter theRecord(theRecordBuffer, kRecordBufferSize);
+    
+    sStringTable->BeginRecord(&theDefs);
+    
+    theRecord.PutUInt32((UInt32)theLogTime);                                                    //date time
+    theRecord.PutVarInt(sStringTable->Intern(&remoteAddr, &theDefs));                          //c-ip
+    theRecord.PutVarInt(sStringTable->Intern(&remoteDNS, &theDefs));                           //c-dns
+    theRecord.PutVarInt(sStringTable->Intern(&url, &theDefs));                                 //cs-uri-stem
+    theRecord.PutVarInt(startPlayTimeInSecs);                                                   //c-starttime
+    theRecord.PutVarInt(theCreateTime == NULL ? 0 : (UInt32) (QTSS_MilliSecsTo1970Secs(curTime)
+                        - QTSS_MilliSecsTo1970Secs(*theCreateTime)));                           //x-duration
+    theRecord.PutVarInt(*theStatusCode);                                                        //c-status
+    theRecord.PutVarInt(sStringTable->Intern(&userAgent, &theDefs));                           //cs(User-Agent)
+    theRecord.PutVarInt(movieDuration == NULL ? 0 : (UInt32) (*movieDuration + 0.5));           //filelength
+    theRecord.PutVarInt(movieSizeInBytes == NULL ? 0 : *movieSizeInBytes);                      //filesize
+    theRecord.PutVarInt(movieAverageBitRatePtr == NULL ? 0 : *movieAverageBitRatePtr);          //avgbandwidth
+    theRecord.PutUInt8(theTransport);                                                           //transport
+    theRecord.PutVarInt(sStringTable->Intern(&audioPayloadName, &theDefs));                    //audiocodec
+    theRecord.PutVarInt(sStringTable->Intern(&videoPayloadName, &theDefs));                    //videocodec
+    theRecord.PutVarInt(rtpBytesSent == NULL ? 0 : *rtpBytesSent);                              //sc-bytes
+    theRecord.PutVarInt(rtcpBytesRecv == NULL ? 0 : *rtcpBytesRecv);                            //cs-bytes
+    theRecord.PutVarInt(clientBytesRecv);                                                       //c-bytes
+    theRecord.PutVarInt(rtpPacketsSent == NULL ? 0 : *rtpPacketsSent);                          //s-pkts-sent
+    theRecord.PutVarInt(clientPacketsReceived);                                                 //c-pkts-received
+    theRecord.PutVarInt(clientPacketsLost);                                                     //c-pkts-lost-client
+    theRecord.PutVarInt(clientBufferTime);                                                      //c-totalbuffertime
+    theRecord.PutVarInt(GetQualityLevel(rtpPacketsSent, clientPacketsReceived, clientPacketsLost)); //c-quality
+    theRecord.PutVarInt(sStringTable->Intern(&localIPAddr, &theDefs));                         //s-ip
+    theRecord.PutVarInt(sStringTable->Intern(&localDNS, &theDefs));                            //s-dns
+    theRecord.PutVarInt(numCurClients);                                                         //s-totalclients
+    theRecord.PutVarInt(0);                                                                     //s-cpu-util
+    theRecord.PutVarInt(sStringTable->Intern(&urlQry, &theDefs));                              //cs-uri-query
+    theRecord.PutVarInt(sStringTable->Intern(&userName, &theDefs));                            //c-username
+    theRecord.PutVarInt(sStringTable->Intern(&urlRealm, &theDefs));                            //sc(Realm)
+    
+    // definitions first, so a reader always knows every ID the record uses
+    theDefs.PutRecord(QTSSAccessLogFormat::kSessionRecord, theRecord.GetBufPtr(), theRecord.GetCurrentOffset());
+    Assert(theDefs.GetSpaceLeft() > 0);
+    
+    sAccessLog->WriteBinaryToLog(theDefs.GetBufPtr(), theDefs.GetCurrentOffset(), kAllowLogToRoll);
+    
+    return QTSS_NoErr;
+}
+
+void AccessLogStringTable::BeginRecord(QTSSBinaryLogFormatter* ioDefs)
+{
+    OSMutexLocker locker(&fMutex);
+    if (fTable.GetNumEntries() + kMaxStringsPerRecord <= kMaxStrings)
+        return;
+    
+    this->Clear();
+    ioDefs->PutRecord(QTSSAccessLogFormat::kStringReset, NULL, 0);
+}
+
+UInt32 AccessLogStringTable::Intern(StrPtrLen* inString, QTSSBinaryLogFormatter* ioDefs)
+{
+    if ((inString->Ptr == NULL) || (inString->Len == 0) || (inString->Ptr[0] == '\0'))
+        return 0;
+    
+    StrPtrLen theString(inString->Ptr, inString->Len);
+    if (theString.Len > QTSSAccessLogFormat::kMaxStringLen)
+        theString.Len = QTSSAccessLogFormat::kMaxStringLen;
+    
+    OSMutexLocker locker(&fMutex);
+    AccessLogStringKey theKey(&theString);
+    AccessLogString* theEntry = fTable.Map(&theKey);
+    if (theEntry != NULL)
+        return theEntry->fID;
+    
+    theEntry = NEW AccessLogString(&theString, theKey.GetHashKey(), fNextID++);
+    fTable.Add(theEntry);
+    PutDefinition(theEntry, ioDefs);
+    return theEntry->fID;
+}
+
+char* AccessLogStringTable::GetDefinitions(UInt32* outLen)
+{
+    OSMutexLocker locker(&fMutex);
+    
+    UInt32 theBufferSize = 1;
+    AccessLogString* theEntry = NULL;
+    for (UInt32 x = 0; x < fTable.GetTableSize(); x++)
+    {
+        for (theEntry = fTable.GetTableEntry(x); theEntry != NULL; theEntry = theEntry->fNextHashEntry)
+        {
+            UInt32 thePayloadLen = QTSSBinaryLogFormatter::GetVarIntLen(theEntry->fID) + theEntry->fString.Len;
+            theBufferSize += 1 + QTSSBinaryLogFormatter::GetVarIntLen(thePayloadLen) + thePayloadLen;
+        }
+    }
+    
+    char* theBuffer = NEW char[theBufferSize];
+    QTSSBinaryLogFormatter theDefs(theBuffer, theBufferSize);
+    for (UInt32 y = 0; y < fTable.GetTableSize(); y++)
+    {
+        for (theEntry = fTable.GetTableEntry(y); theEntry != NULL; theEntry = theEntry->fNextHashEntry)
+            PutDefinition(theEntry, &theDefs);
+    }
+    
+    *outLen = theDefs.GetCurrentOffset();
+    return theBuffer;
+}
+
+void AccessLogStringTable::Clear()
+{
+    AccessLogString* theEntry = NULL;
+    for (UInt32 x = 0; x < fTable.GetTableSize(); x++)
+    {
+        while ((theEntry = fTable.GetTableEntry(x)) != NULL)
+        {
+            fTable.Remove(theEntry);
+            delete theEntry;
+        }
+    }
+    fNextID = 1;
+}
+
+void AccessLogStringTable::PutDefinition(AccessLogString* inString, QTSSBinaryLogFormatter* ioDefs)
+{
+    ioDefs->PutUInt8(QTSSAccessLogFormat::kStringDef);
+    ioDefs->PutVarInt(QTSSBinaryLogFormatter::GetVarIntLen(inString->fID) + inString->fString.Len);
+    ioDefs->PutVarInt(inString->fID);
+    ioDefs->Put(inString->fString);
+}
+
 void CheckAccessLogState(Bool16 forceEnabled)
 {
     //this function makes sure the logging state is in synch with the preferences.
     //extern variable declared in QTSSPreferences.h
     //check error log.
+    
+    // the log format changed, start over with a log of the new kind
+    if ((NULL != sAccessLog) && (sAccessLog->IsBinary() != sLogBinary))
+    {
+        sAccessLog->Delete(); //sAccessLog is a task object, so don't delete it directly
+        sAccessLog = NULL;
+    }
+    
     if ((NULL == sAccessLog) && (forceEnabled || sLogEnabled))
     {
-        sAccessLog = NEW QTSSAccessLog();
+        sAccessLog = NEW QTSSAccessLog(sLogBinary);
         sAccessLog->EnableLog();
     }
 
@@ -873,11 +1242,62 @@ SInt64 LogCheckTask::Run()
     return (60*60*1000);
 }
 
+char* QTSSAccessLog::GetLogName()
+{
+    char* theLogName = QTSSModuleUtils::GetStringAttribute(sPrefs, "request_logfile_name", sDefaultLogName);
+    if (!fIsBinary)
+        return theLogName;
+    
+    // keep binary logs apart from text logs: StreamingServer.bin.log
+    OSCharArrayDeleter theTextLogName(theLogName);
+    char* theBinaryLogName = NEW char[::strlen(theTextLogName.GetObject()) + ::strlen(sBinaryLogSuffix) + 1];
+    ::strcpy(theBinaryLogName, theTextLogName.GetObject());
+    ::strcat(theBinaryLogName, sBinaryLogSuffix);
+    return theBinaryLogName;
+}
+
 /* streamingserver.logд־ͷ, ؾĵǰUNIXʱ */
 time_t QTSSAccessLog::WriteLogHeader(FILE *inFile)
 {//־ʱдlogͷ,ٶ,Unixʱ䷵
     time_t calendarTime = QTSSRollingLog::WriteLogHeader(inFile);
 
+    if (fIsBinary)
+    {
+        enum { kHeaderBufferSize = 1024 };
+        
+        StrPtrLen serverName;
+        (void)QTSS_GetValuePtr(sServer, qtssSvrServerName, 0, (void**)&serverName.Ptr, &serverName.Len);
+        StrPtrLen serverVersion;
+        (void)QTSS_GetValuePtr(sServer, qtssSvrServerVersion, 0, (void**)&serverVersion.Ptr, &serverVersion.Len);
+        if (serverName.Len > QTSSAccessLogFormat::kMaxStringLen)
+            serverName.Len = QTSSAccessLogFormat::kMaxStringLen;
+        if (serverVersion.Len > QTSSAccessLogFormat::kMaxStringLen)
+            serverVersion.Len = QTSSAccessLogFormat::kMaxStringLen;
+        
+        char thePayloadBuffer[kHeaderBufferSize];
+        QTSSBinaryLogFormatter thePayload(thePayloadBuffer, kHeaderBufferSize);
+        thePayload.Put((char*)QTSSAccessLogFormat::GetMagic(), 4);
+        thePayload.PutUInt8(QTSSAccessLogFormat::kVersion);
+        thePayload.PutUInt8(sLogTimeInGMT ? (UInt8) QTSSAccessLogFormat::kLogTimeInGMTFlag : (UInt8) 0);
+        thePayload.PutUInt32((UInt32)::time(NULL));
+        thePayload.PutVarInt(serverName.Len);
+        thePayload.Put(serverName);
+        thePayload.PutVarInt(serverVersion.Len);
+        thePayload.Put(serverVersion);
+        
+        char theHeaderBuffer[kHeaderBufferSize];
+        QTSSBinaryLogFormatter theHeader(theHeaderBuffer, kHeaderBufferSize);
+        theHeader.PutRecord(QTSSAccessLogFormat::kFileHeader, thePayload.GetBufPtr(), thePayload.GetCurrentOffset());
+        this->WriteBinaryToLog(theHeader.GetBufPtr(), theHeader.GetCurrentOffset(), !kAllowLogToRoll);
+        
+        // a new file: repeat every string still in use so this file can be read on its own
+        UInt32 theDefsLen = 0;
+        OSCharArrayDeleter theDefs(sStringTable->GetDefinitions(&theDefsLen));
+        this->WriteBinaryToLog(theDefs.GetObject(), theDefsLen, !kAllowLogToRoll);
+        
+        return calendarTime;
+    }
+
     //format a date for the startup time
     char theDateBuffer[QTSSRollingLog::kMaxDateBufferSizeInBytes] = { 0 };
 	//ȡlocal timeʽ2010-03-16 23:34:54ʱ,theDateBuffer,true
@@ -906,6 +1326,12 @@ void    WriteStartupMessage()
         
     sStartedUp = true;
     
+    if ((sAccessLog != NULL) && sAccessLog->IsBinary())
+    {
+        WriteBinaryRemark(QTSSAccessLogFormat::kRemarkStartup);
+        return;
+    }
+    
     //format a date for the startup time
     char theDateBuffer[QTSSRollingLog::kMaxDateBufferSizeInBytes];
 	//ȡlocalʽ2010-03-16 23:34:54ʱ,theDateBuffer,true
@@ -927,6 +1353,12 @@ void    WriteShutdownMessage()
         
     sStartedUp = false;
     
+    if ((sAccessLog != NULL) && sAccessLog->IsBinary())
+    {
+        WriteBinaryRemark(QTSSAccessLogFormat::kRemarkShutdown);
+        return;
+    }
+    
     //log shutdown message
     //format a date for the shutdown time
     char theDateBuffer[QTSSRollingLog::kMaxDateBufferSizeInBytes];
@@ -941,6 +1373,19 @@ void    WriteShutdownMessage()
         sAccessLog->WriteToLog(tempBuffer, kAllowLogToRoll);
 }
 
+void    WriteBinaryRemark(UInt8 inRemarkKind)
+{
+    char thePayloadBuffer[8];
+    QTSSBinaryLogFormatter thePayload(thePayloadBuffer, sizeof(thePayloadBuffer));
+    thePayload.PutUInt32((UInt32)::time(NULL));
+    thePayload.PutUInt8(inRemarkKind);
+    
+    char theRecordBuffer[16];
+    QTSSBinaryLogFormatter theRecord(theRecordBuffer, sizeof(theRecordBuffer));
+    theRecord.PutRecord(QTSSAccessLogFormat::kRemark, thePayload.GetBufPtr(), thePayload.GetCurrentOffset());
+    sAccessLog->WriteBinaryToLog(theRecord.GetBufPtr(), theRecord.GetCurrentOffset(), kAllowLogToRoll);
+}
+
 
 /*
 
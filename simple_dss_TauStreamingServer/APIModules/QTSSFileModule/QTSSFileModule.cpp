@@ -87,6 +87,7 @@ static  StrPtrLen sEOL("\r\n");
 static  StrPtrLen sSDPNotValidMessage("Movie SDP is not valid.");
 
 const   SInt16    sNumSDPVectors = 22;/* important param */
+const   UInt32    sSortedSDPBufferSize = 4096;
 
 // ATTRIBUTES IDs,see QTSS.h,used in Register()
 /* both initialize -1 */
@@ -137,6 +138,8 @@ static Float32              sAddClientBufferDelaySecs = 0;/* used in DoDescribe(
 static Bool16               sRecordMovieFileSDP = false;/* whether record movie file? */
 static Bool16               sEnableMovieFileSDP = false;/* if represent separately in a individual file or in a built-in atom ? */
 
+static UInt32               sPacketCacheWindowSecs = 0;/* secs of built RTP packets shared by sessions playing the same file, see QTRTPPacketCache */
+
 static Bool16               sPlayerCompatibility = true;/* ݲ? used in DoDescribe() */
 static UInt32               sAdjustMediaBandwidthPercent = 50;/* ýٷֱ used in DoDescribe() */
 
@@ -545,6 +548,16 @@ QTSS_Error RereadPrefs()
 	//sEnableMovieFileSDP
     sEnableMovieFileSDP = false;
     QTSSModuleUtils::GetIOAttribute(sPrefs, "enable_movie_file_sdp", qtssAttrDataTypeBool16, &sEnableMovieFileSDP, sizeof(sEnableMovieFileSDP));
+
+	//sPacketCacheWindowSecs
+    sPacketCacheWindowSecs = 4;
+    QTSSModuleUtils::GetIOAttribute(sPrefs, "shared_packet_cache_window_secs", qtssAttrDataTypeUInt32, &sPacketCacheWindowSecs, sizeof(sPacketCacheWindowSecs));
+    QTRTPFile::SetPacketCacheWindow(sPacketCacheWindowSecs);
+
+    // Empty leaves the atom TOC cache off
+    char* theTOCCacheFolder = QTSSModuleUtils::GetStringAttribute(sPrefs, "atom_toc_cache_folder", "");
+    QTFile::SetTOCCacheFolder(theTOCCacheFolder);
+    delete [] theTOCCacheFolder;
     
 	//sPlayerCompatibility
     sPlayerCompatibility = true;
@@ -996,18 +1009,6 @@ QTSS_Error DoDescribe(QTSS_StandardRTSP_Params* inParamBlock)
 		/* ¶һµStrPtrLenĶ,ǰtheFullSDPBufferʼָдֽʼ */
         StrPtrLen fullSDPBuffSPL(theFullSDPBuffer.GetBufPtr(),theFullSDPBuffer.GetBytesWritten());
 
-// ------------ Check the headers
-		/* ͷĺϷ, */
-		/* ע: SetSDPBuffer()ѾInitialize(),Parse(),Ϸsdpд뵱ǰеһ,غϷĽ*/
-        SDPContainer rawSDPContainer;
-		/* input the given string, store in buffer, then parse its validity and add it to the next sdp line to current line */
-        rawSDPContainer.SetSDPBuffer( &fullSDPBuffSPL ); 
-		/* SDPϢϷ,ͻ˷һϢ"Movie SDP is not valid.",ǷQTSS_RequestFailed */
-        if (!rawSDPContainer.IsSDPBufferValid())
-        {    
-			return QTSSModuleUtils::SendErrorResponseWithMessage(inParamBlock->inRTSPRequest, qtssUnsupportedMediaType, &sSDPNotValidMessage);
-        }
-		
 // ------------ reorder the sdp headers to make them proper.ǡ˳SDPͷ
         Float32 adjustMediaBandwidthPercent = 1.0;
         Bool16 adjustMediaBandwidth = false;
@@ -1018,19 +1019,21 @@ QTSS_Error DoDescribe(QTSS_StandardRTSP_Params* inParamBlock)
 		if (adjustMediaBandwidth)
 		    adjustMediaBandwidthPercent = (Float32) sAdjustMediaBandwidthPercent / 100.0;//õٷֱΪ50%,sortedSDPҪ
 
-// ----------- get session header and media header from sdp cache
+// ------------ check the headers and sort them
+        // the sorted SDP of most movies fits in theSortedSDPBuffer, a bigger one goes to the heap
+        char theSortedSDPBuffer[sSortedSDPBufferSize];
+        ResizeableStringFormatter theSortedSDP(theSortedSDPBuffer, sizeof(theSortedSDPBuffer));
+        if (!SDPLineSorter::SortSDP(&fullSDPBuffSPL, &theSortedSDP, adjustMediaBandwidthPercent))
+        {
+            if (sdpFile != NULL)
+                ::fclose(sdpFile);
+			return QTSSModuleUtils::SendErrorResponseWithMessage(inParamBlock->inRTSPRequest, qtssUnsupportedMediaType, &sSDPNotValidMessage);
+        }
 
-		SDPLineSorter sortedSDP(&rawSDPContainer,adjustMediaBandwidthPercent);
-		/* sSessionOrderedLines[]= "vosiuepcbtrzka"Ϊ̶˳,ͬĸͷзһ,γfSDPSessionHeaders */
-		StrPtrLen *theSessionHeadersPtr = sortedSDP.GetSessionHeaders();
-		/* ÿauido/video track,ӶӦmͷԺҵܵbͷ,MediaBandwidth,ʼԱfMediaHeaders */
-		StrPtrLen *theMediaHeadersPtr = sortedSDP.GetMediaHeaders();
-		
 // ----------- write out the sdp
 
-		/* theSessionHeadersPtrtheMediaHeadersPtrдsdp file,ע*ioVectorIndexԶ1 */
-		totalSDPLength += ::WriteSDPHeader(sdpFile, theSDPVec, &vectorIndex, theSessionHeadersPtr);//1,0?
-        totalSDPLength += ::WriteSDPHeader(sdpFile, theSDPVec, &vectorIndex, theMediaHeadersPtr); //2
+        StrPtrLen theSortedSDPStr(theSortedSDP.GetBufPtr(), theSortedSDP.GetBytesWritten());
+        totalSDPLength += ::WriteSDPHeader(sdpFile, theSDPVec, &vectorIndex, &theSortedSDPStr);
  
 
 // -------- done with SDP processing
@@ -1040,7 +1043,7 @@ QTSS_Error DoDescribe(QTSS_StandardRTSP_Params* inParamBlock)
             
 
         Assert(theSDPData.Len > 0);//ע,ʱtheSDPData洢ǴsdpԭлõϢ
-        Assert(theSDPVec[2].iov_base != NULL);//ǵ3iovec
+        Assert(theSDPVec[1].iov_base != NULL);//ǵ2iovec
         //ok, we have a filled out iovec. Let's send the response!
         
         // Append the Last Modified header to be a good caching proxy citizen before sending the Describe
@@ -22,6 +22,7 @@ LastUpdate:  2010-08-16
 #include "OSHeaders.h"
 #include "QTSSModuleUtils.h"
 #include "MyAssert.h"
+#include "RTCPCompoundParser.h"
 
 //Turns on printfs that are useful for debugging
 #define FLOW_CONTROL_DEBUGGING 1
@@ -239,11 +240,39 @@ QTSS_Error ProcessRTCPPacket(QTSS_RTCPProcess_Params* inParams)
         theNumWorses = *uint32Ptr;
      
     
+    //Take the client's report from the parsed packet if it has one, otherwise
+    //fall back to the last report the stream got
+    Bool16 hasPercentLoss = false;
+    UInt16 thePercentLoss = 0;
+    UInt16 isGettingWorse = 0;
+    UInt16 isGettingBetter = 0;
+    RTCPCompoundSummary* theSummary = (RTCPCompoundSummary*)inParams->inRTCPSummary;
+    if ((theSummary != NULL) && theSummary->fHasQTSSApp)
+    {
+        hasPercentLoss = true;
+        thePercentLoss = theSummary->fQTSSApp.fPercentPacketsLost;
+        isGettingWorse = (UInt16)theSummary->fQTSSApp.fIsGettingWorse;
+        isGettingBetter = (UInt16)theSummary->fQTSSApp.fIsGettingBetter;
+    }
+    else
+    {
+        (void)QTSS_GetValuePtr(inParams->inRTPStream, qtssRTPStrPercentPacketsLost, 0, (void**)&uint16Ptr, &theLen);
+        if ((uint16Ptr != NULL) && (theLen == sizeof(UInt16)))
+        {
+            hasPercentLoss = true;
+            thePercentLoss = *uint16Ptr;
+        }
+        (void)QTSS_GetValuePtr(inParams->inRTPStream, qtssRTPStrGettingWorse, 0, (void**)&uint16Ptr, &theLen);
+        if ((uint16Ptr != NULL) && (theLen == sizeof(UInt16)))
+            isGettingWorse = *uint16Ptr;
+        (void)QTSS_GetValuePtr(inParams->inRTPStream, qtssRTPStrGettingBetter, 0, (void**)&uint16Ptr, &theLen);
+        if ((uint16Ptr != NULL) && (theLen == sizeof(UInt16)))
+            isGettingBetter = *uint16Ptr;
+    }
+
     //First take any action necessitated by the loss percent
-    (void)QTSS_GetValuePtr(inParams->inRTPStream, qtssRTPStrPercentPacketsLost, 0, (void**)&uint16Ptr, &theLen);
-    if ((uint16Ptr != NULL) && (theLen == sizeof(UInt16)))
+    if (hasPercentLoss)
     {
-        UInt16 thePercentLoss = *uint16Ptr;
         thePercentLoss /= 256; //Hmmm... looks like the client reports loss percent in multiples of 256
 #if FLOW_CONTROL_DEBUGGING
         qtss_printf("Percent loss: %d\n", thePercentLoss);
@@ -295,36 +324,30 @@ QTSS_Error ProcessRTCPPacket(QTSS_RTCPProcess_Params* inParams)
     }
     
     //Now take a look at the getting worse heuristic
-    (void)QTSS_GetValuePtr(inParams->inRTPStream, qtssRTPStrGettingWorse, 0, (void**)&uint16Ptr, &theLen);
-    if ((uint16Ptr != NULL) && (theLen == sizeof(UInt16)))
+    if (isGettingWorse != 0)
     {
-        UInt16 isGettingWorse = *uint16Ptr;
-        if (isGettingWorse != 0)
+        theNumWorses++;//we must count this getting worse
+        
+        //If we've gotten N number of getting worses, then thin. Otherwise, just
+        //increment our count of getting worses
+        if (theNumWorses >= sWorsesToThin)
         {
-            theNumWorses++;//we must count this getting worse
-            
-            //If we've gotten N number of getting worses, then thin. Otherwise, just
-            //increment our count of getting worses
-            if (theNumWorses >= sWorsesToThin)
-            {
 #if FLOW_CONTROL_DEBUGGING
-                qtss_printf("Client reporting getting worse. Ratcheting less\n");
+            qtss_printf("Client reporting getting worse. Ratcheting less\n");
 #endif
-                ratchetLess = true;
-            }
-            else
-            {
+            ratchetLess = true;
+        }
+        else
+        {
 #if FLOW_CONTROL_DEBUGGING
-                qtss_printf("Client reporting getting worse. Incrementing num worses count to %lu\n", theNumWorses);
+            qtss_printf("Client reporting getting worse. Incrementing num worses count to %lu\n", theNumWorses);
 #endif
-                (void)QTSS_SetValue(theStream, sNumWorsesAttr, 0, &theNumWorses, sizeof(theNumWorses));
-            }
+            (void)QTSS_SetValue(theStream, sNumWorsesAttr, 0, &theNumWorses, sizeof(theNumWorses));
         }
     }
 
     //Finally, if we get a getting better, automatically ratchet up
-    (void)QTSS_GetValuePtr(inParams->inRTPStream, qtssRTPStrGettingBetter, 0, (void**)&uint16Ptr, &theLen);
-    if ((uint16Ptr != NULL) && (theLen == sizeof(UInt16)) && (*uint16Ptr > 0))
+    if (isGettingBetter > 0)
         ratchetMore = true;
         
     //For clearing out counts below
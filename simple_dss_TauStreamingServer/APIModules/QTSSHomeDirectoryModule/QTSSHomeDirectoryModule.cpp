@@ -141,6 +141,9 @@ QTSS_Error Register(QTSS_Register_Params* inParams)
 	(void)QTSS_AddRole(QTSS_RTSPRoute_Role);
     (void)QTSS_AddRole(QTSS_RTSPAuthorize_Role);
 	(void)QTSS_AddRole(QTSS_ClientSessionClosing_Role);
+	
+	// Only paths like /~joe/mysample.mov need routing
+	(void)QTSS_AddRoleURLPrefix(QTSS_RTSPRoute_Role, "/~");
     
 	// Add an RTSP session attribute to track if the request is the first request of the session
 	// so that the bandwidth/# of connections quota check can be done only if it is the first request
@@ -0,0 +1,518 @@
+/***************************************************************************
+
+Copyright (c) 2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 AccessLogConverter.cpp
+Description: Converts the binary access log written by QTSSAccessLogModule
+             (request_logfile_format "binary") into the W3C extended log
+             format of the text access log, or into CSV.
+Comment:
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-19
+LastUpdate:  2026-10-19
+
+****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "SafeStdLib.h"
+#include "OSHeaders.h"
+#include "StrPtrLen.h"
+#include "StringParser.h"
+#include "StringFormatter.h"
+#include "UserAgentParser.h"
+#include "QTSSAccessLogFormat.h"
+
+// Same field list as the text log written by QTSSAccessLogModule
+static const char* sW3CFields = "c-ip date time c-dns cs-uri-stem c-starttime x-duration c-rate c-status c-playerid"
+                              " c-playerversion c-playerlanguage cs(User-Agent) c-os"
+                              " c-osversion c-cpu filelength filesize avgbandwidth protocol transport audiocodec videocodec"
+                              " sc-bytes cs-bytes c-bytes s-pkts-sent c-pkts-received c-pkts-lost-client c-buffercount"
+                              " c-totalbuffertime c-quality s-ip s-dns s-totalclients s-cpu-util cs-uri-query c-username sc(Realm) ";
+
+static const char* sVoidField = "-";
+
+enum
+{
+    kTimeFormatFromFile = 0,
+    kTimeFormatGMT      = 1,
+    kTimeFormatLocal    = 2,
+
+    kMaxStringID        = 1 << 20,  // sanity limit on IDs read from the file
+    kPlayerFieldSize    = 32,
+    kReplacedStringSize = 256
+};
+
+static Bool16   sCSVOutput      = false;
+static UInt32   sTimeFormat     = kTimeFormatFromFile;
+static Bool16   sLogTimeInGMT   = true;
+
+static char**   sStrings        = NULL;
+static UInt32   sNumStrings     = 0;
+
+
+static void Usage(char* inProgName)
+{
+    qtss_printf("usage: %s [-c] [-g | -l] binarylog ...\n", inProgName);
+    qtss_printf("  -c  write CSV instead of the W3C extended log format\n");
+    qtss_printf("  -g  print times in GMT (default: as configured when the log was written)\n");
+    qtss_printf("  -l  print times in local time\n");
+}
+
+static void ClearStrings()
+{
+    for (UInt32 x = 0; x < sNumStrings; x++)
+    {
+        delete [] sStrings[x];
+        sStrings[x] = NULL;
+    }
+}
+
+static void DefineString(UInt32 inID, StrPtrLen* inString)
+{
+    if ((inID == 0) || (inID >= kMaxStringID))
+        return;
+
+    if (inID >= sNumStrings)
+    {
+        UInt32 theNumStrings = (sNumStrings == 0) ? 1024 : sNumStrings;
+        while (theNumStrings <= inID)
+            theNumStrings *= 2;
+
+        char** theStrings = new char*[theNumStrings];
+        ::memset(theStrings, 0, sizeof(char*) * theNumStrings);
+        if (sStrings != NULL)
+            ::memcpy(theStrings, sStrings, sizeof(char*) * sNumStrings);
+        delete [] sStrings;
+        sStrings = theStrings;
+        sNumStrings = theNumStrings;
+    }
+
+    delete [] sStrings[inID];
+    sStrings[inID] = inString->GetAsCString();
+}
+
+// Unknown or empty IDs come back as ""
+static const char* GetString(UInt32 inID)
+{
+    if ((inID < sNumStrings) && (sStrings[inID] != NULL))
+        return sStrings[inID];
+    return "";
+}
+
+// Same as ReplaceSpaces() in QTSSAccessLogModule.cpp
+static void ReplaceSpaces(StrPtrLen *sourcePtr, StrPtrLen *destPtr, const char *replaceStr)
+{
+    if ( (NULL != destPtr) && (NULL != destPtr->Ptr) && (0 < destPtr->Len) ) destPtr->Ptr[0] = 0;
+    do
+    {
+        if  (  (NULL == sourcePtr)
+            || (NULL == destPtr)
+            || (NULL == sourcePtr->Ptr)
+            || (NULL == destPtr->Ptr)
+            || (0 == sourcePtr->Len)
+            || (0 == destPtr->Len)
+            )    break;
+
+        if (0 == sourcePtr->Ptr[0])
+        {
+            destPtr->Len = 0;
+            break;
+        }
+
+        const StrPtrLen replaceValue((char*)replaceStr);
+        StringFormatter formattedString(destPtr->Ptr, destPtr->Len);
+        StringParser sourceStringParser(sourcePtr);
+        StrPtrLen preStopChars;
+
+        do
+        {   sourceStringParser.ConsumeUntil(&preStopChars, StringParser::sEOLWhitespaceMask);
+            if (preStopChars.Len > 0)
+            {   formattedString.Put(preStopChars);
+                if ( sourceStringParser.Expect(' ') && (formattedString.GetSpaceLeft() > replaceValue.Len) )
+                {   formattedString.Put(replaceValue.Ptr, replaceValue.Len);
+                }
+                else
+                {    break;
+                }
+            }
+
+        } while ( preStopChars.Len != 0);
+
+        destPtr->Set(formattedString.GetBufPtr(), formattedString.GetBytesWritten() );
+
+    } while (false);
+}
+
+static void ReplaceSpaces(const char* inString, char* outBuffer)
+{
+    StrPtrLen theSource((char*)inString);
+    StrPtrLen theDest(outBuffer, kReplacedStringSize - 1);
+    ::memset(outBuffer, 0, kReplacedStringSize);
+    ReplaceSpaces(&theSource, &theDest, "%20");
+    outBuffer[theDest.Len] = '\0';
+}
+
+static void CopyPlayerField(StrPtrLen* inField, char* outBuffer)
+{
+    UInt32 theSize = inField->Len;
+    if (theSize > kPlayerFieldSize - 1)
+        theSize = kPlayerFieldSize - 1;
+    if (inField->Ptr != NULL)
+        ::memcpy(outBuffer, inField->Ptr, theSize);
+    outBuffer[theSize] = '\0';
+}
+
+static void FormatDate(UInt32 inTime, Bool16 inGMT, char* outDate, const char* inFormat)
+{
+    time_t theTime = (time_t)inTime;
+    struct tm  timeResult;
+    struct tm* theTm = inGMT ? qtss_gmtime(&theTime, &timeResult) : qtss_localtime(&theTime, &timeResult);
+    outDate[0] = '\0';
+    if (theTm != NULL)
+        qtss_strftime(outDate, 64, inFormat, theTm);
+}
+
+static Bool16 LogTimeInGMT()
+{
+    if (sTimeFormat == kTimeFormatGMT)
+        return true;
+    if (sTimeFormat == kTimeFormatLocal)
+        return false;
+    return sLogTimeInGMT;
+}
+
+// Writes one field. W3C fields are each followed by a space like the text log,
+// CSV fields are comma separated and quoted when needed.
+static void PutField(const char* inValue, Bool16 isFirst)
+{
+    if (!sCSVOutput)
+    {
+        qtss_printf("%s ", (inValue[0] == '\0') ? sVoidField : inValue);
+        return;
+    }
+
+    if (!isFirst)
+        qtss_printf(",");
+    if (::strpbrk(inValue, ",\"\n") == NULL)
+    {
+        qtss_printf("%s", inValue);
+        return;
+    }
+
+    qtss_printf("\"");
+    for (const char* theChar = inValue; *theChar != '\0'; theChar++)
+    {
+        if (*theChar == '"')
+            qtss_printf("\"\"");
+        else
+            qtss_printf("%c", *theChar);
+    }
+    qtss_printf("\"");
+}
+
+static void PutField(UInt64 inValue)
+{
+    char theBuffer[32];
+    qtss_sprintf(theBuffer, "%" _64BITARG_ "u", inValue);
+    PutField(theBuffer, false);
+}
+
+static Bool16 ConvertFileHeader(StrPtrLen* inPayload)
+{
+    QTSSBinaryLogParser theParser(inPayload->Ptr, inPayload->Len);
+    StrPtrLen theMagic, theServerName, theServerVersion;
+    UInt8 theVersion = 0;
+    UInt8 theFlags = 0;
+    UInt32 theTime = 0;
+    UInt32 theLen = 0;
+
+    if (!theParser.GetBytes(&theMagic, 4) || !theMagic.Equal(StrPtrLen((char*)QTSSAccessLogFormat::GetMagic(), 4)))
+        return false;
+    if (!theParser.GetUInt8(&theVersion) || (theVersion > QTSSAccessLogFormat::kVersion))
+        return false;
+    if (!theParser.GetUInt8(&theFlags) || !theParser.GetUInt32(&theTime))
+        return false;
+    if (!theParser.GetVarInt(&theLen) || !theParser.GetBytes(&theServerName, theLen))
+        return false;
+    if (!theParser.GetVarInt(&theLen) || !theParser.GetBytes(&theServerVersion, theLen))
+        return false;
+
+    sLogTimeInGMT = (theFlags & QTSSAccessLogFormat::kLogTimeInGMTFlag) != 0;
+
+    if (sCSVOutput)
+        return true;
+
+    char theDate[64];
+    FormatDate(theTime, false, theDate, "%Y-%m-%d %H:%M:%S");
+    StrPtrLenDel theName(theServerName.GetAsCString());
+    StrPtrLenDel theServerVersionStr(theServerVersion.GetAsCString());
+    qtss_printf("#Software: %s\n#Version: %s\n#Date: %s\n#Remark: all time values are in %s.\n#Fields: %s\n",
+                theName.Ptr, theServerVersionStr.Ptr, theDate, LogTimeInGMT() ? "GMT" : "local time", sW3CFields);
+    return true;
+}
+
+static Bool16 ConvertRemark(StrPtrLen* inPayload)
+{
+    QTSSBinaryLogParser theParser(inPayload->Ptr, inPayload->Len);
+    UInt32 theTime = 0;
+    UInt8 theKind = 0;
+    if (!theParser.GetUInt32(&theTime) || !theParser.GetUInt8(&theKind))
+        return false;
+
+    if (sCSVOutput)
+        return true;
+
+    char theDate[64];
+    FormatDate(theTime, false, theDate, "%Y-%m-%d %H:%M:%S");
+    qtss_printf("#Remark: Streaming beginning %s %s\n", (theKind == QTSSAccessLogFormat::kRemarkStartup) ? "STARTUP" : "SHUTDOWN", theDate);
+    return true;
+}
+
+static Bool16 ConvertSessionRecord(StrPtrLen* inPayload)
+{
+    enum
+    {
+        kClientIP = 0, kClientDNS, kURL, kStartTime, kDuration, kStatus, kUserAgent, kFileLength,
+        kFileSize, kAvgBandwidth, kAudioCodec, kVideoCodec, kServerBytes, kClientSentBytes,
+        kClientBytes, kPacketsSent, kPacketsReceived, kPacketsLost, kBufferTime, kQuality,
+        kServerIP, kServerDNS, kTotalClients, kCPUUtil, kQuery, kUserName, kRealm,
+        kNumValues
+    };
+
+    QTSSBinaryLogParser theParser(inPayload->Ptr, inPayload->Len);
+    UInt32 theTime = 0;
+    UInt8 theTransport = 0;
+    UInt64 theValues[kNumValues];
+
+    if (!theParser.GetUInt32(&theTime))
+        return false;
+    for (UInt32 x = 0; x < kNumValues; x++)
+    {
+        if (x == kAudioCodec && !theParser.GetUInt8(&theTransport))
+            return false;
+        if (!theParser.GetVarInt(&theValues[x]))
+            return false;
+    }
+
+    // one "date time" field in the W3C log, two columns in CSV
+    char theDate[64], theTimeOfDay[64];
+    FormatDate(theTime, LogTimeInGMT(), theDate, sCSVOutput ? "%Y-%m-%d" : "%Y-%m-%d %H:%M:%S");
+    FormatDate(theTime, LogTimeInGMT(), theTimeOfDay, "%H:%M:%S");
+
+    // player fields come out of the user agent, like QTSSAccessLogModule's text log
+    char theUserAgent[kReplacedStringSize];
+    ReplaceSpaces(GetString((UInt32)theValues[kUserAgent]), theUserAgent);
+    StrPtrLen theUserAgentStr(theUserAgent);
+    UserAgentParser theUserAgentParser(&theUserAgentStr);
+    char thePlayerVersion[kPlayerFieldSize], thePlayerLang[kPlayerFieldSize], thePlayerOS[kPlayerFieldSize];
+    char thePlayerOSVers[kPlayerFieldSize], thePlayerCPU[kPlayerFieldSize];
+    CopyPlayerField(theUserAgentParser.GetUserVersion(), thePlayerVersion);
+    CopyPlayerField(theUserAgentParser.GetUserLanguage(), thePlayerLang);
+    CopyPlayerField(theUserAgentParser.GetrUserOS(), thePlayerOS);
+    CopyPlayerField(theUserAgentParser.GetUserOSVersion(), thePlayerOSVers);
+    CopyPlayerField(theUserAgentParser.GetUserCPU(), thePlayerCPU);
+
+    char theUserName[kReplacedStringSize];
+    ReplaceSpaces(GetString((UInt32)theValues[kUserName]), theUserName);
+    char theRealm[kReplacedStringSize];
+    ReplaceSpaces(GetString((UInt32)theValues[kRealm]), theRealm);
+
+    const char* theTransportStr = "";
+    if (theTransport == QTSSAccessLogFormat::kTransportUDP)
+        theTransportStr = "UDP";
+    else if (theTransport == QTSSAccessLogFormat::kTransportTCP)
+        theTransportStr = "TCP";
+
+    PutField(GetString((UInt32)theValues[kClientIP]), true);    //c-ip
+    PutField(theDate, false);                                   //date time
+    if (sCSVOutput)
+        PutField(theTimeOfDay, false);
+    PutField(GetString((UInt32)theValues[kClientDNS]), false);  //c-dns
+    PutField(GetString((UInt32)theValues[kURL]), false);        //cs-uri-stem
+    PutField(theValues[kStartTime]);                            //c-starttime
+    PutField(theValues[kDuration]);                             //x-duration
+    PutField(1);                                                //c-rate
+    PutField(theValues[kStatus]);                               //c-status
+    PutField(GetString((UInt32)theValues[kClientIP]), false);   //c-playerid
+    PutField(thePlayerVersion, false);                          //c-playerversion
+    PutField(thePlayerLang, false);                             //c-playerlanguage
+    PutField(theUserAgent, false);                              //cs(User-Agent)
+    PutField(thePlayerOS, false);                               //c-os
+    PutField(thePlayerOSVers, false);                           //c-osversion
+    PutField(thePlayerCPU, false);                              //c-cpu
+    PutField(theValues[kFileLength]);                           //filelength
+    PutField(theValues[kFileSize]);                             //filesize
+    PutField(theValues[kAvgBandwidth]);                         //avgbandwidth
+    PutField("RTP", false);                                     //protocol
+    PutField(theTransportStr, false);                           //transport
+    PutField(GetString((UInt32)theValues[kAudioCodec]), false); //audiocodec
+    PutField(GetString((UInt32)theValues[kVideoCodec]), false); //videocodec
+    PutField(theValues[kServerBytes]);                          //sc-bytes
+    PutField(theValues[kClientSentBytes]);                      //cs-bytes
+    PutField(theValues[kClientBytes]);                          //c-bytes
+    PutField(theValues[kPacketsSent]);                          //s-pkts-sent
+    PutField(theValues[kPacketsReceived]);                      //c-pkts-received
+    PutField(theValues[kPacketsLost]);                          //c-pkts-lost-client
+    PutField(1);                                                //c-buffercount
+    PutField(theValues[kBufferTime]);                           //c-totalbuffertime
+    PutField(theValues[kQuality]);                              //c-quality
+    PutField(GetString((UInt32)theValues[kServerIP]), false);   //s-ip
+    PutField(GetString((UInt32)theValues[kServerDNS]), false);  //s-dns
+    PutField(theValues[kTotalClients]);                         //s-totalclients
+    PutField(theValues[kCPUUtil]);                              //s-cpu-util
+    PutField(GetString((UInt32)theValues[kQuery]), false);      //cs-uri-query
+    PutField(theUserName, false);                               //c-username
+    PutField(theRealm, false);                                  //sc(Realm)
+    qtss_printf("\n");
+    return true;
+}
+
+static Bool16 ConvertFile(char* inPath)
+{
+    FILE* theFile = ::fopen(inPath, "rb");
+    if (theFile == NULL)
+    {
+        qtss_fprintf(stderr, "AccessLogConverter: cannot open %s\n", inPath);
+        return false;
+    }
+
+    ::fseek(theFile, 0, SEEK_END);
+    long theFileLen = ::ftell(theFile);
+    ::rewind(theFile);
+
+    char* theData = new char[theFileLen + 1];
+    UInt32 theDataLen = (UInt32)::fread(theData, 1, theFileLen, theFile);
+    ::fclose(theFile);
+
+    // the QTSSRollingLog "#Log File Created On:" line comes first
+    char* theRecords = theData;
+    if ((theDataLen > 0) && (theData[0] == '#'))
+    {
+        char* theEOL = (char*)::memchr(theData, '\n', theDataLen);
+        theRecords = (theEOL == NULL) ? theData + theDataLen : theEOL + 1;
+        if (!sCSVOutput)
+            ::fwrite(theData, 1, theRecords - theData, stdout);
+    }
+
+    ClearStrings();
+
+    Bool16 theResult = true;
+    QTSSBinaryLogParser theParser(theRecords, theDataLen - (UInt32)(theRecords - theData));
+    while (theParser.GetDataRemaining() > 0)
+    {
+        UInt8 theType = 0;
+        StrPtrLen thePayload;
+        if (!theParser.GetRecord(&theType, &thePayload))
+        {
+            qtss_fprintf(stderr, "AccessLogConverter: %s is truncated\n", inPath);
+            theResult = false;
+            break;
+        }
+
+        Bool16 isValid = true;
+        switch (theType)
+        {
+            case QTSSAccessLogFormat::kFileHeader:
+                isValid = ConvertFileHeader(&thePayload);
+                break;
+            case QTSSAccessLogFormat::kStringDef:
+            {
+                QTSSBinaryLogParser theDefParser(thePayload.Ptr, thePayload.Len);
+                UInt32 theID = 0;
+                isValid = theDefParser.GetVarInt(&theID);
+                if (isValid)
+                {
+                    StrPtrLen theString(theDefParser.GetCurrentPtr(), theDefParser.GetDataRemaining());
+                    DefineString(theID, &theString);
+                }
+                break;
+            }
+            case QTSSAccessLogFormat::kStringReset:
+                ClearStrings();
+                break;
+            case QTSSAccessLogFormat::kSessionRecord:
+                isValid = ConvertSessionRecord(&thePayload);
+                break;
+            case QTSSAccessLogFormat::kRemark:
+                isValid = ConvertRemark(&thePayload);
+                break;
+            default:
+                break; // written by a newer server, skip it
+        }
+
+        if (!isValid)
+        {
+            qtss_fprintf(stderr, "AccessLogConverter: bad record of type %d in %s\n", theType, inPath);
+            theResult = false;
+        }
+    }
+
+    delete [] theData;
+    return theResult;
+}
+
+int main(int argc, char * argv[])
+{
+    int ch;
+    while ((ch = getopt(argc, argv, "cglh")) != EOF)
+    {
+        switch (ch)
+        {
+            case 'c':
+                sCSVOutput = true;
+                break;
+            case 'g':
+                sTimeFormat = kTimeFormatGMT;
+                break;
+            case 'l':
+                sTimeFormat = kTimeFormatLocal;
+                break;
+            default:
+                Usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (optind >= argc)
+    {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    if (sCSVOutput)
+    {
+        // CSV header: the W3C field names, with "date time" as two columns
+        Bool16 isFirst = true;
+        StrPtrLen theFields((char*)sW3CFields);
+        StringParser theFieldParser(&theFields);
+        StrPtrLen theField;
+        while (theFieldParser.GetDataRemaining() > 0)
+        {
+            theFieldParser.ConsumeUntilWhitespace(&theField);
+            theFieldParser.ConsumeWhitespace();
+            if (theField.Len == 0)
+                continue;
+            StrPtrLenDel theFieldName(theField.GetAsCString());
+            PutField(theFieldName.Ptr, isFirst);
+            isFirst = false;
+        }
+        qtss_printf("\n");
+    }
+
+    int theResult = 0;
+    for (int x = optind; x < argc; x++)
+    {
+        if (!ConvertFile(argv[x]))
+            theResult = 1;
+    }
+
+    ClearStrings();
+    delete [] sStrings;
+    return theResult;
+}
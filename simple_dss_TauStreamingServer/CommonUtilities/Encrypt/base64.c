@@ -54,7 +54,7 @@ int Base64decode_len(const char *bufcoded)
     return nbytesdecoded + 1;
 }
 
-/* used in RTSPRequestStream::DecodeIncomingData() */
+/* used in RTSPRequest::ParseBasicHeader() */
 int Base64decode(char *bufplain, const char *bufcoded)
 {
     int nbytesdecoded;
@@ -100,6 +100,46 @@ int Base64decode(char *bufplain, const char *bufcoded)
     return nbytesdecoded;
 }
 
+/* used in RTSPRequestStream::DecodeIncomingData(). Decodes len bytes, a multiple of 4, in one
+   pass without scanning for the end first. bufplain may be bufcoded, as every quantum is read
+   before its 3 bytes are written. A quantum may end in padding, or in any other non base64
+   bytes, which Base64decode would stop at, and decoding goes on with the next one. Stops at a
+   quantum whose first two bytes are not base64, *outConsumed tells how far it got. */
+int Base64decode_quanta(char *bufplain, const char *bufcoded, int len, int *outConsumed)
+{
+    register const unsigned char *bufin = (const unsigned char *) bufcoded;
+    register unsigned char *bufout = (unsigned char *) bufplain;
+    const unsigned char *bufend = bufin + (len & ~3);
+    register unsigned int a, b, c, d;
+
+    for (; bufin < bufend; bufin += 4) {
+    a = pr2six[bufin[0]];
+    b = pr2six[bufin[1]];
+    c = pr2six[bufin[2]];
+    d = pr2six[bufin[3]];
+
+    /* 64 is the only value with bit 6 set, so one test covers the 4 bytes */
+    if (((a | b | c | d) & 64) == 0) {
+        unsigned int triple = (a << 18) | (b << 12) | (c << 6) | d;
+        bufout[0] = (unsigned char) (triple >> 16);
+        bufout[1] = (unsigned char) (triple >> 8);
+        bufout[2] = (unsigned char) triple;
+        bufout += 3;
+        continue;
+    }
+
+    if ((a | b) & 64)
+        break;
+    *(bufout++) = (unsigned char) (a << 2 | b >> 4);
+    if (c & 64)
+        continue;
+    *(bufout++) = (unsigned char) (b << 4 | c >> 2);
+    }
+
+    *outConsumed = bufin - (const unsigned char *) bufcoded;
+    return bufout - (unsigned char *) bufplain;
+}
+
 static const char basis_64[] =
     "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
 
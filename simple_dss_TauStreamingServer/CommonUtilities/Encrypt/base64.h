@@ -26,6 +26,7 @@ int Base64encode(char * coded_dst, const char *plain_src,int len_plain_src);
 
 int Base64decode_len(const char * coded_src);
 int Base64decode(char * plain_dst, const char *coded_src);
+int Base64decode_quanta(char * plain_dst, const char *coded_src, int len_coded_src, int *consumed);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,115 @@
+/***************************************************************************
+
+Copyright (c) 2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 OSHistogram.cpp
+Description: A fixed size, log-linear (HDR style) latency histogram that
+             many threads can add samples to without taking a lock.
+Comment:
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-19
+LastUpdate:  2026-10-19
+
+****************************************************************************/
+
+#include <string.h>
+#include "OSHistogram.h"
+#include "SafeStdLib.h"
+
+// atomic_add() in atomic.h only works on unsigned int and fTotal is 64 bit,
+// so use the compiler's atomic builtins directly.
+void OSHistogram::AddSample(SInt64 inValue)
+{
+    UInt32 theValue = 0;
+    if (inValue > (SInt64)0xFFFFFFFF)
+        theValue = 0xFFFFFFFF;
+    else if (inValue > 0)
+        theValue = (UInt32)inValue;
+
+    (void)__sync_fetch_and_add(&fBuckets[GetBucketIndex(theValue)], 1);
+    (void)__sync_fetch_and_add(&fCount, 1);
+    (void)__sync_fetch_and_add(&fTotal, (UInt64)theValue);
+
+    unsigned int theMax = fMax;
+    while (theValue > theMax)
+    {
+        if (__sync_bool_compare_and_swap(&fMax, theMax, (unsigned int)theValue))
+            break;
+        theMax = fMax;
+    }
+}
+
+void OSHistogram::Reset()
+{
+    ::memset(fBuckets, 0, sizeof(fBuckets));
+    fCount = 0;
+    fMax = 0;
+    fTotal = 0;
+}
+
+UInt32 OSHistogram::GetBucketIndex(UInt32 inValue)
+{
+    if (inValue < kSubBuckets)
+        return inValue;
+
+    // position of the highest set bit, at least kSubBucketBits here
+    UInt32 theHighBit = kSubBucketBits;
+    while ((inValue >> (theHighBit + 1)) != 0)
+        theHighBit++;
+
+    UInt32 theShift = theHighBit - kSubBucketBits;
+    UInt32 theSubBucket = (inValue >> theShift) - kSubBuckets;
+    return kSubBuckets + (theShift * kSubBuckets) + theSubBucket;
+}
+
+UInt32 OSHistogram::GetBucketUpperBound(UInt32 inIndex)
+{
+    if (inIndex < kSubBuckets)
+        return inIndex;
+
+    UInt32 theShift = (inIndex - kSubBuckets) / kSubBuckets;
+    UInt32 theSubBucket = (inIndex - kSubBuckets) % kSubBuckets;
+    UInt64 theUpperBound = ((UInt64)(kSubBuckets + theSubBucket + 1) << theShift) - 1;
+    if (theUpperBound > 0xFFFFFFFF)
+        theUpperBound = 0xFFFFFFFF;
+    return (UInt32)theUpperBound;
+}
+
+UInt32 OSHistogram::GetPercentile(Float32 inPercentile)
+{
+    UInt32 theCount = fCount;
+    if (theCount == 0)
+        return 0;
+
+    // the rank of the sample we are looking for, 1 based
+    UInt64 theRank = (UInt64)(((Float64)inPercentile * (Float64)theCount / 100.0) + 0.5);
+    if (theRank == 0)
+        theRank = 1;
+
+    UInt64 theSeen = 0;
+    for (UInt32 x = 0; x < kNumBuckets; x++)
+    {
+        theSeen += fBuckets[x];
+        if (theSeen >= theRank)
+        {
+            // never report more than the biggest sample we actually got
+            UInt32 theUpperBound = GetBucketUpperBound(x);
+            return (theUpperBound < fMax) ? theUpperBound : (UInt32)fMax;
+        }
+    }
+    return fMax;
+}
+
+void OSHistogram::Format(StringFormatter* ioFormatter, char* inName)
+{
+    UInt32 theCount = fCount;
+    UInt64 theAverage = (theCount == 0) ? 0 : fTotal / theCount;
+
+    char theLine[256];
+    qtss_snprintf(theLine, sizeof(theLine), "%s count=%lu total=%" _64BITARG_ "u avg=%" _64BITARG_ "u p50=%lu p90=%lu p99=%lu p999=%lu max=%lu\n",
+                    inName, theCount, fTotal, theAverage,
+                    this->GetPercentile(50.0), this->GetPercentile(90.0),
+                    this->GetPercentile(99.0), this->GetPercentile(99.9), (UInt32)fMax);
+    ioFormatter->Put(theLine);
+}
@@ -0,0 +1,73 @@
+/***************************************************************************
+
+Copyright (c) 2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 OSHistogram.h
+Description: A fixed size, log-linear (HDR style) latency histogram that
+             many threads can add samples to without taking a lock.
+Comment:
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-19
+LastUpdate:  2026-10-19
+
+****************************************************************************/
+
+#ifndef _OSHISTOGRAM_H_
+#define _OSHISTOGRAM_H_
+
+#include "OSHeaders.h"
+#include "StringFormatter.h"
+
+/*
+    Samples are unsigned 32 bit values (microseconds for the RTSP latency
+    histograms, so up to ~71 minutes). Values below kSubBuckets get a bucket
+    of their own, above that every power of two is split into kSubBuckets
+    linear buckets, so any reported value is within 1/kSubBuckets (12.5%) of
+    the real one. Percentiles report the upper bound of their bucket.
+
+    AddSample() only does atomic adds, readers see a consistent enough
+    snapshot for reporting but no locking is done between them.
+*/
+class OSHistogram
+{
+    public:
+
+        enum
+        {
+            kSubBucketBits  = 3,                                            //UInt32
+            kSubBuckets     = 1 << kSubBucketBits,                          //UInt32
+            kNumBuckets     = kSubBuckets + (32 - kSubBucketBits) * kSubBuckets   //UInt32
+        };
+
+        OSHistogram() { this->Reset(); }
+        ~OSHistogram() {}
+
+        // Lock free, may be called from any thread
+        void    AddSample(SInt64 inValue);
+
+        // Not atomic with respect to AddSample, samples added meanwhile may be lost
+        void    Reset();
+
+        UInt32  GetCount()      { return fCount; }
+        UInt32  GetMax()        { return fMax; }
+        UInt64  GetTotal()      { return fTotal; }
+
+        // inPercentile is 0 - 100. Returns 0 if the histogram is empty.
+        UInt32  GetPercentile(Float32 inPercentile);
+
+        // Appends "<inName> count=n total=n avg=n p50=n p90=n p99=n p999=n max=n\n"
+        void    Format(StringFormatter* ioFormatter, char* inName);
+
+        static UInt32   GetBucketIndex(UInt32 inValue);
+        static UInt32   GetBucketUpperBound(UInt32 inIndex);
+
+    private:
+
+        unsigned int    fBuckets[kNumBuckets];
+        unsigned int    fCount;
+        unsigned int    fMax;
+        UInt64          fTotal;
+};
+
+#endif //_OSHISTOGRAM_H_
@@ -36,14 +36,17 @@ UInt32  OSRefTableUtils::HashString(StrPtrLen* inString)
 	/* ȷתַUInt8 */
     UInt8* theData = (UInt8*)inString->Ptr;
     
-    //divide by 4 and take the characters at quarter points in the string,
-    //use those as the basis for the hash value
-	/* ʹȱΪԭ1/4 */
-    UInt32 quarterLen = inString->Len >> 2;
-	/* *ֵַ(ĵȷֺ)ĺ */
-    return (inString->Len * (theData[0] + theData[quarterLen] +
-            theData[quarterLen * 2] + theData[quarterLen * 3] +
-            theData[inString->Len - 1]));
+    //FNV-1a over the whole string. Keys such as the x-sessioncookie of HTTP tunnels
+    //have the same length and alphabet, and sampling only a few characters of them
+    //put most of them in the same few buckets
+    UInt32 theHash = 2166136261U;
+    for (UInt32 x = 0; x < inString->Len; x++)
+    {
+        theHash ^= theData[x];
+        theHash *= 16777619U;
+    }
+    //OSRefKey::GetHashKey returns it as an SInt32
+    return theHash & 0x7FFFFFFF;
 }
 
 /* HashעᲢһOSRef,ַʶΨһ,ܳɹOS_NoErr;һͬkeyֵԪ,ͷشEPERM  */
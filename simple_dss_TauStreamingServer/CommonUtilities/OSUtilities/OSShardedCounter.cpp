@@ -0,0 +1,73 @@
+/***************************************************************************
+
+Copyright (c) 2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 OSShardedCounter.cpp
+Description: Statistics counters split into one cache line per task thread,
+             so threads counting packets never touch each other's memory.
+Comment:
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-19
+LastUpdate:  2026-10-19
+
+****************************************************************************/
+
+#include "OSShardedCounter.h"
+
+unsigned int    OSShardedCounterShard::sNextShard = 1;
+
+void OSShardedCounterShard::ClaimShard()
+{
+    OSThread* theThread = OSThread::GetCurrent();
+    if (theThread == NULL)
+        return;
+
+    unsigned int theShard = __sync_fetch_and_add(&sNextShard, 1);
+    theThread->SetCounterShard((theShard < kNumShards) ? theShard : 0);
+}
+
+SInt64 OSShardedCounter::Get()
+{
+    SInt64 theSum = 0;
+    for (UInt32 x = 0; x < OSShardedCounterShard::kNumShards; x++)
+        theSum += fShards[x].fValue;
+    return theSum;
+}
+
+SInt64 OSShardedCounter::TakeAll()
+{
+    SInt64 theSum = 0;
+    for (UInt32 x = 0; x < OSShardedCounterShard::kNumShards; x++)
+        theSum += __sync_lock_test_and_set(&fShards[x].fValue, 0);
+    return theSum;
+}
+
+void OSShardedMax::Update(SInt64 inValue)
+{
+    Shard* theShard = &fShards[OSShardedCounterShard::GetCurrentShard()];
+    SInt64 theMax = theShard->fValue;
+    while (inValue > theMax)
+    {
+        if (__sync_bool_compare_and_swap(&theShard->fValue, theMax, inValue))
+            break;
+        theMax = theShard->fValue;
+    }
+}
+
+SInt64 OSShardedMax::Get()
+{
+    SInt64 theMax = 0;
+    for (UInt32 x = 0; x < OSShardedCounterShard::kNumShards; x++)
+    {
+        if (fShards[x].fValue > theMax)
+            theMax = fShards[x].fValue;
+    }
+    return theMax;
+}
+
+void OSShardedMax::Reset()
+{
+    for (UInt32 x = 0; x < OSShardedCounterShard::kNumShards; x++)
+        (void)__sync_lock_test_and_set(&fShards[x].fValue, 0);
+}
@@ -0,0 +1,119 @@
+/***************************************************************************
+
+Copyright (c) 2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 OSShardedCounter.h
+Description: Statistics counters split into one cache line per task thread,
+             so threads counting packets never touch each other's memory.
+Comment:
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-19
+LastUpdate:  2026-10-19
+
+****************************************************************************/
+
+#ifndef _OSSHARDEDCOUNTER_H_
+#define _OSSHARDEDCOUNTER_H_
+
+#include "OSHeaders.h"
+#include "OSThread.h"
+
+/*
+    Every TaskThread claims a shard of its own when it starts (see
+    TaskThread::Entry), all other threads share shard 0. The shard index is
+    kept in the OSThread, not in a __thread variable, so that modules built
+    as shared objects can link this code.
+
+    Updates are still atomic, because shard 0 is shared and because readers
+    reset shards, but an atomic add on a cache line only one core writes to
+    does not bounce between cores the way a single global counter (or a
+    global mutex) does.
+
+    Readers walk all shards, which is meant for the periodic stats task and
+    other infrequent callers only.
+*/
+
+class OSShardedCounterShard
+{
+    public:
+
+        enum
+        {
+            kNumShards      = 64,   //UInt32, shard 0 is shared by all non task threads
+            kShardStride    = 128   //UInt32, two cache lines, so no two shards share one
+                                    //whatever the alignment of the object
+        };
+
+        // Gives the calling OSThread a shard of its own, or shard 0 if
+        // all shards are taken
+        static void     ClaimShard();
+
+        static UInt32   GetCurrentShard()
+            {
+                OSThread* theThread = OSThread::GetCurrent();
+                return (theThread != NULL) ? theThread->GetCounterShard() : 0;
+            }
+
+    private:
+
+        static unsigned int     sNextShard;
+};
+
+class OSShardedCounter
+{
+    public:
+
+        OSShardedCounter() { this->Reset(); }
+        ~OSShardedCounter() {}
+
+        void    Add(SInt64 inValue)
+                    { (void)__sync_fetch_and_add(&fShards[OSShardedCounterShard::GetCurrentShard()].fValue, inValue); }
+
+        // Sum of all shards
+        SInt64  Get();
+
+        // Returns the sum and sets every shard to 0. Adds that happen
+        // meanwhile are either counted now or by the next call, never lost.
+        SInt64  TakeAll();
+
+        void    Reset()     { (void)this->TakeAll(); }
+
+    private:
+
+        struct Shard
+        {
+            volatile SInt64 fValue;
+            char            fPad[OSShardedCounterShard::kShardStride - sizeof(SInt64)];
+        };
+
+        Shard   fShards[OSShardedCounterShard::kNumShards];
+};
+
+// Keeps the largest value seen
+class OSShardedMax
+{
+    public:
+
+        OSShardedMax() { this->Reset(); }
+        ~OSShardedMax() {}
+
+        void    Update(SInt64 inValue);
+
+        // Largest value of all shards
+        SInt64  Get();
+
+        void    Reset();
+
+    private:
+
+        struct Shard
+        {
+            volatile SInt64 fValue;
+            char            fPad[OSShardedCounterShard::kShardStride - sizeof(SInt64)];
+        };
+
+        Shard   fShards[OSShardedCounterShard::kNumShards];
+};
+
+#endif //_OSSHARDEDCOUNTER_H_
@@ -44,7 +44,8 @@ void OSThread::Initialize()
 OSThread::OSThread()
 :   fStopRequested(false),/* δĳ߳stop */
     fJoined(false),/* δĳ߳ */
-    fThreadData(NULL) /*  ߳(洢TlsAllocĴ洢Ԫ)Ϊ */
+    fThreadData(NULL), /*  ߳(洢TlsAllocĴ洢Ԫ)Ϊ */
+    fCounterShard(0)
 {
 }
 
@@ -62,6 +62,20 @@ public:
                 
                 // As a convienence to higher levels, each thread has its own date buffer(ʱ仺)
                 DateBuffer*     GetDateBuffer()         { return &fDateBuffer; }
+
+                // The statistics counter shard of this thread, see OSShardedCounter.h
+                UInt32          GetCounterShard()       { return fCounterShard; }
+                void            SetCounterShard(UInt32 inShard) { fCounterShard = inShard; }
+
+                // The current date: the calling thread's date buffer, or inLocalBuffer
+                // when the caller is not an OSThread, updated to the second
+                static DateBuffer*  GetCurrentDate(DateBuffer* inLocalBuffer)
+                {
+                    OSThread* theThread = OSThread::GetCurrent();
+                    DateBuffer* theDate = (theThread != NULL) ? theThread->GetDateBuffer() : inLocalBuffer;
+                    theDate->InexactUpdate();
+                    return theDate;
+                }
                 
 				/* ߳ */
                 static void*    GetMainThreadData()     { return sMainThreadData; }
@@ -109,6 +123,7 @@ private:
 	/* ߳(洢TlsAllocĴ洢Ԫ)ʱʽݻ */
     void*           fThreadData;
     DateBuffer      fDateBuffer;
+    UInt32          fCounterShard;
     
 	/* ߳,TlsAlloc̴߳洢δʹóԱ߳,߳ */
     static void*    sMainThreadData;
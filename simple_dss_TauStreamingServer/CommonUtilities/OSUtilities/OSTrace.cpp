@@ -0,0 +1,566 @@
+/***************************************************************************
+
+Copyright (c) 2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 OSTrace.cpp
+Description: Leveled per subsystem trace points, recorded in binary form into
+             a ring buffer and formatted later by a background thread.
+Comment:
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-19
+LastUpdate:  2026-10-19
+
+****************************************************************************/
+
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "OSTrace.h"
+#include "OS.h"
+#include "OSMemory.h"
+#include "SafeStdLib.h"
+
+UInt32          OSTrace::sLevels[kNumSubsystems] = { kWarning, kWarning, kWarning, kWarning };
+OSTraceRecord   OSTrace::sRecords[kNumRecords];
+volatile UInt64 OSTrace::sNextIndex = 0;
+UInt64          OSTrace::sNextToDrain = 0;
+UInt64          OSTrace::sLostRecords = 0;
+
+static const char* sSubsystemNames[OSTrace::kNumSubsystems] = { "task", "rtsp", "rtp", "resend" };
+static const char* sLevelNames[] = { "off", "error", "warning", "info", "debug", "verbose" };
+
+// How PackArgs() stored an argument, FormatRecord() has to pass it back to
+// snprintf as the same type
+enum
+{
+    kArgInt         = 0,
+    kArgLong        = 1,
+    kArgLongLong    = 2,
+    kArgSize        = 3,
+    kArgIntMax      = 4,
+    kArgPtrDiff     = 5
+};
+
+static UInt32 ParseLengthModifier(const char** ioFormat)
+{
+    const char* theFormat = *ioFormat;
+    UInt32 theType = kArgInt;
+    switch (*theFormat)
+    {
+        case 'h':
+            theFormat++;
+            if (*theFormat == 'h')
+                theFormat++;
+            break;
+        case 'l':
+            theFormat++;
+            theType = kArgLong;
+            if (*theFormat == 'l')
+            {
+                theFormat++;
+                theType = kArgLongLong;
+            }
+            break;
+        case 'q':
+        case 'L':
+            theFormat++;
+            theType = kArgLongLong;
+            break;
+        case 'z':
+            theFormat++;
+            theType = kArgSize;
+            break;
+        case 'j':
+            theFormat++;
+            theType = kArgIntMax;
+            break;
+        case 't':
+            theFormat++;
+            theType = kArgPtrDiff;
+            break;
+    }
+    *ioFormat = theFormat;
+    return theType;
+}
+
+static inline Bool16 PutArg(OSTraceRecord* ioRecord, void* inValue, UInt32 inLen)
+{
+    if (ioRecord->fArgsLen + inLen > sizeof(ioRecord->fArgs))
+    {
+        ioRecord->fTruncated = true;
+        return false;
+    }
+    ::memcpy(&ioRecord->fArgs[ioRecord->fArgsLen], inValue, inLen);
+    ioRecord->fArgsLen += inLen;
+    return true;
+}
+
+static inline Bool16 GetArg(OSTraceRecord* inRecord, UInt32* ioOffset, void* outValue, UInt32 inLen)
+{
+    if (*ioOffset + inLen > inRecord->fArgsLen)
+        return false;
+    ::memcpy(outValue, &inRecord->fArgs[*ioOffset], inLen);
+    *ioOffset += inLen;
+    return true;
+}
+
+void OSTrace::Initialize()
+{
+    OSTraceThread* theThread = NEW OSTraceThread();
+    theThread->Start();
+}
+
+void OSTrace::SetLevel(UInt32 inSubsystem, UInt32 inLevel)
+{
+    if (inSubsystem >= kNumSubsystems)
+        return;
+    if (inLevel > kVerbose)
+        inLevel = kVerbose;
+    sLevels[inSubsystem] = inLevel;
+}
+
+void OSTrace::SetLevels(char* inSpec)
+{
+    if (inSpec == NULL)
+        return;
+
+    char* theSpec = NEW char[::strlen(inSpec) + 1];
+    ::strcpy(theSpec, inSpec);
+
+    char* theLast = NULL;
+    for (char* theItem = ::strtok_r(theSpec, ", \t", &theLast); theItem != NULL; theItem = ::strtok_r(NULL, ", \t", &theLast))
+    {
+        char* theLevelStr = ::strchr(theItem, '=');
+        if (theLevelStr == NULL)
+            continue;
+        *theLevelStr++ = '\0';
+
+        UInt32 theLevel = 0xFFFFFFFF; // invalid
+        if (::isdigit(*theLevelStr))
+            theLevel = ::atoi(theLevelStr);
+        else
+        {
+            for (UInt32 x = 0; x <= kVerbose; x++)
+                if (::strcasecmp(theLevelStr, sLevelNames[x]) == 0)
+                    theLevel = x;
+        }
+        if (theLevel > kVerbose)
+            continue;
+
+        for (UInt32 x = 0; x < kNumSubsystems; x++)
+        {
+            if ((::strcasecmp(theItem, "all") == 0) || (::strcasecmp(theItem, sSubsystemNames[x]) == 0))
+                OSTrace::SetLevel(x, theLevel);
+        }
+    }
+
+    delete [] theSpec;
+}
+
+void OSTrace::Record(UInt32 inSubsystem, UInt32 inLevel, const char* inFormat, ...)
+{
+    UInt64 theIndex = __sync_fetch_and_add(&sNextIndex, 1);
+    OSTraceRecord* theRecord = &sRecords[theIndex & (kNumRecords - 1)];
+
+    // readers that copy this slot meanwhile notice the sequence change
+    theRecord->fSequence = 0;
+    __sync_synchronize();
+
+    theRecord->fTimeMilli = OS::Milliseconds();
+    theRecord->fFormat = inFormat;
+    theRecord->fThreadID = (UInt64)OSThread::GetCurrentThreadID();
+    theRecord->fSubsystem = (UInt16)inSubsystem;
+    theRecord->fLevel = (UInt16)inLevel;
+    theRecord->fArgsLen = 0;
+    theRecord->fTruncated = false;
+
+    va_list theArgs;
+    va_start(theArgs, inFormat);
+    OSTrace::PackArgs(theRecord, inFormat, theArgs);
+    va_end(theArgs);
+
+    __sync_synchronize();
+    theRecord->fSequence = theIndex + 1;
+}
+
+// Walks the conversions of inFormat and copies each argument into the
+// record: integers and pointers by value, %s as a UInt16 length followed
+// by the bytes (at most the precision, if there is one).
+void OSTrace::PackArgs(OSTraceRecord* ioRecord, const char* inFormat, va_list inArgs)
+{
+    const char* theFormat = inFormat;
+    while ((theFormat = ::strchr(theFormat, '%')) != NULL)
+    {
+        theFormat++;
+        if (*theFormat == '%')
+        {
+            theFormat++;
+            continue;
+        }
+
+        while ((*theFormat != '\0') && (::strchr("-+ #0'", *theFormat) != NULL))
+            theFormat++;
+
+        if (*theFormat == '*')
+        {
+            int theWidth = va_arg(inArgs, int);
+            if (!PutArg(ioRecord, &theWidth, sizeof(theWidth)))
+                return;
+            theFormat++;
+        }
+        else while (::isdigit(*theFormat))
+            theFormat++;
+
+        SInt32 thePrecision = -1;
+        if (*theFormat == '.')
+        {
+            theFormat++;
+            if (*theFormat == '*')
+            {
+                int theStarPrecision = va_arg(inArgs, int);
+                if (!PutArg(ioRecord, &theStarPrecision, sizeof(theStarPrecision)))
+                    return;
+                thePrecision = theStarPrecision;
+                theFormat++;
+            }
+            else
+            {
+                thePrecision = ::atoi(theFormat);
+                while (::isdigit(*theFormat))
+                    theFormat++;
+            }
+        }
+
+        UInt32 theType = ParseLengthModifier(&theFormat);
+        char theConversion = *theFormat;
+        if (theConversion == '\0')
+            return;
+        theFormat++;
+
+        switch (theConversion)
+        {
+            case 'd': case 'i': case 'u': case 'o': case 'x': case 'X': case 'c':
+            {
+                SInt64 theValue = 0;
+                switch (theType)
+                {
+                    case kArgLong:      theValue = (SInt64)va_arg(inArgs, long);        break;
+                    case kArgLongLong:  theValue = (SInt64)va_arg(inArgs, long long);   break;
+                    case kArgSize:      theValue = (SInt64)va_arg(inArgs, size_t);      break;
+                    case kArgIntMax:    theValue = (SInt64)va_arg(inArgs, intmax_t);    break;
+                    case kArgPtrDiff:   theValue = (SInt64)va_arg(inArgs, ptrdiff_t);   break;
+                    default:            theValue = (SInt64)va_arg(inArgs, int);         break;
+                }
+                if (!PutArg(ioRecord, &theValue, sizeof(theValue)))
+                    return;
+                break;
+            }
+            case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+            {
+                Float64 theValue = (theType == kArgLongLong) ? (Float64)va_arg(inArgs, long double) : va_arg(inArgs, double);
+                if (!PutArg(ioRecord, &theValue, sizeof(theValue)))
+                    return;
+                break;
+            }
+            case 'p':
+            {
+                void* theValue = va_arg(inArgs, void*);
+                if (!PutArg(ioRecord, &theValue, sizeof(theValue)))
+                    return;
+                break;
+            }
+            case 's':
+            {
+                const char* theString = va_arg(inArgs, const char*);
+                if (theString == NULL)
+                    theString = "(null)";
+
+                UInt32 theRoom = sizeof(ioRecord->fArgs) - ioRecord->fArgsLen;
+                if (theRoom <= sizeof(UInt16))
+                {
+                    ioRecord->fTruncated = true;
+                    return;
+                }
+                theRoom -= sizeof(UInt16);
+
+                // the string need not be terminated if there is a precision
+                UInt32 theLen = 0;
+                UInt32 theMaxLen = (thePrecision >= 0) ? (UInt32)thePrecision : 0xFFFFFFFF;
+                while ((theLen < theMaxLen) && (theLen < theRoom) && (theString[theLen] != '\0'))
+                    theLen++;
+                if ((theLen == theRoom) && (theLen < theMaxLen) && (theString[theLen] != '\0'))
+                    ioRecord->fTruncated = true;
+
+                UInt16 theStoredLen = (UInt16)theLen;
+                (void)PutArg(ioRecord, &theStoredLen, sizeof(theStoredLen));
+                (void)PutArg(ioRecord, (void*)theString, theLen);
+                break;
+            }
+            default:
+                // %n and anything unknown: nothing sensible can be recorded
+                ioRecord->fTruncated = true;
+                return;
+        }
+    }
+}
+
+// Replays the format of inRecord against the recorded arguments,
+// "<time> <thread> <subsystem> <level> <message>" without a trailing newline
+void OSTrace::FormatRecord(OSTraceRecord* inRecord, char* outLine, UInt32 inLineLen)
+{
+    time_t theSecs = OS::TimeMilli_To_UnixTimeSecs(inRecord->fTimeMilli);
+    struct tm theTime;
+    ::localtime_r(&theSecs, &theTime);
+
+    UInt32 theSubsystem = (inRecord->fSubsystem < kNumSubsystems) ? inRecord->fSubsystem : 0;
+    UInt32 theLevel = (inRecord->fLevel <= kVerbose) ? inRecord->fLevel : kVerbose;
+    int theLen = qtss_snprintf(outLine, inLineLen, "%02d:%02d:%02d.%03d %" _64BITARG_ "x %s %s ",
+                                theTime.tm_hour, theTime.tm_min, theTime.tm_sec, (int)(inRecord->fTimeMilli % 1000),
+                                inRecord->fThreadID, sSubsystemNames[theSubsystem], sLevelNames[theLevel]);
+    UInt32 thePos = ((theLen < 0) || ((UInt32)theLen >= inLineLen)) ? inLineLen - 1 : (UInt32)theLen;
+
+    UInt32 theArgOffset = 0;
+    Bool16 theArgsMissing = false;
+    const char* theFormat = inRecord->fFormat;
+    while ((*theFormat != '\0') && (thePos < inLineLen - 1))
+    {
+        if (*theFormat != '%')
+        {
+            outLine[thePos++] = *theFormat++;
+            continue;
+        }
+        if (theFormat[1] == '%')
+        {
+            outLine[thePos++] = '%';
+            theFormat += 2;
+            continue;
+        }
+
+        // rebuild the conversion with '*' replaced by the recorded values
+        char theSpec[64];
+        UInt32 theSpecLen = 0;
+        theSpec[theSpecLen++] = *theFormat++;
+        while ((*theFormat != '\0') && (::strchr("-+ #0'", *theFormat) != NULL) && (theSpecLen < 8))
+            theSpec[theSpecLen++] = *theFormat++;
+
+        int theWidth = 0;
+        if (*theFormat == '*')
+        {
+            if (!GetArg(inRecord, &theArgOffset, &theWidth, sizeof(theWidth)))
+            {
+                theArgsMissing = true;
+                break;
+            }
+            theSpecLen += qtss_sprintf(&theSpec[theSpecLen], "%d", theWidth);
+            theFormat++;
+        }
+        else while (::isdigit(*theFormat) && (theSpecLen < 20))
+            theSpec[theSpecLen++] = *theFormat++;
+
+        UInt32 thePrecisionStart = theSpecLen;
+        if (*theFormat == '.')
+        {
+            theSpec[theSpecLen++] = *theFormat++;
+            if (*theFormat == '*')
+            {
+                int thePrecision = 0;
+                if (!GetArg(inRecord, &theArgOffset, &thePrecision, sizeof(thePrecision)))
+                {
+                    theArgsMissing = true;
+                    break;
+                }
+                theSpecLen += qtss_sprintf(&theSpec[theSpecLen], "%d", thePrecision);
+                theFormat++;
+            }
+            else while (::isdigit(*theFormat) && (theSpecLen < 40))
+                theSpec[theSpecLen++] = *theFormat++;
+        }
+
+        const char* theModifier = theFormat;
+        UInt32 theType = ParseLengthModifier(&theFormat);
+        while (theModifier < theFormat)
+            theSpec[theSpecLen++] = *theModifier++;
+
+        char theConversion = *theFormat;
+        if (theConversion == '\0')
+            break;
+        theFormat++;
+        theSpec[theSpecLen++] = theConversion;
+        theSpec[theSpecLen] = '\0';
+
+        char* theOut = &outLine[thePos];
+        UInt32 theRoom = inLineLen - thePos;
+        int theWritten = 0;
+        switch (theConversion)
+        {
+            case 'd': case 'i': case 'u': case 'o': case 'x': case 'X': case 'c':
+            {
+                SInt64 theValue = 0;
+                if (!GetArg(inRecord, &theArgOffset, &theValue, sizeof(theValue)))
+                {
+                    theArgsMissing = true;
+                    break;
+                }
+                switch (theType)
+                {
+                    case kArgLong:      theWritten = qtss_snprintf(theOut, theRoom, theSpec, (long)theValue);       break;
+                    case kArgLongLong:  theWritten = qtss_snprintf(theOut, theRoom, theSpec, (long long)theValue);  break;
+                    case kArgSize:      theWritten = qtss_snprintf(theOut, theRoom, theSpec, (size_t)theValue);     break;
+                    case kArgIntMax:    theWritten = qtss_snprintf(theOut, theRoom, theSpec, (intmax_t)theValue);   break;
+                    case kArgPtrDiff:   theWritten = qtss_snprintf(theOut, theRoom, theSpec, (ptrdiff_t)theValue);  break;
+                    default:            theWritten = qtss_snprintf(theOut, theRoom, theSpec, (int)theValue);        break;
+                }
+                break;
+            }
+            case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+            {
+                Float64 theValue = 0;
+                if (!GetArg(inRecord, &theArgOffset, &theValue, sizeof(theValue)))
+                {
+                    theArgsMissing = true;
+                    break;
+                }
+                if (theType == kArgLongLong)
+                    theWritten = qtss_snprintf(theOut, theRoom, theSpec, (long double)theValue);
+                else
+                    theWritten = qtss_snprintf(theOut, theRoom, theSpec, theValue);
+                break;
+            }
+            case 'p':
+            {
+                void* theValue = NULL;
+                if (!GetArg(inRecord, &theArgOffset, &theValue, sizeof(theValue)))
+                {
+                    theArgsMissing = true;
+                    break;
+                }
+                theWritten = qtss_snprintf(theOut, theRoom, theSpec, theValue);
+                break;
+            }
+            case 's':
+            {
+                UInt16 theStrLen = 0;
+                if (!GetArg(inRecord, &theArgOffset, &theStrLen, sizeof(theStrLen)) || (theArgOffset + theStrLen > inRecord->fArgsLen))
+                {
+                    theArgsMissing = true;
+                    break;
+                }
+                // the recorded bytes are not terminated, print them with "%.*s"
+                ::strcpy(&theSpec[thePrecisionStart], ".*s");
+                theWritten = qtss_snprintf(theOut, theRoom, theSpec, (int)theStrLen, &inRecord->fArgs[theArgOffset]);
+                theArgOffset += theStrLen;
+                break;
+            }
+            default:
+                theArgsMissing = true;
+                break;
+        }
+        if (theArgsMissing)
+            break;
+
+        if ((theWritten < 0) || ((UInt32)theWritten >= theRoom))
+            thePos = inLineLen - 1;
+        else
+            thePos += theWritten;
+    }
+
+    if ((theArgsMissing || inRecord->fTruncated) && (thePos + 4 < inLineLen))
+    {
+        ::memcpy(&outLine[thePos], "...", 3);
+        thePos += 3;
+    }
+
+    // the caller adds its own line end
+    while ((thePos > 0) && ((outLine[thePos - 1] == '\n') || (outLine[thePos - 1] == '\r')))
+        thePos--;
+    outLine[thePos] = '\0';
+}
+
+// Takes a consistent copy of record inIndex. Returns false if the record
+// is still being written or has been overwritten by a newer one.
+Bool16 OSTrace::CopyRecord(UInt64 inIndex, OSTraceRecord* outRecord)
+{
+    OSTraceRecord* theRecord = &sRecords[inIndex & (kNumRecords - 1)];
+    if (theRecord->fSequence != inIndex + 1)
+        return false;
+    __sync_synchronize();
+
+    ::memcpy(outRecord, (void*)theRecord, sizeof(OSTraceRecord));
+
+    __sync_synchronize();
+    return theRecord->fSequence == inIndex + 1;
+}
+
+void OSTrace::Drain()
+{
+    UInt64 theEnd = sNextIndex;
+    if (theEnd - sNextToDrain > kNumRecords)
+    {
+        sLostRecords += theEnd - sNextToDrain - kNumRecords;
+        qtss_printf("OSTrace: %" _64BITARG_ "u trace records lost\n", theEnd - sNextToDrain - kNumRecords);
+        sNextToDrain = theEnd - kNumRecords;
+    }
+
+    OSTraceRecord theRecord;
+    char theLine[kMaxLineLen];
+    while (sNextToDrain < theEnd)
+    {
+        if (!OSTrace::CopyRecord(sNextToDrain, &theRecord))
+        {
+            // wait for a writer that has not finished it yet, a newer
+            // sequence means it has been overwritten already
+            if (sRecords[sNextToDrain & (kNumRecords - 1)].fSequence <= sNextToDrain + 1)
+                break;
+            sLostRecords++;
+            sNextToDrain++;
+            continue;
+        }
+
+        OSTrace::FormatRecord(&theRecord, theLine, sizeof(theLine));
+        qtss_printf("%s\n", theLine);
+        sNextToDrain++;
+    }
+}
+
+void OSTrace::Dump(FILE* inFile)
+{
+    UInt64 theEnd = sNextIndex;
+    UInt64 theIndex = (theEnd > kNumRecords) ? theEnd - kNumRecords : 0;
+
+    OSTraceRecord theRecord;
+    char theLine[kMaxLineLen];
+    for ( ; theIndex < theEnd; theIndex++)
+    {
+        if (!OSTrace::CopyRecord(theIndex, &theRecord))
+            continue;
+        OSTrace::FormatRecord(&theRecord, theLine, sizeof(theLine));
+        qtss_fprintf(inFile, "%s\n", theLine);
+    }
+}
+
+OS_Error OSTrace::DumpToFile(char* inPath)
+{
+    FILE* theFile = ::fopen(inPath, "w");
+    if (theFile == NULL)
+        return errno;
+
+    OSTrace::Dump(theFile);
+    ::fclose(theFile);
+    return OS_NoErr;
+}
+
+void OSTraceThread::Entry()
+{
+    while (!this->IsStopRequested())
+    {
+        OSTrace::Drain();
+        OSThread::Sleep(OSTrace::kDrainIntervalInMsec);
+    }
+    OSTrace::Drain();
+}
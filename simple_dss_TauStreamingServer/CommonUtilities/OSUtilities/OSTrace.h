@@ -0,0 +1,164 @@
+/***************************************************************************
+
+Copyright (c) 2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 OSTrace.h
+Description: Leveled per subsystem trace points, recorded in binary form into
+             a ring buffer and formatted later by a background thread.
+Comment:
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-19
+LastUpdate:  2026-10-19
+
+****************************************************************************/
+
+#ifndef _OSTRACE_H_
+#define _OSTRACE_H_
+
+#include <stdio.h>
+#include <stdarg.h>
+#include "OSHeaders.h"
+#include "OSThread.h"
+
+/*
+    OS_TRACE(RTSP, Debug, "format", ...) takes printf style arguments, but
+    the calling thread only copies the format pointer and the raw argument
+    values (and the bytes of %s strings) into a fixed size record of a
+    shared ring buffer. OSTraceThread formats new records every
+    kDrainIntervalInMsec and prints them, Dump() formats whatever is still
+    in the ring, so the last kNumRecords trace points can be looked at
+    after an incident even if nobody was watching the output.
+
+    Format strings must be string literals: only the pointer is recorded.
+
+    A trace point is compiled out when its level is above the compile time
+    limit of its subsystem, OSTRACE_MAX_LEVEL_<SUBSYSTEM>, which defaults to
+    OSTRACE_MAX_LEVEL. Build with -DOSTRACE_MAX_LEVEL=0 to remove every
+    trace point. Trace points that are compiled in cost one compare until
+    SetLevel() / SetLevels() enables their level at runtime.
+*/
+
+#ifndef OSTRACE_MAX_LEVEL
+#if DEBUG
+#define OSTRACE_MAX_LEVEL 5     // OSTrace::kVerbose
+#else
+#define OSTRACE_MAX_LEVEL 2     // OSTrace::kWarning
+#endif
+#endif
+
+#ifndef OSTRACE_MAX_LEVEL_TASK
+#define OSTRACE_MAX_LEVEL_TASK      OSTRACE_MAX_LEVEL
+#endif
+#ifndef OSTRACE_MAX_LEVEL_RTSP
+#define OSTRACE_MAX_LEVEL_RTSP      OSTRACE_MAX_LEVEL
+#endif
+#ifndef OSTRACE_MAX_LEVEL_RTP
+#define OSTRACE_MAX_LEVEL_RTP       OSTRACE_MAX_LEVEL
+#endif
+#ifndef OSTRACE_MAX_LEVEL_RESEND
+#define OSTRACE_MAX_LEVEL_RESEND    OSTRACE_MAX_LEVEL
+#endif
+
+#define OS_TRACE(inSubsystem, inLevel, ...)                                                     \
+    do {                                                                                        \
+        if ((OSTrace::k##inLevel <= OSTRACE_MAX_LEVEL_##inSubsystem)                            \
+            && OSTrace::IsEnabled(OSTrace::k##inSubsystem, OSTrace::k##inLevel))                \
+            OSTrace::Record(OSTrace::k##inSubsystem, OSTrace::k##inLevel, __VA_ARGS__);         \
+    } while (0)
+
+struct OSTraceRecord
+{
+    volatile UInt64 fSequence;      // record index + 1 once complete, 0 while being written
+    SInt64          fTimeMilli;
+    const char*     fFormat;
+    UInt64          fThreadID;
+    UInt16          fSubsystem;
+    UInt16          fLevel;
+    UInt16          fArgsLen;
+    UInt16          fTruncated;     // not all arguments fit into fArgs
+    char            fArgs[216];
+};
+
+class OSTrace
+{
+    public:
+
+        enum
+        {
+            kTASK           = 0,    //UInt32
+            kRTSP           = 1,    //UInt32
+            kRTP            = 2,    //UInt32
+            kRESEND         = 3,    //UInt32
+            kNumSubsystems  = 4     //UInt32
+        };
+
+        enum
+        {
+            kOff            = 0,    //UInt32
+            kError          = 1,    //UInt32
+            kWarning        = 2,    //UInt32
+            kInfo           = 3,    //UInt32
+            kDebug          = 4,    //UInt32
+            kVerbose        = 5     //UInt32
+        };
+
+        enum
+        {
+            kNumRecords             = 4096, //UInt32, must be a power of 2
+            kMaxLineLen             = 1024, //UInt32
+            kDrainIntervalInMsec    = 100   //UInt32
+        };
+
+        // Starts the thread that prints new records
+        static void     Initialize();
+
+        static Bool16   IsEnabled(UInt32 inSubsystem, UInt32 inLevel)
+                            { return inLevel <= sLevels[inSubsystem]; }
+
+        static void     SetLevel(UInt32 inSubsystem, UInt32 inLevel);
+
+        // inSpec is a comma separated list of <subsystem>=<level>, for
+        // example "all=warning,rtsp=debug,resend=5". Subsystems are all,
+        // task, rtsp, rtp and resend, levels are 0 - 5 or their names.
+        // Subsystems not mentioned keep their level.
+        static void     SetLevels(char* inSpec);
+
+        // Lock free, may be called from any thread. Use OS_TRACE instead
+        // unless the caller has a runtime switch of its own.
+        static void     Record(UInt32 inSubsystem, UInt32 inLevel, const char* inFormat, ...)
+                            __attribute__((format(printf, 3, 4)));
+
+        // Formats all records still in the ring, oldest first
+        static void     Dump(FILE* inFile);
+        static OS_Error DumpToFile(char* inPath);
+
+        // Prints the records added since the last call, used by OSTraceThread
+        static void     Drain();
+
+    private:
+
+        static void     PackArgs(OSTraceRecord* ioRecord, const char* inFormat, va_list inArgs);
+        static Bool16   CopyRecord(UInt64 inIndex, OSTraceRecord* outRecord);
+        static void     FormatRecord(OSTraceRecord* inRecord, char* outLine, UInt32 inLineLen);
+
+        static UInt32           sLevels[kNumSubsystems];
+        static OSTraceRecord    sRecords[kNumRecords];
+        static volatile UInt64  sNextIndex;
+        static UInt64           sNextToDrain;
+        static UInt64           sLostRecords;
+};
+
+class OSTraceThread : public OSThread
+{
+    public:
+
+        OSTraceThread() : OSThread() {}
+        virtual ~OSTraceThread() {}
+
+    private:
+
+        virtual void Entry();
+};
+
+#endif //_OSTRACE_H_
@@ -138,10 +138,13 @@ void DateTranslator::UpdateDateBuffer(DateBuffer* inDateBuffer, const SInt64& in
 
 void DateBuffer::InexactUpdate()
 {
+    // Every RTSP request and response gets here, most within the same second
+    // as the last one, so this skips the gmtime and strftime then
     SInt64 theCurTime = OS::Milliseconds();
-    if ((fLastDateUpdate == 0) || ((fLastDateUpdate + kUpdateInterval) < theCurTime))
+    SInt64 theCurSecond = theCurTime / 1000;
+    if (theCurSecond != fLastDateUpdate)
     {
-        fLastDateUpdate = theCurTime;
-        this->Update(0);
+        DateTranslator::UpdateDateBuffer(this, theCurTime);
+        fLastDateUpdate = theCurSecond;
     }
 }
@@ -75,10 +75,10 @@ public:
     
     // Updates this date buffer to reflect the current time.
     // If a date is provided, this updates the DateBuffer to be that date.
-    void Update(const SInt64& inDate)           { DateTranslator::UpdateDateBuffer(this, inDate); }
+    void Update(const SInt64& inDate)           { fLastDateUpdate = 0; DateTranslator::UpdateDateBuffer(this, inDate); }
     
-    // Updates this date buffer to reflect the current time, with a certain degree
-    // of inexactitude (the range of error is defined by the kUpdateInterval value)
+    // Updates this date buffer to reflect the current time, to the second. The
+    // string is only formatted again once the second has changed.
     void InexactUpdate();
     
     //returns a NULL terminated C-string always of kHTTPDateLen length.
@@ -86,14 +86,9 @@ public:
 
 private:
 
-    enum
-    {
-        kUpdateInterval = 60000 // Update every minute
-    };
-
     //+1 for terminator +1 for padding
     char    fDateBuffer[kDateBufferLen + 2];
-    SInt64  fLastDateUpdate;
+    SInt64  fLastDateUpdate; // second of the time in fDateBuffer, 0 if not set by InexactUpdate
     
     friend class DateTranslator;
 };
@@ -19,6 +19,12 @@ LastUpdate:  2010-08-19
 #include "StrPtrLen.h"
 #include "UserAgentParser.h"
 
+OSMutex                         UserAgentParser::sCacheMutex;
+UserAgentParser::CacheEntry     UserAgentParser::sCache[kMaxCachedUserAgents];
+UInt32                          UserAgentParser::sCacheBuckets[kNumCacheBuckets];
+UInt32                          UserAgentParser::sNumCacheEntries = 0;
+UInt32                          UserAgentParser::sNextVictim = 0;
+
 
 
 /* User Agent Ե */
@@ -95,17 +101,152 @@ UInt8 UserAgentParser::sEOLSemicolonCloseParenMask[] =
 };
 
 
+/* ڻвҸUser Agent,ҵֱø,뻺 */
 void UserAgentParser::Parse(StrPtrLen *inStream)
+{
+	/* ṹָ(4ֽ)0 */
+    memset(&fFieldData,0,sizeof(fFieldData) );
+    
+    if ((inStream->Ptr == NULL) || (inStream->Len == 0) || (inStream->Len > kMaxCachedUserAgentLen))
+    {
+        this->ParseFields(inStream);
+        return;
+    }
+    
+    UInt32 theHash = HashUserAgent(inStream);
+    OSMutexLocker theLocker(&sCacheMutex);
+    
+    CacheEntry* theEntry = FindEntry(inStream, theHash);
+    if (theEntry != NULL)
+    {
+        for (UInt32 x = 0; x < eNumAttributes; x++)
+        {
+            if (!theEntry->fFieldFound[x])
+                continue;
+            fFieldData[x].fData.Set(inStream->Ptr + theEntry->fFieldOffset[x], theEntry->fFieldLen[x]);
+            fFieldData[x].fFound = true;
+        }
+        return;
+    }
+    
+    this->ParseFields(inStream);
+    
+    theEntry = AddEntry(inStream, theHash);
+    for (UInt32 y = 0; y < eNumAttributes; y++)
+    {
+        theEntry->fFieldFound[y] = fFieldData[y].fFound;
+        theEntry->fFieldOffset[y] = fFieldData[y].fFound ? (UInt32)(fFieldData[y].fData.Ptr - inStream->Ptr) : 0;
+        theEntry->fFieldLen[y] = fFieldData[y].fFound ? fFieldData[y].fData.Len : 0;
+    }
+}
+
+/* FNV-1a */
+UInt32 UserAgentParser::HashUserAgent(StrPtrLen* inUserAgent)
+{
+    UInt8* theData = (UInt8*)inUserAgent->Ptr;
+    UInt32 theHash = 2166136261U;
+    for (UInt32 x = 0; x < inUserAgent->Len; x++)
+    {
+        theHash ^= theData[x];
+        theHash = (theHash * 16777619U) & 0xFFFFFFFF;
+    }
+    return theHash;
+}
+
+/* ָĻ,ûзNULL */
+UserAgentParser::CacheEntry* UserAgentParser::FindEntry(StrPtrLen* inUserAgent, UInt32 inHash)
+{
+    for (UInt32 x = sCacheBuckets[inHash & (kNumCacheBuckets - 1)]; x != 0; x = sCache[x - 1].fNext)
+    {
+        CacheEntry* theEntry = &sCache[x - 1];
+        if ((theEntry->fHash == inHash) && (theEntry->fLen == inUserAgent->Len) &&
+            (::memcmp(theEntry->fUserAgent, inUserAgent->Ptr, inUserAgent->Len) == 0))
+            return theEntry;
+    }
+    return NULL;
+}
+
+/* һ,ʱ滻 */
+UserAgentParser::CacheEntry* UserAgentParser::AddEntry(StrPtrLen* inUserAgent, UInt32 inHash)
+{
+    UInt32 theIndex = sNumCacheEntries;
+    if (sNumCacheEntries < kMaxCachedUserAgents)
+        sNumCacheEntries++;
+    else
+    {
+        theIndex = sNextVictim;
+        sNextVictim = (sNextVictim + 1) % kMaxCachedUserAgents;
+        
+        // Take it out of its bucket
+        UInt32* thePrev = &sCacheBuckets[sCache[theIndex].fHash & (kNumCacheBuckets - 1)];
+        while (*thePrev != theIndex + 1)
+            thePrev = &sCache[*thePrev - 1].fNext;
+        *thePrev = sCache[theIndex].fNext;
+    }
+    
+    CacheEntry* theEntry = &sCache[theIndex];
+    ::memcpy(theEntry->fUserAgent, inUserAgent->Ptr, inUserAgent->Len);
+    theEntry->fLen = inUserAgent->Len;
+    theEntry->fHash = inHash;
+    theEntry->fHasProfile = false;
+    theEntry->fProfileOwner = NULL;
+    theEntry->fProfileID = 0;
+    theEntry->fProfile = 0;
+    
+    UInt32* theBucket = &sCacheBuckets[inHash & (kNumCacheBuckets - 1)];
+    theEntry->fNext = *theBucket;
+    *theBucket = theIndex + 1;
+    return theEntry;
+}
+
+/* ȡиUser AgentָIDprofile,ûзfalse */
+Bool16 UserAgentParser::GetProfile(StrPtrLen* inUserAgent, void* inProfileOwner, UInt32 inProfileID, UInt32* outProfile)
+{
+    if ((inUserAgent->Ptr == NULL) || (inUserAgent->Len == 0) || (inUserAgent->Len > kMaxCachedUserAgentLen))
+        return false;
+    
+    UInt32 theHash = HashUserAgent(inUserAgent);
+    OSMutexLocker theLocker(&sCacheMutex);
+    
+    CacheEntry* theEntry = FindEntry(inUserAgent, theHash);
+    if ((theEntry == NULL) || !theEntry->fHasProfile || (theEntry->fProfileOwner != inProfileOwner) || (theEntry->fProfileID != inProfileID))
+        return false;
+    
+    *outProfile = theEntry->fProfile;
+    return true;
+}
+
+/* ûиUser Agentprofile,ڻоȽ */
+void UserAgentParser::SetProfile(StrPtrLen* inUserAgent, void* inProfileOwner, UInt32 inProfileID, UInt32 inProfile)
+{
+    if ((inUserAgent->Ptr == NULL) || (inUserAgent->Len == 0) || (inUserAgent->Len > kMaxCachedUserAgentLen))
+        return;
+    
+    UInt32 theHash = HashUserAgent(inUserAgent);
+    OSMutexLocker theLocker(&sCacheMutex);
+    
+    CacheEntry* theEntry = FindEntry(inUserAgent, theHash);
+    if (theEntry == NULL)
+    {
+        // Adds it, the mutex is recursive
+        UserAgentParser theParser(inUserAgent);
+        theEntry = FindEntry(inUserAgent, theHash);
+    }
+    
+    theEntry->fHasProfile = true;
+    theEntry->fProfileOwner = inProfileOwner;
+    theEntry->fProfileID = inProfileID;
+    theEntry->fProfile = inProfile;
+}
+
+/* User Agentĸ */
+void UserAgentParser::ParseFields(StrPtrLen *inStream)
 {
     StrPtrLen tempID;
     StrPtrLen tempData;
     StringParser parser(inStream);/* ε */
     StrPtrLen startFields;
         
-
-	/* ṹָ(4ֽ)0 */
-    memset(&fFieldData,0,sizeof(fFieldData) );
-    
 	/* startFields'('֮ǰĲ */
     parser.ConsumeUntil(&startFields, '(' ); // search for '(', if not found, does nothing
     
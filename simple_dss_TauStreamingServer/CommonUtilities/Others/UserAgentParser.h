@@ -22,6 +22,7 @@ LastUpdate:  2010-08-19
 #include "StringParser.h"
 #include "StringFormatter.h"
 #include "StrPtrLen.h"
+#include "OSMutex.h"
 
 
 
@@ -72,6 +73,53 @@ class UserAgentParser
         
 		//ֻй캯
         UserAgentParser (StrPtrLen *inStream)  { if (inStream != NULL) Parse(inStream); }
+        
+        // A caller's classification of a User-Agent, such as which player
+        // workarounds it needs, kept in the cache along with its fields.
+        // inProfileOwner and inProfileID name what the profile was worked out
+        // from, GetProfile returns false when there is none for both of them.
+        static Bool16 GetProfile(StrPtrLen* inUserAgent, void* inProfileOwner, UInt32 inProfileID, UInt32* outProfile);
+        static void   SetProfile(StrPtrLen* inUserAgent, void* inProfileOwner, UInt32 inProfileID, UInt32 inProfile);
+        
+    private:
+    
+        // Clients send few distinct User-Agents. The fields found in each are
+        // cached as offsets into it, keyed by the whole string, so a repeat is
+        // not parsed again. The cache is bounded, the oldest entry goes first.
+        enum
+        {
+            kMaxCachedUserAgents    = 128,  //UInt32
+            kNumCacheBuckets        = 256,  //UInt32, a power of two
+            kMaxCachedUserAgentLen  = 256   //UInt32, longer ones are parsed each time
+        };
+        
+        struct CacheEntry
+        {
+            char        fUserAgent[kMaxCachedUserAgentLen];
+            UInt32      fLen;
+            UInt32      fHash;
+            UInt32      fNext;              // entry index + 1 in the bucket, 0 at the end
+            UInt32      fFieldOffset[eNumAttributes];
+            UInt32      fFieldLen[eNumAttributes];
+            bool        fFieldFound[eNumAttributes];
+            Bool16      fHasProfile;
+            void*       fProfileOwner;
+            UInt32      fProfileID;
+            UInt32      fProfile;
+        };
+        
+        void                ParseFields(StrPtrLen *inStream);
+        static UInt32       HashUserAgent(StrPtrLen* inUserAgent);
+        
+        // With sCacheMutex held
+        static CacheEntry*  FindEntry(StrPtrLen* inUserAgent, UInt32 inHash);
+        static CacheEntry*  AddEntry(StrPtrLen* inUserAgent, UInt32 inHash);
+        
+        static OSMutex      sCacheMutex;
+        static CacheEntry   sCache[kMaxCachedUserAgents];
+        static UInt32       sCacheBuckets[kNumCacheBuckets];    // entry index + 1, 0 if empty
+        static UInt32       sNumCacheEntries;
+        static UInt32       sNextVictim;
 };
 
 
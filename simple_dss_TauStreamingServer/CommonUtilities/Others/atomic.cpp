@@ -15,6 +15,34 @@ LastUpdate:  2010-08-19
 
 
 #include "atomic.h"
+
+// These back Task::Signal and other per packet paths. gcc's atomic builtins
+// are full barriers and lock free on every platform this server runs on;
+// anything else falls back to one global mutex.
+#if defined(__GNUC__)
+
+unsigned int atomic_add(unsigned int *area, int val)
+{
+    return __sync_add_and_fetch(area, (unsigned int)val);
+}
+
+unsigned int atomic_sub(unsigned int *area,int val)
+{
+    return atomic_add(area,-val);
+}
+
+unsigned int atomic_or(unsigned int *area, unsigned int val)
+{
+    return __sync_fetch_and_or(area, val);
+}
+
+unsigned int compare_and_store(unsigned int oval, unsigned int nval, unsigned int *area)
+{
+    return __sync_bool_compare_and_swap(area, oval, nval) ? 1 : 0;
+}
+
+#else
+
 #include "OSMutex.h"
 
 static OSMutex sAtomicMutex;
@@ -55,3 +83,5 @@ unsigned int compare_and_store(unsigned int oval, unsigned int nval, unsigned in
     rv=0;
     return rv;
 }
+
+#endif
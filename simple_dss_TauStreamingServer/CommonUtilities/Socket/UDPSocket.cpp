@@ -17,6 +17,7 @@ LastUpdate:  2010-08-19
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <errno.h>
+#include <time.h>
 #include "UDPSocket.h"
 #include "OSMemory.h"
 
@@ -28,7 +29,7 @@ LastUpdate:  2010-08-19
 
 /* עǴӸSocket̳,еһRTCPTask,μRTPSocketPool::ConstructUDPSocketPair() */
 UDPSocket::UDPSocket(Task* inTask, UInt32 inSocketType)
-: Socket(inTask, inSocketType), fDemuxer(NULL)
+: Socket(inTask, inSocketType), fDemuxer(NULL), fTxTimeEnabled(false)
 {
 	//SocketkWantsDemuxer,ʹUDPDemuxerʵ
     if (inSocketType & kWantsDemuxer)
@@ -61,6 +62,78 @@ OS_Error UDPSocket::SendTo(UInt32 inRemoteAddr, UInt16 inRemotePort, void* inBuf
     return OS_NoErr;
 }
 
+/* SO_TXTIME,ʱCLOCK_MONOTONICΪ׼,fq qdiscʱ */
+OS_Error UDPSocket::EnableTxTime()
+{
+#if defined(__linux__) && defined(SO_TXTIME)
+    struct sock_txtime
+    {
+        clockid_t   clockid;
+        unsigned int flags;     // __u32, UInt32 is 64 bits on some platforms
+    } theTxTime;
+    theTxTime.clockid = CLOCK_MONOTONIC;
+    theTxTime.flags = 0;
+
+    int err = ::setsockopt(fFileDesc, SOL_SOCKET, SO_TXTIME, (char*)&theTxTime, sizeof(theTxTime));
+    if (err == -1)
+        return (OS_Error)OSThread::GetErrno();
+
+    fTxTimeEnabled = true;
+    return OS_NoErr;
+#else
+    return ENOPROTOOPT;
+#endif
+}
+
+/* ͬSendTo(),ҪںinDelayInMicroSecs΢ŷݱ */
+OS_Error UDPSocket::SendToLater(UInt32 inRemoteAddr, UInt16 inRemotePort, void* inBuffer, UInt32 inLength, UInt32 inDelayInMicroSecs)
+{
+#if defined(__linux__) && defined(SO_TXTIME)
+    if (!fTxTimeEnabled || (inDelayInMicroSecs == 0))
+        return this->SendTo(inRemoteAddr, inRemotePort, inBuffer, inLength);
+
+    Assert(inBuffer != NULL);
+
+    struct sockaddr_in  theRemoteAddr;
+    theRemoteAddr.sin_family = AF_INET;
+    theRemoteAddr.sin_port = htons(inRemotePort);
+    theRemoteAddr.sin_addr.s_addr = htonl(inRemoteAddr);
+
+    struct timespec theNow;
+    ::clock_gettime(CLOCK_MONOTONIC, &theNow);
+    UInt64 theTxTime = ((UInt64)theNow.tv_sec * 1000000000) + (UInt64)theNow.tv_nsec + ((UInt64)inDelayInMicroSecs * 1000);
+
+    char theControl[CMSG_SPACE(sizeof(UInt64))];
+    ::memset(theControl, 0, sizeof(theControl));
+
+    struct iovec theIOVec;
+    theIOVec.iov_base = (char*)inBuffer;
+    theIOVec.iov_len = inLength;
+
+    struct msghdr theMsg;
+    ::memset(&theMsg, 0, sizeof(theMsg));
+    theMsg.msg_name = &theRemoteAddr;
+    theMsg.msg_namelen = sizeof(theRemoteAddr);
+    theMsg.msg_iov = &theIOVec;
+    theMsg.msg_iovlen = 1;
+    theMsg.msg_control = theControl;
+    theMsg.msg_controllen = sizeof(theControl);
+
+    struct cmsghdr* theCMsg = CMSG_FIRSTHDR(&theMsg);
+    theCMsg->cmsg_level = SOL_SOCKET;
+    theCMsg->cmsg_type = SCM_TXTIME;
+    theCMsg->cmsg_len = CMSG_LEN(sizeof(UInt64));
+    ::memcpy(CMSG_DATA(theCMsg), &theTxTime, sizeof(theTxTime));
+
+    int theErr = ::sendmsg(fFileDesc, &theMsg, 0);
+    if (theErr == -1)
+        return (OS_Error)OSThread::GetErrno();
+    return OS_NoErr;
+#else
+    return this->SendTo(inRemoteAddr, inRemotePort, inBuffer, inLength);
+#endif
+}
+
 /* Էӷʽ(UDP Socket)һݱԴַͽݳ */
 OS_Error UDPSocket::RecvFrom(UInt32* outRemoteAddr, UInt16* outRemotePort,
                             void* ioBuffer, UInt32 inBufLen, UInt32* outRecvLen)
@@ -90,6 +163,54 @@ OS_Error UDPSocket::RecvFrom(UInt32* outRemoteAddr, UInt16* outRemotePort,
     return OS_NoErr;        
 }
 
+/* һϵͳýնݱ,RTCPTask */
+OS_Error UDPSocket::RecvFromMultiple(char* ioBuffers, UInt32 inBufLen, UInt32 inNumPackets,
+                                     UInt32* outRemoteAddrs, UInt16* outRemotePorts, UInt32* outRecvLens,
+                                     UInt32* outNumPackets)
+{
+    Assert(outNumPackets != NULL);
+    *outNumPackets = 0;
+
+#if defined(__linux__) && defined(MSG_WAITFORONE)
+    enum { kMaxPackets = 32 };
+    if (inNumPackets > kMaxPackets)
+        inNumPackets = kMaxPackets;
+
+    struct mmsghdr      theMsgs[kMaxPackets];
+    struct iovec        theIOVecs[kMaxPackets];
+    struct sockaddr_in  theAddrs[kMaxPackets];
+    ::memset(theMsgs, 0, sizeof(struct mmsghdr) * inNumPackets);
+    for (UInt32 x = 0; x < inNumPackets; x++)
+    {
+        theIOVecs[x].iov_base = ioBuffers + (x * inBufLen);
+        theIOVecs[x].iov_len = inBufLen;
+        theMsgs[x].msg_hdr.msg_name = &theAddrs[x];
+        theMsgs[x].msg_hdr.msg_namelen = sizeof(theAddrs[x]);
+        theMsgs[x].msg_hdr.msg_iov = &theIOVecs[x];
+        theMsgs[x].msg_hdr.msg_iovlen = 1;
+    }
+
+    int theNumRecvd = ::recvmmsg(fFileDesc, theMsgs, inNumPackets, 0, NULL);
+    if (theNumRecvd == -1)
+        return (OS_Error)OSThread::GetErrno();
+
+    for (int y = 0; y < theNumRecvd; y++)
+    {
+        outRemoteAddrs[y] = ntohl(theAddrs[y].sin_addr.s_addr);
+        outRemotePorts[y] = ntohs(theAddrs[y].sin_port);
+        outRecvLens[y] = theMsgs[y].msg_len;
+    }
+    *outNumPackets = (UInt32)theNumRecvd;
+    return OS_NoErr;
+#else
+    Assert(inNumPackets > 0);
+    OS_Error theErr = this->RecvFrom(&outRemoteAddrs[0], &outRemotePorts[0], ioBuffers, inBufLen, &outRecvLens[0]);
+    if (theErr == OS_NoErr)
+        *outNumPackets = 1;
+    return theErr;
+#endif
+}
+
 /* öಥṹӦSocket */
 OS_Error UDPSocket::JoinMulticast(UInt32 inRemoteAddr)
 {
@@ -58,6 +58,22 @@ class   UDPSocket : public Socket
         /* Էӷʽ(UDP Socket)һݱԴַͽݳ */                
         OS_Error    RecvFrom(UInt32* outRemoteAddr, UInt16* outRemotePort,
                      void* ioBuffer, UInt32 inBufLen, UInt32* outRecvLen);
+
+        // Receives up to inNumPackets datagrams, with one recvmmsg on Linux, into
+        // ioBuffers, which holds inNumPackets buffers of inBufLen bytes one after
+        // the other. The out arrays have inNumPackets entries. *outNumPackets is
+        // 0 if there was nothing to read, the error is EAGAIN then.
+        OS_Error    RecvFromMultiple(char* ioBuffers, UInt32 inBufLen, UInt32 inNumPackets,
+                     UInt32* outRemoteAddrs, UInt16* outRemotePorts, UInt32* outRecvLens,
+                     UInt32* outNumPackets);
+
+        // Linux SO_TXTIME: packets sent with SendToLater() carry a transmit time
+        // and are held back by the fq qdisc until then. Returns ENOPROTOOPT where
+        // the option does not exist; SendToLater() then sends right away.
+        OS_Error    EnableTxTime();
+        Bool16      IsTxTimeEnabled()   { return fTxTimeEnabled; }
+        OS_Error    SendToLater(UInt32 inRemoteAddr, UInt16 inRemotePort,
+                                    void* inBuffer, UInt32 inLength, UInt32 inDelayInMicroSecs);
         
         //A UDP socket may or may not have a demuxer() associated with it. The demuxer
         //is a data structure so the socket can associate incoming data with the proper
@@ -71,6 +87,8 @@ class   UDPSocket : public Socket
         UDPDemuxer* fDemuxer;
 		/* ͨUDP SocketMessage(Message handler)Socketַ */
         struct sockaddr_in  fMsgAddr;
+
+        Bool16      fTxTimeEnabled;
 };
 #endif // __UDPSOCKET_H__
 
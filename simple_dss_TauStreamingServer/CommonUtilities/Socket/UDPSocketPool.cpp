@@ -16,44 +16,107 @@ LastUpdate:  2010-08-19
 
 
 #include "UDPSocketPool.h"
+#include "OSMemory.h"
 
 
-/* ԴIPַͶ˿ڷ: һʱ,ͨѭҳҪĲdemuxerеUDPSocketPair;½ҪUDPSocketPair */
+// The pairs bound to one local address, and a bit for each port pair in
+// kLowestUDPPort..kHighestUDPPort that one of them holds
+class UDPSocketPoolAddr
+{
+    public:
+
+        UDPSocketPoolAddr(UInt32 inAddr, UInt32 inNumPortPairs)
+        :   fAddr(inAddr), fPairs(), fPortMap(NEW UInt32[(inNumPortPairs + 31) / 32]),
+            fNextPortPair(0), fElem()
+        {
+            ::memset(fPortMap, 0, sizeof(UInt32) * ((inNumPortPairs + 31) / 32));
+            fElem.SetEnclosingObject(this);
+        }
+        ~UDPSocketPoolAddr() { delete [] fPortMap; }
+
+        Bool16  IsInUse(UInt32 inPortPair)  { return ((fPortMap[inPortPair >> 5] >> (inPortPair & 31)) & 1) != 0; }
+        void    SetInUse(UInt32 inPortPair, Bool16 inUse)
+        {
+            if (inUse)
+                fPortMap[inPortPair >> 5] |= (1UL << (inPortPair & 31));
+            else
+                fPortMap[inPortPair >> 5] &= ~(1UL << (inPortPair & 31));
+        }
+
+        UInt32      fAddr;
+        OSQueue     fPairs;
+        UInt32*     fPortMap;
+        UInt32      fNextPortPair;  // the search for a free port pair starts here
+        OSQueueElem fElem;
+};
+
+UDPSocketPool::~UDPSocketPool()
+{
+    while (fAddrQueue.GetLength() > 0)
+        delete (UDPSocketPoolAddr*)fAddrQueue.DeQueue()->GetEnclosingObject();
+}
+
+//check to make sure this source IP & port is not already in the demuxer.
+//If not, the pair can be shared with this source.
+/* ûеõUDPSocketPairһUDP Socket(RTCP)UDPDemuxerָ(ûи),ҵָ,
+   ָIPַͶ˿ûзTask,ͿԸ */
+static Bool16 CanShareUDPSocketPair(UDPSocketPair* inPair, UInt32 inSrcIPAddr, UInt16 inSrcPort)
+{
+    UDPDemuxer* theDemuxer = inPair->GetSocketB()->GetDemuxer();
+    return (theDemuxer == NULL) ||
+            ((!theDemuxer->AddrInMap(0, 0)) && (!theDemuxer->AddrInMap(inSrcIPAddr, inSrcPort)));
+}
+
+/* ԴIPַͶ˿ڷ: һʱ,ҳҪĲdemuxerеUDPSocketPair;½ҪUDPSocketPair */
 UDPSocketPair* UDPSocketPool::GetUDPSocketPair(UInt32 inIPAddr, UInt16 inPort,
                                                 UInt32 inSrcIPAddr, UInt16 inSrcPort)
 {
     OSMutexLocker locker(&fMutex);
-	/* source IP address or portһʱ,UDPSocketPairɵpool */
+	/* source IP address or portһʱ,ҿɸõUDPSocketPair */
     if ((inSrcIPAddr != 0) || (inSrcPort != 0))
     {
-        for (OSQueueIter qIter(&fUDPQueue); !qIter.IsDone(); qIter.Next())
+        UDPSocketPair* theElem = NULL;
+        if (inPort != 0)
         {
-            //If we find a pair that is a) on the right IP address, and b) doesn't
-            //have this source IP & port in the demuxer already, we can return this pair
-			/* ȡǰUDPSocketPairеQueue elemڵָ,μUDPSocketPairඨ */
-            UDPSocketPair* theElem = (UDPSocketPair*)qIter.GetCurrent()->GetEnclosingObject();
-			/* UDPSocketPairıصַָĵַ,Ҷ˿ҪôΪ0(󶨵Ķ˿ں),ҪôָĶ˿ں */
-            if ((theElem->fSocketA->GetLocalAddr() == inIPAddr) &&
-                ((inPort == 0) || (theElem->fSocketA->GetLocalPort() == inPort)))
+            //If port is specified, there is only one pair that can match, and if
+            //it can't be shared, there is NO WAY a socket pair can exist that matches
+            //the criteria (because caller wants a specific ip & port combination)
+            UDPSocketPairKey theKey(inIPAddr, inPort);
+            theElem = fPairTable.Map(&theKey);
+            if ((theElem != NULL) && !CanShareUDPSocketPair(theElem, inSrcIPAddr, inSrcPort))
+                return NULL;
+        }
+        else
+        {
+            //Any pair on the right IP address that doesn't have this source IP & port
+            //in the demuxer already will do
+            UDPSocketPoolAddr* theAddr = this->GetAddr(inIPAddr, false);
+            if (theAddr != NULL)
             {
-                //check to make sure this source IP & port is not already in the demuxer.
-                //If not, we can return this socket pair.
-				/* ûеõUDPSocketPairһUDP Socket(RTCP)UDPDemuxerָ(ûи),ҵָ,
-				   ָIPַͶ˿ûзTask,Ӽ, */
-                if ((theElem->fSocketB->GetDemuxer() == NULL) ||
-                    ((!theElem->fSocketB->GetDemuxer()->AddrInMap(0, 0)) &&
-                    (!theElem->fSocketB->GetDemuxer()->AddrInMap(inSrcIPAddr, inSrcPort))))
+                for (OSQueueIter qIter(&theAddr->fPairs); !qIter.IsDone(); qIter.Next())
+                {
+                    UDPSocketPair* thePair = (UDPSocketPair*)qIter.GetCurrent()->GetEnclosingObject();
+                    if (CanShareUDPSocketPair(thePair, inSrcIPAddr, inSrcPort))
+                    {
+                        theElem = thePair;
+                        break;
+                    }
+                }
+
+                // Move it to the back, so the next stream gets the next pair
+                if (theElem != NULL)
                 {
-                    theElem->fRefCount++;
-                    return theElem;
+                    theAddr->fPairs.Remove(&theElem->fAddrElem);
+                    theAddr->fPairs.EnQueue(&theElem->fAddrElem);
                 }
-                //If port is specified, there is NO WAY a socket pair can exist that matches
-                //the criteria (because caller wants a specific ip & port combination)
-				/* inPort,ֻһλ,,ζŲʧ,NULL */
-                else if (inPort != 0)
-                    return NULL;
             }
         }
+
+        if (theElem != NULL)
+        {
+            theElem->fRefCount++;
+            return theElem;
+        }
     }
     //if we get here, there is no UDP Socket pair already in the pool that matches the specified criteria, so we have to create a new pair.
     //ǵ,˵ǰUDPSocketPairûзָ׼UDPSocketPair,ֻ½һ,pool
@@ -68,6 +131,13 @@ void UDPSocketPool::ReleaseUDPSocketPair(UDPSocketPair* inPair)
     if (inPair->fRefCount == 0)
     {
         fUDPQueue.Remove(&inPair->fElem);
+        inPair->fAddr->fPairs.Remove(&inPair->fAddrElem);
+        fPairTable.Remove(inPair);
+
+        UInt16 thePort = inPair->fSocketA->GetLocalPort();
+        if ((thePort >= kLowestUDPPort) && (((thePort - kLowestUDPPort) & 1) == 0))
+            inPair->fAddr->SetInUse((thePort - kLowestUDPPort) / 2, false);
+
         this->DestructUDPSocketPair(inPair);
     }
 }
@@ -77,74 +147,111 @@ void UDPSocketPool::ReleaseUDPSocketPair(UDPSocketPair* inPair)
 UDPSocketPair*  UDPSocketPool::CreateUDPSocketPair(UInt32 inAddr, UInt16 inPort)
 {
     OSMutexLocker locker(&fMutex);
+    UDPSocketPair* theElem = this->NewUDPSocketPair();
+    if (theElem == NULL)
+        return NULL;
+
+    UDPSocketPoolAddr* theAddr = this->GetAddr(inAddr, true);
+
+    //If port is 0, then the caller doesn't care what port # we bind this socket to.
+    //Otherwise, ONLY attempt to bind this socket to the specified port
+	/* ָĶ˿ںΪ0,߲ʵʰ󶨵ĸ˿ں;,ָֻܰĶ˿ں */
+    if (inPort != 0)
+    {
+        if (this->BindUDPSocketPair(theElem, theAddr, inPort) == OS_NoErr)
+            return theElem;
+        this->DestructUDPSocketPair(theElem);
+        return NULL;
+    }
+
+    //try to find an open pair of ports to bind these sockets to. Start after the pair
+    //found last time and skip the ones the pool holds, rather than trying every port
+    //from kLowestUDPPort up
+	/* һδʹõĶ˿(Χ6970~65536)󶨵UDPSocketPair */
+    for (UInt32 theCount = 0; theCount < kNumPortPairs; theCount++)
+    {
+        UInt32 thePortPair = (theAddr->fNextPortPair + theCount) % kNumPortPairs;
+        if (theAddr->IsInUse(thePortPair))
+            continue;
+
+        if (this->BindUDPSocketPair(theElem, theAddr, (UInt16)(kLowestUDPPort + (thePortPair * 2))) == OS_NoErr)
+        {
+            theAddr->fNextPortPair = (thePortPair + 1) % kNumPortPairs;
+            return theElem;
+        }
+
+        // The RTP port was free but the RTCP one wasn't. A bound socket can't be
+        // bound again, so go on with new sockets
+        if (theElem->fSocketA->GetLocalPort() != 0)
+        {
+            this->DestructUDPSocketPair(theElem);
+            theElem = this->NewUDPSocketPair();
+            if (theElem == NULL)
+                return NULL;
+        }
+    }
+    //if we couldn't find a pair of sockets, make sure to clean up our mess
+	/* ѭûгɹ,ٸUDP Socket Pair */
+    this->DestructUDPSocketPair(theElem);
+    return NULL;
+}
+
+UDPSocketPair* UDPSocketPool::NewUDPSocketPair()
+{
 	/* RTPSocketPool(μQTSServer.cpp)UDP Socket Pair,ӷȡRTCPʵָ벢ӦһUDPSocketPairʵ */
     UDPSocketPair* theElem = ConstructUDPSocketPair();
 	/* ȷɳɹ */
     Assert(theElem != NULL);
 	/* ȷUDP Socket Pair˵UDPSocketɳɹ, */
-    if (theElem->fSocketA->Open() != OS_NoErr)
+    if ((theElem->fSocketA->Open() != OS_NoErr) || (theElem->fSocketB->Open() != OS_NoErr))
     {
 		/* ԴʵֲμRTPSocketPool(μQTSServer.cpp),ɾȥָ(,洴)һUDPSocketPairʵ */
         this->DestructUDPSocketPair(theElem);
         return NULL;
     }
-    if (theElem->fSocketB->Open() != OS_NoErr)
-    {
-        this->DestructUDPSocketPair(theElem);
-        return NULL;
-    }
     
     // Set socket options on these new sockets
-	/* RTPSocketPool(μQTSServer.cpp)UDP Socket Pairoptions,: UDP socketԵķbufferջС:
-	һù̶,ڶҪ,:UDPSocketPairⷢRTPݵsocket bufferСΪ256Kֽ,Ԥֵʼ,Լ
-	̬RTCP socketbufferĴС */
+	/* RTPSocketPool(μQTSServer.cpp)UDP Socket Pairoptions */
     this->SetUDPSocketOptions(theElem);
-    
-    //try to find an open pair of ports to bind these sockets to
-	/* һδʹõĶ˿(Χ6970~65536)󶨵UDPSocketPair,ʼֵΪfalse,úúֵ */
-    Bool16 foundPair = false;
-    
-    //If port is 0, then the caller doesn't care what port # we bind this socket to.
-    //Otherwise, ONLY attempt to bind this socket to the specified port
-	/* ָĶ˿ںΪ0,߲ʵʰ󶨵ĸ˿ں;,ָֻܰĶ˿ں */
-    UInt16 startIndex = kLowestUDPPort;
-    if (inPort != 0)
-        startIndex = inPort;
-    UInt16 stopIndex = kHighestUDPPort;
-    if (inPort != 0)
-        stopIndex = inPort;
-    
-	/* ҪһԶ˿,ʼ˿ڲֵʱ,ѭҶ˿ڵ */
-    while ((!foundPair) && (startIndex <= kHighestUDPPort))
+    return theElem;
+}
+
+OS_Error UDPSocketPool::BindUDPSocketPair(UDPSocketPair* inPair, UDPSocketPoolAddr* inAddr, UInt16 inPort)
+{
+	//󶨳ɹRTP˿ںź, ٽŰRTCP˿ں
+    OS_Error theErr = inPair->fSocketA->Bind(inAddr->fAddr, inPort);
+    if (theErr == OS_NoErr)
+        theErr = inPair->fSocketB->Bind(inAddr->fAddr, inPort + 1);
+    if (theErr != OS_NoErr)
+        return theErr;
+
+	/* 󶨺UDP Socket PairUDPSocketPairĶ,UDP Socket Pair1 */
+    fUDPQueue.EnQueue(&inPair->fElem);
+    inAddr->fPairs.EnQueue(&inPair->fAddrElem);
+    inPair->fAddr = inAddr;
+    inPair->fHashValue = UDPSocketPairKey::ComputeHashValue(inAddr->fAddr, inPort);
+    fPairTable.Add(inPair);
+
+    if ((inPort >= kLowestUDPPort) && (((inPort - kLowestUDPPort) & 1) == 0))
+        inAddr->SetInUse((inPort - kLowestUDPPort) / 2, true);
+
+    inPair->fRefCount++;
+    return OS_NoErr;
+}
+
+UDPSocketPoolAddr* UDPSocketPool::GetAddr(UInt32 inAddr, Bool16 inCreate)
+{
+    for (OSQueueIter qIter(&fAddrQueue); !qIter.IsDone(); qIter.Next())
     {
-        OS_Error theErr = theElem->fSocketA->Bind(inAddr, startIndex);
-		//󶨳ɹRTP˿ںź, ٽŰRTCP˿ں
-        if (theErr == OS_NoErr)
-        {
-            theErr = theElem->fSocketB->Bind(inAddr, startIndex+1);
-			/* Socketɹʱ */
-            if (theErr == OS_NoErr)
-            {
-				/* ʾҵ˿ */
-                foundPair = true;
-				/* 󶨺UDP Socket PairUDPSocketPairĶ */
-                fUDPQueue.EnQueue(&theElem->fElem);
-				/* UDP Socket Pair1 */
-                theElem->fRefCount++;
-				/* ظUDP Socket Pair */
-                return theElem;
-            }
-        }
-        //If we are looking to bind to a specific port set, and we couldn't then
-        //just break it out here.
-		/* ʱinPort(˵ǲܰ󶨵ָ˿),Ψһһΰ󶨻ûгɹ,ж */
-        if (inPort != 0)
-            break;
-		/* ,ٴѭҶ˿,עǳɶԲ,21 ! */
-        startIndex += 2;
+        UDPSocketPoolAddr* theAddr = (UDPSocketPoolAddr*)qIter.GetCurrent()->GetEnclosingObject();
+        if (theAddr->fAddr == inAddr)
+            return theAddr;
     }
-    //if we couldn't find a pair of sockets, make sure to clean up our mess
-	/* ָĶ˿ںΪ0,ѭûгɹ,ٸUDP Socket Pair */
-    this->DestructUDPSocketPair(theElem);
-    return NULL;
+
+    if (!inCreate)
+        return NULL;
+
+    UDPSocketPoolAddr* theAddr = NEW UDPSocketPoolAddr(inAddr, kNumPortPairs);
+    fAddrQueue.EnQueue(&theAddr->fElem);
+    return theAddr;
 }
@@ -23,16 +23,21 @@ LastUpdate:  2010-08-19
 #include "UDPSocket.h"
 #include "OSMutex.h"
 #include "OSQueue.h"
+#include "OSHashTable.h"
 
 
 class UDPSocketPair;
+class UDPSocketPairKey;
+class UDPSocketPoolAddr;
+
+typedef OSHashTable<UDPSocketPair, UDPSocketPairKey> UDPSocketPairHashTable;
 
 class UDPSocketPool
 {
     public:
     
-        UDPSocketPool() : fMutex() {}
-        virtual ~UDPSocketPool() {}
+        UDPSocketPool() : fMutex(), fPairTable(kPairTableSize) {}
+        virtual ~UDPSocketPool();
         
         //Skanky(˷) access to member data
         OSMutex*    GetMutex()          { return &fMutex; }
@@ -44,6 +49,7 @@ class UDPSocketPool
         //inSrcIPAddr = srcIP address of incoming packets for the demuxer(refer to note in UDPSocket.h).
         //inSrcPort = src port of incoming packets for the demuxer.
         //This may return NULL if no pair is available that meets the criteria.
+        //Pairs that can be shared are handed out round robin among those on inIPAddr.
 		/* ԴIPַͶ˿ڷ: һʱ,ͨѭҳҪĲdemuxerеUDPSocketPair;½ҪUDPSocketPair */
         UDPSocketPair*  GetUDPSocketPair(UInt32 inIPAddr, UInt16 inPort,
                                             UInt32 inSrcIPAddr, UInt16 inSrcPort);
@@ -75,13 +81,29 @@ class UDPSocketPool
         enum
         {
             kLowestUDPPort = 6970,  //UInt16
-            kHighestUDPPort = 65535 //UInt16
+            kHighestUDPPort = 65535, //UInt16
+            kNumPortPairs = (kHighestUDPPort - kLowestUDPPort + 1) / 2, //UInt32
+            kPairTableSize = 2747   //UInt32
         };
+
+        // Finds the entry of a local address, or creates it if inCreate
+        UDPSocketPoolAddr*  GetAddr(UInt32 inAddr, Bool16 inCreate);
+
+        // Binds the pair to inPort and inPort + 1, and adds it to the pool
+        OS_Error            BindUDPSocketPair(UDPSocketPair* inPair, UDPSocketPoolAddr* inAddr, UInt16 inPort);
+
+        // Constructs, opens and sets the options of a new pair, NULL on failure
+        UDPSocketPair*      NewUDPSocketPair();
     
 		/* UDPSocketPairɵĶ */
         OSQueue fUDPQueue;
 		/* UDPSocketPoolӦĻ */
         OSMutex fMutex;
+
+        // Local addresses the pairs are bound to, a handful at most
+        OSQueue                 fAddrQueue;
+        // Pairs by the local address and port of their RTP socket
+        UDPSocketPairHashTable  fPairTable;
 };
 
 /* UDPSocketϳUDPsocketPair,ΪһԪUDPSocket Pool,UDPSocketPoolͳһά͹ */
@@ -90,7 +112,9 @@ class UDPSocketPair
     public:
         
         UDPSocketPair(UDPSocket* inSocketA, UDPSocket* inSocketB)
-            : fSocketA(inSocketA), fSocketB(inSocketB), fRefCount(0), fElem() {fElem.SetEnclosingObject(this);/* Queue elemڵָ */}
+            : fSocketA(inSocketA), fSocketB(inSocketB), fRefCount(0), fElem(), fAddrElem(),
+              fAddr(NULL), fHashValue(0), fNextHashEntry(NULL)
+            { fElem.SetEnclosingObject(this);/* Queue elemڵָ */ fAddrElem.SetEnclosingObject(this); }
         ~UDPSocketPair() {}
     
 		//accessors
@@ -106,8 +130,51 @@ class UDPSocketPair
         UInt32      fRefCount;
 		/* Ԫ */
         OSQueueElem fElem;
+
+        // In the queue of pairs on its local address
+        OSQueueElem         fAddrElem;
+        UDPSocketPoolAddr*  fAddr;
+
+        // Of the local address and port of fSocketA, for fPairTable
+        UInt32              fHashValue;
+        UDPSocketPair*      fNextHashEntry;
         
         friend class UDPSocketPool;
+        friend class UDPSocketPairKey;
+        friend class OSHashTable<UDPSocketPair, UDPSocketPairKey>;
+};
+
+//IMPLEMENTATION ONLY:
+//key of UDPSocketPool::fPairTable, see UDPDemuxerKey
+class UDPSocketPairKey
+{
+    private:
+
+        UDPSocketPairKey(UInt32 inLocalAddr, UInt16 inLocalPort)
+            :   fLocalAddr(inLocalAddr), fLocalPort(inLocalPort),
+                fHashValue(ComputeHashValue(inLocalAddr, inLocalPort)) {}
+
+        //only used by the hash table itself
+        UDPSocketPairKey(UDPSocketPair* elem)
+            :   fLocalAddr(elem->fSocketA->GetLocalAddr()), fLocalPort(elem->fSocketA->GetLocalPort()),
+                fHashValue(elem->fHashValue) {}
+
+        ~UDPSocketPairKey() {}
+
+        static UInt32 ComputeHashValue(UInt32 inLocalAddr, UInt16 inLocalPort)
+            { return ((inLocalAddr << 16) + inLocalPort); }
+
+        UInt32      GetHashKey()        { return fHashValue; }
+
+        friend int operator ==(const UDPSocketPairKey &key1, const UDPSocketPairKey &key2)
+            { return (key1.fLocalAddr == key2.fLocalAddr) && (key1.fLocalPort == key2.fLocalPort); }
+
+        UInt32  fLocalAddr;
+        UInt16  fLocalPort;
+        UInt32  fHashValue;
+
+        friend class UDPSocketPool;
+        friend class OSHashTable<UDPSocketPair, UDPSocketPairKey>;
 };
 #endif // __UDPSOCKETPOOL_H__
 
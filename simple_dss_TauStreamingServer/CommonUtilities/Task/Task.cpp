@@ -20,6 +20,7 @@ LastUpdate:  2010-08-18
 #include "OSMemory.h"
 #include "atomic.h" /* use atom_sub() */
 #include "OSMutexRW.h"
+#include "OSShardedCounter.h"
 
 
 unsigned int    Task::sThreadPicker = 0;
@@ -27,7 +28,8 @@ OSMutexRW       TaskThreadPool::sMutexRW;
 static char*    sTaskStateStr="live_"; //Alive
 
 Task::Task()
-:   fEvents(0), fUseThisThread(NULL), fWriteLock(false), fTimerHeapElem(), fTaskQueueElem()
+:   fEvents(0), fUseThisThread(NULL), fWriteLock(false), fTimerHeapElem(), fTimerSlotElem(),
+    fTimerSlotTime(0), fUseTimerSlots(false), fTaskQueueElem()
 {
 #if DEBUG
     fInRunCount = 0;
@@ -37,6 +39,7 @@ Task::Task()
 	/* ݳԱڵ */
 	fTaskQueueElem.SetEnclosingObject(this);
 	fTimerHeapElem.SetEnclosingObject(this);
+	fTimerSlotElem.SetEnclosingObject(this);
 
 }
 
@@ -62,7 +65,7 @@ Bool16 Task::Valid()
          || (0 != ::strncmp(sTaskStateStr,this->fTaskName, 5))
          )
      {
-        if (TASK_DEBUG) qtss_printf(" Task::Valid Found invalid task = %ld\n", this);
+        OS_TRACE(TASK, Error, " Task::Valid Found invalid task = %p\n", this);
         
         return false;
      }
@@ -107,7 +110,7 @@ void Task::Signal(EventFlags events)
             // Task needs to be placed on a particular thread.
          {
             if (TASK_DEBUG) if (fTaskName[0] == 0) ::strcpy(fTaskName, " corrupt task");
-            if (TASK_DEBUG) qtss_printf("Task::Signal enque TaskName=%s fUseThisThread=%lu q elem=%lu enclosing=%lu\n", fTaskName, (UInt32) fUseThisThread, (UInt32) &fTaskQueueElem, (UInt32) this);
+            OS_TRACE(TASK, Verbose, "Task::Signal enque TaskName=%s fUseThisThread=%p q elem=%p enclosing=%p\n", fTaskName, fUseThisThread, &fTaskQueueElem, this);
 			/* ӦĶԪָ뵱ǰ߳ڵTask */
             fUseThisThread->fTaskQueue.EnQueue(&fTaskQueueElem);
         }
@@ -119,13 +122,13 @@ void Task::Signal(EventFlags events)
             theThread %= TaskThreadPool::sNumTaskThreads;
 			/* Ԥȴ,ֻTASK_DEBUGʱ */
             if (TASK_DEBUG) if (fTaskName[0] == 0) ::strcpy(fTaskName, " corrupt task");
-            if (TASK_DEBUG) qtss_printf("Task::Signal enque TaskName=%s thread=%lu q elem=%lu enclosing=%lu\n", fTaskName, (UInt32)TaskThreadPool::sTaskThreadArray[theThread],(UInt32) &fTaskQueueElem,(UInt32) this);
+            OS_TRACE(TASK, Verbose, "Task::Signal enque TaskName=%s thread=%p q elem=%p enclosing=%p\n", fTaskName, TaskThreadPool::sTaskThreadArray[theThread], &fTaskQueueElem, this);
             /* ӦĶԪָ뵱ǰ߳ڵTask */
 			TaskThreadPool::sTaskThreadArray[theThread]->fTaskQueue.EnQueue(&fTaskQueueElem);
         }
     }
     else/* ԭTaskalive,ɶ²! */
-        if (TASK_DEBUG) qtss_printf("Task::Signal sent to dead TaskName=%s  q elem=%lu  enclosing=%lu\n",  fTaskName, (UInt32) &fTaskQueueElem, (UInt32) this);
+        OS_TRACE(TASK, Verbose, "Task::Signal sent to dead TaskName=%s  q elem=%p  enclosing=%p\n", fTaskName, &fTaskQueueElem, this);
         
 
 }
@@ -143,6 +146,9 @@ void Task::GlobalUnlock()
 /* WaitForTask(),ȴ,Task::Run(),ݺֵ:ظֵʱ,ɾ;Ϊ0ʱ,doneProcessingEvent=0;Ϊֵʱ,TimerHeapElemѯ */
 void TaskThread::Entry()
 {
+    // count server statistics into a shard of our own, see OSShardedCounter.h
+    OSShardedCounterShard::ClaimShard();
+
 	//Taskָ
     Task* theTask = NULL;
     
@@ -180,7 +186,7 @@ void TaskThread::Entry()
             if (theTask->fWriteLock)
             {   
                 OSMutexWriteLocker mutexLocker(&TaskThreadPool::sMutexRW);
-                if (TASK_DEBUG) qtss_printf("TaskThread::Entry run global locked TaskName=%s CurMSec=%.3f thread=%ld task=%ld\n", theTask->fTaskName, OS::StartTimeMilli_Float() ,(SInt32) this,(SInt32) theTask);
+                OS_TRACE(TASK, Verbose, "TaskThread::Entry run global locked TaskName=%s CurMSec=%.3f thread=%p task=%p\n", theTask->fTaskName, OS::StartTimeMilli_Float(), this, theTask);
                 
 				/* ȫ */
                 theTimeout = theTask->Run();
@@ -190,7 +196,7 @@ void TaskThread::Entry()
             else
             {
                 OSMutexReadLocker mutexLocker(&TaskThreadPool::sMutexRW);
-                if (TASK_DEBUG) qtss_printf("TaskThread::Entry run TaskName=%s CurMSec=%.3f thread=%ld task=%ld\n", theTask->fTaskName, OS::StartTimeMilli_Float(), (SInt32) this,(SInt32) theTask);
+                OS_TRACE(TASK, Verbose, "TaskThread::Entry run TaskName=%s CurMSec=%.3f thread=%p task=%p\n", theTask->fTaskName, OS::StartTimeMilli_Float(), this, theTask);
 
 				/* TaskRun() */
                 theTimeout = theTask->Run();
@@ -206,21 +212,21 @@ void TaskThread::Entry()
             {
                 if (TASK_DEBUG) 
                 {
-                    qtss_printf("TaskThread::Entry delete TaskName=%s CurMSec=%.3f thread=%ld task=%ld\n", theTask->fTaskName, OS::StartTimeMilli_Float(), (SInt32) this, (SInt32) theTask);
+                    OS_TRACE(TASK, Verbose, "TaskThread::Entry delete TaskName=%s CurMSec=%.3f thread=%p task=%p\n", theTask->fTaskName, OS::StartTimeMilli_Float(), this, theTask);
                      
                     theTask->fUseThisThread = NULL;
                     
                     if (NULL != fHeap.Remove(&theTask->fTimerHeapElem)) 
-                        qtss_printf("TaskThread::Entry task still in heap before delete\n");
+                        OS_TRACE(TASK, Warning, "TaskThread::Entry task still in heap before delete\n");
                     
                     if (NULL != theTask->fTaskQueueElem.InQueue())
-                        qtss_printf("TaskThread::Entry task still in queue before delete\n");
+                        OS_TRACE(TASK, Warning, "TaskThread::Entry task still in queue before delete\n");
                     
                     theTask->fTaskQueueElem.Remove();
                     
 					/* ע~ Task::kAlive=Task::kAliveOff,theTask->fEvents&theTask->fEvents */
                     if (theTask->fEvents &~ Task::kAlive)
-                        qtss_printf ("TaskThread::Entry flags still set  before delete\n");
+                        OS_TRACE(TASK, Warning, "TaskThread::Entry flags still set before delete\n");
 
                     (void)atomic_sub(&theTask->fEvents, 0);
                     
@@ -248,11 +254,19 @@ void TaskThread::Entry()
             {
                 //note that if we get here, we don't reset theTask, so it will get passed into
                 //WaitForTask
-                if (TASK_DEBUG) qtss_printf("TaskThread::Entry insert TaskName=%s in timer heap thread=%lu elem=%lu task=%ld timeout=%.2f\n", theTask->fTaskName,  (UInt32) this, (UInt32) &theTask->fTimerHeapElem,(SInt32) theTask, (float)theTimeout / (float) 1000);
-                /* timer Heap elem */
-				theTask->fTimerHeapElem.SetValue(OS::Milliseconds() + theTimeout);
-				/* ղõtimer Heap elemOSHeapѵ */
-                fHeap.Insert(&theTask->fTimerHeapElem);
+                SInt64 theWakeupTime = OS::Milliseconds() + theTimeout;
+                if (theTask->fUseTimerSlots && (theTimeout < kNumTimerSlots) && this->InsertIntoTimerSlot(theTask, theWakeupTime))
+                {
+                    OS_TRACE(TASK, Verbose, "TaskThread::Entry insert TaskName=%s in timer slot thread=%p task=%p timeout=%ld\n", theTask->fTaskName, this, theTask, (long)theTimeout);
+                }
+                else
+                {
+                    OS_TRACE(TASK, Verbose, "TaskThread::Entry insert TaskName=%s in timer heap thread=%p elem=%p task=%p timeout=%.2f\n", theTask->fTaskName, this, &theTask->fTimerHeapElem, theTask, (float)theTimeout / (float) 1000);
+                    /* timer Heap elem */
+                    theTask->fTimerHeapElem.SetValue(theWakeupTime);
+                    /* ղõtimer Heap elemOSHeapѵ */
+                    fHeap.Insert(&theTask->fTimerHeapElem);
+                }
 				/* ıһfEventsֵ,һIdle bitλ,ǸTaskǸIdle Task */
                 (void)atomic_or(&theTask->fEvents, Task::kIdleEvent);
                 doneProcessingEvent = true;
@@ -271,7 +285,7 @@ void TaskThread::Entry()
         
         if ( yieldDur > 1 )
         {
-            if (TASK_DEBUG) qtss_printf( "TaskThread::Entry time in Yield %i, numZeroYields %i\n", (long)yieldDur, (long)numZeroYields );
+            OS_TRACE(TASK, Verbose, "TaskThread::Entry time in Yield %ld, numZeroYields %ld\n", (long)yieldDur, (long)numZeroYields);
             numZeroYields = 0;
         }
         else
@@ -289,11 +303,19 @@ Task* TaskThread::WaitForTask()
     {
 		/* ȡǰʱ */
         SInt64 theCurrentTime = OS::Milliseconds();
+
+        /* ̳ʱʱ,ȷ */
+        Task* theSlotTask = this->ExtractDueTimerSlot(theCurrentTime);
+        if (theSlotTask != NULL)
+        {
+            OS_TRACE(TASK, Verbose, "TaskThread::WaitForTask found slot-task=%s thread %p numSlotTasks=%lu\n", theSlotTask->fTaskName, this, fNumTimerSlotTasks);
+            return theSlotTask;
+        }
         
 		/* OSHeapеСOSHeapElementԪǿ,ҴСǰʱ(Ѿִʱ),(ѯʽ)СԪӦ */
         if ((fHeap.PeekMin() != NULL) && (fHeap.PeekMin()->GetValue() <= theCurrentTime))
         {    
-            if (TASK_DEBUG) qtss_printf("TaskThread::WaitForTask found timer-task=%s thread %lu fHeap.CurrentHeapSize(%lu) taskElem = %lu enclose=%lu\n",((Task*)fHeap.PeekMin()->GetEnclosingObject())->fTaskName, (UInt32) this, fHeap.CurrentHeapSize(), (UInt32) fHeap.PeekMin(), (UInt32) fHeap.PeekMin()->GetEnclosingObject());
+            OS_TRACE(TASK, Verbose, "TaskThread::WaitForTask found timer-task=%s thread %p fHeap.CurrentHeapSize(%lu) taskElem = %p enclose=%p\n", ((Task*)fHeap.PeekMin()->GetEnclosingObject())->fTaskName, this, fHeap.CurrentHeapSize(), fHeap.PeekMin(), fHeap.PeekMin()->GetEnclosingObject());
             return (Task*)fHeap.ExtractMin()->GetEnclosingObject();
         }
     
@@ -312,6 +334,15 @@ Task* TaskThread::WaitForTask()
 	    /* ǵR-UDP,עⳬʱС10ms */
 		if (theTimeout < 10) 
            theTimeout = 10;
+
+        // Tasks in the timer slots asked for a short wait, so wake up for them on time
+        SInt64 theSlotTime = this->GetNextTimerSlotTime();
+        if ((theSlotTime != -1) && (theSlotTime - theCurrentTime < theTimeout))
+        {
+            theTimeout = theSlotTime - theCurrentTime;
+            if (theTimeout < 1)
+                theTimeout = 1;
+        }
             
         //wait...
 		/* ɾȥصǰêԪصǰһԪ() */
@@ -319,7 +350,7 @@ Task* TaskThread::WaitForTask()
         OSQueueElem* theElem = fTaskQueue.DeQueueBlocking(this, (SInt32) theTimeout);
         if (theElem != NULL)
         {    
-            if (TASK_DEBUG) qtss_printf("TaskThread::WaitForTask found signal-task=%s thread %lu fTaskQueue.GetLength(%lu) taskElem = %lu enclose=%lu\n", ((Task*)theElem->GetEnclosingObject())->fTaskName,  (UInt32) this, fTaskQueue.GetQueue()->GetLength(), (UInt32)  theElem,  (UInt32)theElem->GetEnclosingObject() );
+            OS_TRACE(TASK, Verbose, "TaskThread::WaitForTask found signal-task=%s thread %p fTaskQueue.GetLength(%lu) taskElem = %p enclose=%p\n", ((Task*)theElem->GetEnclosingObject())->fTaskName, this, fTaskQueue.GetQueue()->GetLength(), theElem, theElem->GetEnclosingObject());
             return (Task*)theElem->GetEnclosingObject();
         }
 
@@ -330,6 +361,57 @@ Task* TaskThread::WaitForTask()
     }   
 }
 
+/* 뵽ʱӦʱ,ʱ۵ķΧ򷵻false,ɵ߷OSHeap */
+Bool16 TaskThread::InsertIntoTimerSlot(Task* inTask, SInt64 inWakeupTime)
+{
+    if (fNumTimerSlotTasks == 0)
+        fTimerSlotCursor = OS::Milliseconds();
+
+    // A slot is reused every kNumTimerSlots msecs, so only times within that
+    // distance of the oldest unexpired slot are unambiguous
+    if ((inWakeupTime < fTimerSlotCursor) || (inWakeupTime - fTimerSlotCursor >= kNumTimerSlots))
+        return false;
+
+    Assert(inTask->fTimerSlotElem.InQueue() == NULL);
+    inTask->fTimerSlotTime = inWakeupTime;
+    fTimerSlots[inWakeupTime % kNumTimerSlots].EnQueue(&inTask->fTimerSlotElem);
+    fNumTimerSlotTasks++;
+    return true;
+}
+
+/* μα굽ǰʱʱ,صһڵ,û򷵻NULL */
+Task* TaskThread::ExtractDueTimerSlot(SInt64 inCurrentTime)
+{
+    while ((fNumTimerSlotTasks > 0) && (fTimerSlotCursor <= inCurrentTime))
+    {
+        OSQueueElem* theElem = fTimerSlots[fTimerSlotCursor % kNumTimerSlots].DeQueue();
+        if (theElem != NULL)
+        {
+            Task* theTask = (Task*)theElem->GetEnclosingObject();
+            Assert(theTask->fTimerSlotTime == fTimerSlotCursor);
+            fNumTimerSlotTasks--;
+            return theTask;
+        }
+        fTimerSlotCursor++;
+    }
+    return NULL;
+}
+
+/* ķǿʱ۵ʱ,û򷵻-1 */
+SInt64 TaskThread::GetNextTimerSlotTime()
+{
+    if (fNumTimerSlotTasks == 0)
+        return -1;
+
+    for (SInt64 theTime = fTimerSlotCursor; theTime < fTimerSlotCursor + kNumTimerSlots; theTime++)
+    {
+        if (fTimerSlots[theTime % kNumTimerSlots].GetLength() > 0)
+            return theTime;
+    }
+    Assert(0);
+    return -1;
+}
+
 /* TaskThreadPoolݳԱֵ,ἰʱǵֵ */
 TaskThread** TaskThreadPool::sTaskThreadArray = NULL;
 UInt32       TaskThreadPool::sNumTaskThreads = 0;
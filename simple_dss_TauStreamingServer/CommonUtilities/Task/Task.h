@@ -23,6 +23,7 @@ LastUpdate:  2010-08-18
 #include "OSHeap.h"
 #include "OSThread.h"
 #include "OSMutexRW.h"
+#include "OSTrace.h"
 
 #define TASK_DEBUG 0
 
@@ -72,6 +73,12 @@ class Task
         
         //Send an event to this task.
         void                    Signal(EventFlags eventFlags);
+
+        // Timeouts shorter than TaskThread::kNumTimerSlots msecs returned from Run()
+        // go into the thread's timer slots and are honored to the msec, rather than
+        // through the timer heap, where waits are rounded up to kMinWaitTimeInMilSecs.
+        // For tasks that pace their output, see RTPPacer.
+        void                    UseTimerSlots(Bool16 inUseTimerSlots) { fUseTimerSlots = inUseTimerSlots; }
         void                    GlobalUnlock();
 
 		/* жǷϷ,boolֵ */
@@ -95,7 +102,7 @@ class Task
                                                         fUseThisThread = (TaskThread*)OSThread::GetCurrent();/* ȡǰ߳ */
                                                         Assert(fUseThisThread != NULL);/* line 101 */
                                                         if (TASK_DEBUG) if (fTaskName[0] == 0) ::strcpy(fTaskName, " corrupt task");
-                                                        if (TASK_DEBUG) qtss_printf("Task::ForceSameThread fUseThisThread %lu task %s enque elem=%lu enclosing %lu\n", (UInt32)fUseThisThread, fTaskName,(UInt32) &fTaskQueueElem,(UInt32) this);
+                                                        OS_TRACE(TASK, Verbose, "Task::ForceSameThread fUseThisThread %p task %s enque elem=%p enclosing %p\n", fUseThisThread, fTaskName, &fTaskQueueElem, this);
                                                     }
         // used in QTSSModule::Run()
         SInt64                  CallLocked()        {   ForceSameThread();
@@ -134,6 +141,11 @@ class Task
 		/* ʱԪ */
         OSHeapElem      fTimerHeapElem;
 
+        // In one of TaskThread::fTimerSlots while waiting for a short timeout
+        OSQueueElem     fTimerSlotElem;
+        SInt64          fTimerSlotTime;
+        Bool16          fUseTimerSlots;
+
 		/* Ԫ,ÿΪһTask QueueеԪ */
         OSQueueElem     fTaskQueueElem;
         
@@ -150,7 +162,7 @@ class TaskThread : public OSThread  //refer to OSThread.h
     
         //Implementation detail: all tasks get run on TaskThreads.
         
-                        TaskThread() :  OSThread(), fTaskThreadPoolElem()
+                        TaskThread() :  OSThread(), fTaskThreadPoolElem(), fTimerSlotCursor(0), fNumTimerSlotTasks(0)
                                         {fTaskThreadPoolElem.SetEnclosingObject(this);}/* ̳߳صԪΪǰTask Thread */
 						virtual         ~TaskThread() { this->StopAndWaitForThread(); }
            
@@ -159,7 +171,8 @@ class TaskThread : public OSThread  //refer to OSThread.h
 		/* Сĵȴʱ10ms */
         enum
         {
-            kMinWaitTimeInMilSecs = 10  //UInt32
+            kMinWaitTimeInMilSecs = 10, //UInt32
+            kNumTimerSlots = 64         //UInt32, one per msec
         };
 
 		/* member functions */
@@ -170,6 +183,11 @@ class TaskThread : public OSThread  //refer to OSThread.h
 		/* OSHeapеʱ,ѯʽȴTask,ɾȥسʱȴ */
         Task*           WaitForTask();
 
+        // Timer slots: a wheel of one msec slots for short timeouts, see Task::UseTimerSlots
+        Bool16          InsertIntoTimerSlot(Task* inTask, SInt64 inWakeupTime);
+        Task*           ExtractDueTimerSlot(SInt64 inCurrentTime);
+        SInt64          GetNextTimerSlotTime();
+
 		/* data members */
         /* Task ThreadΪTask Thread poolеԪ */
         OSQueueElem     fTaskThreadPoolElem;
@@ -179,6 +197,10 @@ class TaskThread : public OSThread  //refer to OSThread.h
 		//¼ʱĶѣWaitForTask 
         OSHeap              fHeap;
 
+        OSQueue             fTimerSlots[kNumTimerSlots];
+        SInt64              fTimerSlotCursor;   // time of the first slot not yet expired
+        UInt32              fNumTimerSlotTasks;
+
 		/*ؼݽṹУTask Signal ֱӵ
 		fTaskQueue EnQueue Լ*/
 		/* Task ThreadҪĿ,õOSCond::Signal() */
@@ -0,0 +1,481 @@
+/***************************************************************************
+
+Copyright (c) 2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 CongestionSimulator.cpp
+Description: Replays a network trace through the reliable UDP congestion
+             controllers offline and compares their throughput, RTT and loss.
+Comment:
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-19
+LastUpdate:  2026-10-19
+
+****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "SafeStdLib.h"
+#include "OSHeaders.h"
+#include "StrPtrLen.h"
+#include "RTPCongestionController.h"
+
+/*
+    The path is a single bottleneck: a drop tail queue drained at the link
+    capacity, random loss after it and a fixed round trip time. Every packet
+    is acked on its own, as DSS clients do. Lost packets are resent when the
+    retransmit timeout passes and given up the max retransmit delay after
+    their first send, which is what RTPPacketResender does.
+
+    A trace is a list of segments, one per line:
+
+        <duration msec> <capacity kbps> <round trip msec> <loss percent>
+
+    and '#' starts a comment. Runs are deterministic for a given seed.
+*/
+
+enum
+{
+    kPacketSize                 = RTPCongestionController::kMaximumSegmentSize,
+    kMaxSegments                = 256,
+    kMaxPackets                 = 65536,    // packets in flight or queued, a power of 2
+    kMinRetransmitIntervalMSecs = 600,      // as RTPBandwidthTracker
+    kMaxRetransmitIntervalMSecs = 24000
+};
+
+struct TraceSegment
+{
+    SInt64  fDurationMSecs;
+    UInt32  fCapacityKbps;
+    UInt32  fRTTMSecs;
+    Float32 fLossPercent;
+};
+
+struct SimPacket
+{
+    SInt64  fFirstSendTime;
+    SInt64  fSendTime;
+    UInt32  fNumSends;
+    Bool16  fDone;          // acked or expired
+};
+
+struct SimEvent
+{
+    UInt32  fSeqNum;
+    SInt64  fTime;
+};
+
+struct SimResult
+{
+    UInt64  fBytesAcked;
+    UInt64  fPacketsSent;
+    UInt64  fPacketsResent;
+    UInt64  fPacketsLost;       // dropped by the queue or the link
+    UInt64  fPacketsExpired;
+    UInt64  fRTTSum;
+    UInt64  fNumRTTSamples;
+    SInt64  fMaxRTT;
+    UInt64  fWindowSum;
+    SInt64  fDurationMSecs;
+};
+
+static TraceSegment sSegments[kMaxSegments];
+static UInt32       sNumSegments = 0;
+
+static SimPacket    sPackets[kMaxPackets];
+static SimEvent     sQueue[kMaxPackets];    // waiting at the bottleneck
+static SimEvent     sAcks[kMaxPackets];     // delivered, ack on its way back
+
+static UInt32       sRandomSeed = 1;
+
+// Deterministic, so that every algorithm sees the same loss pattern
+static UInt32 NextRandom()
+{
+    sRandomSeed = sRandomSeed * 1103515245 + 12345;
+    return (sRandomSeed >> 16) & 0x7FFF;
+}
+
+static Bool16 AddSegment(SInt64 inDurationMSecs, UInt32 inCapacityKbps, UInt32 inRTTMSecs, Float32 inLossPercent)
+{
+    if ((sNumSegments == kMaxSegments) || (inDurationMSecs <= 0) || (inCapacityKbps == 0))
+        return false;
+
+    sSegments[sNumSegments].fDurationMSecs = inDurationMSecs;
+    sSegments[sNumSegments].fCapacityKbps = inCapacityKbps;
+    sSegments[sNumSegments].fRTTMSecs = inRTTMSecs;
+    sSegments[sNumSegments].fLossPercent = inLossPercent;
+    sNumSegments++;
+    return true;
+}
+
+static Bool16 LoadPreset(char* inName)
+{
+    if (::strcmp(inName, "wired") == 0)
+        return AddSegment(60000, 4000, 40, 0);
+
+    if (::strcmp(inName, "mobile") == 0)
+    {
+        for (UInt32 x = 0; x < 3; x++)
+        {
+            AddSegment(5000, 3000, 80, 1);
+            AddSegment(5000, 800, 120, 3);
+            AddSegment(5000, 2000, 100, 0.5);
+            AddSegment(5000, 400, 200, 5);
+        }
+        return true;
+    }
+
+    if (::strcmp(inName, "lossy") == 0)
+        return AddSegment(60000, 2000, 60, 2);
+
+    return false;
+}
+
+static Bool16 LoadTrace(char* inPath)
+{
+    FILE* theFile = ::fopen(inPath, "r");
+    if (theFile == NULL)
+        return false;
+
+    char theLine[256];
+    UInt32 theLineNum = 0;
+    Bool16 isOK = true;
+    while (isOK && (::fgets(theLine, sizeof(theLine), theFile) != NULL))
+    {
+        theLineNum++;
+        char* theComment = ::strchr(theLine, '#');
+        if (theComment != NULL)
+            *theComment = '\0';
+
+        long theDuration = 0, theCapacity = 0, theRTT = 0;
+        float theLoss = 0;
+        int theNumFields = ::sscanf(theLine, "%ld %ld %ld %f", &theDuration, &theCapacity, &theRTT, &theLoss);
+        if (theNumFields <= 0)
+            continue;
+        if ((theNumFields < 3) || !AddSegment(theDuration, theCapacity, theRTT, theLoss))
+        {
+            qtss_fprintf(stderr, "%s:%lu: bad segment\n", inPath, theLineNum);
+            isOK = false;
+        }
+    }
+    ::fclose(theFile);
+    return isOK && (sNumSegments > 0);
+}
+
+// Karn / Jacobson, as RTPBandwidthTracker::AddToRTTEstimate
+static void AddToRTTEstimate(SInt32 inSample, SInt32* ioAverage, SInt32* ioDeviation, SInt32* outRTO)
+{
+    if (*ioAverage == 0)
+        *ioAverage = inSample * 8;
+    SInt32 theDelta = inSample - *ioAverage / 8;
+    *ioAverage += theDelta;
+    if (theDelta < 0)
+        theDelta = -theDelta;
+    *ioDeviation += theDelta - *ioDeviation / 4;
+
+    *outRTO = *ioAverage / 8 + *ioDeviation;
+    if (*outRTO < kMinRetransmitIntervalMSecs)
+        *outRTO = kMinRetransmitIntervalMSecs;
+    if (*outRTO > kMaxRetransmitIntervalMSecs)
+        *outRTO = kMaxRetransmitIntervalMSecs;
+}
+
+static void Simulate(RTPCongestionController* inController, UInt32 inClientWindow, UInt32 inQueuePackets,
+                        UInt32 inSourceKbps, UInt32 inMaxRetransmitDelay, UInt32 inSeed, Bool16 inVerbose, SimResult* outResult)
+{
+    ::memset(outResult, 0, sizeof(SimResult));
+    ::memset(sPackets, 0, sizeof(sPackets));
+    sRandomSeed = inSeed;
+
+    UInt32 theNextSeqNum = 0;       // next new packet
+    UInt32 theOldestSeqNum = 0;     // oldest packet not yet acked or expired
+    UInt32 theBytesInFlight = 0;
+    UInt32 theQueueHead = 0, theQueueTail = 0;
+    UInt32 theAckHead = 0, theAckTail = 0;
+
+    SInt32 theRTTAverage = 0, theRTTDeviation = 0, theRTO = kMinRetransmitIntervalMSecs;
+    SInt64 theLinkCredit = 0;       // in bits
+    SInt64 thePacingTokens = 0;     // in bytes * 1000
+    SInt64 theSourceTokens = 0;     // in bits
+
+    SInt64 theTime = 0;
+    UInt64 theLastBytesAcked = 0;
+    inController->SetClientWindow(inClientWindow, theTime);
+
+    for (UInt32 theSegment = 0; theSegment < sNumSegments; theSegment++)
+    {
+        TraceSegment* theTrace = &sSegments[theSegment];
+        UInt32 theLossThreshold = (UInt32)(theTrace->fLossPercent * 32768 / 100);
+
+        for (SInt64 theEnd = theTime + theTrace->fDurationMSecs; theTime < theEnd; theTime++)
+        {
+            // Acks arriving now
+            while ((theAckHead != theAckTail) && (sAcks[theAckHead].fTime <= theTime))
+            {
+                UInt32 theSeqNum = sAcks[theAckHead].fSeqNum;
+                theAckHead = (theAckHead + 1) & (kMaxPackets - 1);
+
+                SimPacket* thePacket = &sPackets[theSeqNum & (kMaxPackets - 1)];
+                if (thePacket->fDone || (theSeqNum < theOldestSeqNum))
+                    continue;   // a duplicate of a resent packet
+
+                thePacket->fDone = true;
+                theBytesInFlight -= kPacketSize;
+                outResult->fBytesAcked += kPacketSize;
+
+                if (thePacket->fNumSends == 1)
+                {
+                    SInt32 theRTT = (SInt32)(theTime - thePacket->fSendTime);
+                    AddToRTTEstimate(theRTT, &theRTTAverage, &theRTTDeviation, &theRTO);
+                    inController->OnRTTSample(theRTT, theTime);
+                    outResult->fRTTSum += theRTT;
+                    outResult->fNumRTTSamples++;
+                    if (theRTT > outResult->fMaxRTT)
+                        outResult->fMaxRTT = theRTT;
+                }
+                inController->OnAck(kPacketSize, theBytesInFlight, theTime);
+            }
+
+            // Resend or expire packets whose retransmit timeout passed
+            for (UInt32 theSeqNum = theOldestSeqNum; theSeqNum < theNextSeqNum; theSeqNum++)
+            {
+                SimPacket* thePacket = &sPackets[theSeqNum & (kMaxPackets - 1)];
+                if (thePacket->fDone || (theTime - thePacket->fSendTime < theRTO))
+                    continue;
+
+                if (theTime - thePacket->fFirstSendTime > (SInt64)inMaxRetransmitDelay)
+                {
+                    thePacket->fDone = true;
+                    theBytesInFlight -= kPacketSize;
+                    outResult->fPacketsExpired++;
+                    inController->OnLoss(kPacketSize, theTime);
+                    continue;
+                }
+
+                if (thePacket->fNumSends == 1)
+                    AddToRTTEstimate(theRTO * 3 / 2, &theRTTAverage, &theRTTDeviation, &theRTO);
+                thePacket->fNumSends++;
+                thePacket->fSendTime = theTime;
+                outResult->fPacketsResent++;
+                inController->OnRetransmitTimeout(theTime);
+
+                if (((theQueueTail - theQueueHead) & (kMaxPackets - 1)) < inQueuePackets)
+                {
+                    sQueue[theQueueTail].fSeqNum = theSeqNum;
+                    theQueueTail = (theQueueTail + 1) & (kMaxPackets - 1);
+                }
+                else
+                    outResult->fPacketsLost++;
+            }
+            while ((theOldestSeqNum < theNextSeqNum) && sPackets[theOldestSeqNum & (kMaxPackets - 1)].fDone)
+                theOldestSeqNum++;
+
+            // Send new packets, as far as the window, the pacing rate and the source allow
+            UInt32 thePacingRate = inController->GetPacingRateInBytesPerSec();
+            if (thePacingRate > 0)
+            {
+                thePacingTokens += thePacingRate;
+                if (thePacingTokens > 2 * kPacketSize * 1000)
+                    thePacingTokens = 2 * kPacketSize * 1000;
+            }
+            if (inSourceKbps > 0)
+            {
+                theSourceTokens += inSourceKbps;
+                if (theSourceTokens > (SInt64)inClientWindow * 8)
+                    theSourceTokens = (SInt64)inClientWindow * 8;
+            }
+
+            while ((theBytesInFlight + kPacketSize <= (UInt32)inController->CongestionWindow())
+                    && (theNextSeqNum - theOldestSeqNum < kMaxPackets)
+                    && ((thePacingRate == 0) || (thePacingTokens >= kPacketSize * 1000))
+                    && ((inSourceKbps == 0) || (theSourceTokens >= kPacketSize * 8)))
+            {
+                SimPacket* thePacket = &sPackets[theNextSeqNum & (kMaxPackets - 1)];
+                thePacket->fFirstSendTime = thePacket->fSendTime = theTime;
+                thePacket->fNumSends = 1;
+                thePacket->fDone = false;
+
+                if (thePacingRate > 0)
+                    thePacingTokens -= kPacketSize * 1000;
+                if (inSourceKbps > 0)
+                    theSourceTokens -= kPacketSize * 8;
+
+                if (((theQueueTail - theQueueHead) & (kMaxPackets - 1)) < inQueuePackets)
+                {
+                    sQueue[theQueueTail].fSeqNum = theNextSeqNum;
+                    theQueueTail = (theQueueTail + 1) & (kMaxPackets - 1);
+                }
+                else
+                    outResult->fPacketsLost++;
+
+                theNextSeqNum++;
+                theBytesInFlight += kPacketSize;
+                outResult->fPacketsSent++;
+            }
+
+            // The bottleneck forwards what its capacity allows this millisecond
+            theLinkCredit += theTrace->fCapacityKbps;
+            while ((theQueueHead != theQueueTail) && (theLinkCredit >= kPacketSize * 8))
+            {
+                UInt32 theSeqNum = sQueue[theQueueHead].fSeqNum;
+                theQueueHead = (theQueueHead + 1) & (kMaxPackets - 1);
+                theLinkCredit -= kPacketSize * 8;
+
+                if (NextRandom() < theLossThreshold)
+                {
+                    outResult->fPacketsLost++;
+                    continue;
+                }
+                sAcks[theAckTail].fSeqNum = theSeqNum;
+                sAcks[theAckTail].fTime = theTime + theTrace->fRTTMSecs;
+                theAckTail = (theAckTail + 1) & (kMaxPackets - 1);
+            }
+            if ((theQueueHead == theQueueTail) && (theLinkCredit > kPacketSize * 8))
+                theLinkCredit = kPacketSize * 8;    // an idle link does not save up capacity
+
+            outResult->fWindowSum += inController->CongestionWindow();
+
+            if (inVerbose && ((theTime % 1000) == 999))
+            {
+                qtss_printf("%-7s %6" _64BITARG_ "d s %8" _64BITARG_ "u kbps %8d cwnd %6lu queued %6d rto\n",
+                            RTPCongestionController::GetTypeName(inController->GetType()), (theTime + 1) / 1000,
+                            ((outResult->fBytesAcked - theLastBytesAcked) * 8) / 1000, inController->CongestionWindow(),
+                            (theQueueTail - theQueueHead) & (kMaxPackets - 1), theRTO);
+                theLastBytesAcked = outResult->fBytesAcked;
+            }
+        }
+    }
+
+    outResult->fDurationMSecs = theTime;
+}
+
+static void Usage(char* inProgName)
+{
+    qtss_printf("usage: %s [-p preset | -t tracefile] [-a algorithm] [-w bytes] [-q packets] [-b kbps] [-r msec] [-s seed] [-S] [-v]\n", inProgName);
+    qtss_printf("  -p  built in trace: wired, mobile or lossy (default: mobile)\n");
+    qtss_printf("  -t  trace file, one \"<msec> <kbps> <rtt msec> <loss percent>\" segment per line\n");
+    qtss_printf("  -a  reno, ledbat or bbr (default: compare all of them)\n");
+    qtss_printf("  -w  client window in bytes (default: 65536)\n");
+    qtss_printf("  -q  bottleneck queue size in packets (default: 64)\n");
+    qtss_printf("  -b  source bit rate in kbps, 0 sends as fast as allowed (default: 0)\n");
+    qtss_printf("  -r  give up resending after this long, as max_retransmit_delay (default: 2000,\n");
+    qtss_printf("      raised to the %d msec minimum retransmit timeout, below which nothing is resent)\n", kMinRetransmitIntervalMSecs);
+    qtss_printf("  -s  random seed for the link losses (default: 1)\n");
+    qtss_printf("  -S  start with the reliable_udp_slow_start behavior\n");
+    qtss_printf("  -v  print one line per simulated second\n");
+}
+
+int main(int argc, char * argv[])
+{
+    char*   thePreset = NULL;
+    char*   theTraceFile = NULL;
+    UInt32  theType = RTPCongestionController::kNumTypes;
+    UInt32  theClientWindow = 65536;
+    UInt32  theQueuePackets = 64;
+    UInt32  theSourceKbps = 0;
+    UInt32  theMaxRetransmitDelay = 2000;
+    UInt32  theSeed = 1;
+    Bool16  useSlowStart = false;
+    Bool16  isVerbose = false;
+
+    int ch;
+    while ((ch = getopt(argc, argv, "p:t:a:w:q:b:r:s:Svh")) != EOF)
+    {
+        switch (ch)
+        {
+            case 'p':
+                thePreset = optarg;
+                break;
+            case 't':
+                theTraceFile = optarg;
+                break;
+            case 'a':
+            {
+                StrPtrLen theName(optarg);
+                theType = RTPCongestionController::GetTypeFromName(&theName);
+                if (theType == RTPCongestionController::kNumTypes)
+                {
+                    qtss_fprintf(stderr, "%s: unknown algorithm %s\n", argv[0], optarg);
+                    return 1;
+                }
+                break;
+            }
+            case 'w':
+                theClientWindow = ::atoi(optarg);
+                break;
+            case 'q':
+                theQueuePackets = ::atoi(optarg);
+                break;
+            case 'b':
+                theSourceKbps = ::atoi(optarg);
+                break;
+            case 'r':
+                theMaxRetransmitDelay = ::atoi(optarg);
+                break;
+            case 's':
+                theSeed = ::atoi(optarg);
+                break;
+            case 'S':
+                useSlowStart = true;
+                break;
+            case 'v':
+                isVerbose = true;
+                break;
+            default:
+                Usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if ((theClientWindow < 2 * kPacketSize) || (theQueuePackets == 0) || (theQueuePackets >= kMaxPackets))
+    {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    if (theMaxRetransmitDelay < kMinRetransmitIntervalMSecs)
+        theMaxRetransmitDelay = kMinRetransmitIntervalMSecs;
+
+    if (theTraceFile != NULL)
+    {
+        if (!LoadTrace(theTraceFile))
+        {
+            qtss_fprintf(stderr, "%s: cannot load trace %s\n", argv[0], theTraceFile);
+            return 1;
+        }
+    }
+    else if (!LoadPreset((thePreset != NULL) ? thePreset : (char*)"mobile"))
+    {
+        qtss_fprintf(stderr, "%s: unknown preset %s\n", argv[0], thePreset);
+        return 1;
+    }
+
+    qtss_printf("%-7s %10s %10s %10s %8s %8s %8s %10s\n",
+                "Algo", "kbps", "avgRTT", "maxRTT", "lost%", "resent", "expired", "avgCwnd");
+
+    for (UInt32 x = 0; x < RTPCongestionController::kNumTypes; x++)
+    {
+        if ((theType != RTPCongestionController::kNumTypes) && (theType != x))
+            continue;
+
+        RTPCongestionController* theController = RTPCongestionController::Create(x, useSlowStart);
+        SimResult theResult;
+        Simulate(theController, theClientWindow, theQueuePackets, theSourceKbps, theMaxRetransmitDelay, theSeed, isVerbose, &theResult);
+
+        UInt64 theDuration = (theResult.fDurationMSecs > 0) ? theResult.fDurationMSecs : 1;
+        UInt64 theSent = (theResult.fPacketsSent + theResult.fPacketsResent > 0) ? theResult.fPacketsSent + theResult.fPacketsResent : 1;
+        UInt64 theSamples = (theResult.fNumRTTSamples > 0) ? theResult.fNumRTTSamples : 1;
+        UInt64 theLostX100 = (theResult.fPacketsLost * 10000) / theSent;
+
+        qtss_printf("%-7s %10" _64BITARG_ "u %10" _64BITARG_ "u %10" _64BITARG_ "d %5" _64BITARG_ "u.%02" _64BITARG_ "u %8" _64BITARG_ "u %8" _64BITARG_ "u %10" _64BITARG_ "u\n",
+                    RTPCongestionController::GetTypeName(x), (theResult.fBytesAcked * 8) / theDuration,
+                    theResult.fRTTSum / theSamples, theResult.fMaxRTT, theLostX100 / 100, theLostX100 % 100,
+                    theResult.fPacketsResent, theResult.fPacketsExpired, theResult.fWindowSum / theDuration);
+        delete theController;
+    }
+
+    return 0;
+}
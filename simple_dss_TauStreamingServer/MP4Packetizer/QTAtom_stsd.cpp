@@ -139,12 +139,17 @@ Bool16 QTAtom_stsd::Initialize(void)
             fTable[CurDesc] = pSampleDescriptionTable;
             
             //
-            // Skip over this mini-atom.
+            // Skip over this mini-atom, which must at least hold its size
+            // and data format, and fit in the table.
+            if (maxSampleDescriptionPtr - pSampleDescriptionTable < 8)
+            {   return false;
+            }
             memcpy(&tempInt32, pSampleDescriptionTable, 4);
-            pSampleDescriptionTable += ntohl(tempInt32);
-            if (pSampleDescriptionTable > maxSampleDescriptionPtr)
+            tempInt32 = ntohl(tempInt32);
+            if ((tempInt32 < 8) || (tempInt32 > (UInt32)(maxSampleDescriptionPtr - pSampleDescriptionTable)))
             {   return false;
             }
+            pSampleDescriptionTable += tempInt32;
         }
     }
 
@@ -519,8 +519,9 @@ Bool16 QTAtom_ctts::SampleNumberToMediaTimeOffset(UInt32 SampleNumber, UInt32 *
         SampleOffset = ntohl(SampleOffset);
 
         //
-        // Can we skip over this entry?
-        if( STCB->fSNtMT_CurSample + SampleCount < SampleNumber ) {
+        // Can we skip over this entry? Unlike a duration, the offset is the
+        // entry's own, so its last sample must not take the next one's.
+        if( STCB->fSNtMT_CurSample + SampleCount <= SampleNumber ) {
             STCB->fSNtMT_CurMediaTime += SampleCount * SampleOffset;
             STCB->fSNtMT_CurSample += SampleCount;
             continue;
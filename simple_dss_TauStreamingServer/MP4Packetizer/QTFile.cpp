@@ -22,6 +22,12 @@ LastUpdate:  2010-08-19
 #include "SafeStdLib.h"
 #include <string.h>
 
+#ifndef __Win32__
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #include "OSMutex.h"
 #include "QTFile.h"
 #include "QTAtom.h"
@@ -30,6 +36,8 @@ LastUpdate:  2010-08-19
 
 #include "QTTrack.h"
 #include "QTHintTrack.h"
+#include "QTMediaHintTrack.h"
+#include "QTFragmentIndex.h"
 #include "OSMemory.h"
 
 
@@ -46,6 +54,14 @@ LastUpdate:  2010-08-19
 
 
 
+// -------------------------------------
+// TOC cache variables
+//
+char        *QTFile::sTOCCacheFolder = NULL;
+OSMutex     QTFile::sTOCCacheMutex;
+
+
+
 // -------------------------------------
 // Constructors and destructors
 //
@@ -61,7 +77,9 @@ QTFile::QTFile(Bool16 Debug, Bool16 DeepDebug)
     fNumTracks(0),
     fFirstTrack(NULL), fLastTrack(NULL),
     fMovieHeaderAtom(NULL), 
-    fFile(-1)
+    fFile(-1),
+    fTOCMap(NULL), fTOCMapLength(0), fTOCReadPos(0),
+    fIsFragmented(false), fFragmentScanPos(0)
 {
 }
 
@@ -76,6 +94,8 @@ QTFile::~QTFile(void)
         // Delete this track entry and move to the next one.
         if( TrackEntry->Track != NULL )
             delete TrackEntry->Track;
+        if( TrackEntry->Fragments != NULL )
+            delete TrackEntry->Fragments;
         delete TrackEntry;
         
         TrackEntry = NextTrackEntry;
@@ -116,6 +136,11 @@ QTFile::~QTFile(void)
 #if DSS_USE_API_CALLBACKS
     (void)QTSS_CloseFileObject(fMovieFD);
 #endif
+
+#ifndef __Win32__
+    if (fFile != -1)
+        ::close(fFile);
+#endif
 }
 
 // -------------------------------------
@@ -180,8 +205,11 @@ QTFile::ErrorCode QTFile::Open(const char * MoviePath)
     //
     // Generate the table of contents for this movie.
     DEBUG_PRINT(("QTFile::Open - Generating Atom TOC.\n"));
-    if( !GenerateAtomTOC() )
-        return errInvalidQuickTimeFile;
+    if( !ReadTOCCache() ) {
+        if( !GenerateAtomTOC() )
+            return errInvalidQuickTimeFile;
+        WriteTOCCache();
+    }
     
 
     //
@@ -207,6 +235,15 @@ QTFile::ErrorCode QTFile::Open(const char * MoviePath)
     // NOTE that the tracks are *not* initialized here.  That is done when they
     // are actually used; either directly or by a QTHintTrack.
     DEBUG_PRINT(("QTFile::Open - Loading tracks.\n"));
+
+    //
+    // A movie without a single hint track gets its H.264 and AAC tracks
+    // packetized on the fly instead.
+    Bool16 hasHintTracks = false;
+    TOCEntry = NULL;
+    while( !hasHintTracks && FindTOCEntry("moov:trak", &TOCEntry, TOCEntry) )
+        hasHintTracks = FindTOCEntry(":tref:hint", NULL, TOCEntry);
+
     TOCEntry = NULL;
     while( FindTOCEntry("moov:trak", &TOCEntry, TOCEntry) ) {
         // General vars
@@ -218,12 +255,16 @@ QTFile::ErrorCode QTFile::Open(const char * MoviePath)
         ListEntry = NEW TrackListEntry();
         if( ListEntry == NULL )
             return errInternalError;
+        ListEntry->Fragments = NULL;
 
         //
         // Make a hint track if that's what this is.
         if( FindTOCEntry(":tref:hint", NULL, TOCEntry) ) {
             ListEntry->Track = NEW QTHintTrack(this, TOCEntry, fDebug, fDeepDebug);
             ListEntry->IsHintTrack = true;
+        } else if( !hasHintTracks && QTMediaHintTrack::CanPacketize(this, TOCEntry) ) {
+            ListEntry->Track = NEW QTMediaHintTrack(this, TOCEntry, fDebug, fDeepDebug);
+            ListEntry->IsHintTrack = true;
         } else {
             ListEntry->Track = NEW QTTrack(this, TOCEntry, fDebug, fDeepDebug);
             ListEntry->IsHintTrack = false;
@@ -261,6 +302,20 @@ QTFile::ErrorCode QTFile::Open(const char * MoviePath)
         // One more track..
         fNumTracks++;
     }
+
+    //
+    // A fragmented movie has its samples in moof atoms after the moov.
+    // Index the ones there are now; IndexFragments picks up any written
+    // later.
+    if( FindTOCEntry("moov:mvex", &TOCEntry) ) {
+        DEBUG_PRINT(("QTFile::Open - Indexing movie fragments.\n"));
+        fIsFragmented = true;
+        for( TrackListEntry *ListEntry = fFirstTrack; ListEntry != NULL; ListEntry = ListEntry->NextTrack )
+            ListEntry->Fragments = NEW QTFragmentIndex(ListEntry->TrackID);
+
+        ReadTrackExtends(TOCEntry);
+        IndexFragments();
+    }
     
     
     //
@@ -269,8 +324,26 @@ QTFile::ErrorCode QTFile::Open(const char * MoviePath)
     return errNoError;
 }
 
+void QTFile::SetTOCCacheFolder(const char * inFolder)
+{
+    OSMutexLocker locker(&sTOCCacheMutex);
+
+    delete [] sTOCCacheFolder;
+    sTOCCacheFolder = NULL;
+
+    if( (inFolder != NULL) && (inFolder[0] != '\0') ) {
+        sTOCCacheFolder = NEW char[::strlen(inFolder) + 1];
+        ::strcpy(sTOCCacheFolder, inFolder);
+    }
+}
+
 void QTFile::AllocateBuffers(UInt32 inUnitSizeInK, UInt32 inBufferInc, UInt32 inBufferSizeUnits, UInt32 inMaxBitRateBuffSizeInBlocks, UInt32 inBitrate)
 {
+    //
+    // The file cache is laid out for the file's length at open, and a
+    // fragmented movie may still be growing.
+    if (fIsFragmented)
+        return;
 
 #if DSS_USE_API_CALLBACKS
     if (fOSFileSourceFD != NULL)
@@ -526,6 +599,143 @@ Bool16 QTFile::IsHintTrack(QTTrack *Track)
     return false;
 }
 
+QTFragmentIndex *QTFile::GetFragmentIndex(UInt32 TrackID)
+{
+    for( TrackListEntry *ListEntry = fFirstTrack; ListEntry != NULL; ListEntry = ListEntry->NextTrack ) {
+        if( ListEntry->TrackID == TrackID )
+            return ListEntry->Fragments;
+    }
+    return NULL;
+}
+
+void QTFile::IndexFragments(void)
+{
+    if( !fIsFragmented )
+        return;
+
+    OSMutexLocker   FragmentMutex(&fFragmentMutex);
+
+    //
+    // Go on over the top level atoms from the last whole one. An atom not
+    // all written yet stops the scan until the next call, and so does a
+    // moof whose sample data is not.
+    UInt64 theFileLength = GetCurrentFileLength();
+    while( fFragmentScanPos + 8 <= theFileLength ) {
+        char theHeader[16];
+        if( !Read(fFragmentScanPos, theHeader, 8) )
+            break;
+
+        UInt32 theLength32 = 0;
+        ::memcpy(&theLength32, theHeader, 4);
+        UInt64 theAtomLength = ntohl(theLength32);
+        OSType theAtomType = 0;
+        ::memcpy(&theAtomType, theHeader + 4, 4);
+        theAtomType = ntohl(theAtomType);
+        UInt32 theHeaderLength = 8;
+
+        if( theAtomLength == 1 ) {
+            if( (fFragmentScanPos + 16 > theFileLength) || !Read(fFragmentScanPos + 8, theHeader + 8, 8) )
+                break;
+            UInt64 theLength64 = 0;
+            ::memcpy(&theLength64, theHeader + 8, 8);
+            theAtomLength = QTAtom::NTOH64(theLength64);
+            theHeaderLength = 16;
+        }
+
+        //
+        // A length of 0 runs to the end of the file, wherever that ends up.
+        if( (theAtomLength < theHeaderLength) || (theAtomLength > theFileLength - fFragmentScanPos) )
+            break;
+
+        if( (theAtomType == FOUR_CHARS_TO_INT('m', 'o', 'o', 'f')) && (theAtomLength - theHeaderLength <= kMaxMoofSize) ) {
+            UInt32 theMoofLength = (UInt32)(theAtomLength - theHeaderLength);
+            char *theMoof = NEW char[theMoofLength];
+            Bool16 isIndexed = Read(fFragmentScanPos + theHeaderLength, theMoof, theMoofLength)
+                                && IndexMoof(theMoof, theMoofLength, fFragmentScanPos, theFileLength);
+            delete [] theMoof;
+            if( !isIndexed )
+                break;
+        }
+
+        fFragmentScanPos += theAtomLength;
+    }
+}
+
+Bool16 QTFile::IndexMoof(char * Moof, UInt32 Length, UInt64 MoofPos, UInt64 FileLength)
+{
+    QTFragmentIndex::Fragment   theFragments[kMaxTrafsPerMoof];
+    QTFragmentIndex             *theIndexes[kMaxTrafsPerMoof];
+    UInt32                      theNumFragments = 0;
+    UInt64                      theDataOffset = MoofPos;
+
+    //
+    // Parse every traf first, a bad one is left out.
+    UInt32 thePos = 0;
+    OSType theType = 0;
+    char *theTraf = NULL;
+    UInt32 theTrafLength = 0;
+    while( (theNumFragments < kMaxTrafsPerMoof)
+            && QTFragmentIndex::NextAtom(Moof, Length, &thePos, &theType, &theTraf, &theTrafLength) ) {
+        if( theType != FOUR_CHARS_TO_INT('t', 'r', 'a', 'f') )
+            continue;
+
+        QTFragmentIndex *theIndex = GetFragmentIndex(QTFragmentIndex::GetFragmentTrackID(theTraf, theTrafLength));
+        if( (theIndex == NULL) || !theIndex->ParseFragment(theTraf, theTrafLength, MoofPos, &theDataOffset, &theFragments[theNumFragments]) )
+            continue;
+        theIndexes[theNumFragments++] = theIndex;
+    }
+
+    //
+    // Then add them all, once all of their samples are in the file.
+    Bool16 isComplete = true;
+    for( UInt32 i = 0; i < theNumFragments; i++ ) {
+        if( theFragments[i].fDataEnd > FileLength )
+            isComplete = false;
+    }
+
+    for( UInt32 i = 0; i < theNumFragments; i++ ) {
+        if( isComplete )
+            theIndexes[i]->AddFragment(&theFragments[i]);
+        else
+            QTFragmentIndex::DisposeFragment(&theFragments[i]);
+    }
+    return isComplete;
+}
+
+void QTFile::ReadTrackExtends(AtomTOCEntry * MvexEntry)
+{
+    //
+    // The trex atoms hold each track's sample defaults. 'mvex' is not
+    // descended into by the TOC, so walk it here.
+    if( (MvexEntry->AtomDataLength == 0) || (MvexEntry->AtomDataLength > kMaxMoofSize) )
+        return;
+
+    UInt32 theMvexLength = (UInt32)MvexEntry->AtomDataLength;
+    char *theMvex = NEW char[theMvexLength];
+    if( Read(MvexEntry->AtomDataPos, theMvex, theMvexLength) ) {
+        UInt32 thePos = 0;
+        OSType theType = 0;
+        char *theData = NULL;
+        UInt32 theLength = 0;
+        while( QTFragmentIndex::NextAtom(theMvex, theMvexLength, &thePos, &theType, &theData, &theLength) ) {
+            if( (theType != FOUR_CHARS_TO_INT('t', 'r', 'e', 'x')) || (theLength < 24) )
+                continue;
+
+            // track_ID, then the default sample description index, duration, size and flags
+            UInt32 theFields[5];
+            for( UInt32 i = 0; i < 5; i++ ) {
+                UInt32 theField = 0;
+                ::memcpy(&theField, theData + 4 + (4 * i), 4);
+                theFields[i] = ntohl(theField);
+            }
+            QTFragmentIndex *theIndex = GetFragmentIndex(theFields[0]);
+            if( theIndex != NULL )
+                theIndex->SetDefaults(theFields[1], theFields[2], theFields[3], theFields[4]);
+        }
+    }
+    delete [] theMvex;
+}
+
 
 
 //
@@ -543,7 +753,21 @@ Float64 QTFile::GetDurationInSeconds(void)
    if (fMovieHeaderAtom == NULL)
         return 0.0;
 
-    return fMovieHeaderAtom->GetDurationInSeconds();
+    //
+    // The mvhd of a fragmented movie need not cover the fragments, if it
+    // has a duration at all; the longest track goes as far as they do.
+    Float64 theDuration = fMovieHeaderAtom->GetDurationInSeconds();
+    if (fIsFragmented)
+    {
+        for (TrackListEntry *ListEntry = fFirstTrack; ListEntry != NULL; ListEntry = ListEntry->NextTrack)
+        {
+            if (!ListEntry->Track->IsInitialized() && (ListEntry->Track->Initialize() != QTTrack::errNoError))
+                continue;
+            if (ListEntry->Track->GetDurationInSeconds() > theDuration)
+                theDuration = ListEntry->Track->GetDurationInSeconds();
+        }
+    }
+    return theDuration;
 }
 
 SInt64 QTFile::GetModDate()
@@ -559,6 +783,41 @@ SInt64 QTFile::GetModDate()
 #endif
 }
 
+UInt64 QTFile::GetCurrentFileLength()
+{
+    //
+    // The length at open is all fMovieFD knows of; a file being written
+    // goes on growing. Let fMovieFD read up to where it is now.
+    UInt64 theLength = GetFileLength();
+#ifndef __Win32__
+    OSMutexLocker   ReadMutex(fReadMutex);
+
+    if( fFile == -1 )
+        fFile = ::open(fMoviePath, O_RDONLY);
+
+    struct stat theStat;
+    if( (fFile != -1) && (::fstat(fFile, &theStat) == 0) && ((UInt64)theStat.st_size > theLength) ) {
+        theLength = (UInt64)theStat.st_size;
+#if DSS_USE_API_CALLBACKS
+        (void)QTSS_SetValue(fMovieFD, qtssFlObjLength, 0, &theLength, sizeof(theLength));
+#endif
+    }
+#endif
+    return theLength;
+}
+
+UInt64 QTFile::GetFileLength()
+{
+#if DSS_USE_API_CALLBACKS
+    UInt64 theLength = 0;
+    UInt32 theLen = sizeof(UInt64);
+    (void)QTSS_GetValue(fMovieFD, qtssFlObjLength, 0, (void*)&theLength, &theLen);
+    return theLength;
+#else
+    return fMovieFD.GetLength();
+#endif
+}
+
 //
 // Read functions.
 Bool16 QTFile::Read(UInt64 Offset, char * const Buffer, UInt32 Length, QTFile_FileControlBlock * FCB)
@@ -594,6 +853,58 @@ Bool16 QTFile::Read(UInt64 Offset, char * const Buffer, UInt32 Length, QTFile_Fi
 // Protected functions
 //
 Bool16 QTFile::GenerateAtomTOC(void)
+{
+    //
+    // Parse over a mapping of the whole file if it maps, so that each atom
+    // header is a memory access instead of a read call.
+    fTOCMapLength = GetFileLength();
+    fTOCReadPos = 0;
+    if( (fTOCMapLength > 0) && ((UInt64)(size_t)(UInt32)fTOCMapLength == fTOCMapLength) )
+        fTOCMap = MapFileToMem(0, (UInt32)fTOCMapLength);
+
+    Bool16 isValid = ParseAtomTOC();
+
+    if( fTOCMap != NULL ) {
+        (void)UnmapMem(fTOCMap, (UInt32)fTOCMapLength);
+        fTOCMap = NULL;
+    }
+
+#ifndef __Win32__
+    //
+    // Nothing else is mapped; GetCurrentFileLength opens fFile again if it
+    // is ever asked about a live file.
+    OSMutexLocker   ReadMutex(fReadMutex);
+    if( fFile != -1 ) {
+        ::close(fFile);
+        fFile = -1;
+    }
+#endif
+    return isValid;
+}
+
+Bool16 QTFile::ReadTOCBytes(UInt64 Offset, char * const Buffer, UInt32 Length)
+{
+    if( fTOCMap == NULL )
+        return Read(Offset, Buffer, Length);
+
+    //
+    // Leave fTOCReadPos where a failed read leaves the file position, which
+    // is what ValidTOC looks at.
+    if( Offset >= fTOCMapLength ) {
+        fTOCReadPos = Offset;
+        return false;
+    }
+    if( Length > fTOCMapLength - Offset ) {
+        fTOCReadPos = fTOCMapLength;
+        return false;
+    }
+
+    ::memcpy(Buffer, fTOCMap + Offset, Length);
+    fTOCReadPos = Offset + Length;
+    return true;
+}
+
+Bool16 QTFile::ParseAtomTOC(void)
 {
     // General vars
     OSType          AtomType;
@@ -613,7 +924,7 @@ Bool16 QTFile::GenerateAtomTOC(void)
     // Scan through all of the atoms in this movie, generating a TOC entry
     // for each one.
     CurPos = 0;
-    while( Read(CurPos, (char *)&atomLength, 4) ) {
+    while( ReadTOCBytes(CurPos, (char *)&atomLength, 4) ) {
 
         //
         // Swap the AtomLength for little-endian machines.
@@ -650,12 +961,12 @@ Bool16 QTFile::GenerateAtomTOC(void)
 
             //
             // Read the size and the type of this atom.
-            if( !Read(CurPos, (char *)&atomLength, 4) )
+            if( !ReadTOCBytes(CurPos, (char *)&atomLength, 4) )
                 return false;
             CurPos += 4;
             BigAtomLength =  (UInt64) ntohl(atomLength);
             
-            if( !Read(CurPos, (char *)&AtomType, 4) )
+            if( !ReadTOCBytes(CurPos, (char *)&AtomType, 4) )
                 return false;
             CurPos += 4;
             AtomType = ntohl(AtomType);
@@ -673,7 +984,7 @@ Bool16 QTFile::GenerateAtomTOC(void)
         } 
         else  // This is a normal atom; get the atom type.
         {
-            if( !Read(CurPos, (char *)&AtomType, 4) )
+            if( !ReadTOCBytes(CurPos, (char *)&AtomType, 4) )
                 break;
 
             CurPos += 4;
@@ -682,7 +993,7 @@ Bool16 QTFile::GenerateAtomTOC(void)
 
             if ( atomLength == 1 ) //large size atom
             {
-                if( !Read(CurPos, (char *)&BigAtomLength, 8) )  
+                if( !ReadTOCBytes(CurPos, (char *)&BigAtomLength, 8) )  
                     break;
                 BigAtomLength = QTAtom::NTOH64(BigAtomLength);
                 CurPos += 8;
@@ -695,7 +1006,7 @@ Bool16 QTFile::GenerateAtomTOC(void)
                 static const int sExtendedTypeSize = 16;
                 UInt8 usertype[sExtendedTypeSize + 1]; //sExtendedTypeSize for the type + 1 for 0 terminator.
                 usertype[sExtendedTypeSize] = 0;
-                if( !Read(CurPos, (char *)usertype, 16) ) // read and just throw it away we don't need to store
+                if( !ReadTOCBytes(CurPos, (char *)usertype, 16) ) // read and just throw it away we don't need to store
                     return false;
     
                 DEEP_DEBUG_PRINT(("QTFile::GenerateAtomTOC - Found 'uuid' extended type name= %s.\n",usertype));
@@ -745,6 +1056,21 @@ Bool16 QTFile::GenerateAtomTOC(void)
         else if (AtomType == FOUR_CHARS_TO_INT('m', 'o', 'o', 'v'))
         {
            hasMoovAtom = true;
+
+#ifndef __Win32__
+           //
+           // Have the whole 'moov' read in at once rather than a page
+           // at a time as the parse below touches it.
+           if (fTOCMap != NULL)
+           {
+               UInt64 theStart = CurPos - (CurPos % (UInt64)::sysconf(_SC_PAGESIZE));
+               UInt64 theEnd = CurPos + BigAtomLength - CurAtomHeaderSize;
+               if (theEnd > fTOCMapLength)
+                   theEnd = fTOCMapLength;
+               if (theEnd > theStart)
+                   (void)::madvise(fTOCMap + theStart, (size_t)(theEnd - theStart), MADV_WILLNEED);
+           }
+#endif
         }
         else if (!hasMoovAtom)
         {
@@ -872,12 +1198,230 @@ lbl_SkipAtom:
 
 char *QTFile::MapFileToMem(UInt64 offset, UInt32 length)
 {
-	return NULL;
+#ifndef __Win32__
+    if( length == 0 )
+        return NULL;
+
+    OSMutexLocker   ReadMutex(fReadMutex);
+
+    //
+    // Mapped from a descriptor of our own, fMovieFD need not be a plain file.
+    if( fFile == -1 )
+        fFile = ::open(fMoviePath, O_RDONLY);
+    if( fFile == -1 )
+        return NULL;
+
+    //
+    // Touching a page past the end of the file raises SIGBUS, so refuse a
+    // range the file is no longer long enough for, say since it was cut
+    // short after it was opened.
+    struct stat theStat;
+    if( (::fstat(fFile, &theStat) != 0) || ((UInt64)theStat.st_size < offset + length) )
+        return NULL;
+
+    //
+    // mmap takes a page aligned offset; hand back a pointer past the slack.
+    UInt64 theSlack = offset % (UInt64)::sysconf(_SC_PAGESIZE);
+    void *theMem = ::mmap(NULL, (size_t)(length + theSlack), PROT_READ, MAP_SHARED, fFile, (off_t)(offset - theSlack));
+    if( theMem == MAP_FAILED )
+        return NULL;
+
+    return (char *)theMem + theSlack;
+#else
+    return NULL;
+#endif
 }
 
 int QTFile::UnmapMem(char* memPtr, UInt32 length)
 {
+#ifndef __Win32__
+    if( memPtr == NULL )
+        return 0;
+
+    // The mapping starts at the page memPtr is in
+    UInt64 theSlack = (unsigned long)memPtr % (UInt64)::sysconf(_SC_PAGESIZE);
+    return ::munmap(memPtr - theSlack, (size_t)(length + theSlack));
+#else
     return 0;
+#endif
+}
+
+Bool16 QTFile::GetTOCCachePath(char * outPath, UInt32 inPathSize)
+{
+    OSMutexLocker locker(&sTOCCacheMutex);
+    if( sTOCCacheFolder == NULL )
+        return false;
+
+    //
+    // One file per movie, named by an FNV-1a hash of its path.
+    UInt64 theHash = 14695981039346656037ULL;
+    for( char *p = fMoviePath; *p != '\0'; p++ ) {
+        theHash ^= (UInt8)*p;
+        theHash *= 1099511628211ULL;
+    }
+
+    int theLen = qtss_snprintf(outPath, inPathSize, "%s%s%08lx%08lx.toc", sTOCCacheFolder,
+                    (sTOCCacheFolder[::strlen(sTOCCacheFolder) - 1] == '/') ? "" : "/",
+                    (unsigned long)(theHash >> 32), (unsigned long)(theHash & 0xFFFFFFFF));
+    return (theLen > 0) && ((UInt32)theLen < inPathSize);
+}
+
+Bool16 QTFile::ReadTOCCache(void)
+{
+#ifndef __Win32__
+    char thePath[kTOCCachePathSize];
+    if( !GetTOCCachePath(thePath, sizeof(thePath)) )
+        return false;
+
+    int theFile = ::open(thePath, O_RDONLY);
+    if( theFile == -1 )
+        return false;
+
+    struct stat theStat;
+    char *theData = NULL;
+    UInt64 theSize = 0;
+    if( (::fstat(theFile, &theStat) == 0) && (theStat.st_size >= (off_t)sizeof(TOCCacheHeader)) ) {
+        theSize = (UInt64)theStat.st_size;
+        theData = NEW char[theSize];
+        if( ::read(theFile, theData, (size_t)theSize) != (ssize_t)theSize ) {
+            delete [] theData;
+            theData = NULL;
+        }
+    }
+    ::close(theFile);
+    if( theData == NULL )
+        return false;
+
+    //
+    // Only good for the same file, unchanged since the cache was written.
+    TOCCacheHeader *theHeader = (TOCCacheHeader *)theData;
+    UInt32 thePathLength = ::strlen(fMoviePath);
+    UInt32 theEntriesOffset = sizeof(TOCCacheHeader) + ((thePathLength + 7) & ~7);
+    TOCCacheEntry *theCacheEntries = (TOCCacheEntry *)(theData + theEntriesOffset);
+    if( (theHeader->Magic != kTOCCacheMagic) || (theHeader->EntrySize != sizeof(TOCCacheEntry))
+        || (theHeader->ModDate != GetModDate()) || (theHeader->FileLength != GetFileLength())
+        || (theHeader->NumEntries == 0) || (theHeader->PathLength != thePathLength)
+        || (theSize != theEntriesOffset + (UInt64)theHeader->NumEntries * sizeof(TOCCacheEntry))
+        || (::memcmp(theData + sizeof(TOCCacheHeader), fMoviePath, thePathLength) != 0) ) {
+        delete [] theData;
+        return false;
+    }
+
+    //
+    // Entries are in TOC order, so a parent always comes before its children.
+    UInt32 theNumEntries = theHeader->NumEntries;
+    for( UInt32 i = 0; i < theNumEntries; i++ ) {
+        if( theCacheEntries[i].ParentTOCID > i ) {
+            delete [] theData;
+            return false;
+        }
+    }
+
+    //
+    // Rebuild the TOC as GenerateAtomTOC would have.  TOC ids are 1..n in
+    // TOC order; LastEntries[id] is the last child seen of that atom, [0]
+    // the last top level atom.
+    AtomTOCEntry **theEntries = NEW AtomTOCEntry *[theNumEntries + 1];
+    AtomTOCEntry **theLastEntries = NEW AtomTOCEntry *[theNumEntries + 1];
+    ::memset(theLastEntries, 0, sizeof(AtomTOCEntry *) * (theNumEntries + 1));
+    theEntries[0] = NULL;
+
+    for( UInt32 i = 0; i < theNumEntries; i++ ) {
+        AtomTOCEntry *NewTOCEntry = NEW AtomTOCEntry();
+        UInt32 theParentID = theCacheEntries[i].ParentTOCID;
+
+        NewTOCEntry->TOCID = fNextTOCID++;
+        NewTOCEntry->AtomType = theCacheEntries[i].AtomType;
+        NewTOCEntry->beAtomType = htonl(NewTOCEntry->AtomType);
+        NewTOCEntry->AtomDataPos = theCacheEntries[i].AtomDataPos;
+        NewTOCEntry->AtomDataLength = theCacheEntries[i].AtomDataLength;
+        NewTOCEntry->AtomHeaderSize = theCacheEntries[i].AtomHeaderSize;
+
+        NewTOCEntry->NextOrdAtom = NULL;
+        NewTOCEntry->PrevAtom = theLastEntries[theParentID];
+        NewTOCEntry->NextAtom = NULL;
+        NewTOCEntry->Parent = theEntries[theParentID];
+        NewTOCEntry->FirstChild = NULL;
+
+        if( NewTOCEntry->PrevAtom != NULL )
+            NewTOCEntry->PrevAtom->NextAtom = NewTOCEntry;
+        else if( NewTOCEntry->Parent != NULL )
+            NewTOCEntry->Parent->FirstChild = NewTOCEntry;
+        theLastEntries[theParentID] = NewTOCEntry;
+        theEntries[i + 1] = NewTOCEntry;
+
+        if( fTOC == NULL ) {
+            fTOC = NewTOCEntry;
+            fTOCOrdHead = fTOCOrdTail = NewTOCEntry;
+        } else {
+            fTOCOrdTail->NextOrdAtom = NewTOCEntry;
+            fTOCOrdTail = NewTOCEntry;
+        }
+    }
+
+    delete [] theEntries;
+    delete [] theLastEntries;
+    delete [] theData;
+
+    DEBUG_PRINT(("QTFile::ReadTOCCache - Read %lu atoms from %s.\n", theNumEntries, thePath));
+    return true;
+#else
+    return false;
+#endif
+}
+
+void QTFile::WriteTOCCache(void)
+{
+#ifndef __Win32__
+    char thePath[kTOCCachePathSize];
+    if( !GetTOCCachePath(thePath, sizeof(thePath)) )
+        return;
+
+    UInt32 theNumEntries = 0;
+    for( AtomTOCEntry *TOCEntry = fTOCOrdHead; TOCEntry != NULL; TOCEntry = TOCEntry->NextOrdAtom )
+        theNumEntries++;
+    if( theNumEntries == 0 )
+        return;
+
+    UInt32 thePathLength = ::strlen(fMoviePath);
+    UInt32 theEntriesOffset = sizeof(TOCCacheHeader) + ((thePathLength + 7) & ~7);
+    UInt32 theSize = theEntriesOffset + theNumEntries * sizeof(TOCCacheEntry);
+    char *theData = NEW char[theSize];
+    ::memset(theData, 0, theSize);
+
+    TOCCacheHeader *theHeader = (TOCCacheHeader *)theData;
+    theHeader->Magic = kTOCCacheMagic;
+    theHeader->EntrySize = sizeof(TOCCacheEntry);
+    theHeader->ModDate = GetModDate();
+    theHeader->FileLength = GetFileLength();
+    theHeader->NumEntries = theNumEntries;
+    theHeader->PathLength = thePathLength;
+    ::memcpy(theData + sizeof(TOCCacheHeader), fMoviePath, thePathLength);
+
+    TOCCacheEntry *theCacheEntry = (TOCCacheEntry *)(theData + theEntriesOffset);
+    for( AtomTOCEntry *TOCEntry = fTOCOrdHead; TOCEntry != NULL; TOCEntry = TOCEntry->NextOrdAtom, theCacheEntry++ ) {
+        theCacheEntry->AtomType = TOCEntry->AtomType;
+        theCacheEntry->AtomHeaderSize = TOCEntry->AtomHeaderSize;
+        theCacheEntry->AtomDataPos = TOCEntry->AtomDataPos;
+        theCacheEntry->AtomDataLength = TOCEntry->AtomDataLength;
+        theCacheEntry->ParentTOCID = (TOCEntry->Parent != NULL) ? TOCEntry->Parent->TOCID : 0;
+    }
+
+    //
+    // Written aside and renamed in, so a reader never sees half a file.
+    char theTempPath[kTOCCachePathSize + 8];
+    qtss_sprintf(theTempPath, "%s.XXXXXX", thePath);
+    int theFile = ::mkstemp(theTempPath);
+    if( theFile != -1 ) {
+        Bool16 isWritten = (::write(theFile, theData, theSize) == (ssize_t)theSize);
+        (void)::fchmod(theFile, 0644);
+        ::close(theFile);
+        if( !isWritten || (::rename(theTempPath, thePath) != 0) )
+            (void)::unlink(theTempPath);
+    }
+
+    delete [] theData;
+#endif
 }
 
 
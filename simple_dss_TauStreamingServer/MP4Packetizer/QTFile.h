@@ -19,6 +19,7 @@ LastUpdate:  2010-08-19
 
 
 #include "OSHeaders.h"
+#include "OSMutex.h"
 #include "OSFileSource.h"
 #include "QTFile_FileControlBlock.h"
 #include "DateTranslator.h"
@@ -30,6 +31,7 @@ class OSFileSource;
 class FileMap;
 class QTAtom_mvhd;
 class QTTrack;
+class QTFragmentIndex;
 
 
 //
@@ -50,6 +52,13 @@ public:
         errInternalError            = 100
     };
 
+    enum {
+        kTOCCacheMagic              = FOUR_CHARS_TO_INT('q', 't', 'o', 'c'),  //UInt32
+        kTOCCachePathSize           = 1024, //UInt32
+        kMaxTrafsPerMoof            = 16,   //UInt32
+        kMaxMoofSize                = 16 * 1024 * 1024  //UInt32
+    };
+
 
     //
     // Class typedefs.
@@ -77,6 +86,9 @@ public:
         QTTrack         *Track;
         Bool16          IsHintTrack;
 
+        // Samples of a fragmented movie, NULL otherwise
+        QTFragmentIndex *Fragments;
+
         // List pointers
         TrackListEntry  *NextTrack;
     };
@@ -92,6 +104,12 @@ public:
     //
     // Open a movie file and generate the atom table of contents.
             ErrorCode   Open(const char * MoviePath);
+
+    //
+    // Folder where the atom TOC of each opened movie is saved, and read back
+    // instead of parsing the movie while its mod date and length are unchanged.
+    // NULL or empty turns the TOC cache off.
+    static  void        SetTOCCacheFolder(const char * inFolder);
             
             OSMutex*    GetMutex() { return fReadMutex; }
 
@@ -107,6 +125,14 @@ public:
             Bool16      NextTrack(QTTrack **Track, QTTrack *LastFoundTrack = NULL);
             Bool16      FindTrack(UInt32 TrackID, QTTrack **Track);
             Bool16      IsHintTrack(QTTrack *Track);
+
+    //
+    // Fragmented movie functions. IndexFragments indexes the moof atoms
+    // written since it last ran; a track calls it when asked for a sample
+    // past the last one it has.
+    inline  Bool16      IsFragmented(void) { return fIsFragmented; }
+            QTFragmentIndex *GetFragmentIndex(UInt32 TrackID);
+            void        IndexFragments(void);
     
     //
     // Accessors
@@ -133,6 +159,8 @@ public:
     inline Bool16       ValidTOC();
             
             
+            // Read only mapping of the movie, NULL if it can't be mapped.
+            // offset need not be page aligned.
             char*      MapFileToMem(UInt64 offset, UInt32 length);
             
             int         UnmapMem(char *memPtr, UInt32 length);
@@ -145,6 +173,39 @@ protected:
     //
     // Protected member functions.
             Bool16      GenerateAtomTOC(void);
+            Bool16      ParseAtomTOC(void);
+            Bool16      ReadTOCBytes(UInt64 Offset, char * const Buffer, UInt32 Length);
+            UInt64      GetFileLength();
+            UInt64      GetCurrentFileLength();
+            Bool16      IndexMoof(char * Moof, UInt32 Length, UInt64 MoofPos, UInt64 FileLength);
+            void        ReadTrackExtends(AtomTOCEntry * MvexEntry);
+
+            Bool16      GetTOCCachePath(char * outPath, UInt32 inPathSize);
+            Bool16      ReadTOCCache(void);
+            void        WriteTOCCache(void);
+
+    //
+    // TOC cache file layout: a TOCCacheHeader, the movie path padded to 8
+    // bytes, then an entry per atom in TOC order.
+    struct TOCCacheHeader {
+        UInt32          Magic;
+        UInt32          EntrySize;
+        SInt64          ModDate;
+        UInt64          FileLength;
+        UInt32          NumEntries;
+        UInt32          PathLength;
+    };
+
+    struct TOCCacheEntry {
+        OSType          AtomType;
+        UInt32          AtomHeaderSize;
+        UInt64          AtomDataPos;
+        UInt64          AtomDataLength;
+        UInt32          ParentTOCID;    // 0 at the top level
+    };
+
+    static char         *sTOCCacheFolder;
+    static OSMutex      sTOCCacheMutex;
     
     //
     // Protected member variables.
@@ -171,6 +232,17 @@ protected:
     
     OSMutex             *fReadMutex;
     int                  fFile;
+
+    // Mapping of the whole file while GenerateAtomTOC runs, NULL when it
+    // reads through Read. fTOCReadPos stands in for the file position.
+    char                *fTOCMap;
+    UInt64              fTOCMapLength;
+    UInt64              fTOCReadPos;
+
+    // Where IndexFragments goes on from, the end of the last whole atom
+    Bool16              fIsFragmented;
+    OSMutex             fFragmentMutex;
+    UInt64              fFragmentScanPos;
                         
 };
 
@@ -179,6 +251,9 @@ Bool16 QTFile::ValidTOC()
     UInt64 theLength = 0;
     UInt64 thePos = 0;
 
+    if (fTOCMap != NULL)
+        return fTOCReadPos >= fTOCMapLength;
+
 #if DSS_USE_API_CALLBACKS
     UInt32 theDataLen = sizeof(UInt64);
     (void)QTSS_GetValue(fMovieFD, qtssFlObjLength, 0, (void*)&theLength, &theDataLen);
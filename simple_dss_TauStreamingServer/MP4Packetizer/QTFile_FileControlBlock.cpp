@@ -158,9 +158,11 @@ Bool16 QTFile_FileControlBlock::Read(FILE_SOURCE *dflt, UInt64 inPosition, void*
     if( (inPosition < fDataBufferPosStart) || ((inPosition + inLength) > fDataBufferPosEnd) ) 
     {
         // If this is a forward-moving, contiguous read, then we can keep the
-        // current buffer around.
+        // current buffer around. Not a short one though: it ended at the end
+        // of the file as it was then, and the copy below takes the previous
+        // buffer to be full.
         
-        if (    (fCurrentDataBufferLength != 0)
+        if (    (fCurrentDataBufferLength == fDataBufferSize)
             &&  ((fDataBufferPosEnd - fCurrentDataBufferLength) <= inPosition)
             && ((fDataBufferPosEnd + fDataBufferSize) >= (inPosition + inLength))
            ) 
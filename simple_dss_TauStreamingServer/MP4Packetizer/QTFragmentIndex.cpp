@@ -0,0 +1,545 @@
+/***************************************************************************
+
+Copyright (c) 2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 QTFragmentIndex.cpp
+Description: Sample index of one track of a fragmented MP4 file, built from
+             the traf atoms of its moof atoms and extended as they are appended.
+Comment:
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-19
+LastUpdate:  2026-10-19
+
+****************************************************************************/
+
+#include <string.h>
+
+#include "QTFragmentIndex.h"
+#include "OSMemory.h"
+
+#ifndef __Win32__
+#include <netinet/in.h>
+#endif
+
+// tfhd flags
+static const UInt32 kBaseDataOffsetPresent          = 0x000001;
+static const UInt32 kSampleDescriptionIndexPresent  = 0x000002;
+static const UInt32 kDefaultDurationPresent         = 0x000008;
+static const UInt32 kDefaultSizePresent             = 0x000010;
+static const UInt32 kDefaultFlagsPresent            = 0x000020;
+static const UInt32 kDefaultBaseIsMoof              = 0x020000;
+
+// trun flags
+static const UInt32 kDataOffsetPresent              = 0x000001;
+static const UInt32 kFirstSampleFlagsPresent        = 0x000004;
+static const UInt32 kSampleDurationPresent          = 0x000100;
+static const UInt32 kSampleSizePresent              = 0x000200;
+static const UInt32 kSampleFlagsPresent             = 0x000400;
+static const UInt32 kSampleCompositionOffsetPresent = 0x000800;
+
+static UInt32 ReadUInt32(char* inData)
+{
+    UInt32 theValue = 0;
+    ::memcpy(&theValue, inData, 4);
+    return ntohl(theValue);
+}
+
+static UInt64 ReadUInt64(char* inData)
+{
+    return ((UInt64)ReadUInt32(inData) << 32) | (UInt64)ReadUInt32(inData + 4);
+}
+
+QTFragmentIndex::QTFragmentIndex(UInt32 inTrackID)
+:   fMutex(),
+    fTrackID(inTrackID),
+    fDefaultSampleDescriptionIndex(1),
+    fDefaultDuration(0),
+    fDefaultLength(0),
+    fDefaultFlags(0),
+    fFragments(NULL),
+    fNumFragments(0),
+    fMaxFragments(0),
+    fNumSamples(0),
+    fTimeOrigin(0),
+    fEndTime(0)
+{}
+
+QTFragmentIndex::~QTFragmentIndex()
+{
+    for (UInt32 x = 0; x < fNumFragments; x++)
+        DisposeFragment(&fFragments[x]);
+    delete [] fFragments;
+}
+
+void QTFragmentIndex::SetDefaults(UInt32 inSampleDescriptionIndex, UInt32 inDuration, UInt32 inLength, UInt32 inFlags)
+{
+    fDefaultSampleDescriptionIndex = inSampleDescriptionIndex;
+    fDefaultDuration = inDuration;
+    fDefaultLength = inLength;
+    fDefaultFlags = inFlags;
+}
+
+Bool16 QTFragmentIndex::NextAtom(char* inStart, UInt32 inLength, UInt32* ioPos, OSType* outType, char** outData, UInt32* outLength)
+{
+    if ((*ioPos > inLength) || (inLength - *ioPos < 8))
+        return false;
+
+    char* theAtom = inStart + *ioPos;
+    UInt64 theAtomLength = ReadUInt32(theAtom);
+    UInt32 theHeaderLength = 8;
+    if (theAtomLength == 1)
+    {
+        if (inLength - *ioPos < 16)
+            return false;
+        theAtomLength = ReadUInt64(theAtom + 8);
+        theHeaderLength = 16;
+    }
+    else if (theAtomLength == 0)
+        theAtomLength = inLength - *ioPos;
+
+    if ((theAtomLength < theHeaderLength) || (theAtomLength > inLength - *ioPos))
+        return false;
+
+    *outType = ReadUInt32(theAtom + 4);
+    *outData = theAtom + theHeaderLength;
+    *outLength = (UInt32)theAtomLength - theHeaderLength;
+    *ioPos += (UInt32)theAtomLength;
+    return true;
+}
+
+UInt32 QTFragmentIndex::GetFragmentTrackID(char* inTraf, UInt32 inLength)
+{
+    UInt32 thePos = 0;
+    OSType theType = 0;
+    char* theData = NULL;
+    UInt32 theLength = 0;
+    while (NextAtom(inTraf, inLength, &thePos, &theType, &theData, &theLength))
+    {
+        if ((theType == FOUR_CHARS_TO_INT('t', 'f', 'h', 'd')) && (theLength >= 8))
+            return ReadUInt32(theData + 4);
+    }
+    return 0;
+}
+
+Bool16 QTFragmentIndex::ParseFragment(char* inTraf, UInt32 inLength, UInt64 inMoofPos, UInt64* ioDataOffset, Fragment* outFragment)
+{
+    ::memset(outFragment, 0, sizeof(Fragment));
+
+    UInt32 theSampleDescriptionIndex = fDefaultSampleDescriptionIndex;
+    UInt32 theDefaultDuration = fDefaultDuration;
+    UInt32 theDefaultLength = fDefaultLength;
+    UInt32 theDefaultFlags = fDefaultFlags;
+    UInt64 theBaseOffset = *ioDataOffset;
+    Bool16 hasHeader = false;
+    UInt32 theNumSamples = 0;
+
+    // The tfhd and tfdt, and how many samples the truns add up to
+    UInt32 thePos = 0;
+    OSType theType = 0;
+    char* theData = NULL;
+    UInt32 theLength = 0;
+    while (NextAtom(inTraf, inLength, &thePos, &theType, &theData, &theLength))
+    {
+        if (theType == FOUR_CHARS_TO_INT('t', 'f', 'h', 'd'))
+        {
+            if (theLength < 8)
+                return false;
+            UInt32 theFlags = ReadUInt32(theData) & 0x00FFFFFF;
+            UInt32 theFieldPos = 8;
+            UInt32 theFieldsLength = 0;
+            if (theFlags & kBaseDataOffsetPresent)          theFieldsLength += 8;
+            if (theFlags & kSampleDescriptionIndexPresent)  theFieldsLength += 4;
+            if (theFlags & kDefaultDurationPresent)         theFieldsLength += 4;
+            if (theFlags & kDefaultSizePresent)             theFieldsLength += 4;
+            if (theFlags & kDefaultFlagsPresent)            theFieldsLength += 4;
+            if (theLength < theFieldPos + theFieldsLength)
+                return false;
+
+            if (theFlags & kBaseDataOffsetPresent)
+            {
+                theBaseOffset = ReadUInt64(theData + theFieldPos);
+                theFieldPos += 8;
+            }
+            else if (theFlags & kDefaultBaseIsMoof)
+                theBaseOffset = inMoofPos;
+            if (theFlags & kSampleDescriptionIndexPresent)
+            {
+                theSampleDescriptionIndex = ReadUInt32(theData + theFieldPos);
+                theFieldPos += 4;
+            }
+            if (theFlags & kDefaultDurationPresent)
+            {
+                theDefaultDuration = ReadUInt32(theData + theFieldPos);
+                theFieldPos += 4;
+            }
+            if (theFlags & kDefaultSizePresent)
+            {
+                theDefaultLength = ReadUInt32(theData + theFieldPos);
+                theFieldPos += 4;
+            }
+            if (theFlags & kDefaultFlagsPresent)
+                theDefaultFlags = ReadUInt32(theData + theFieldPos);
+            hasHeader = true;
+        }
+        else if (theType == FOUR_CHARS_TO_INT('t', 'f', 'd', 't'))
+        {
+            if ((theLength >= 12) && (theData[0] == 1))
+                outFragment->fBaseMediaTime = ReadUInt64(theData + 4);
+            else if (theLength >= 8)
+                outFragment->fBaseMediaTime = ReadUInt32(theData + 4);
+            else
+                return false;
+            outFragment->fHasBaseMediaTime = true;
+        }
+        else if (theType == FOUR_CHARS_TO_INT('t', 'r', 'u', 'n'))
+        {
+            if (theLength < 8)
+                return false;
+            UInt32 theRunSamples = ReadUInt32(theData + 4);
+            if (theRunSamples > kMaxSamplesPerFragment - theNumSamples)
+                return false;
+            theNumSamples += theRunSamples;
+        }
+    }
+
+    if (!hasHeader)
+        return false;
+
+    outFragment->fSampleDescriptionIndex = theSampleDescriptionIndex;
+    outFragment->fDataEnd = theBaseOffset;
+    if (theNumSamples == 0)
+        return true;
+
+    outFragment->fSamples = NEW Sample[theNumSamples];
+
+    // The samples, each trun going on from the data of the one before
+    // unless it has a data offset of its own
+    UInt64 theDataOffset = theBaseOffset;
+    UInt64 theTime = 0;
+    thePos = 0;
+    while (NextAtom(inTraf, inLength, &thePos, &theType, &theData, &theLength))
+    {
+        if (theType != FOUR_CHARS_TO_INT('t', 'r', 'u', 'n'))
+            continue;
+
+        UInt32 theFlags = ReadUInt32(theData) & 0x00FFFFFF;
+        UInt32 theRunSamples = ReadUInt32(theData + 4);
+        UInt32 theFieldPos = 8;
+
+        UInt32 theRecordLength = 0;
+        if (theFlags & kSampleDurationPresent)          theRecordLength += 4;
+        if (theFlags & kSampleSizePresent)              theRecordLength += 4;
+        if (theFlags & kSampleFlagsPresent)             theRecordLength += 4;
+        if (theFlags & kSampleCompositionOffsetPresent) theRecordLength += 4;
+
+        UInt64 theRunLength = (UInt64)theFieldPos + (UInt64)theRunSamples * theRecordLength;
+        if (theFlags & kDataOffsetPresent)          theRunLength += 4;
+        if (theFlags & kFirstSampleFlagsPresent)    theRunLength += 4;
+        if (theRunLength > theLength)
+        {
+            DisposeFragment(outFragment);
+            return false;
+        }
+
+        if (theFlags & kDataOffsetPresent)
+        {
+            theDataOffset = theBaseOffset + (SInt64)(SInt32)ReadUInt32(theData + theFieldPos);
+            theFieldPos += 4;
+        }
+        UInt32 theFirstFlags = theDefaultFlags;
+        if (theFlags & kFirstSampleFlagsPresent)
+        {
+            theFirstFlags = ReadUInt32(theData + theFieldPos);
+            theFieldPos += 4;
+        }
+
+        for (UInt32 x = 0; x < theRunSamples; x++)
+        {
+            UInt32 theDuration = theDefaultDuration;
+            UInt32 theSampleLength = theDefaultLength;
+            UInt32 theSampleFlags = (x == 0) ? theFirstFlags : theDefaultFlags;
+            SInt32 theCompositionOffset = 0;
+            if (theFlags & kSampleDurationPresent)
+            {
+                theDuration = ReadUInt32(theData + theFieldPos);
+                theFieldPos += 4;
+            }
+            if (theFlags & kSampleSizePresent)
+            {
+                theSampleLength = ReadUInt32(theData + theFieldPos);
+                theFieldPos += 4;
+            }
+            if (theFlags & kSampleFlagsPresent)
+            {
+                theSampleFlags = ReadUInt32(theData + theFieldPos);
+                theFieldPos += 4;
+            }
+            // Unsigned in version 0, but nobody writes one that big
+            if (theFlags & kSampleCompositionOffsetPresent)
+            {
+                theCompositionOffset = (SInt32)ReadUInt32(theData + theFieldPos);
+                theFieldPos += 4;
+            }
+
+            Sample* theSample = &outFragment->fSamples[outFragment->fNumSamples++];
+            theSample->fOffset = theDataOffset;
+            theSample->fLength = theSampleLength;
+            theSample->fTime = (UInt32)theTime;
+            theSample->fCompositionOffset = theCompositionOffset;
+            theSample->fIsSync = (theSampleFlags & kSampleIsNonSync) == 0;
+            if (theSample->fIsSync)
+                outFragment->fNumSyncSamples++;
+
+            theDataOffset += theSampleLength;
+            theTime += theDuration;
+            if (theDataOffset > outFragment->fDataEnd)
+                outFragment->fDataEnd = theDataOffset;
+        }
+    }
+
+    outFragment->fDuration = theTime;
+    *ioDataOffset = theDataOffset;
+    return true;
+}
+
+void QTFragmentIndex::AddFragment(Fragment* inFragment)
+{
+    if (inFragment->fNumSamples == 0)
+    {
+        DisposeFragment(inFragment);
+        return;
+    }
+
+    OSMutexWriteLocker locker(&fMutex);
+
+    if (fNumFragments == fMaxFragments)
+    {
+        UInt32 theMaxFragments = (fMaxFragments == 0) ? (UInt32)kInitialFragments : fMaxFragments * 2;
+        Fragment* theFragments = NEW Fragment[theMaxFragments];
+        if (fNumFragments > 0)
+            ::memcpy(theFragments, fFragments, sizeof(Fragment) * fNumFragments);
+        delete [] fFragments;
+        fFragments = theFragments;
+        fMaxFragments = theMaxFragments;
+    }
+
+    // Times only go forward, so that they can be searched. A fragment
+    // without a tfdt, or one that would start in an earlier one, goes
+    // right after the last.
+    if (fNumFragments == 0)
+        fTimeOrigin = inFragment->fHasBaseMediaTime ? inFragment->fBaseMediaTime : 0;
+    if (inFragment->fHasBaseMediaTime && (inFragment->fBaseMediaTime >= fTimeOrigin + fEndTime))
+        inFragment->fBaseMediaTime -= fTimeOrigin;
+    else
+        inFragment->fBaseMediaTime = fEndTime;
+
+    inFragment->fFirstSample = fNumSamples + 1;
+    fFragments[fNumFragments++] = *inFragment;
+    fNumSamples += inFragment->fNumSamples;
+    fEndTime = inFragment->fBaseMediaTime + inFragment->fDuration;
+
+    // The index owns the samples now
+    inFragment->fSamples = NULL;
+}
+
+void QTFragmentIndex::DisposeFragment(Fragment* inFragment)
+{
+    delete [] inFragment->fSamples;
+    inFragment->fSamples = NULL;
+    inFragment->fNumSamples = 0;
+}
+
+UInt32 QTFragmentIndex::GetNumSamples()
+{
+    OSMutexReadLocker locker(&fMutex);
+    return fNumSamples;
+}
+
+UInt64 QTFragmentIndex::GetDuration()
+{
+    OSMutexReadLocker locker(&fMutex);
+    return fEndTime;
+}
+
+SInt32 QTFragmentIndex::FindFragment(UInt32 inSampleNumber)
+{
+    if ((inSampleNumber == 0) || (inSampleNumber > fNumSamples))
+        return -1;
+
+    // The last fragment starting at or before the sample
+    UInt32 theLow = 0;
+    UInt32 theHigh = fNumFragments - 1;
+    while (theLow < theHigh)
+    {
+        UInt32 theMiddle = (theLow + theHigh + 1) / 2;
+        if (fFragments[theMiddle].fFirstSample <= inSampleNumber)
+            theLow = theMiddle;
+        else
+            theHigh = theMiddle - 1;
+    }
+    return (SInt32)theLow;
+}
+
+SInt32 QTFragmentIndex::FindFragmentByTime(UInt64 inMediaTime)
+{
+    if ((fNumFragments == 0) || (inMediaTime >= fEndTime))
+        return -1;
+
+    UInt32 theLow = 0;
+    UInt32 theHigh = fNumFragments - 1;
+    while (theLow < theHigh)
+    {
+        UInt32 theMiddle = (theLow + theHigh + 1) / 2;
+        if (fFragments[theMiddle].fBaseMediaTime <= inMediaTime)
+            theLow = theMiddle;
+        else
+            theHigh = theMiddle - 1;
+    }
+    return (SInt32)theLow;
+}
+
+Bool16 QTFragmentIndex::GetSampleInfo(UInt32 inSampleNumber, UInt32* outLength, UInt64* outOffset, UInt32* outSampleDescriptionIndex)
+{
+    OSMutexReadLocker locker(&fMutex);
+
+    SInt32 theIndex = this->FindFragment(inSampleNumber);
+    if (theIndex < 0)
+        return false;
+
+    Fragment* theFragment = &fFragments[theIndex];
+    Sample* theSample = &theFragment->fSamples[inSampleNumber - theFragment->fFirstSample];
+    if (outLength != NULL)
+        *outLength = theSample->fLength;
+    if (outOffset != NULL)
+        *outOffset = theSample->fOffset;
+    if (outSampleDescriptionIndex != NULL)
+        *outSampleDescriptionIndex = theFragment->fSampleDescriptionIndex;
+    return true;
+}
+
+Bool16 QTFragmentIndex::SampleNumberToMediaTime(UInt32 inSampleNumber, UInt32* outMediaTime)
+{
+    OSMutexReadLocker locker(&fMutex);
+
+    SInt32 theIndex = this->FindFragment(inSampleNumber);
+    if (theIndex < 0)
+        return false;
+
+    Fragment* theFragment = &fFragments[theIndex];
+    *outMediaTime = (UInt32)(theFragment->fBaseMediaTime + theFragment->fSamples[inSampleNumber - theFragment->fFirstSample].fTime);
+    return true;
+}
+
+Bool16 QTFragmentIndex::MediaTimeToSampleNumber(UInt32 inMediaTime, UInt32* outSampleNumber)
+{
+    OSMutexReadLocker locker(&fMutex);
+
+    SInt32 theIndex = this->FindFragmentByTime(inMediaTime);
+    if (theIndex < 0)
+        return false;
+
+    // The last sample starting at or before the time
+    Fragment* theFragment = &fFragments[theIndex];
+    UInt32 theTime = (UInt32)(inMediaTime - theFragment->fBaseMediaTime);
+    UInt32 theLow = 0;
+    UInt32 theHigh = theFragment->fNumSamples - 1;
+    while (theLow < theHigh)
+    {
+        UInt32 theMiddle = (theLow + theHigh + 1) / 2;
+        if (theFragment->fSamples[theMiddle].fTime <= theTime)
+            theLow = theMiddle;
+        else
+            theHigh = theMiddle - 1;
+    }
+
+    if (outSampleNumber != NULL)
+        *outSampleNumber = theFragment->fFirstSample + theLow;
+    return true;
+}
+
+Bool16 QTFragmentIndex::SampleNumberToMediaTimeOffset(UInt32 inSampleNumber, UInt32* outMediaTimeOffset)
+{
+    OSMutexReadLocker locker(&fMutex);
+
+    SInt32 theIndex = this->FindFragment(inSampleNumber);
+    if (theIndex < 0)
+        return false;
+
+    Fragment* theFragment = &fFragments[theIndex];
+    *outMediaTimeOffset = (UInt32)theFragment->fSamples[inSampleNumber - theFragment->fFirstSample].fCompositionOffset;
+    return true;
+}
+
+Bool16 QTFragmentIndex::IsSyncSample(UInt32 inSampleNumber)
+{
+    OSMutexReadLocker locker(&fMutex);
+
+    SInt32 theIndex = this->FindFragment(inSampleNumber);
+    if (theIndex < 0)
+        return false;
+
+    Fragment* theFragment = &fFragments[theIndex];
+    return theFragment->fSamples[inSampleNumber - theFragment->fFirstSample].fIsSync;
+}
+
+void QTFragmentIndex::PreviousSyncSample(UInt32 inSampleNumber, UInt32* outSyncSampleNumber)
+{
+    OSMutexReadLocker locker(&fMutex);
+
+    *outSyncSampleNumber = inSampleNumber;
+    if ((inSampleNumber == 0) || (fNumFragments == 0))
+        return;
+
+    UInt32 theSampleNumber = (inSampleNumber > fNumSamples) ? fNumSamples : inSampleNumber;
+    SInt32 theIndex = this->FindFragment(theSampleNumber);
+
+    // Fragments without a sync sample are skipped whole
+    for ( ; theIndex >= 0; theIndex--)
+    {
+        Fragment* theFragment = &fFragments[theIndex];
+        if (theFragment->fNumSyncSamples == 0)
+            continue;
+
+        UInt32 theLast = theFragment->fNumSamples - 1;
+        if (theSampleNumber < theFragment->fFirstSample + theLast)
+            theLast = theSampleNumber - theFragment->fFirstSample;
+        for (SInt32 x = (SInt32)theLast; x >= 0; x--)
+        {
+            if (theFragment->fSamples[x].fIsSync)
+            {
+                *outSyncSampleNumber = theFragment->fFirstSample + (UInt32)x;
+                return;
+            }
+        }
+    }
+}
+
+void QTFragmentIndex::NextSyncSample(UInt32 inSampleNumber, UInt32* outSyncSampleNumber)
+{
+    OSMutexReadLocker locker(&fMutex);
+
+    *outSyncSampleNumber = inSampleNumber + 1;
+    SInt32 theIndex = this->FindFragment(inSampleNumber + 1);
+    if (theIndex < 0)
+        return;
+
+    for ( ; (UInt32)theIndex < fNumFragments; theIndex++)
+    {
+        Fragment* theFragment = &fFragments[theIndex];
+        if (theFragment->fNumSyncSamples == 0)
+            continue;
+
+        UInt32 theFirst = 0;
+        if (inSampleNumber + 1 > theFragment->fFirstSample)
+            theFirst = inSampleNumber + 1 - theFragment->fFirstSample;
+        for (UInt32 x = theFirst; x < theFragment->fNumSamples; x++)
+        {
+            if (theFragment->fSamples[x].fIsSync)
+            {
+                *outSyncSampleNumber = theFragment->fFirstSample + x;
+                return;
+            }
+        }
+    }
+}
@@ -0,0 +1,135 @@
+/***************************************************************************
+
+Copyright (c) 2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 QTFragmentIndex.h
+Description: Sample index of one track of a fragmented MP4 file, built from
+             the traf atoms of its moof atoms and extended as they are appended.
+Comment:
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-19
+LastUpdate:  2026-10-19
+
+****************************************************************************/
+
+#ifndef __QT_FRAGMENT_INDEX_H__
+#define __QT_FRAGMENT_INDEX_H__
+
+#include "OSHeaders.h"
+#include "OSMutexRW.h"
+
+/*
+    A fragmented movie has empty sample tables in its moov, and an mvex
+    saying the samples follow in moof atoms: a traf per track, holding a
+    tfhd, usually a tfdt, and one or more trun. QTFile::Open makes one of
+    these per track of such a movie, and QTFile::IndexFragments feeds it
+    the traf atoms, first all of those in the file and later the ones
+    appended since, so a recording can be served while it is written.
+    QTTrack answers its sample functions from here in place of the
+    sample table atoms.
+
+    Samples are numbered on from the last fragment, and media times
+    count from the first fragment's tfdt. A sample number or media time is
+    found with a binary search over the fragments, then over the samples
+    of the one fragment, so lookups cost the log of the fragment count.
+
+    The index only grows. Lookups take the read lock, adding a fragment
+    the write lock.
+*/
+
+class QTFragmentIndex
+{
+    public:
+
+        struct Sample
+        {
+            UInt64      fOffset;
+            UInt32      fLength;
+            UInt32      fTime;              // decode time from the fragment's start
+            SInt32      fCompositionOffset;
+            Bool16      fIsSync;
+        };
+
+        // What one traf adds
+        struct Fragment
+        {
+            UInt32      fFirstSample;       // set by AddFragment
+            UInt32      fNumSamples;
+            UInt32      fNumSyncSamples;
+            UInt32      fSampleDescriptionIndex;
+            Bool16      fHasBaseMediaTime;  // false without a tfdt, it then follows the last fragment
+            UInt64      fBaseMediaTime;     // from the time origin once added
+            UInt64      fDuration;
+            UInt64      fDataEnd;           // end of the furthest sample in the file
+            Sample*     fSamples;
+        };
+
+                    QTFragmentIndex(UInt32 inTrackID);
+                    ~QTFragmentIndex();
+
+        UInt32      GetTrackID() { return fTrackID; }
+
+        // From the trex of the track
+        void        SetDefaults(UInt32 inSampleDescriptionIndex, UInt32 inDuration, UInt32 inLength, UInt32 inFlags);
+
+        // Steps *ioPos over the atoms in inStart and returns the data of the
+        // next one, false at the end or on an atom that does not fit
+        static Bool16   NextAtom(char* inStart, UInt32 inLength, UInt32* ioPos, OSType* outType, char** outData, UInt32* outLength);
+
+        // The track a traf is for, 0 if it has no tfhd
+        static UInt32   GetFragmentTrackID(char* inTraf, UInt32 inLength);
+
+        // Parses a traf of the moof at inMoofPos. ioDataOffset is where the
+        // previous traf's data ended, the moof for the first one. The
+        // fragment is then either added or disposed of.
+        Bool16      ParseFragment(char* inTraf, UInt32 inLength, UInt64 inMoofPos, UInt64* ioDataOffset, Fragment* outFragment);
+        void        AddFragment(Fragment* inFragment);
+        static void DisposeFragment(Fragment* inFragment);
+
+        UInt32      GetNumSamples();
+        UInt64      GetDuration();          // in the media's timescale
+
+        Bool16      GetSampleInfo(UInt32 inSampleNumber, UInt32* outLength, UInt64* outOffset, UInt32* outSampleDescriptionIndex);
+        Bool16      SampleNumberToMediaTime(UInt32 inSampleNumber, UInt32* outMediaTime);
+        Bool16      MediaTimeToSampleNumber(UInt32 inMediaTime, UInt32* outSampleNumber);
+        Bool16      SampleNumberToMediaTimeOffset(UInt32 inSampleNumber, UInt32* outMediaTimeOffset);
+
+        // As QTAtom_stss: Previous leaves inSampleNumber and Next gives
+        // inSampleNumber + 1 when there is no sync sample that way
+        Bool16      IsSyncSample(UInt32 inSampleNumber);
+        void        PreviousSyncSample(UInt32 inSampleNumber, UInt32* outSyncSampleNumber);
+        void        NextSyncSample(UInt32 inSampleNumber, UInt32* outSyncSampleNumber);
+
+    private:
+
+        enum
+        {
+            kInitialFragments       = 64,           //UInt32
+            kMaxSamplesPerFragment  = 1 << 20,      //UInt32
+            kSampleIsNonSync        = 0x00010000    //UInt32, of the sample flags
+        };
+
+        // Index of the fragment holding the sample or media time, -1 if none
+        SInt32      FindFragment(UInt32 inSampleNumber);
+        SInt32      FindFragmentByTime(UInt64 inMediaTime);
+
+        OSMutexRW   fMutex;
+        UInt32      fTrackID;
+
+        UInt32      fDefaultSampleDescriptionIndex;
+        UInt32      fDefaultDuration;
+        UInt32      fDefaultLength;
+        UInt32      fDefaultFlags;
+
+        Fragment*   fFragments;
+        UInt32      fNumFragments;
+        UInt32      fMaxFragments;
+        UInt32      fNumSamples;
+
+        // The first fragment's tfdt, and where the last one ended, from it
+        UInt64      fTimeOrigin;
+        UInt64      fEndTime;
+};
+
+#endif // __QT_FRAGMENT_INDEX_H__
@@ -336,6 +336,17 @@ QTTrack::ErrorCode QTHintTrack::Initialize(void)
 
     //
     // Calculate the first RTP timestamp for this track.
+    this->SetFirstRTPTimestamp();
+
+    //
+    // This track has been successfully initialiazed.
+    fHintTrackInitialized = true;
+    
+    return errNoError;
+}
+
+void QTHintTrack::SetFirstRTPTimestamp(void)
+{
     if( GetFirstEditMovieTime() > 0 ) 
     {
         UInt64 trackTime = GetFirstEditMovieTime();
@@ -352,12 +363,6 @@ QTTrack::ErrorCode QTHintTrack::Initialize(void)
     {
         fFirstRTPTimestamp = 0;
     }
-
-    //
-    // This track has been successfully initialiazed.
-    fHintTrackInitialized = true;
-    
-    return errNoError;
 }
     
 
@@ -1261,78 +1266,8 @@ QTTrack::ErrorCode QTHintTrack::GetPacket(UInt32 sampleNumber, UInt16 packetNumb
     COPY_LONG_WORD(pPacketOutBuf, &tempInt32);
     pPacketOutBuf += 4;
     
-    //
-    // Go through each possible field. For each one, see if caller
-    // wants the field appended. If so, append the field
-    for ( UInt32 fieldCount = 0; fieldCount < RTPMetaInfoPacket::kNumFields; fieldCount++)
-    {
-        //
-        // If there is no field array, don't generate a packet
-        if (htcb->fRTPMetaInfoFieldArray == NULL)
-            break;
-            
-        //
-        // Check if field should be appended
-        if (htcb->fRTPMetaInfoFieldArray[fieldCount] == RTPMetaInfoPacket::kFieldNotUsed)
-            continue;
-        
-        switch (fieldCount)
-        {
-            case RTPMetaInfoPacket::kPacketPosField:
-            {
-                SInt64 curPacketPos = OS::HostToNetworkSInt64(htcb->fCurrentPacketPosition);
-                this->WriteMetaInfoField(RTPMetaInfoPacket::kPacketPosField, htcb->fRTPMetaInfoFieldArray[fieldCount], &curPacketPos, sizeof(curPacketPos), &pPacketOutBuf);
-                break;
-            }
-            case RTPMetaInfoPacket::kTransTimeField:
-            {
-                SInt64 transmitTimeInMsec = OS::HostToNetworkSInt64((SInt64)(*transmitTime * 1000));
-                this->WriteMetaInfoField(RTPMetaInfoPacket::kTransTimeField, htcb->fRTPMetaInfoFieldArray[fieldCount], &transmitTimeInMsec, sizeof(transmitTimeInMsec), &pPacketOutBuf);
-                break;
-            }
-            
-            case RTPMetaInfoPacket::kFrameTypeField:
-            {
-                UInt16 theFrameType = RTPMetaInfoPacket::kUnknownFrameType;
-                
-                if (!htcb->fIsVideo)
-                    theFrameType = RTPMetaInfoPacket::kUnknownFrameType;
-                else if (hdrData.hintFlags & kBFrameBitMask)
-                    theFrameType = RTPMetaInfoPacket::kBFrameType;
-                else if (this->IsSyncSample(sampleNumber, htcb->fSyncSampleCursor))
-                    theFrameType = RTPMetaInfoPacket::kKeyFrameType;
-                else
-                    theFrameType = RTPMetaInfoPacket::kPFrameType;
-
-                theFrameType = htons(theFrameType);
-                this->WriteMetaInfoField(RTPMetaInfoPacket::kFrameTypeField, htcb->fRTPMetaInfoFieldArray[fieldCount], &theFrameType, sizeof(theFrameType), &pPacketOutBuf);
-                break;
-            }
-            case RTPMetaInfoPacket::kPacketNumField:
-            {
-                SInt64 curPacketNum = OS::HostToNetworkSInt64(htcb->fCurrentPacketNumber);
-                this->WriteMetaInfoField(RTPMetaInfoPacket::kPacketNumField, htcb->fRTPMetaInfoFieldArray[fieldCount], &curPacketNum, sizeof(curPacketNum), &pPacketOutBuf);
-                break;
-            }
-            case RTPMetaInfoPacket::kSeqNumField:
-            {
-                tempInt16 = htons(hdrData.rtpSequenceNumber);
-                this->WriteMetaInfoField(RTPMetaInfoPacket::kSeqNumField, htcb->fRTPMetaInfoFieldArray[fieldCount], &tempInt16, sizeof(tempInt16), &pPacketOutBuf);
-                break;
-            }
-            case RTPMetaInfoPacket::kMediaDataField:
-            {
-                //
-                // This field cannot be compressed
-                Assert(htcb->fRTPMetaInfoFieldArray[fieldCount] == RTPMetaInfoPacket::kUncompressed);
-                
-                //
-                // We don't have the data yet, so just write in the header
-                this->WriteMetaInfoField(RTPMetaInfoPacket::kMediaDataField, htcb->fRTPMetaInfoFieldArray[fieldCount], NULL, 0, &pPacketOutBuf);
-                break;
-            }
-        }
-    }
+    this->WriteMetaInfoFields(htcb, sampleNumber, *transmitTime, (hdrData.hintFlags & kBFrameBitMask) != 0,
+                                hdrData.rtpSequenceNumber, &pPacketOutBuf);
     
     char* endOfMetaInfo = pPacketOutBuf;
     packetSize = endOfMetaInfo - buffer;
@@ -1416,9 +1351,95 @@ QTTrack::ErrorCode QTHintTrack::GetPacket(UInt32 sampleNumber, UInt16 packetNumb
 
     *length = packetSize;
     
+    this->FinishPacket(htcb, endOfMetaInfo, pPacketOutBuf, length);
+    
+    //
+    // The packet has been generated.
+    return err;
+}
+
+void QTHintTrack::WriteMetaInfoFields(QTHintTrack_HintTrackControlBlock * htcb, UInt32 sampleNumber,
+                                        Float64 transmitTime, Bool16 isBFrame, UInt16 sequenceNumber, char** ioBuffer)
+{
+    //
+    // Go through each possible field. For each one, see if caller
+    // wants the field appended. If so, append the field
+    for ( UInt32 fieldCount = 0; fieldCount < RTPMetaInfoPacket::kNumFields; fieldCount++)
+    {
+        //
+        // If there is no field array, don't generate a packet
+        if (htcb->fRTPMetaInfoFieldArray == NULL)
+            break;
+            
+        //
+        // Check if field should be appended
+        if (htcb->fRTPMetaInfoFieldArray[fieldCount] == RTPMetaInfoPacket::kFieldNotUsed)
+            continue;
+        
+        switch (fieldCount)
+        {
+            case RTPMetaInfoPacket::kPacketPosField:
+            {
+                SInt64 curPacketPos = OS::HostToNetworkSInt64(htcb->fCurrentPacketPosition);
+                this->WriteMetaInfoField(RTPMetaInfoPacket::kPacketPosField, htcb->fRTPMetaInfoFieldArray[fieldCount], &curPacketPos, sizeof(curPacketPos), ioBuffer);
+                break;
+            }
+            case RTPMetaInfoPacket::kTransTimeField:
+            {
+                SInt64 transmitTimeInMsec = OS::HostToNetworkSInt64((SInt64)(transmitTime * 1000));
+                this->WriteMetaInfoField(RTPMetaInfoPacket::kTransTimeField, htcb->fRTPMetaInfoFieldArray[fieldCount], &transmitTimeInMsec, sizeof(transmitTimeInMsec), ioBuffer);
+                break;
+            }
+            
+            case RTPMetaInfoPacket::kFrameTypeField:
+            {
+                UInt16 theFrameType = RTPMetaInfoPacket::kUnknownFrameType;
+                
+                if (!htcb->fIsVideo)
+                    theFrameType = RTPMetaInfoPacket::kUnknownFrameType;
+                else if (isBFrame)
+                    theFrameType = RTPMetaInfoPacket::kBFrameType;
+                else if (this->IsSyncSample(sampleNumber, htcb->fSyncSampleCursor))
+                    theFrameType = RTPMetaInfoPacket::kKeyFrameType;
+                else
+                    theFrameType = RTPMetaInfoPacket::kPFrameType;
+
+                theFrameType = htons(theFrameType);
+                this->WriteMetaInfoField(RTPMetaInfoPacket::kFrameTypeField, htcb->fRTPMetaInfoFieldArray[fieldCount], &theFrameType, sizeof(theFrameType), ioBuffer);
+                break;
+            }
+            case RTPMetaInfoPacket::kPacketNumField:
+            {
+                SInt64 curPacketNum = OS::HostToNetworkSInt64(htcb->fCurrentPacketNumber);
+                this->WriteMetaInfoField(RTPMetaInfoPacket::kPacketNumField, htcb->fRTPMetaInfoFieldArray[fieldCount], &curPacketNum, sizeof(curPacketNum), ioBuffer);
+                break;
+            }
+            case RTPMetaInfoPacket::kSeqNumField:
+            {
+                UInt16 theSeqNum = htons(sequenceNumber);
+                this->WriteMetaInfoField(RTPMetaInfoPacket::kSeqNumField, htcb->fRTPMetaInfoFieldArray[fieldCount], &theSeqNum, sizeof(theSeqNum), ioBuffer);
+                break;
+            }
+            case RTPMetaInfoPacket::kMediaDataField:
+            {
+                //
+                // This field cannot be compressed
+                Assert(htcb->fRTPMetaInfoFieldArray[fieldCount] == RTPMetaInfoPacket::kUncompressed);
+                
+                //
+                // We don't have the data yet, so just write in the header
+                this->WriteMetaInfoField(RTPMetaInfoPacket::kMediaDataField, htcb->fRTPMetaInfoFieldArray[fieldCount], NULL, 0, ioBuffer);
+                break;
+            }
+        }
+    }
+}
+
+void QTHintTrack::FinishPacket(QTHintTrack_HintTrackControlBlock * htcb, char* endOfMetaInfo, char* endOfPacket, UInt32* length)
+{
     //
     // Always track packet number and packet position.
-    UInt16 thePacketDataLen = pPacketOutBuf - endOfMetaInfo;
+    UInt16 thePacketDataLen = endOfPacket - endOfMetaInfo;
     htcb->fCurrentPacketNumber++;
     htcb->fCurrentPacketPosition += thePacketDataLen;
         
@@ -1438,10 +1459,6 @@ QTTrack::ErrorCode QTHintTrack::GetPacket(UInt32 sampleNumber, UInt16 packetNumb
             COPY_WORD(endOfMetaInfo - 2, &thePacketDataLen);
         }
     }
-    
-    //
-    // The packet has been generated.
-    return err;
 }
 
 void QTHintTrack::WriteMetaInfoField(   RTPMetaInfoPacket::FieldIndex inFieldIndex,
@@ -90,6 +90,7 @@ public:
     // Sample Table control blocks
     QTAtom_stsc_SampleTableControlBlock  fstscSTCB;
     QTAtom_stts_SampleTableControlBlock  fsttsSTCB;
+    QTAtom_ctts_SampleTableControlBlock  fcttsSTCB;
      
     //
     // Sample cache
@@ -139,13 +140,17 @@ public:
     
     Bool16              IsHintTrackInitialized() { return fHintTrackInitialized; }
 
+    //
+    // True for a media track packetized on the fly, see QTMediaHintTrack.
+    virtual Bool16      IsMediaPacketizer(void) { return false; }
+
     //
     // Accessors.
-            ErrorCode   GetSDPFileLength(int * Length);
-            char *      GetSDPFile(int * Length);
+    virtual ErrorCode   GetSDPFileLength(int * Length);
+    virtual char *      GetSDPFile(int * Length);
             
-    inline  UInt64      GetTotalRTPBytes(void) { return fHintInfoAtom ? fHintInfoAtom->GetTotalRTPBytes() : 0; }
-    inline  UInt64      GetTotalRTPPackets(void) { return fHintInfoAtom ? fHintInfoAtom->GetTotalRTPPackets() : 0; }
+    virtual UInt64      GetTotalRTPBytes(void) { return fHintInfoAtom ? fHintInfoAtom->GetTotalRTPBytes() : 0; }
+    virtual UInt64      GetTotalRTPPackets(void) { return fHintInfoAtom ? fHintInfoAtom->GetTotalRTPPackets() : 0; }
 
     inline  UInt32      GetFirstRTPTimestamp(void) { return fFirstRTPTimestamp; }
     
@@ -162,7 +167,7 @@ public:
     
     inline  UInt16      GetRTPSequenceNumberRandomOffset(void) { return fSequenceNumberRandomOffset; }
     
-    ErrorCode   GetNumPackets(UInt32 SampleNumber, UInt16 * NumPackets,
+    virtual ErrorCode   GetNumPackets(UInt32 SampleNumber, UInt16 * NumPackets,
                                       QTHintTrack_HintTrackControlBlock * HTCB = NULL);
 
     //
@@ -176,7 +181,7 @@ public:
     //      is a compressed field ID.
     //
     // Supported fields: tt, md, ft, pp, pn, sq
-    ErrorCode   GetPacket(UInt32 SampleNumber, UInt16 PacketNumber,
+    virtual ErrorCode   GetPacket(UInt32 SampleNumber, UInt16 PacketNumber,
                                   char * Buffer, UInt32 * Length,
                                   Float64 * TransmitTime,
                                   Bool16 dropBFrames,
@@ -227,12 +232,26 @@ protected:
     UInt16              fSequenceNumberRandomOffset;    
     Bool16              fHintTrackInitialized;
     SInt16              fHintType;
+    //
+    // Sets fFirstRTPTimestamp from the first edit, once fRTPTimescale is known
+    void                SetFirstRTPTimestamp(void);
+
     //
     // Used by GetPacket for RTP-Meta-Info payload stuff
     void                WriteMetaInfoField( RTPMetaInfoPacket::FieldIndex inFieldIndex,
                                             RTPMetaInfoPacket::FieldID inFieldID,
                                             void* inFieldData, UInt32 inFieldLen, char** ioBuffer);
 
+    //
+    // Writes the fields the HTCB asks for after the RTP header, if any
+    void                WriteMetaInfoFields(QTHintTrack_HintTrackControlBlock * htcb, UInt32 sampleNumber,
+                                            Float64 transmitTime, Bool16 isBFrame, UInt16 sequenceNumber, char** ioBuffer);
+
+    //
+    // Counts the packet in the HTCB and fixes up its media data for RTP-Meta-Info,
+    // once the payload between endOfMetaInfo and endOfPacket is written
+    void                FinishPacket(QTHintTrack_HintTrackControlBlock * htcb, char* endOfMetaInfo, char* endOfPacket, UInt32* length);
+
     inline QTTrack::ErrorCode   GetSamplePacketPtr( char ** samplePacketPtr, UInt32 sampleNumber, UInt16 packetNumber, QTHintTrackRTPHeaderData &hdrData,  QTHintTrack_HintTrackControlBlock & htcb);
     inline void         GetSamplePacketHeaderVars( char *samplePacketPtr,char *maxBuffPtr, QTHintTrackRTPHeaderData &hdrData );
 };
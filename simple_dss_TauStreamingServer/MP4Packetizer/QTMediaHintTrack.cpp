@@ -0,0 +1,647 @@
+/***************************************************************************
+
+Copyright (c) 2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 QTMediaHintTrack.cpp
+Description: Packetizes the H.264 and AAC tracks of an MP4 file without hint
+             tracks on the fly, straight from their sample tables.
+Comment:
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-19
+LastUpdate:  2026-10-19
+
+****************************************************************************/
+
+#include <string.h>
+#include "SafeStdLib.h"
+
+#include "QTMediaHintTrack.h"
+#include "QTFile.h"
+#include "QTAtom_stsd.h"
+#include "OSMutex.h"
+#include "OSMemory.h"
+#include "base64.h"
+
+#ifndef __Win32__
+#include <netinet/in.h>
+#endif
+
+// Sample description offsets, from the start of the entry
+static const UInt32 kVisualEntryWidthPos    = 32;
+static const UInt32 kVisualEntryHeightPos   = 34;
+static const UInt32 kVisualEntryChildrenPos = 86;
+static const UInt32 kAudioEntryVersionPos   = 16;
+static const UInt32 kAudioEntryChannelsPos  = 24;
+static const UInt32 kAudioEntryChildrenPos  = 36;   // 52 for version 1, 72 for version 2
+
+static const UInt32 kAACSampleRates[] =
+{
+    96000, 88200, 64000, 48000, 44100, 32000, 24000, 22050, 16000, 12000, 11025, 8000, 7350
+};
+
+static UInt32 ReadBigEndian(char * inData, UInt32 inLength)
+{
+    UInt32 theValue = 0;
+    for (UInt32 x = 0; x < inLength; x++)
+        theValue = (theValue << 8) | (UInt8)inData[x];
+    return theValue;
+}
+
+// Reads MSB first, 0 past the end
+static UInt32 ReadBits(char * inData, UInt32 inLength, UInt32 * ioBitPos, UInt32 inNumBits)
+{
+    UInt32 theValue = 0;
+    for (UInt32 x = 0; x < inNumBits; x++, (*ioBitPos)++)
+    {
+        UInt32 theBit = 0;
+        if ((*ioBitPos >> 3) < inLength)
+            theBit = ((UInt8)inData[*ioBitPos >> 3] >> (7 - (*ioBitPos & 7))) & 1;
+        theValue = (theValue << 1) | theBit;
+    }
+    return theValue;
+}
+
+// Length of an MPEG-4 descriptor, which can take 1 to 4 bytes
+static Bool16 ReadDescriptorLength(char ** ioData, char * inEnd, UInt32 * outLength)
+{
+    *outLength = 0;
+    for (UInt32 x = 0; x < 4; x++)
+    {
+        if (*ioData >= inEnd)
+            return false;
+        UInt8 theByte = (UInt8)**ioData;
+        (*ioData)++;
+        *outLength = (*outLength << 7) | (theByte & 0x7F);
+        if ((theByte & 0x80) == 0)
+            return (UInt32)(inEnd - *ioData) >= *outLength;
+    }
+    return false;
+}
+
+Bool16 QTMediaHintTrack::CanPacketize(QTFile * inFile, QTFile::AtomTOCEntry * inTrakAtom)
+{
+    QTFile::AtomTOCEntry* stsdTOCEntry = NULL;
+    if (!inFile->FindTOCEntry(":mdia:minf:stbl:stsd", &stsdTOCEntry, inTrakAtom))
+        return false;
+
+    // Version and flags, entry count, then the first entry's size and format
+    char theHeader[16];
+    if ((stsdTOCEntry->AtomDataLength < sizeof(theHeader)) || !inFile->Read(stsdTOCEntry->AtomDataPos, theHeader, sizeof(theHeader)))
+        return false;
+    if (ReadBigEndian(theHeader + 4, 4) == 0)
+        return false;
+
+    UInt32 theFormat = ReadBigEndian(theHeader + 12, 4);
+    return (theFormat == FOUR_CHARS_TO_INT('a', 'v', 'c', '1')) || (theFormat == FOUR_CHARS_TO_INT('m', 'p', '4', 'a'));
+}
+
+QTMediaHintTrack::QTMediaHintTrack(QTFile * File, QTFile::AtomTOCEntry * trakAtom, Bool16 Debug, Bool16 DeepDebug)
+:   QTHintTrack(File, trakAtom, Debug, DeepDebug),
+    fMediaType(kNoMedia),
+    fNALLengthSize(4),
+    fParameterSetData(NULL),
+    fNumParameterSets(0),
+    fSDPFile(NULL),
+    fSDPFileLength(0),
+    fTotalRTPBytes(0),
+    fTotalRTPPackets(0)
+{}
+
+QTMediaHintTrack::~QTMediaHintTrack(void)
+{
+    delete [] fParameterSetData;
+    delete [] fSDPFile;
+}
+
+QTTrack::ErrorCode QTMediaHintTrack::Initialize(void)
+{
+    if (IsHintTrackInitialized())
+        return errNoError;
+
+    if (QTTrack::Initialize() != errNoError)
+        return errInvalidQuickTimeFile;
+
+    char* theDesc = NULL;
+    UInt32 theDescLength = 0;
+    ErrorCode theErr = errInvalidQuickTimeFile;
+    if (fSampleDescriptionAtom->FindSampleDescription(FOUR_CHARS_TO_INT('a', 'v', 'c', '1'), &theDesc, &theDescLength))
+        theErr = this->InitializeH264(theDesc, theDescLength);
+    else if (fSampleDescriptionAtom->FindSampleDescription(FOUR_CHARS_TO_INT('m', 'p', '4', 'a'), &theDesc, &theDescLength))
+        theErr = this->InitializeAAC(theDesc, theDescLength);
+    if (theErr != errNoError)
+        return theErr;
+
+    fMaxPacketSize = 12 + kMaxPayloadSize;
+    this->SetFirstRTPTimestamp();
+
+    fHintTrackInitialized = true;
+    return errNoError;
+}
+
+Bool16 QTMediaHintTrack::FindChildAtom(char * inStart, char * inEnd, OSType inType, char ** outData, UInt32 * outLength)
+{
+    for (char* theAtom = inStart; inEnd - theAtom >= 8; )
+    {
+        UInt32 theSize = ReadBigEndian(theAtom, 4);
+        if ((theSize < 8) || (theSize > (UInt32)(inEnd - theAtom)))
+            return false;
+
+        if (ReadBigEndian(theAtom + 4, 4) == inType)
+        {
+            *outData = theAtom + 8;
+            *outLength = theSize - 8;
+            return true;
+        }
+        theAtom += theSize;
+    }
+    return false;
+}
+
+QTTrack::ErrorCode QTMediaHintTrack::InitializeH264(char * inDesc, UInt32 inDescLength)
+{
+    // Initialize() may be called again after this failed partway
+    delete [] fParameterSetData;
+    fParameterSetData = NULL;
+    fNumParameterSets = 0;
+
+    char* theAVCC = NULL;
+    UInt32 theAVCCLength = 0;
+    if ((inDescLength <= kVisualEntryChildrenPos)
+        || !this->FindChildAtom(inDesc + kVisualEntryChildrenPos, inDesc + inDescLength, FOUR_CHARS_TO_INT('a', 'v', 'c', 'C'), &theAVCC, &theAVCCLength)
+        || (theAVCCLength < 7))
+        return errInvalidQuickTimeFile;
+
+    fMediaType = kH264Media;
+    fNALLengthSize = ((UInt8)theAVCC[4] & 0x03) + 1;
+
+    // Copy the SPSs then the PPSs out, both counts are followed by 2 byte lengths
+    fParameterSetData = NEW char[theAVCCLength];
+    char* theSetData = fParameterSetData;
+    char* theData = theAVCC + 5;
+    char* theEnd = theAVCC + theAVCCLength;
+    UInt32 theCount = (UInt8)*theData++ & 0x1F;
+    for (UInt32 theList = 0; theList < 2; theList++)
+    {
+        for (UInt32 x = 0; x < theCount; x++)
+        {
+            if (theEnd - theData < 2)
+                return errInvalidQuickTimeFile;
+            UInt32 theLength = ReadBigEndian(theData, 2);
+            theData += 2;
+            if ((UInt32)(theEnd - theData) < theLength)
+                return errInvalidQuickTimeFile;
+
+            if ((theLength > 0) && (fNumParameterSets < kMaxParameterSets))
+            {
+                ::memcpy(theSetData, theData, theLength);
+                fParameterSets[fNumParameterSets].fData = theSetData;
+                fParameterSets[fNumParameterSets].fLength = theLength;
+                fNumParameterSets++;
+                theSetData += theLength;
+            }
+            theData += theLength;
+        }
+
+        if (theList == 0)
+        {
+            if (theData >= theEnd)
+                return errInvalidQuickTimeFile;
+            theCount = (UInt8)*theData++;
+        }
+    }
+
+    fRTPTimescale = kH264RTPTimescale;
+
+    // The SDP, with the parameter sets base64 encoded and comma separated
+    char* theSprop = NEW char[Base64encode_len(theAVCCLength) + kMaxParameterSets + 1];
+    char* theSpropEnd = theSprop;
+    *theSprop = '\0';
+    for (UInt32 x = 0; x < fNumParameterSets; x++)
+    {
+        if (x > 0)
+            *theSpropEnd++ = ',';
+        theSpropEnd += Base64encode(theSpropEnd, fParameterSets[x].fData, fParameterSets[x].fLength) - 1;
+    }
+
+    char* theFmtp = NEW char[(theSpropEnd - theSprop) + 128];
+    qtss_sprintf(theFmtp, "packetization-mode=1;profile-level-id=%02X%02X%02X;sprop-parameter-sets=%s",
+                (UInt8)theAVCC[1], (UInt8)theAVCC[2], (UInt8)theAVCC[3], theSprop);
+    this->BuildSDP(theFmtp, kH264RTPTimescale, 0, ReadBigEndian(inDesc + kVisualEntryWidthPos, 2), ReadBigEndian(inDesc + kVisualEntryHeightPos, 2));
+
+    delete [] theFmtp;
+    delete [] theSprop;
+    return errNoError;
+}
+
+QTTrack::ErrorCode QTMediaHintTrack::InitializeAAC(char * inDesc, UInt32 inDescLength)
+{
+    if (inDescLength < kAudioEntryChildrenPos)
+        return errInvalidQuickTimeFile;
+
+    UInt32 theChildrenPos = kAudioEntryChildrenPos;
+    UInt32 theVersion = ReadBigEndian(inDesc + kAudioEntryVersionPos, 2);
+    if (theVersion == 1)
+        theChildrenPos += 16;
+    else if (theVersion == 2)
+        theChildrenPos += 36;
+
+    char* theESDS = NULL;
+    UInt32 theESDSLength = 0;
+    if ((inDescLength <= theChildrenPos)
+        || !this->FindChildAtom(inDesc + theChildrenPos, inDesc + inDescLength, FOUR_CHARS_TO_INT('e', 's', 'd', 's'), &theESDS, &theESDSLength)
+        || (theESDSLength < 4))
+        return errInvalidQuickTimeFile;
+
+    // ES_Descriptor, then DecoderConfigDescriptor, then the AudioSpecificConfig
+    char* theData = theESDS + 4;
+    char* theEnd = theESDS + theESDSLength;
+    UInt32 theLength = 0;
+    if ((theData >= theEnd) || ((UInt8)*theData++ != 0x03) || !ReadDescriptorLength(&theData, theEnd, &theLength) || (theLength < 3))
+        return errInvalidQuickTimeFile;
+    theEnd = theData + theLength;
+
+    UInt8 theFlags = (UInt8)theData[2];
+    theData += 3;
+    if (theFlags & 0x80)
+        theData += 2;
+    if ((theFlags & 0x40) && (theData < theEnd))
+        theData += 1 + (UInt8)*theData;
+    if (theFlags & 0x20)
+        theData += 2;
+
+    if ((theData >= theEnd) || ((UInt8)*theData++ != 0x04) || !ReadDescriptorLength(&theData, theEnd, &theLength) || (theLength < 13))
+        return errInvalidQuickTimeFile;
+
+    // MPEG-4 audio, or AAC from MPEG-2 part 7
+    UInt8 theObjectType = (UInt8)theData[0];
+    if ((theObjectType != 0x40) && ((theObjectType < 0x66) || (theObjectType > 0x68)))
+        return errInvalidQuickTimeFile;
+
+    theEnd = theData + theLength;
+    theData += 13;
+    if ((theData >= theEnd) || ((UInt8)*theData++ != 0x05) || !ReadDescriptorLength(&theData, theEnd, &theLength) || (theLength < 2))
+        return errInvalidQuickTimeFile;
+
+    // audioObjectType, escaped past 30, then the sampling frequency and channels
+    UInt32 theBitPos = 0;
+    if (ReadBits(theData, theLength, &theBitPos, 5) == 31)
+        (void)ReadBits(theData, theLength, &theBitPos, 6);
+
+    UInt32 theRate = 0;
+    UInt32 theRateIndex = ReadBits(theData, theLength, &theBitPos, 4);
+    if (theRateIndex == 15)
+        theRate = ReadBits(theData, theLength, &theBitPos, 24);
+    else if (theRateIndex < sizeof(kAACSampleRates) / sizeof(kAACSampleRates[0]))
+        theRate = kAACSampleRates[theRateIndex];
+    if (theRate == 0)
+        theRate = (UInt32)this->GetTimeScale();
+
+    UInt32 theChannels = ReadBits(theData, theLength, &theBitPos, 4);
+    if (theChannels == 0)
+        theChannels = ReadBigEndian(inDesc + kAudioEntryChannelsPos, 2);
+
+    fMediaType = kAACMedia;
+    fRTPTimescale = theRate;
+
+    char* theFmtp = NEW char[2 * theLength + 128];
+    char* theConfig = theFmtp + qtss_sprintf(theFmtp, "profile-level-id=15;mode=AAC-hbr;sizelength=13;indexlength=3;indexdeltalength=3;config=");
+    for (UInt32 x = 0; x < theLength; x++)
+        theConfig += qtss_sprintf(theConfig, "%02x", (UInt8)theData[x]);
+    this->BuildSDP(theFmtp, theRate, theChannels, 0, 0);
+
+    delete [] theFmtp;
+    return errNoError;
+}
+
+void QTMediaHintTrack::BuildSDP(char * inFmtp, UInt32 inClockRate, UInt32 inChannels, UInt32 inWidth, UInt32 inHeight)
+{
+    // What the whole track comes to once packetized, for b=AS
+    UInt32 theNumSamples = this->GetNumSamples();
+    for (UInt32 theSample = 1; theSample <= theNumSamples; theSample++)
+    {
+        UInt32 theSize = 0;
+        if (!this->SampleSize(theSample, &theSize))
+            break;
+
+        UInt32 theNumPackets = (theSize + kMaxPayloadSize - 1) / kMaxPayloadSize;
+        fTotalRTPPackets += theNumPackets;
+        fTotalRTPBytes += theSize + (12 + 4) * theNumPackets;
+    }
+
+    UInt32 theBandwidth = 0;
+    Float64 theDuration = this->GetMediaDurationInSeconds();
+    if (theDuration > 0)
+        theBandwidth = (UInt32)((Float64)(SInt64)fTotalRTPBytes * 8 / theDuration / 1000) + 1;
+
+    UInt32 thePayloadType = (fMediaType == kH264Media) ? kH264PayloadType : kAACPayloadType;
+    char* theSDP = NEW char[::strlen(inFmtp) + 512];
+    char* theLine = theSDP;
+    if (fMediaType == kH264Media)
+    {
+        theLine += qtss_sprintf(theLine, "m=video 0 RTP/AVP %lu\r\n", thePayloadType);
+        theLine += qtss_sprintf(theLine, "b=AS:%lu\r\n", theBandwidth);
+        theLine += qtss_sprintf(theLine, "a=rtpmap:%lu H264/%lu\r\n", thePayloadType, inClockRate);
+    }
+    else
+    {
+        theLine += qtss_sprintf(theLine, "m=audio 0 RTP/AVP %lu\r\n", thePayloadType);
+        theLine += qtss_sprintf(theLine, "b=AS:%lu\r\n", theBandwidth);
+        theLine += qtss_sprintf(theLine, "a=rtpmap:%lu mpeg4-generic/%lu/%lu\r\n", thePayloadType, inClockRate, inChannels);
+    }
+    theLine += qtss_sprintf(theLine, "a=control:trackID=%lu\r\n", this->GetTrackID());
+    if ((inWidth > 0) && (inHeight > 0))
+    {
+        theLine += qtss_sprintf(theLine, "a=cliprect:0,0,%lu,%lu\r\n", inHeight, inWidth);
+        theLine += qtss_sprintf(theLine, "a=framesize:%lu %lu-%lu\r\n", thePayloadType, inWidth, inHeight);
+    }
+    theLine += qtss_sprintf(theLine, "a=fmtp:%lu %s\r\n", thePayloadType, inFmtp);
+
+    fSDPFile = theSDP;
+    fSDPFileLength = theLine - theSDP;
+}
+
+QTTrack::ErrorCode QTMediaHintTrack::GetSDPFileLength(int * length)
+{
+    {
+        OSMutexLocker locker(fFile->GetMutex());
+        if (this->Initialize() != errNoError)
+            return errInvalidQuickTimeFile;
+    }
+
+    *length = (int)fSDPFileLength;
+    return errNoError;
+}
+
+char * QTMediaHintTrack::GetSDPFile(int * length)
+{
+    if (this->GetSDPFileLength(length) != errNoError)
+        return NULL;
+
+    // The caller deletes it, as the one QTHintTrack reads from the file
+    char* theSDP = NEW char[fSDPFileLength];
+    ::memcpy(theSDP, fSDPFile, fSDPFileLength);
+    return theSDP;
+}
+
+UInt32 QTMediaHintTrack::GetNALUnits(UInt32 inSampleNumber, char * inSample, UInt32 inSampleLength,
+                                    QTHintTrack_HintTrackControlBlock * htcb, NALUnit * outUnits)
+{
+    // Leave room for the parameter sets in front
+    UInt32 theNumUnits = fNumParameterSets;
+    Bool16 hasSPS = false;
+
+    char* theEnd = inSample + inSampleLength;
+    for (char* theData = inSample; theData < theEnd; )
+    {
+        if ((UInt32)(theEnd - theData) < fNALLengthSize)
+            return 0;
+        UInt32 theLength = ReadBigEndian(theData, fNALLengthSize);
+        theData += fNALLengthSize;
+        if ((UInt32)(theEnd - theData) < theLength)
+            return 0;
+        if (theLength == 0)
+            continue;
+
+        if (theNumUnits == kMaxNALUnits)
+            return 0;
+        if ((*theData & 0x1F) == 7)
+            hasSPS = true;
+        outUnits[theNumUnits].fData = theData;
+        outUnits[theNumUnits].fLength = theLength;
+        theNumUnits++;
+        theData += theLength;
+    }
+
+    if (theNumUnits == fNumParameterSets)
+        return 0;
+
+    if (!hasSPS && this->IsSyncSample(inSampleNumber, htcb->fSyncSampleCursor))
+    {
+        ::memcpy(outUnits, fParameterSets, sizeof(NALUnit) * fNumParameterSets);
+        return theNumUnits;
+    }
+
+    ::memmove(outUnits, &outUnits[fNumParameterSets], sizeof(NALUnit) * (theNumUnits - fNumParameterSets));
+    return theNumUnits - fNumParameterSets;
+}
+
+UInt16 QTMediaHintTrack::FindPacket(NALUnit * inUnits, UInt32 inNumUnits, UInt16 inPacketNumber, PacketInfo * outInfo)
+{
+    UInt32 theNumPackets = 0;
+    UInt32 theUnit = 0;
+    while (theUnit < inNumUnits)
+    {
+        // Too big for one packet, FU-A fragments of the NAL unit after its header byte
+        if (inUnits[theUnit].fLength > kMaxPayloadSize)
+        {
+            UInt32 theFragmentSize = kMaxPayloadSize - 2;
+            UInt32 thePayload = inUnits[theUnit].fLength - 1;
+            UInt32 theNumFragments = (thePayload + theFragmentSize - 1) / theFragmentSize;
+            if ((inPacketNumber > theNumPackets) && (inPacketNumber <= theNumPackets + theNumFragments))
+            {
+                UInt32 theOffset = (inPacketNumber - theNumPackets - 1) * theFragmentSize;
+                outInfo->fFirstUnit = theUnit;
+                outInfo->fNumUnits = 1;
+                outInfo->fFragmentOffset = 1 + theOffset;
+                outInfo->fFragmentLength = (thePayload - theOffset < theFragmentSize) ? thePayload - theOffset : theFragmentSize;
+                outInfo->fIsFragment = true;
+            }
+            theNumPackets += theNumFragments;
+            theUnit++;
+        }
+        else
+        {
+            // As many as fit in one STAP-A, or just the one unit
+            UInt32 theLast = theUnit + 1;
+            UInt32 theSize = 1 + 2 + inUnits[theUnit].fLength;
+            while ((theLast < inNumUnits) && (theSize + 2 + inUnits[theLast].fLength <= kMaxPayloadSize))
+            {
+                theSize += 2 + inUnits[theLast].fLength;
+                theLast++;
+            }
+
+            theNumPackets++;
+            if (inPacketNumber == theNumPackets)
+            {
+                outInfo->fFirstUnit = theUnit;
+                outInfo->fNumUnits = theLast - theUnit;
+                outInfo->fIsFragment = false;
+            }
+            theUnit = theLast;
+        }
+
+        if (theNumPackets > 0xFFFF)
+            return 0;
+    }
+    return (UInt16)theNumPackets;
+}
+
+UInt32 QTMediaHintTrack::WriteH264Payload(NALUnit * inUnits, PacketInfo * inInfo, char * outBuffer)
+{
+    NALUnit* theUnit = &inUnits[inInfo->fFirstUnit];
+    if (inInfo->fIsFragment)
+    {
+        UInt8 theHeader = (UInt8)theUnit->fData[0];
+        outBuffer[0] = (char)((theHeader & 0xE0) | 28);
+        outBuffer[1] = (char)(theHeader & 0x1F);
+        if (inInfo->fFragmentOffset == 1)
+            outBuffer[1] |= 0x80;
+        if (inInfo->fFragmentOffset + inInfo->fFragmentLength == theUnit->fLength)
+            outBuffer[1] |= 0x40;
+        ::memcpy(outBuffer + 2, theUnit->fData + inInfo->fFragmentOffset, inInfo->fFragmentLength);
+        return 2 + inInfo->fFragmentLength;
+    }
+
+    if (inInfo->fNumUnits == 1)
+    {
+        ::memcpy(outBuffer, theUnit->fData, theUnit->fLength);
+        return theUnit->fLength;
+    }
+
+    // STAP-A takes the highest NRI and any F bit of the units in it
+    UInt8 theHeader = 24;
+    char* theOut = outBuffer + 1;
+    for (UInt32 x = 0; x < inInfo->fNumUnits; x++, theUnit++)
+    {
+        UInt8 theUnitHeader = (UInt8)theUnit->fData[0];
+        theHeader |= theUnitHeader & 0x80;
+        if ((theUnitHeader & 0x60) > (theHeader & 0x60))
+            theHeader = (theHeader & ~0x60) | (theUnitHeader & 0x60);
+
+        theOut[0] = (char)(theUnit->fLength >> 8);
+        theOut[1] = (char)theUnit->fLength;
+        ::memcpy(theOut + 2, theUnit->fData, theUnit->fLength);
+        theOut += 2 + theUnit->fLength;
+    }
+    outBuffer[0] = (char)theHeader;
+    return theOut - outBuffer;
+}
+
+QTTrack::ErrorCode QTMediaHintTrack::GetNumPackets(UInt32 sampleNumber, UInt16 * numPackets, QTHintTrack_HintTrackControlBlock * htcb)
+{
+    char* theSample = NULL;
+    UInt32 theSampleLength = 0;
+    if (!this->GetSamplePtr(sampleNumber, &theSample, &theSampleLength, htcb))
+        return errInvalidQuickTimeFile;
+
+    if (fMediaType == kAACMedia)
+    {
+        // 13 bits of AU size in the AU header
+        if (theSampleLength >= (1 << 13))
+            return errInvalidQuickTimeFile;
+        *numPackets = (UInt16)((theSampleLength + kMaxPayloadSize - 4 - 1) / (kMaxPayloadSize - 4));
+        return errNoError;
+    }
+
+    NALUnit theUnits[kMaxNALUnits];
+    UInt32 theNumUnits = this->GetNALUnits(sampleNumber, theSample, theSampleLength, htcb, theUnits);
+    *numPackets = 0;
+    if (theNumUnits > 0)
+        *numPackets = this->FindPacket(theUnits, theNumUnits, 0, NULL);
+    return errNoError;
+}
+
+QTTrack::ErrorCode QTMediaHintTrack::GetPacket(UInt32 sampleNumber, UInt16 packetNumber, char * buffer, UInt32 * length,
+                                                Float64 * transmitTime, Bool16 dropBFrames, Bool16 /*dropRepeatPackets*/,
+                                                UInt32 ssrc, QTHintTrack_HintTrackControlBlock * htcb)
+{
+    Assert(htcb != NULL);
+
+    UInt32 theMediaTime = 0;
+    if (!this->GetSampleMediaTime(sampleNumber, &theMediaTime, &htcb->fsttsSTCB))
+        return errInvalidQuickTimeFile;
+
+    char* theSample = NULL;
+    UInt32 theSampleLength = 0;
+    if (!this->GetSamplePtr(sampleNumber, &theSample, &theSampleLength, htcb))
+        return errInvalidQuickTimeFile;
+
+    // Composition time, the ctts offset being signed in version 1
+    SInt64 theCompositionTime = theMediaTime;
+    UInt32 theOffset = 0;
+    if (this->GetSampleMediaTimeOffset(sampleNumber, &theOffset, &htcb->fcttsSTCB))
+        theCompositionTime += (SInt32)theOffset;
+
+    Float64 theTimeScale = 1.0;
+    if (fRTPTimescale != this->GetTimeScale())
+        theTimeScale = (Float64)fRTPTimescale * (Float64)this->GetTimeScaleRecip();
+    UInt32 theRTPTimestamp = (UInt32)(SInt64)((Float64)theCompositionTime * theTimeScale) + fFirstRTPTimestamp;
+
+    *transmitTime = (theMediaTime + this->GetFirstEditMediaTime()) * fMediaHeaderAtom->GetTimeScaleRecip();
+
+    NALUnit theUnits[kMaxNALUnits];
+    UInt32 theNumUnits = 0;
+    PacketInfo theInfo;
+    UInt16 theNumPackets = 0;
+    Bool16 isBFrame = false;
+    if (fMediaType == kH264Media)
+    {
+        theNumUnits = this->GetNALUnits(sampleNumber, theSample, theSampleLength, htcb, theUnits);
+        if (theNumUnits > 0)
+            theNumPackets = this->FindPacket(theUnits, theNumUnits, packetNumber, &theInfo);
+        if ((packetNumber == 0) || (packetNumber > theNumPackets))
+            return errInvalidQuickTimeFile;
+
+        // A sample no other refers to, all its slices with nal_ref_idc 0, is the one to thin
+        isBFrame = true;
+        for (UInt32 x = 0; (x < theNumUnits) && isBFrame; x++)
+        {
+            UInt8 theHeader = (UInt8)theUnits[x].fData[0];
+            if (((theHeader & 0x1F) >= 1) && ((theHeader & 0x1F) <= 5) && ((theHeader & 0x60) != 0))
+                isBFrame = false;
+        }
+        if (isBFrame && dropBFrames)
+            return QTTrack::errIsSkippedPacket;
+    }
+    else
+    {
+        theNumPackets = (UInt16)((theSampleLength + kMaxPayloadSize - 4 - 1) / (kMaxPayloadSize - 4));
+        if ((packetNumber == 0) || (packetNumber > theNumPackets))
+            return errInvalidQuickTimeFile;
+    }
+
+    // The RTP header, the sequence number counting the packets this HTCB built
+    UInt16 theSequenceNumber = (UInt16)htcb->fCurrentPacketNumber;
+    UInt8 thePayloadType = (fMediaType == kH264Media) ? kH264PayloadType : kAACPayloadType;
+    if (packetNumber == theNumPackets)
+        thePayloadType |= 0x80;
+
+    char* thePacket = buffer;
+    thePacket[0] = (char)0x80;
+    thePacket[1] = (char)thePayloadType;
+    UInt16 theNetSequenceNumber = htons(theSequenceNumber);
+    ::memcpy(thePacket + 2, &theNetSequenceNumber, 2);
+    UInt32 theNetLong = htonl(theRTPTimestamp);
+    ::memcpy(thePacket + 4, &theNetLong, 4);
+    theNetLong = htonl(ssrc);
+    ::memcpy(thePacket + 8, &theNetLong, 4);
+    thePacket += 12;
+
+    this->WriteMetaInfoFields(htcb, sampleNumber, *transmitTime, isBFrame, theSequenceNumber, &thePacket);
+    char* theEndOfMetaInfo = thePacket;
+    if ((UInt32)(theEndOfMetaInfo - buffer) + kMaxPayloadSize > *length)
+        return errParamError;
+
+    if (fMediaType == kH264Media)
+        thePacket += this->WriteH264Payload(theUnits, &theInfo, thePacket);
+    else
+    {
+        // AU-headers-length in bits, then one AU header with the size of the whole AU
+        UInt32 theFragmentOffset = (packetNumber - 1) * (kMaxPayloadSize - 4);
+        UInt32 theFragmentLength = theSampleLength - theFragmentOffset;
+        if (theFragmentLength > kMaxPayloadSize - 4)
+            theFragmentLength = kMaxPayloadSize - 4;
+
+        UInt16 theAUHeader[2];
+        theAUHeader[0] = htons(16);
+        theAUHeader[1] = htons((UInt16)(theSampleLength << 3));
+        ::memcpy(thePacket, theAUHeader, 4);
+        ::memcpy(thePacket + 4, theSample + theFragmentOffset, theFragmentLength);
+        thePacket += 4 + theFragmentLength;
+    }
+
+    *length = thePacket - buffer;
+    this->FinishPacket(htcb, theEndOfMetaInfo, thePacket, length);
+    return errNoError;
+}
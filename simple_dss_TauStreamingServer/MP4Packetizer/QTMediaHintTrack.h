@@ -0,0 +1,138 @@
+/***************************************************************************
+
+Copyright (c) 2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 QTMediaHintTrack.h
+Description: Packetizes the H.264 and AAC tracks of an MP4 file without hint
+             tracks on the fly, straight from their sample tables.
+Comment:
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-19
+LastUpdate:  2026-10-19
+
+****************************************************************************/
+
+#ifndef __QT_MEDIA_HINT_TRACK_H__
+#define __QT_MEDIA_HINT_TRACK_H__
+
+#include "QTHintTrack.h"
+
+/*
+    QTFile::Open makes one of these, in place of a plain QTTrack, for every
+    avc1 or mp4a track of a movie that has no hint tracks at all, and
+    flags it as a hint track. QTRTPFile then streams it like any other.
+
+    H.264 goes out as RFC 6184 packetization-mode 1: a sample is split into
+    its NAL units, small ones are grouped into STAP-A packets, big ones cut
+    into FU-A fragments. Sync samples that carry no SPS get the parameter
+    sets from avcC in front of them. AAC goes out as RFC 3640 AAC-hbr with
+    one access unit per packet, fragmented when it does not fit. The SDP
+    for either comes from the sample description.
+
+    A sample is packetized again for every packet fetched from it. That
+    costs a walk over its NAL units, the sample itself stays in the HTCB
+    cache. Nothing is shared between readers: the sequence number is the
+    count of packets the HTCB has built, so QTRTPFile keeps these packets
+    out of its packet cache.
+*/
+
+class QTMediaHintTrack : public QTHintTrack
+{
+    public:
+
+        enum
+        {
+            kMaxPayloadSize     = 1400, //UInt32, RTP header not included
+            kMaxNALUnits        = 256,  //UInt32, per sample, parameter sets included
+            kMaxParameterSets   = 8,    //UInt32
+            kH264PayloadType    = 96,   //UInt32
+            kAACPayloadType     = 97,   //UInt32
+            kH264RTPTimescale   = 90000 //UInt32
+        };
+
+        // True if the first sample description of the track is avc1 or mp4a
+        static Bool16       CanPacketize(QTFile * inFile, QTFile::AtomTOCEntry * inTrakAtom);
+
+                            QTMediaHintTrack(QTFile * File, QTFile::AtomTOCEntry * trakAtom,
+                                        Bool16 Debug = false, Bool16 DeepDebug = false);
+        virtual             ~QTMediaHintTrack(void);
+
+        virtual ErrorCode   Initialize(void);
+        virtual Bool16      IsMediaPacketizer(void) { return true; }
+
+        // Initialize the track if need be, so these work before AddTrack
+        virtual ErrorCode   GetSDPFileLength(int * Length);
+        virtual char *      GetSDPFile(int * Length);
+
+        virtual UInt64      GetTotalRTPBytes(void) { return fTotalRTPBytes; }
+        virtual UInt64      GetTotalRTPPackets(void) { return fTotalRTPPackets; }
+
+        virtual ErrorCode   GetNumPackets(UInt32 SampleNumber, UInt16 * NumPackets,
+                                        QTHintTrack_HintTrackControlBlock * HTCB = NULL);
+
+        virtual ErrorCode   GetPacket(UInt32 SampleNumber, UInt16 PacketNumber,
+                                        char * Buffer, UInt32 * Length,
+                                        Float64 * TransmitTime,
+                                        Bool16 dropBFrames,
+                                        Bool16 dropRepeatPackets = false,
+                                        UInt32 SSRC = 0,
+                                        QTHintTrack_HintTrackControlBlock * HTCB = NULL);
+
+    private:
+
+        enum
+        {
+            kNoMedia    = 0,    //UInt32
+            kH264Media  = 1,    //UInt32
+            kAACMedia   = 2     //UInt32
+        };
+
+        struct NALUnit
+        {
+            char*       fData;
+            UInt32      fLength;
+        };
+
+        // Where a packet of a sample starts: fNumUnits NAL units from fFirstUnit,
+        // or, for a fragment, fFragmentLength bytes at fFragmentOffset of one unit
+        struct PacketInfo
+        {
+            UInt32      fFirstUnit;
+            UInt32      fNumUnits;
+            UInt32      fFragmentOffset;
+            UInt32      fFragmentLength;
+            Bool16      fIsFragment;
+        };
+
+        ErrorCode   InitializeH264(char * inDesc, UInt32 inDescLength);
+        ErrorCode   InitializeAAC(char * inDesc, UInt32 inDescLength);
+        Bool16      FindChildAtom(char * inStart, char * inEnd, OSType inType, char ** outData, UInt32 * outLength);
+        void        BuildSDP(char * inFmtp, UInt32 inClockRate, UInt32 inChannels, UInt32 inWidth, UInt32 inHeight);
+
+        // Split the sample into NAL units, the parameter sets first where they are
+        // missing. 0 if the sample does not parse
+        UInt32      GetNALUnits(UInt32 inSampleNumber, char * inSample, UInt32 inSampleLength,
+                                QTHintTrack_HintTrackControlBlock * htcb, NALUnit * outUnits);
+
+        // Number of packets the units make, and where packet inPacketNumber starts
+        UInt16      FindPacket(NALUnit * inUnits, UInt32 inNumUnits, UInt16 inPacketNumber, PacketInfo * outInfo);
+
+        UInt32      WriteH264Payload(NALUnit * inUnits, PacketInfo * inInfo, char * outBuffer);
+
+        UInt32      fMediaType;
+        UInt32      fNALLengthSize;
+
+        // SPS and PPS from avcC
+        char*       fParameterSetData;
+        NALUnit     fParameterSets[kMaxParameterSets];
+        UInt32      fNumParameterSets;
+
+        char*       fSDPFile;
+        UInt32      fSDPFileLength;
+
+        UInt64      fTotalRTPBytes;
+        UInt64      fTotalRTPPackets;
+};
+
+#endif // __QT_MEDIA_HINT_TRACK_H__
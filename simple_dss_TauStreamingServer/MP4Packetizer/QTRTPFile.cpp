@@ -44,6 +44,7 @@
 #include "QTHintTrack.h"
 
 #include "QTRTPFile.h"
+#include "QTRTPPacketCache.h"
 #include "OSMemory.h"
 
 
@@ -78,6 +79,7 @@ const RTPMetaInfoPacket::FieldID QTRTPFile::kMetaInfoFields[] =
 OSMutex                         *QTRTPFile::gFileCacheMutex,
                                 *QTRTPFile::gFileCacheAddMutex;
 QTRTPFile::RTPFileCacheEntry    *QTRTPFile::gFirstFileCacheEntry = NULL;
+UInt32                          QTRTPFile::sPacketCacheWindowSecs = 0;
 
 void QTRTPFile::Initialize(void)
 {
@@ -86,7 +88,7 @@ void QTRTPFile::Initialize(void)
 }
 
 
-QTRTPFile::ErrorCode QTRTPFile::new_QTFile(const char * filePath, QTFile ** theQTFile, Bool16 debugFlag, Bool16 deepDebugFlag)
+QTRTPFile::ErrorCode QTRTPFile::new_QTFile(const char * filePath, QTFile ** theQTFile, QTRTPFile::RTPFileCacheEntry ** theCacheEntry, Bool16 debugFlag, Bool16 deepDebugFlag)
 {
     // Temporary vars
     QTFile::ErrorCode   rcFile;
@@ -96,11 +98,17 @@ QTRTPFile::ErrorCode QTRTPFile::new_QTFile(const char * filePath, QTFile ** theQ
 
     QTRTPFile::RTPFileCacheEntry    *fileCacheEntry;
     
+    *theCacheEntry = NULL;
         
     //
     // Find and return the QTFile object out of our cache, if it exists.
     if( QTRTPFile::FindAndRefcountFileCacheEntry(filePath, &fileCacheEntry) ) 
     {
+        //
+        // A second reader; from now on share the packets built.
+        if( (fileCacheEntry->PacketCache == NULL) && (QTRTPFile::sPacketCacheWindowSecs > 0) )
+            fileCacheEntry->PacketCache = NEW QTRTPPacketCache(QTRTPFile::sPacketCacheWindowSecs);
+        
         fileCacheAddMutex.Unlock();
     
         fileCacheEntry->InitMutex->Lock();  // Guaranteed to block as the mutex
@@ -111,6 +119,7 @@ QTRTPFile::ErrorCode QTRTPFile::new_QTFile(const char * filePath, QTFile ** theQ
         *theQTFile = fileCacheEntry->File;
         Assert(*theQTFile);
         
+        *theCacheEntry = fileCacheEntry;
         return errNoError;
     }
 
@@ -154,6 +163,7 @@ QTRTPFile::ErrorCode QTRTPFile::new_QTFile(const char * filePath, QTFile ** theQ
         fileCacheEntry->File = *theQTFile;      
         fileCacheEntry->InitMutex->Unlock();
     }
+    *theCacheEntry = fileCacheEntry;
 
     //
     // Return the file object.
@@ -196,6 +206,9 @@ void QTRTPFile::delete_QTFile(QTFile * theQTFile)
 
             if( listEntry->fFilename != NULL )
                 delete [] listEntry->fFilename;
+
+            if( listEntry->PacketCache != NULL )
+                delete listEntry->PacketCache;
             
             //
             // Remove this entry from the list.
@@ -251,6 +264,7 @@ void QTRTPFile::AddFileToCache(const char *inFilename, QTRTPFile::RTPFileCacheEn
     (*newListEntry)->File = NULL;
     
     (*newListEntry)->ReferenceCount = 1;
+    (*newListEntry)->PacketCache = NULL;
 
     (*newListEntry)->PrevEntry = NULL;
     (*newListEntry)->NextEntry = NULL;
@@ -350,6 +364,7 @@ QTRTPFile::QTRTPFile(Bool16 debugFlag, Bool16 deepDebugFlag)
     , fDeepDebug(deepDebugFlag)
     , fFile(NULL)
     , fFCB(NULL)
+    , fCacheEntry(NULL)
     , fNumHintTracks(0)
     , fFirstTrack(NULL)
     , fLastTrack(NULL)
@@ -420,7 +435,7 @@ QTRTPFile::ErrorCode QTRTPFile::Initialize(const char * filePath)
     
     //
     // Create our file object.
-    rc = this->new_QTFile(filePath, &fFile, fDebug, fDeepDebug);
+    rc = this->new_QTFile(filePath, &fFile, &fCacheEntry, fDebug, fDeepDebug);
     if ( rc != errNoError ) 
     {
         fFile = NULL;
@@ -749,7 +764,10 @@ UInt32 QTRTPFile::GetTrackTimeScale(UInt32 trackID)
         return 0;
     
     //
-    // Return the duration.
+    // Return the timescale. A packetized media track runs on the RTP clock
+    // rather than on its media timescale.
+    if( trackEntry->HintTrack->IsMediaPacketizer() )
+        return trackEntry->HintTrack->GetRTPTimescale();
     return (UInt32)trackEntry->HintTrack->GetTimeScale();
 }
 
@@ -1348,6 +1366,14 @@ Bool16 QTRTPFile::PrefetchNextPacket(RTPTrackListEntry * trackEntry, Bool16 doSe
 
     // Temporary vars
     QTTrack::ErrorCode  getPacketErr = QTTrack::errIsSkippedPacket;
+
+    //
+    // Packets shared with other readers of this file. RTP-Meta-Info packets
+    // carry fields of their own, and packetized media tracks sequence numbers
+    // of their own, so those are always built here.
+    QTRTPPacketCache    *packetCache = NULL;
+    if( (fCacheEntry != NULL) && !fHasRTPMetaInfoFieldArray && !trackEntry->HintTrack->IsMediaPacketizer() )
+        packetCache = fCacheEntry->PacketCache;
     
     // If we are dropping b-frames or repeat packets, QTHintTrack::GetPacket will return the errIsSkippedPacket error to us.
     // If we get that error, we should fetch another packet. So, we have this loop here.
@@ -1463,13 +1489,35 @@ Bool16 QTRTPFile::PrefetchNextPacket(RTPTrackListEntry * trackEntry, Bool16 doSe
         MicroSecondStopWatch    packetTimer;
         packetTimer.Start();
     #endif
-        getPacketErr = trackEntry->HintTrack->GetPacket(trackEntry->CurSampleNumber, trackEntry->CurPacketNumber,
-                                                   trackEntry->CurPacket, &trackEntry->CurPacketLength,
-                                                   &trackEntry->CurPacketTime,
-                                                   (trackEntry->QualityLevel >= kNoBFrames),
-                                                   fDropRepeatPackets,
-                                                   trackEntry->SSRC,
-                                                   trackEntry->HTCB);
+        if( (packetCache != NULL) && !skipThisSample
+            && packetCache->GetPacket(trackEntry->HintTrack, trackEntry->CurSampleNumber, trackEntry->CurPacketNumber,
+                                      trackEntry->NumPacketsInThisSample,
+                                      (trackEntry->QualityLevel >= kNoBFrames),
+                                      fDropRepeatPackets,
+                                      trackEntry->SSRC,
+                                      trackEntry->CurPacket, &trackEntry->CurPacketLength,
+                                      &trackEntry->CurPacketTime) )
+        {
+            getPacketErr = QTTrack::errNoError;
+        }
+        else
+        {
+            getPacketErr = trackEntry->HintTrack->GetPacket(trackEntry->CurSampleNumber, trackEntry->CurPacketNumber,
+                                                       trackEntry->CurPacket, &trackEntry->CurPacketLength,
+                                                       &trackEntry->CurPacketTime,
+                                                       (trackEntry->QualityLevel >= kNoBFrames),
+                                                       fDropRepeatPackets,
+                                                       trackEntry->SSRC,
+                                                       trackEntry->HTCB);
+            
+            if( (packetCache != NULL) && (getPacketErr == QTTrack::errNoError) )
+                packetCache->PutPacket(trackEntry->HintTrack, trackEntry->CurSampleNumber, trackEntry->CurPacketNumber,
+                                       trackEntry->NumPacketsInThisSample,
+                                       (trackEntry->QualityLevel >= kNoBFrames),
+                                       fDropRepeatPackets,
+                                       trackEntry->CurPacket, trackEntry->CurPacketLength,
+                                       trackEntry->CurPacketTime);
+        }
 
     #if QT_PROFILE
         packetTimer.Stop();
@@ -55,6 +55,7 @@ class QTFile;
 class QTFile_FileControlBlock;
 class QTHintTrack;
 class QTHintTrack_HintTrackControlBlock;
+class QTRTPPacketCache;
 
 class QTRTPFile {
 
@@ -89,6 +90,11 @@ public:
         // Reference count for this cache entry
         int         ReferenceCount; 
         
+        //
+        // Packets built for the readers of this file, created once there
+        // are two of them
+        QTRTPPacketCache    *PacketCache;
+        
         //
         // List pointers
         RTPFileCacheEntry   *PrevEntry, *NextEntry;
@@ -139,6 +145,12 @@ public:
     // Global initialize function; CALL THIS FIRST!
     static void         Initialize(void);
     
+    //
+    // How many seconds of packets to keep for other readers of the same
+    // file, 0 to build every packet for every reader. Takes effect for
+    // files opened from then on.
+    static void         SetPacketCacheWindow(UInt32 inWindowSecs) { sPacketCacheWindowSecs = inWindowSecs; }
+    
     //
     // Returns a static array of the RTP-Meta-Info fields supported by QTFileLib.
     // It also returns field IDs for the fields it recommends being compressed.
@@ -236,8 +248,9 @@ protected:
     // Protected cache functions and variables.
     static  OSMutex             *gFileCacheMutex, *gFileCacheAddMutex;
     static  RTPFileCacheEntry   *gFirstFileCacheEntry;
+    static  UInt32              sPacketCacheWindowSecs;
     
-    static  ErrorCode   new_QTFile(const char * FilePath, QTFile ** File, Bool16 Debug = false, Bool16 DeepDebug = false);
+    static  ErrorCode   new_QTFile(const char * FilePath, QTFile ** File, RTPFileCacheEntry ** CacheEntry, Bool16 Debug = false, Bool16 DeepDebug = false);
     static  void        delete_QTFile(QTFile * File);
 
     static  void        AddFileToCache(const char *inFilename, QTRTPFile::RTPFileCacheEntry ** NewListEntry);
@@ -255,6 +268,7 @@ protected:
 
     QTFile              *fFile;
     QTFile_FileControlBlock *fFCB;
+    RTPFileCacheEntry   *fCacheEntry;
     
     UInt32              fNumHintTracks;
     RTPTrackListEntry   *fFirstTrack, *fLastTrack, *fCurSeekTrack;
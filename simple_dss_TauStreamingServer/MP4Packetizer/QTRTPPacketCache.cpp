@@ -0,0 +1,171 @@
+/***************************************************************************
+
+Copyright (c) 2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 QTRTPPacketCache.cpp
+Description: Per file cache of the RTP packets built from its hint tracks, so
+             that viewers close to each other in a movie build each packet once.
+Comment:
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-19
+LastUpdate:  2026-10-19
+
+****************************************************************************/
+
+#include <string.h>
+
+#include "QTRTPPacketCache.h"
+#include "QTHintTrack.h"
+#include "OSMemory.h"
+
+#ifndef __Win32__
+#include <netinet/in.h>
+#endif
+
+QTRTPPacketCache::QTRTPPacketCache(UInt32 inWindowSecs)
+:   fMutex(),
+    fWindowSecs(inWindowSecs),
+    fFirstTrack(NULL)
+{}
+
+QTRTPPacketCache::~QTRTPPacketCache()
+{
+    while (fFirstTrack != NULL)
+    {
+        Track* theTrack = fFirstTrack;
+        fFirstTrack = theTrack->fNextTrack;
+
+        for (UInt32 x = 0; x < theTrack->fNumSamples; x++)
+        {
+            Sample* theSample = &theTrack->fSamples[x];
+            for (UInt16 y = 0; y < theSample->fMaxPackets; y++)
+                delete [] theSample->fPackets[y].fData;
+            delete [] theSample->fPackets;
+        }
+        delete [] theTrack->fSamples;
+        delete theTrack;
+    }
+}
+
+QTRTPPacketCache::Track* QTRTPPacketCache::FindTrack(QTHintTrack* inTrack, Bool16 inCreate)
+{
+    for (Track* theTrack = fFirstTrack; theTrack != NULL; theTrack = theTrack->fNextTrack)
+    {
+        if (theTrack->fHintTrack == inTrack)
+            return theTrack;
+    }
+
+    if (!inCreate)
+        return NULL;
+
+    // Packets per second is at least samples per second, so the ring holds the window
+    Float64 theDuration = inTrack->GetDurationInSeconds();
+    UInt64 theNumSamples = kMaxSamplesPerTrack;
+    if (theDuration > 0)
+        theNumSamples = (UInt64)((Float64)(SInt64)inTrack->GetTotalRTPPackets() * fWindowSecs / theDuration) + 1;
+    if (theNumSamples < kMinSamplesPerTrack)
+        theNumSamples = kMinSamplesPerTrack;
+    else if (theNumSamples > kMaxSamplesPerTrack)
+        theNumSamples = kMaxSamplesPerTrack;
+
+    Track* theTrack = NEW Track;
+    theTrack->fHintTrack = inTrack;
+    theTrack->fNumSamples = (UInt32)theNumSamples;
+    theTrack->fSamples = NEW Sample[theTrack->fNumSamples];
+    ::memset(theTrack->fSamples, 0, sizeof(Sample) * theTrack->fNumSamples);
+    theTrack->fNextTrack = fFirstTrack;
+    fFirstTrack = theTrack;
+    return theTrack;
+}
+
+QTRTPPacketCache::Packet* QTRTPPacketCache::FindPacket(Track* inTrack, UInt32 inSampleNumber, UInt16 inPacketNumber, UInt16 inNumPackets, Bool16 inCreate)
+{
+    if ((inPacketNumber == 0) || (inPacketNumber > inNumPackets))
+        return NULL;
+
+    Sample* theSample = &inTrack->fSamples[inSampleNumber % inTrack->fNumSamples];
+    if ((theSample->fSampleNumber != inSampleNumber) || (theSample->fNumPackets != inNumPackets))
+    {
+        if (!inCreate)
+            return NULL;
+
+        // Take the slot over, keeping the buffers
+        if (inNumPackets > theSample->fMaxPackets)
+        {
+            Packet* thePackets = NEW Packet[inNumPackets];
+            ::memset(thePackets, 0, sizeof(Packet) * inNumPackets);
+            for (UInt16 y = 0; y < theSample->fMaxPackets; y++)
+            {
+                thePackets[y].fBufferSize = theSample->fPackets[y].fBufferSize;
+                thePackets[y].fData = theSample->fPackets[y].fData;
+            }
+            delete [] theSample->fPackets;
+            theSample->fPackets = thePackets;
+            theSample->fMaxPackets = inNumPackets;
+        }
+        for (UInt16 y = 0; y < theSample->fMaxPackets; y++)
+            theSample->fPackets[y].fLength = 0;
+
+        theSample->fSampleNumber = inSampleNumber;
+        theSample->fNumPackets = inNumPackets;
+    }
+
+    return &theSample->fPackets[inPacketNumber - 1];
+}
+
+Bool16 QTRTPPacketCache::GetPacket(QTHintTrack* inTrack, UInt32 inSampleNumber, UInt16 inPacketNumber, UInt16 inNumPackets,
+                                    Bool16 inDropBFrames, Bool16 inDropRepeatPackets, UInt32 inSSRC,
+                                    char* outPacket, UInt32* ioLength, Float64* outTransmitTime)
+{
+    OSMutexLocker locker(&fMutex);
+
+    Track* theTrack = this->FindTrack(inTrack, false);
+    if (theTrack == NULL)
+        return false;
+
+    Packet* thePacket = this->FindPacket(theTrack, inSampleNumber, inPacketNumber, inNumPackets, false);
+    if ((thePacket == NULL) || (thePacket->fLength == 0) || (thePacket->fLength > *ioLength))
+        return false;
+
+    // A packet built without dropping could be one this caller drops
+    if ((inDropBFrames && !thePacket->fDroppedBFrames) || (inDropRepeatPackets && !thePacket->fDroppedRepeatPackets))
+        return false;
+
+    ::memcpy(outPacket, thePacket->fData, thePacket->fLength);
+    UInt32 theSSRC = htonl(inSSRC);
+    ::memcpy(outPacket + 8, &theSSRC, 4);
+    *ioLength = thePacket->fLength;
+    *outTransmitTime = thePacket->fTransmitTime;
+    return true;
+}
+
+void QTRTPPacketCache::PutPacket(QTHintTrack* inTrack, UInt32 inSampleNumber, UInt16 inPacketNumber, UInt16 inNumPackets,
+                                    Bool16 inDropBFrames, Bool16 inDropRepeatPackets,
+                                    char* inPacket, UInt32 inLength, Float64 inTransmitTime)
+{
+    if (inLength < 12)
+        return;
+
+    OSMutexLocker locker(&fMutex);
+
+    Packet* thePacket = this->FindPacket(this->FindTrack(inTrack, true), inSampleNumber, inPacketNumber, inNumPackets, true);
+    if (thePacket == NULL)
+        return;
+
+    // One built with more dropping serves more callers, keep it
+    if ((thePacket->fLength > 0) && (thePacket->fDroppedBFrames || !inDropBFrames) && (thePacket->fDroppedRepeatPackets || !inDropRepeatPackets))
+        return;
+
+    if (inLength > thePacket->fBufferSize)
+    {
+        delete [] thePacket->fData;
+        thePacket->fData = NEW char[inLength];
+        thePacket->fBufferSize = inLength;
+    }
+    ::memcpy(thePacket->fData, inPacket, inLength);
+    thePacket->fLength = inLength;
+    thePacket->fDroppedBFrames = inDropBFrames;
+    thePacket->fDroppedRepeatPackets = inDropRepeatPackets;
+    thePacket->fTransmitTime = inTransmitTime;
+}
@@ -0,0 +1,97 @@
+/***************************************************************************
+
+Copyright (c) 2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 QTRTPPacketCache.h
+Description: Per file cache of the RTP packets built from its hint tracks, so
+             that viewers close to each other in a movie build each packet once.
+Comment:
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-19
+LastUpdate:  2026-10-19
+
+****************************************************************************/
+
+#ifndef __QT_RTP_PACKET_CACHE_H__
+#define __QT_RTP_PACKET_CACHE_H__
+
+#include "OSHeaders.h"
+#include "OSMutex.h"
+
+class QTHintTrack;
+
+/*
+    QTRTPFile creates one of these for a file as soon as a second QTRTPFile
+    opens it, see QTRTPFile::new_QTFile. Every hint track gets a ring of
+    hint samples, slot SampleNumber % ring size, sized to hold about
+    the window of seconds set with QTRTPFile::SetPacketCacheWindow. A
+    sample that comes round again overwrites what was there, so viewers
+    further apart than the window just miss.
+
+    Packets are kept exactly as QTHintTrack::GetPacket built them. Only
+    the SSRC is the builder's: GetPacket puts the caller's in, and
+    QTRTPFile::PrefetchNextPacket goes on to offset the sequence number
+    and timestamp as for a packet it built itself.
+*/
+
+class QTRTPPacketCache
+{
+    public:
+
+        enum
+        {
+            kMinSamplesPerTrack = 16,       //UInt32
+            kMaxSamplesPerTrack = 16384     //UInt32
+        };
+
+        QTRTPPacketCache(UInt32 inWindowSecs);
+        ~QTRTPPacketCache();
+
+        // Copies the packet out, with inSSRC in it, if it is cached and was built
+        // with the same B frame and repeat packet dropping, or a stricter one
+        Bool16  GetPacket(QTHintTrack* inTrack, UInt32 inSampleNumber, UInt16 inPacketNumber, UInt16 inNumPackets,
+                            Bool16 inDropBFrames, Bool16 inDropRepeatPackets, UInt32 inSSRC,
+                            char* outPacket, UInt32* ioLength, Float64* outTransmitTime);
+
+        void    PutPacket(QTHintTrack* inTrack, UInt32 inSampleNumber, UInt16 inPacketNumber, UInt16 inNumPackets,
+                            Bool16 inDropBFrames, Bool16 inDropRepeatPackets,
+                            char* inPacket, UInt32 inLength, Float64 inTransmitTime);
+
+    private:
+
+        struct Packet
+        {
+            UInt32      fLength;        // 0 until built
+            Bool16      fDroppedBFrames;
+            Bool16      fDroppedRepeatPackets;
+            Float64     fTransmitTime;
+            UInt32      fBufferSize;
+            char*       fData;
+        };
+
+        struct Sample
+        {
+            UInt32      fSampleNumber;  // 0 when empty
+            UInt16      fNumPackets;
+            UInt16      fMaxPackets;    // fPackets allocated
+            Packet*     fPackets;
+        };
+
+        struct Track
+        {
+            QTHintTrack*    fHintTrack;
+            UInt32          fNumSamples;
+            Sample*         fSamples;
+            Track*          fNextTrack;
+        };
+
+        Track*  FindTrack(QTHintTrack* inTrack, Bool16 inCreate);
+        Packet* FindPacket(Track* inTrack, UInt32 inSampleNumber, UInt16 inPacketNumber, UInt16 inNumPackets, Bool16 inCreate);
+
+        OSMutex     fMutex;
+        UInt32      fWindowSecs;
+        Track*      fFirstTrack;
+};
+
+#endif // __QT_RTP_PACKET_CACHE_H__
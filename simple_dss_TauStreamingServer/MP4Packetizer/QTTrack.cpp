@@ -73,6 +73,7 @@ QTTrack::QTTrack(QTFile * File, QTFile::AtomTOCEntry * Atom, Bool16 Debug, Bool1
       fEditListAtom(NULL), fDataReferenceAtom(NULL),
       fTimeToSampleAtom(NULL),fCompTimeToSampleAtom(NULL), fSampleToChunkAtom(NULL), fSampleDescriptionAtom(NULL),
       fChunkOffsetAtom(NULL), fSampleSizeAtom(NULL), fSyncSampleAtom(NULL),
+      fFragmentIndex(NULL),
       fFirstEditMediaTime(0)
 {
     // Temporary vars
@@ -281,6 +282,12 @@ QTTrack::ErrorCode QTTrack::Initialize(void)
     } else {
         fSyncSampleAtom = NULL;
     }
+
+    //
+    // The samples of a fragmented movie's track are in its fragments,
+    // unless the moov has some of its own.
+    if( fFile->IsFragmented() && (fSampleSizeAtom->GetNumEntries() == 0) )
+        fFragmentIndex = fFile->GetFragmentIndex(GetTrackID());
     
     
     //
@@ -301,6 +308,14 @@ Bool16 QTTrack::GetSampleInfo(UInt32 SampleNumber, UInt32 * const Length, UInt64
     
 //  qtss_printf("GetSampleInfo QTTrack SampleNumber = %ld \n", SampleNumber);
 
+    if (fFragmentIndex != NULL)
+    {
+        // Past the last sample indexed, more may have been written since
+        if (SampleNumber > fFragmentIndex->GetNumSamples())
+            fFile->IndexFragments();
+        return fFragmentIndex->GetSampleInfo(SampleNumber, Length, Offset, SampleDescriptionIndex);
+    }
+
     if (STCB->fGetSampleInfo_SampleNumber == SampleNumber && STCB->fGetSampleInfo_Length > 0)
     {
 //      qtss_printf("----- GetSampleInfo Cache Hit QTTrack SampleNumber = %ld \n", SampleNumber);
@@ -388,6 +403,19 @@ Bool16 QTTrack::GetSampleInfo(UInt32 SampleNumber, UInt32 * const Length, UInt64
 }
 
 
+Bool16 QTTrack::GetSampleNumberFromMediaTime(UInt32 MediaTime, UInt32 * const SampleNumber, QTAtom_stts_SampleTableControlBlock * STCB)
+{
+    if (fFragmentIndex == NULL)
+        return fTimeToSampleAtom->MediaTimeToSampleNumber(MediaTime, SampleNumber, STCB);
+
+    if (fFragmentIndex->MediaTimeToSampleNumber(MediaTime, SampleNumber))
+        return true;
+
+    fFile->IndexFragments();
+    return fFragmentIndex->MediaTimeToSampleNumber(MediaTime, SampleNumber);
+}
+
+
 Bool16 QTTrack::GetSizeOfSamplesInChunk(UInt32 chunkNumber, UInt32 * const sizePtr, UInt32 * const firstSampleNumPtr, UInt32 * const lastSampleNumPtr, QTAtom_stsc_SampleTableControlBlock * stcbPtr)
 {
     UInt32 firstSample = 0;
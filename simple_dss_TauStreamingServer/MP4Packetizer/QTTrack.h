@@ -42,6 +42,7 @@
 #include "QTAtom_stss.h"
 #include "QTAtom_stsz.h"
 #include "QTAtom_stts.h"
+#include "QTFragmentIndex.h"
 
 
 //
@@ -91,14 +92,28 @@ public:
     inline  SInt64      GetDuration(void) { return (SInt64) fTrackHeaderAtom->GetDuration(); }
     inline  Float64     GetTimeScale(void) { return fMediaHeaderAtom->GetTimeScale(); }
     inline  Float64     GetTimeScaleRecip(void) { return fMediaHeaderAtom->GetTimeScaleRecip(); }
-    inline  Float64     GetDurationInSeconds(void) { return GetDuration() / (Float64)GetTimeScale(); }
+    inline  Float64     GetDurationInSeconds(void)
+                        {   if (fFragmentIndex != NULL) return fFragmentIndex->GetDuration() * GetTimeScaleRecip();
+                            return GetDuration() / (Float64)GetTimeScale();
+                        }
+    inline  Float64     GetMediaDurationInSeconds(void)
+                        {   if (fFragmentIndex != NULL) return fFragmentIndex->GetDuration() * GetTimeScaleRecip();
+                            return (Float64)(SInt64)fMediaHeaderAtom->GetDuration() * GetTimeScaleRecip();
+                        }
     inline  UInt64      GetFirstEditMovieTime(void)
                                               { if(fEditListAtom != NULL) return fEditListAtom->FirstEditMovieTime();
                                                 else return 0; }
     inline  UInt32      GetFirstEditMediaTime(void) { return fFirstEditMediaTime; }
     
     //
-    // Sample functions
+    // Sample functions. A track of a fragmented movie has its samples in
+    // fFragmentIndex, the chunk functions do not apply to it.
+    inline  Bool16      IsFragmented(void) { return fFragmentIndex != NULL; }
+    inline  UInt32      GetNumSamples(void)
+                        {   if (fFragmentIndex != NULL) return fFragmentIndex->GetNumSamples();
+                            return fSampleSizeAtom->GetNumEntries();
+                        }
+
     Bool16              GetSizeOfSamplesInChunk(UInt32 chunkNumber, UInt32 * const sizePtr, UInt32 * const firstSampleNumPtr, UInt32 * const lastSampleNumPtr, QTAtom_stsc_SampleTableControlBlock * stcbPtr);
 
     inline  Bool16      GetChunkFirstLastSample(UInt32 chunkNumber, UInt32 *firstSample, UInt32 *lastSample, 
@@ -128,7 +143,8 @@ public:
                         }
 
     inline  Bool16      SampleSize(UInt32 SampleNumber, UInt32 *Size = NULL) 
-                        {   return fSampleSizeAtom->SampleSize(SampleNumber, Size); 
+                        {   if (fFragmentIndex != NULL) return fFragmentIndex->GetSampleInfo(SampleNumber, Size, NULL, NULL);
+                            return fSampleSizeAtom->SampleSize(SampleNumber, Size); 
                         }
 
     inline  Bool16      SampleRangeSize(UInt32 firstSample, UInt32 lastSample, UInt32 *sizePtr = NULL) 
@@ -143,27 +159,29 @@ public:
 
     inline  Bool16      GetSampleMediaTime(UInt32 SampleNumber, UInt32 * const MediaTime, 
                                                 QTAtom_stts_SampleTableControlBlock * STCB)
-                        {   return fTimeToSampleAtom->SampleNumberToMediaTime(SampleNumber, MediaTime, STCB); 
+                        {   if (fFragmentIndex != NULL) return fFragmentIndex->SampleNumberToMediaTime(SampleNumber, MediaTime);
+                            return fTimeToSampleAtom->SampleNumberToMediaTime(SampleNumber, MediaTime, STCB); 
                         }                       
 
-    inline  Bool16      GetSampleNumberFromMediaTime(UInt32 MediaTime, UInt32 * const SampleNumber, 
-                                                QTAtom_stts_SampleTableControlBlock * STCB)
-                        {   return fTimeToSampleAtom->MediaTimeToSampleNumber(MediaTime, SampleNumber, STCB); 
-                        }
+            Bool16      GetSampleNumberFromMediaTime(UInt32 MediaTime, UInt32 * const SampleNumber, 
+                                                QTAtom_stts_SampleTableControlBlock * STCB);
 
 
     inline  void        GetPreviousSyncSample(UInt32 SampleNumber, UInt32 * SyncSampleNumber)
-                        {   if(fSyncSampleAtom != NULL) fSyncSampleAtom->PreviousSyncSample(SampleNumber, SyncSampleNumber);
+                        {   if(fFragmentIndex != NULL) fFragmentIndex->PreviousSyncSample(SampleNumber, SyncSampleNumber);
+                            else if(fSyncSampleAtom != NULL) fSyncSampleAtom->PreviousSyncSample(SampleNumber, SyncSampleNumber);
                             else *SyncSampleNumber = SampleNumber; 
                         }
                         
     inline  void        GetNextSyncSample(UInt32 SampleNumber, UInt32 * SyncSampleNumber)
-                        {       if(fSyncSampleAtom != NULL) fSyncSampleAtom->NextSyncSample(SampleNumber, SyncSampleNumber);
+                        {       if(fFragmentIndex != NULL) fFragmentIndex->NextSyncSample(SampleNumber, SyncSampleNumber);
+                                else if(fSyncSampleAtom != NULL) fSyncSampleAtom->NextSyncSample(SampleNumber, SyncSampleNumber);
                                 else *SyncSampleNumber = SampleNumber + 1; 
                         }
 
     inline Bool16           IsSyncSample(UInt32 SampleNumber, UInt32 SyncSampleCursor)
-                        { if (fSyncSampleAtom != NULL) return fSyncSampleAtom->IsSyncSample(SampleNumber, SyncSampleCursor);
+                        { if (fFragmentIndex != NULL) return fFragmentIndex->IsSyncSample(SampleNumber);
+                            if (fSyncSampleAtom != NULL) return fSyncSampleAtom->IsSyncSample(SampleNumber, SyncSampleCursor);
                             else return true;
                         } 
     //
@@ -175,6 +193,8 @@ public:
 
     inline Bool16       GetSampleMediaTimeOffset(UInt32 SampleNumber, UInt32 *mediaTimeOffset, QTAtom_ctts_SampleTableControlBlock * STCB)
                         {   
+                            if (fFragmentIndex != NULL)
+                                return fFragmentIndex->SampleNumberToMediaTimeOffset(SampleNumber, mediaTimeOffset);
                             if (fCompTimeToSampleAtom) 
                                 return fCompTimeToSampleAtom->SampleNumberToMediaTimeOffset(SampleNumber, mediaTimeOffset, STCB);
                             else 
@@ -215,6 +235,9 @@ protected:
     QTAtom_stsz         *fSampleSizeAtom;
     QTAtom_stss         *fSyncSampleAtom;
 
+    // Owned by fFile
+    QTFragmentIndex     *fFragmentIndex;
+
     UInt32              fFirstEditMediaTime;
 };
 
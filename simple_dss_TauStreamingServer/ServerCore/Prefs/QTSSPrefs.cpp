@@ -20,6 +20,7 @@ LastUpdate:  2010-08-16
 #include "MyAssert.h"
 #include "OSMemory.h"
 #include "OSArrayObjectDeleter.h"
+#include "atomic.h"
 
 
 
@@ -30,12 +31,25 @@ QTSSPrefs::QTSSPrefs(XMLPrefsParser* inPrefsSource, StrPtrLen* inModuleName, QTS
 :   QTSSDictionary(inMap, &fPrefsMutex),
     fPrefsSource(inPrefsSource),
     fPrefName(NULL),
-    fParentDictionary(parentDictionary)
+    fParentDictionary(parentDictionary),
+    fVersion(0)
 {   //ģݳԱfPrefName
     if (inModuleName != NULL)
         fPrefName = inModuleName->GetAsCString();
 }
 
+/* Ԥֵб仯,ӱϼԤֵİ汾 */
+void QTSSPrefs::PrefsChanged()
+{
+    // Object prefs have their own mutex, so the version can be bumped
+    // from under either one
+    (void)atomic_add(&fVersion, 1);
+    if (fParentDictionary != NULL)
+        fParentDictionary->PrefsChanged();
+    else
+        QTSSModuleUtils::PrefsChanged();
+}
+
 
 /* Ԥֵ,ʵ,ٷ */
 QTSSDictionary* QTSSPrefs::CreateNewDictionary(QTSSDictionaryMap* inMap, OSMutex* /* inMutex */)
@@ -199,6 +213,7 @@ void QTSSPrefs::RereadObjectPreferences(ContainerRef container)
                 //ɾʵ
                 this->GetInstanceDictMap()->RemoveAttribute(theAttrID);
                 modulePrefInServer[a] = NULL;
+                this->PrefsChanged();
             }
         }
     }
@@ -227,6 +242,7 @@ void QTSSPrefs::SetPrefValuesFromFileWithRef(ContainerRef pref, QTSS_AttributeID
     UInt32 numPrefValues = inNumValues;
     if (inNumValues == 0)
         numPrefValues = fPrefsSource->GetNumPrefValues(pref);
+    UInt32 theOldNumValues = this->GetNumValues(inAttrID);
         
     char* thePrefName = NULL;
     char* thePrefValue = NULL;
@@ -273,12 +289,22 @@ void QTSSPrefs::SetPrefValuesFromFileWithRef(ContainerRef pref, QTSS_AttributeID
     
     // Make sure the dictionary knows exactly how many values are associated with this pref
     // øָԵԤֵ,Prefֵ֪
+    // One empty value, as an empty string set through the API comes back
+    // from the file, reads the same as none
+    void* theValue = NULL;
+    UInt32 theValueLen = 0;
+    Bool16 isChanged = (numPrefValues < theOldNumValues) &&
+        ((numPrefValues > 0) || (theOldNumValues > 1) || (this->GetValuePtr(inAttrID, 0, &theValue, &theValueLen, true) != QTSS_ValueNotFound));
     this->SetNumValues(inAttrID, numPrefValues);
+    if (isChanged)
+        this->PrefsChanged();
 }
  
 /* ָIDObject,ȶȡָindexTagֵ,μQTSSDictionary,ָIDԸ */
 void QTSSPrefs::SetObjectValuesFromFile(ContainerRef pref, QTSS_AttributeID inAttrID, UInt32 inNumValues, char* prefName)
 {
+    UInt32 theOldNumValues = this->GetNumValues(inAttrID);
+
 	//ԸָIDObject,ļ
     for (UInt32 z = 0; z < inNumValues; z++)
     {
@@ -298,6 +324,7 @@ void QTSSPrefs::SetObjectValuesFromFile(ContainerRef pref, QTSS_AttributeID inAt
                 return;
             StrPtrLen temp(prefName);
             prefObject->fPrefName = temp.GetAsCString(); //һԤֵ
+            this->PrefsChanged();
         }
 		//ָԤֵ
         prefObject->RereadObjectPreferences(object);
@@ -306,6 +333,8 @@ void QTSSPrefs::SetObjectValuesFromFile(ContainerRef pref, QTSS_AttributeID inAt
     // Make sure the dictionary knows exactly how many values are associated with this pref
     // ӦֵøָIDԵܸ
     this->SetNumValues(inAttrID, inNumValues);
+    if (inNumValues < theOldNumValues)
+        this->PrefsChanged();
 }
 
 /* QTSSDictionaryָIDindexֵ(Ƚת) */
@@ -326,10 +355,29 @@ void    QTSSPrefs::SetPrefValue(QTSS_AttributeID inAttrID, UInt32 inAttrIndex,
     
     if (inValueSize == 0)
         inValueSize = convertedBufSize;
+
+    // Most prefs are the same on a reread, leave those as they are
+    if (inAttrIndex < this->GetNumValues(inAttrID))
+    {
+        void* theOldValue = NULL;
+        UInt32 theOldLen = 0;
+        theErr = this->GetValuePtr(inAttrID, inAttrIndex, &theOldValue, &theOldLen, true);
+        
+        // A string pref with several values is kept as an array of C strings
+        UInt32 theNewLen = inValueSize;
+        if ((inPrefType == qtssAttrDataTypeCharArray) && (this->GetNumValues(inAttrID) > 1))
+            theNewLen = ::strlen(convertedPrefValue);
+        
+        // QTSS_ValueNotFound is an empty string
+        if ((theErr == QTSS_NoErr) && (theOldLen == theNewLen) && (::memcmp(theOldValue, convertedPrefValue, theNewLen) == 0))
+            return;
+        if ((theErr == QTSS_ValueNotFound) && (theNewLen == 0))
+            return;
+    }
      
 	//ӦֵָIDԵֵ
     this->SetValue(inAttrID, inAttrIndex, convertedPrefValue, inValueSize, QTSSDictionary::kDontObeyReadOnly | QTSSDictionary::kDontCallCompletionRoutine);                         
-
+    this->PrefsChanged();
 }
 
 /* QTSSDictionaryָ͵ʵ,ȡظID */
@@ -337,6 +385,7 @@ QTSS_AttributeID QTSSPrefs::AddPrefAttribute(const char* inAttrName, QTSS_AttrDa
 {
     QTSS_Error theErr = this->AddInstanceAttribute( inAttrName, NULL, inDataType, qtssAttrModeRead | qtssAttrModeWrite | qtssAttrModeDelete);
     Assert(theErr == QTSS_NoErr);
+    this->PrefsChanged();
     
     QTSS_AttributeID theID = qtssIllegalAttrID;
     theErr = this->GetInstanceDictMap()->GetAttrID( inAttrName, &theID);
@@ -349,6 +398,8 @@ QTSS_AttributeID QTSSPrefs::AddPrefAttribute(const char* inAttrName, QTSS_AttrDa
 void    QTSSPrefs::RemoveValueComplete(UInt32 inAttrIndex, QTSSDictionaryMap* inMap,
                                         UInt32 inValueIndex)
 {
+    this->PrefsChanged();
+
 	/* õTag */
     ContainerRef objectRef = GetContainerRef();
 	/* صһ,ָNAMEֵΪinPrefNameindexΪ0Tag */
@@ -366,6 +417,8 @@ void    QTSSPrefs::RemoveValueComplete(UInt32 inAttrIndex, QTSSDictionaryMap* in
 /* ҵָNAMEֵΪinPrefNameindexΪ0Tag,ɾ */
 void    QTSSPrefs::RemoveInstanceAttrComplete(UInt32 inAttrIndex, QTSSDictionaryMap* inMap)
 {
+    this->PrefsChanged();
+
     ContainerRef objectRef = GetContainerRef();
 	/* صһ,ָNAMEֵΪinPrefNameindexΪ0Tag */
     ContainerRef pref = fPrefsSource->GetPrefRefByName( objectRef, inMap->GetAttrName(inAttrIndex));
@@ -386,6 +439,7 @@ void QTSSPrefs::SetValueComplete(UInt32 inAttrIndex, QTSSDictionaryMap* inMap,
                                     UInt32 inValueIndex, void* inNewValue, UInt32 inNewValueLen)
 {
     ContainerRef objectRef = GetContainerRef();
+    Bool16 isNewPref = (fPrefsSource->GetPrefRefByName(objectRef, inMap->GetAttrName(inAttrIndex)) == NULL);
 	/* ֵָ͵Tag,TagǶ,ظTag */
     ContainerRef pref = fPrefsSource->AddPref(objectRef, inMap->GetAttrName(inAttrIndex), QTSSDataConverter::TypeToTypeString(inMap->GetAttrType(inAttrIndex)));
     
@@ -403,9 +457,26 @@ void QTSSPrefs::SetValueComplete(UInt32 inAttrIndex, QTSSDictionaryMap* inMap,
     else
     {
         OSCharArrayDeleter theValueAsString(QTSSDataConverter::ValueToString(inNewValue, inNewValueLen, inMap->GetAttrType(inAttrIndex)));
+
+        // Modules set an empty string pref to its default on every reread, as it
+        // reads as missing. When the file already has the value nothing changed,
+        // and there is nothing to write. An empty PREF is one empty value here.
+        static char sEmptyValue[] = "";
+        char* thePrefName = NULL;
+        char* thePrefType = NULL;
+        char* theFileValue = fPrefsSource->GetPrefValueByRef(pref, inValueIndex, &thePrefName, &thePrefType);
+        if ((theFileValue == NULL) && (inValueIndex == 0) && (fPrefsSource->GetNumPrefValues(pref) == 0))
+            theFileValue = sEmptyValue;
+        char* theNewValue = theValueAsString.GetObject();
+        if (theNewValue == NULL)
+            theNewValue = sEmptyValue;
+        if (!isNewPref && (theFileValue != NULL) && (::strcmp(theFileValue, theNewValue) == 0))
+            return;
+
         /* ָindexTagTagֵ(ֵTag) */
 		fPrefsSource->SetPrefValue(pref, inValueIndex, theValueAsString.GetObject());
     }
+    this->PrefsChanged();
 
 	/* ָдxmlļ,,¼־ */
     if (fPrefsSource->WritePrefsFile())
@@ -37,13 +37,18 @@ class QTSSPrefs : public QTSSDictionary
                     QTSSPrefs* parentDictionary = NULL );
         virtual ~QTSSPrefs() { if (fPrefName != NULL) delete [] fPrefName; }
         
-        //This is callable at any time, and is thread safe wrt to the accessors
+        //This is callable at any time, and is thread safe wrt to the accessors.
+        //Only the values that differ from the file are set.
         void        RereadPreferences();
         void        RereadObjectPreferences(ContainerRef container);
         
         
         // ACCESSORS
         OSMutex*       GetMutex() { return &fPrefsMutex; }  
+
+        // Goes up whenever a pref of this object, or of an object pref in it,
+        // changes, be it on a reread or through the API
+        UInt32         GetVersion() { return fVersion; }
         ContainerRef   GetContainerRefForObject(QTSSPrefs* object);
         ContainerRef   GetContainerRef();
         
@@ -53,6 +58,9 @@ class QTSSPrefs : public QTSSDictionary
         OSMutex         fPrefsMutex;       //Ԥֵļ
         char*           fPrefName;         //ģԤֵļ
         QTSSPrefs*      fParentDictionary; //Ԥֵ(ָһԤֵĿ¼)
+        unsigned int    fVersion;          //atomic_add takes an unsigned int
+        
+        void PrefsChanged();
     
         // SET PREF VALUES FROM FILE
         //
@@ -70,7 +78,8 @@ class QTSSPrefs : public QTSSDictionary
         // Places the specified value into the attribute with inAttrID, at inAttrIndex
         // index. This function does the conversion, and uses the converted size of the
         // value when setting the value. If you wish to override this size, specify inValueSize,
-        // otherwise it can be 0.
+        // otherwise it can be 0. A value that is already the same is left alone, so
+        // readers never see an unchanged pref being rewritten.
         void SetPrefValue(QTSS_AttributeID inAttrID, UInt32 inAttrIndex,
                          char* inPrefValue, QTSS_AttrDataType inPrefType, UInt32 inValueSize = 0);
 
@@ -21,6 +21,9 @@ LastUpdate:  2010-08-16
 #include "MyAssert.h"
 #include "OSMemory.h"
 #include "defaultPaths.h"
+#include "OSArrayObjectDeleter.h"
+#include "OSTrace.h"
+#include "RTPCongestionController.h"
 
 #include <sys/types.h>
 #include <netinet/in.h>
@@ -122,7 +125,15 @@ QTSSAttrInfoDict::AttrInfo  QTSServerPrefs::sAttributes[] =
     /* 68 */ { "force_logs_close_on_write",             NULL,                   qtssAttrDataTypeBool16,     qtssAttrModeRead | qtssAttrModeWrite },
     /* 69 */ { "disable_thinning",                      NULL,                   qtssAttrDataTypeBool16,     qtssAttrModeRead | qtssAttrModeWrite },
 	/* 70 */ { "player_requires_rtp_header_info",		NULL,					qtssAttrDataTypeCharArray,	qtssAttrModeRead | qtssAttrModeWrite },
-	/* 71 */ { "player_requires_bandwidth_adjustment",	NULL,					qtssAttrDataTypeCharArray,	qtssAttrModeRead | qtssAttrModeWrite }
+	/* 71 */ { "player_requires_bandwidth_adjustment",	NULL,					qtssAttrDataTypeCharArray,	qtssAttrModeRead | qtssAttrModeWrite },
+    /* 72 */ { "stats_shared_memory_file",              NULL,                   qtssAttrDataTypeCharArray,  qtssAttrModeRead | qtssAttrModeWrite },
+    /* 73 */ { "trace_levels",                          NULL,                   qtssAttrDataTypeCharArray,  qtssAttrModeRead | qtssAttrModeWrite },
+    /* 74 */ { "reliable_udp_congestion_control",       NULL,                   qtssAttrDataTypeCharArray,  qtssAttrModeRead | qtssAttrModeWrite },
+    /* 75 */ { "enable_rtp_pacing",                     NULL,                   qtssAttrDataTypeBool16,     qtssAttrModeRead | qtssAttrModeWrite },
+    /* 76 */ { "rtp_pacing_use_txtime",                 NULL,                   qtssAttrDataTypeBool16,     qtssAttrModeRead | qtssAttrModeWrite },
+    /* 77 */ { "enable_rtp_session_groups",             NULL,                   qtssAttrDataTypeBool16,     qtssAttrModeRead | qtssAttrModeWrite },
+    /* 78 */ { "interleaved_send_queue_bytes",          NULL,                   qtssAttrDataTypeUInt32,     qtssAttrModeRead | qtssAttrModeWrite },
+    /* 79 */ { "rtp_socket_pairs_per_address",          NULL,                   qtssAttrDataTypeUInt32,     qtssAttrModeRead | qtssAttrModeWrite }
     
 
 };
@@ -210,7 +221,15 @@ QTSServerPrefs::PrefInfo QTSServerPrefs::sPrefInfo[] =
 	{ kDontAllowMultipleValues, "false",    NULL                    },  //force_logs_close_on_write,־ÿд󲢲ر
 	{ kDontAllowMultipleValues, "false",    NULL                    },  //disable_thinning,ĬϿԱ
 	{ kAllowMultipleValues,     "Nokia",    sRTP_Header_Players     },  //players_requires_rtp_header_info
-	{ kAllowMultipleValues,     "Nokia",    sAdjust_Bandwidth_Players}  //players_requires_bandwidth_adjustment
+	{ kAllowMultipleValues,     "Nokia",    sAdjust_Bandwidth_Players}, //players_requires_bandwidth_adjustment
+	{ kDontAllowMultipleValues, DEFAULTPATHS_PID_DIR PLATFORM_SERVER_BIN_NAME ".stats",	NULL	},	//stats_shared_memory_file
+	{ kDontAllowMultipleValues, "all=warning",  NULL                },  //trace_levels
+	{ kDontAllowMultipleValues, "reno",     NULL                    },  //reliable_udp_congestion_control
+	{ kDontAllowMultipleValues, "true",     NULL                    },  //enable_rtp_pacing
+	{ kDontAllowMultipleValues, "false",    NULL                    },  //rtp_pacing_use_txtime
+	{ kDontAllowMultipleValues, "false",    NULL                    },  //enable_rtp_session_groups
+	{ kDontAllowMultipleValues, "131072",   NULL                    },  //interleaved_send_queue_bytes
+	{ kDontAllowMultipleValues, "1",        NULL                    }   //rtp_socket_pairs_per_address
 
 
 };
@@ -261,6 +280,12 @@ QTSServerPrefs::QTSServerPrefs(XMLPrefsParser* inPrefsSource, Bool16 inWriteMiss
     fSendIntervalInMsec(0),
     fMaxSendAheadTimeInSecs(0),
     fIsSlowStartEnabled(false),
+    fCongestionControl(RTPCongestionController::kReno),
+    fEnableRTPPacing(true),
+    fRTPPacingUseTxTime(false),
+    fEnableRTPSessionGroups(false),
+    fInterleavedSendQueueBytes(131072),
+    fRTPSocketPairsPerAddress(1),
     fAutoStart(false),
     fReliableUDP(true),/* RUDPʽ */
     fReliableUDPPrintfs(false),
@@ -360,6 +385,11 @@ void QTSServerPrefs::SetupAttributes()
 	this->SetVal(qtssPrefsDisableThinning,              &fDisableThinning,              sizeof(fDisableThinning));
     this->SetVal(qtssPrefsAutoDeleteSDPFiles,       &fauto_delete_sdp_files,    sizeof(fauto_delete_sdp_files));
     this->SetVal(qtssPrefsDeleteSDPFilesInterval,   &fsdp_file_delete_interval_seconds,   sizeof(fsdp_file_delete_interval_seconds));
+    this->SetVal(qtssPrefsEnableRTPPacing,          &fEnableRTPPacing,          sizeof(fEnableRTPPacing));
+    this->SetVal(qtssPrefsRTPPacingUseTxTime,       &fRTPPacingUseTxTime,       sizeof(fRTPPacingUseTxTime));
+    this->SetVal(qtssPrefsEnableRTPSessionGroups,   &fEnableRTPSessionGroups,   sizeof(fEnableRTPSessionGroups));
+    this->SetVal(qtssPrefsInterleavedSendQueueBytes, &fInterleavedSendQueueBytes, sizeof(fInterleavedSendQueueBytes));
+    this->SetVal(qtssPrefsRTPSocketPairsPerAddress, &fRTPSocketPairsPerAddress, sizeof(fRTPSocketPairsPerAddress));
    
 }
 
@@ -372,6 +402,7 @@ void QTSServerPrefs::RereadServerPreferences(Bool16 inWriteMissingPrefs)
 
 	//õԤֵֵ
     QTSSDictionaryMap* theMap = QTSSDictionaryMap::GetMap(QTSSDictionaryMap::kPrefsDictIndex);
+    Bool16 theFileChanged = false;
     
 	//б,Ԥֵļøָ
     for (UInt32 x = 0; x < theMap->GetNumAttrs(); x++)
@@ -428,6 +459,7 @@ void QTSServerPrefs::RereadServerPreferences(Bool16 inWriteMissingPrefs)
                     for (UInt32 a = 0; sPrefInfo[x].fAdditionalDefVals[a] != NULL; a++)
                         fPrefsSource->AddPrefValue(pref, sPrefInfo[x].fAdditionalDefVals[a]);
                 }
+                theFileChanged = true;
             }
             continue; //һ
         }
@@ -471,6 +503,7 @@ void QTSServerPrefs::RereadServerPreferences(Bool16 inWriteMissingPrefs)
                     for (UInt32 b = 0; sPrefInfo[x].fAdditionalDefVals[b] != NULL; b++)
                         fPrefsSource->AddPrefValue(pref, sPrefInfo[x].fAdditionalDefVals[b]);
                 }
+                theFileChanged = true;
             }
             continue;//һ
         }
@@ -491,13 +524,16 @@ void QTSServerPrefs::RereadServerPreferences(Bool16 inWriteMissingPrefs)
     this->UpdateAuthScheme();
     //ȡRTP/RTCPͷӡѡԤֵ,ݳԱfPacketHeaderPrintfOptions
     this->UpdatePrintfOptions();
+    this->UpdateTraceLevels();
+    this->UpdateCongestionControl();
 	//ݳԱfEnableRTSPErrMsgQTSSModuleUtils::sEnableRTSPErrorMsg
     QTSSModuleUtils::SetEnableRTSPErrorMsg(fEnableRTSPErrMsg);
     //ݳԱfCloseLogsOnWriteQTSSRollingLogеľ̬sCloseOnWrite
     QTSSRollingLog::SetCloseOnWrite(fCloseLogsOnWrite);
    
     // In case we made any changes, write out the prefs file,ԤֵдxmlԤֵļ
-    (void)fPrefsSource->WritePrefsFile();
+    if (theFileChanged)
+        (void)fPrefsSource->WritePrefsFile();
 }
 
 //ȵõ֤ʽԤֵ,ݳԱfAuthScheme
@@ -541,6 +577,26 @@ void QTSServerPrefs::UpdatePrintfOptions()
 
 }
 
+void QTSServerPrefs::UpdateTraceLevels()
+{
+    char* theSpec = this->GetStringPref(qtssPrefsTraceLevels);
+    OSCharArrayDeleter theSpecDeleter(theSpec);
+    OSTrace::SetLevels(theSpec);
+}
+
+void QTSServerPrefs::UpdateCongestionControl()
+{
+    char* theName = this->GetStringPref(qtssPrefsReliableUDPCongestionControl);
+    OSCharArrayDeleter theNameDeleter(theName);
+    StrPtrLen theNameStr(theName);
+
+    // Unknown names fall back to the original algorithm
+    UInt32 theType = RTPCongestionController::GetTypeFromName(&theNameStr);
+    if (theType == RTPCongestionController::kNumTypes)
+        theType = RTPCongestionController::kReno;
+    fCongestionControl = theType;
+}
+
 /* used in RTSPRequestInterface::RTSPRequestInterface() */
 // ??·仺,ṩĻδ?
 //ȻȡӰļ·,ٽָĻ沢(ṩĻ泤Ȳ,·ָȵĻ)
@@ -106,6 +106,12 @@ class QTSServerPrefs : public QTSSPrefs
         UInt32  GetSendIntervalInMsec()         { return fSendIntervalInMsec; }/* needed by RTPSession::run() */
         UInt32  GetMaxSendAheadTimeInSecs()     { return fMaxSendAheadTimeInSecs; }
         Bool16  IsSlowStartEnabled()            { return fIsSlowStartEnabled; }
+        UInt32  GetCongestionControl()          { return fCongestionControl; }/* see RTPCongestionController */
+        Bool16  IsRTPPacingEnabled()            { return fEnableRTPPacing; }/* see RTPPacer */
+        Bool16  GetRTPPacingUseTxTime()         { return fRTPPacingUseTxTime; }
+        Bool16  IsRTPSessionGroupsEnabled()     { return fEnableRTPSessionGroups; }/* see RTPSessionGroup */
+        UInt32  GetInterleavedSendQueueBytes()  { return fInterleavedSendQueueBytes; }/* see RTSPInterleavedQueue */
+        UInt32  GetRTPSocketPairsPerAddress()   { return fRTPSocketPairsPerAddress; }/* see QTSServer::SetupUDPSockets */
 		UInt32  IsReliableUDPEnabled()          { return fReliableUDP; }
         Bool16  GetReliableUDPPrintfsEnabled()  { return fReliableUDPPrintfs; }
         Bool16  GetRTSPDebugPrintfs()           { return fEnableRTSPDebugPrintfs; }
@@ -180,6 +186,9 @@ class QTSServerPrefs : public QTSSPrefs
         char*   GetStatsMonitorFileName()
             { return this->GetStringPref(qtssPrefsMonitorStatsFileName); }
 
+        char*   GetStatsSharedMemoryFile()
+            { return this->GetStringPref(qtssPrefsStatsSharedMemoryFile); }
+
         
     private: //58Ԥֵ
 
@@ -226,6 +235,12 @@ class QTSServerPrefs : public QTSSPrefs
         UInt32  fSendIntervalInMsec;           //ͰС(ms), needed by RTPSession::run() 
         UInt32  fMaxSendAheadTimeInSecs;       //ǰͰʱ(25s)
 		Bool16  fIsSlowStartEnabled;           //RUDPǷ?
+        UInt32  fCongestionControl;            //RUDP congestion control algorithm, RTPCongestionController::kReno etc.
+        Bool16  fEnableRTPPacing;              //pace UDP and RUDP streams, see RTPPacer
+        Bool16  fRTPPacingUseTxTime;           //hand short pacing waits to the kernel with SO_TXTIME
+        Bool16  fEnableRTPSessionGroups;       //send packets of many RTPSessions from one Task
+        UInt32  fInterleavedSendQueueBytes;    //per RTSP connection, 0 for no interleaved queue
+        UInt32  fRTPSocketPairsPerAddress;     //read at startup only
         Bool16  fAutoStart;                    //Ƿ񿪻Զ?עstreamingserver.xmlû!!If true, streaming server likes to be started at system startup
         Bool16  fReliableUDP;                  //ǷRUDP?
         Bool16  fReliableUDPPrintfs;           //ǷʹRUDPӡ?
@@ -279,6 +294,8 @@ class QTSServerPrefs : public QTSSPrefs
         void SetupAttributes();
         void UpdateAuthScheme();
         void UpdatePrintfOptions();
+        void UpdateTraceLevels();
+        void UpdateCongestionControl();
         
         // Returns the string preference with the specified ID. If there
         // was any problem, this will return an empty string.
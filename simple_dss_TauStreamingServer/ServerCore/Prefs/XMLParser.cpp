@@ -50,19 +50,18 @@ XMLParser::~XMLParser()
 /* xmlļ,tagϷ,ɹtrue,ʧܷfalse */
 Bool16 XMLParser::ParseFile(char* errorBuffer, int errorBufferSize)
 {
-    if (fRootTag != NULL)
-    {
-        delete fRootTag;    // flush old data
-        fRootTag = NULL;
-    }
-
-    int fd = -1;
-	fd = ::open(fFilePath, O_RDONLY | O_LARGEFILE);
-
 	/* ļС */
     if (errorBufferSize < 500) 
 		errorBuffer = NULL;  // Just a hack to avoid checking everywhere
 
+    // The file may have been edited since the last parse
+    struct stat filestat;
+    if (::stat(fFilePath, &filestat) == 0)
+    {
+        fFileLen = filestat.st_size;
+        fIsDir = S_ISDIR(filestat.st_mode);
+    }
+
 	/*  */
     if ((fFileLen == 0) || fIsDir)
     {
@@ -70,11 +69,20 @@ Bool16 XMLParser::ParseFile(char* errorBuffer, int errorBufferSize)
             qtss_sprintf(errorBuffer, "Couldn't read xml file");
         return false;   // we don't have a valid file;
     }
+
+    int fd = -1;
+	fd = ::open(fFilePath, O_RDONLY | O_LARGEFILE);
+    if (fd == -1)
+    {
+        if (errorBuffer != NULL)
+            qtss_sprintf(errorBuffer, "Couldn't read xml file");
+        return false;
+    }
     
 	/* ļĻ */
     char* fileData = new char[ (SInt32) (fFileLen + 1)];
     UInt64 theLengthRead = 0;
-    ::memset(fileData,0,strlen(fileData));
+    ::memset(fileData, 0, (SInt32) (fFileLen + 1));
 	
 	while (theLengthRead < fFileLen)
 	{
@@ -87,6 +95,8 @@ Bool16 XMLParser::ParseFile(char* errorBuffer, int errorBufferSize)
 		else
 		{
 			printf("read data failed, real read data len %lu \n",theLengthRead);
+            delete [] fileData;
+            ::close(fd);
 			return false;
 		}
 
@@ -98,18 +108,16 @@ Bool16 XMLParser::ParseFile(char* errorBuffer, int errorBufferSize)
     StrPtrLen theDataPtr(fileData, theLengthRead);
     StringParser theParser(&theDataPtr);
     
-	/* ½root tagʵ */
-    fRootTag = new XMLTag();
-    Bool16 result = fRootTag->ParseTag(&theParser, fVerifier, errorBuffer, errorBufferSize);
-    if (!result)
-    {
-        // got error parsing file
-        delete fRootTag;
-        fRootTag = NULL;
-    }
+	/* ½root tagʵ,ɹ滻ԭ,ʱԱϴν */
+    XMLTag* theRootTag = new XMLTag();
+    Bool16 result = theRootTag->ParseTag(&theParser, fVerifier, errorBuffer, errorBufferSize);
+    if (result)
+        this->SetRootTag(theRootTag);
+    else
+        delete theRootTag; // got error parsing file, keep the prefs we had
     
 	//ͷڴ
-    delete fileData;
+    delete [] fileData;
     
 	//رxmlļ,ò
 	::close(fd);
@@ -519,6 +527,17 @@ XMLTag* XMLTag::GetEmbeddedTag(const UInt32 index)
     return (XMLTag*)result->GetEnclosingObject();
 }
 
+/* ҵǶTagָTagһTag */
+XMLTag* XMLTag::GetNextEmbeddedTag(XMLTag* tag)
+{
+    OSQueueIter iter(&fEmbeddedTags, &tag->fElem);
+    iter.Next();
+    if (iter.IsDone())
+        return NULL;
+    
+    return (XMLTag*)iter.GetCurrent()->GetEnclosingObject();
+}
+
 /* ǶTag,ָindexTag */
 XMLTag* XMLTag::GetEmbeddedTagByName(const char* tagName, const UInt32 index)
 {
@@ -694,7 +713,7 @@ void XMLTag::FormatData(ResizeableStringFormatter* formatter, UInt32 indent)
 	/* ΪTag */
     if (fEmbeddedTags.GetLength() == 0)
     {
-        if (fValue > 0)
+        if (fValue != NULL)
             formatter->Put(fValue);
     }
     else/* ΪǶTag */
@@ -58,6 +58,7 @@ public:
     UInt32 GetNumEmbeddedTags() { return fEmbeddedTags.GetLength(); }
     
     XMLTag* GetEmbeddedTag(const UInt32 index = 0);
+    XMLTag* GetNextEmbeddedTag(XMLTag* tag);   // NULL after the last
     XMLTag* GetEmbeddedTagByName(const char* tagName, const UInt32 index = 0);
     XMLTag* GetEmbeddedTagByAttr(const char* attrName, const char* attrValue, const UInt32 index = 0);
     XMLTag* GetEmbeddedTagByNameAndAttr(const char* tagName, const char* attrName, const char* attrValue, const UInt32 index = 0);
@@ -71,11 +71,25 @@ static char* kFileHeader[] =
 };
 
 XMLPrefsParser::XMLPrefsParser(char* inPath)
-:   XMLParser(inPath)
+:   XMLParser(inPath),
+    fIndex(NULL),
+    fIndexValid(false),
+    fNumBuckets(0),
+    fNameBuckets(NULL),
+    fContainerBuckets(NULL),
+    fEntries(NULL),
+    fNumEntries(0),
+    fMaxEntries(0),
+    fContainers(NULL),
+    fNumContainers(0),
+    fMaxContainers(0),
+    fServerRef(NULL)
 {}
 
 XMLPrefsParser::~XMLPrefsParser()
-{}
+{
+    delete [] fIndex;
+}
 
 /* õfRootTag,ûоһXMLTag,ΪfRootTag,fRootTag */
 ContainerRef XMLPrefsParser::GetConfigurationTag()
@@ -85,6 +99,7 @@ ContainerRef XMLPrefsParser::GetConfigurationTag()
     {
         result = new XMLTag(kMainTag);
         SetRootTag(result);
+        this->InvalidateIndex();
     }
     
     return result;
@@ -96,12 +111,21 @@ ContainerRef XMLPrefsParser::GetRefForModule(char* inModuleName, Bool16 create)
     if (inModuleName == NULL)
         return GetRefForServer();
     
-    ContainerRef result = GetConfigurationTag()->GetEmbeddedTagByNameAndAttr(kModule, kNameAttr, inModuleName);
+    ContainerRef theRoot = GetConfigurationTag();
+    ContainerRef result = NULL;
+    if (this->UpdateIndex())
+        result = this->FindIndexEntry(theRoot, inModuleName, kModule);
+    else
+        result = theRoot->GetEmbeddedTagByNameAndAttr(kModule, kNameAttr, inModuleName);
+    
     if (result == NULL)
     {
         result = new XMLTag(kModule);
         result->AddAttribute( kNameAttr, (char*)inModuleName);
         GetRootTag()->AddEmbeddedTag(result);
+        
+        if (!this->AddIndexEntry(theRoot, result) || !this->AddIndexContainer(result))
+            this->InvalidateIndex();
     }
     
     return result;
@@ -110,16 +134,211 @@ ContainerRef XMLPrefsParser::GetRefForModule(char* inModuleName, Bool16 create)
 /* fRootTag»ȡTag SERVER,ûо */
 ContainerRef XMLPrefsParser::GetRefForServer()
 {
-    ContainerRef result = GetConfigurationTag()->GetEmbeddedTagByName(kServer);
+    ContainerRef theRoot = GetConfigurationTag();
+    ContainerRef result = NULL;
+    if (this->UpdateIndex())
+        result = fServerRef;
+    else
+        result = theRoot->GetEmbeddedTagByName(kServer);
+    
     if (result == NULL)
     {
         result = new XMLTag(kServer);
         GetRootTag()->AddEmbeddedTag(result);
+        
+        if (this->AddIndexEntry(theRoot, result) && this->AddIndexContainer(result))
+            fServerRef = result;
+        else
+            this->InvalidateIndex();
     }
     
     return result;
 }
 
+/* жϸTagµTagǷΪԤֵ() */
+Bool16 XMLPrefsParser::IsIndexContainer(ContainerRef inTag)
+{
+    char* theTagName = inTag->GetTagName();
+    return (!strcmp(theTagName, kServer) || !strcmp(theTagName, kModule) || !strcmp(theTagName, kObject));
+}
+
+/* FNV-1a */
+UInt32 XMLPrefsParser::HashName(const char* inName)
+{
+    UInt32 theHash = 2166136261U;
+    for (const UInt8* theChar = (const UInt8*)inName; *theChar != '\0'; theChar++)
+    {
+        theHash ^= *theChar;
+        theHash = (theHash * 16777619U) & 0xFFFFFFFF;
+    }
+    return theHash;
+}
+
+/* ͳҪTagTag */
+void XMLPrefsParser::CountIndexTags(ContainerRef inTag, UInt32* ioNumEntries, UInt32* ioNumContainers)
+{
+    Bool16 isContainer = (inTag == GetRootTag()) || IsIndexContainer(inTag);
+    if (isContainer)
+    {
+        *ioNumEntries += inTag->GetNumEmbeddedTags();
+        *ioNumContainers += 1;
+    }
+    
+    // Objects can be inside a LIST-OBJECT, values of a LIST-PREF have no prefs under them
+    if (isContainer || !strcmp(inTag->GetTagName(), kObjectList))
+    {
+        for (UInt32 x = 0; x < inTag->GetNumEmbeddedTags(); x++)
+            this->CountIndexTags(inTag->GetEmbeddedTag(x), ioNumEntries, ioNumContainers);
+    }
+}
+
+/* ȰѸTagTagμӽ,ټµTag */
+void XMLPrefsParser::IndexTags(ContainerRef inTag)
+{
+    Bool16 isContainer = (inTag == GetRootTag()) || IsIndexContainer(inTag);
+    if (!isContainer && strcmp(inTag->GetTagName(), kObjectList))
+        return;
+    
+    if (isContainer)
+    {
+        (void)this->AddIndexContainer(inTag);
+        for (XMLTag* theTag = inTag->GetEmbeddedTag(); theTag != NULL; theTag = inTag->GetNextEmbeddedTag(theTag))
+            (void)this->AddIndexEntry(inTag, theTag);
+    }
+    
+    for (XMLTag* theTag = inTag->GetEmbeddedTag(); theTag != NULL; theTag = inTag->GetNextEmbeddedTag(theTag))
+        this->IndexTags(theTag);
+}
+
+/* ѹʱ,ؽ.ûfRootTagʱfalse */
+Bool16 XMLPrefsParser::UpdateIndex()
+{
+    if (fIndexValid)
+        return true;
+    
+    ContainerRef theRoot = GetRootTag();
+    if (theRoot == NULL)
+        return false;
+    
+    UInt32 theNumEntries = 0;
+    UInt32 theNumContainers = 0;
+    this->CountIndexTags(theRoot, &theNumEntries, &theNumContainers);
+    
+    // Leave room for the defaults and modules added at startup
+    fMaxEntries = theNumEntries * 2 + kMinIndexEntries;
+    fMaxContainers = theNumContainers * 2 + kMinIndexEntries;
+    fNumBuckets = 1;
+    while (fNumBuckets < fMaxEntries * 2)
+        fNumBuckets <<= 1;
+    
+    delete [] fIndex;
+    fIndex = NEW char[(fMaxEntries * sizeof(IndexEntry)) + (fMaxContainers * sizeof(IndexContainer)) + (2 * fNumBuckets * sizeof(UInt32))];
+    fEntries = (IndexEntry*)fIndex;
+    fContainers = (IndexContainer*)(fEntries + fMaxEntries);
+    fNameBuckets = (UInt32*)(fContainers + fMaxContainers);
+    fContainerBuckets = fNameBuckets + fNumBuckets;
+    for (UInt32 x = 0; x < fNumBuckets; x++)
+    {
+        fNameBuckets[x] = kNoEntry;
+        fContainerBuckets[x] = kNoEntry;
+    }
+    
+    fNumEntries = 0;
+    fNumContainers = 0;
+    fIndexValid = true;
+    this->IndexTags(theRoot);
+    
+    fServerRef = theRoot->GetEmbeddedTagByName(kServer);
+    return true;
+}
+
+/* Tag,ûзNULL */
+XMLPrefsParser::IndexContainer* XMLPrefsParser::FindIndexContainer(ContainerRef inContainer)
+{
+    for (UInt32 x = fContainerBuckets[this->GetContainerBucket(inContainer)]; x != kNoEntry; x = fContainers[x].fNext)
+    {
+        if (fContainers[x].fContainer == inContainer)
+            return &fContainers[x];
+    }
+    return NULL;
+}
+
+/* Tag²ָNAMEֵ(Tag)ĵһTag */
+ContainerRef XMLPrefsParser::FindIndexEntry(ContainerRef inContainer, const char* inName, const char* inTagName)
+{
+    UInt32 theHash = HashName(inName);
+    UInt32 theFirst = kNoEntry;
+    
+    // A bucket lists the newest first, the file's first of a name is the lowest
+    for (UInt32 x = fNameBuckets[this->GetNameBucket(inContainer, theHash)]; x != kNoEntry; x = fEntries[x].fNext)
+    {
+        IndexEntry* theEntry = &fEntries[x];
+        if ((theEntry->fHash == theHash) && (theEntry->fContainer == inContainer) && !strcmp(theEntry->fName, inName)
+            && ((inTagName == NULL) || !strcmp(theEntry->fTag->GetTagName(), inTagName)))
+            theFirst = x;
+    }
+    
+    if (theFirst == kNoEntry)
+        return NULL;
+    return fEntries[theFirst].fTag;
+}
+
+/* һTag,Tag.ЧʱʲôҲ,˷false */
+Bool16 XMLPrefsParser::AddIndexContainer(ContainerRef inContainer)
+{
+    if (!fIndexValid)
+        return true;
+    if (fNumContainers == fMaxContainers)
+        return false;
+    
+    IndexContainer* theContainer = &fContainers[fNumContainers];
+    theContainer->fContainer = inContainer;
+    theContainer->fFirstEntry = fNumEntries;
+    theContainer->fNumEntries = 0;
+    
+    UInt32 theBucket = this->GetContainerBucket(inContainer);
+    theContainer->fNext = fContainerBuckets[theBucket];
+    fContainerBuckets[theBucket] = fNumContainers++;
+    return true;
+}
+
+/* Tag¼ӵһTagӽ.ЧʱʲôҲ,˷false */
+Bool16 XMLPrefsParser::AddIndexEntry(ContainerRef inContainer, ContainerRef inTag)
+{
+    if (!fIndexValid)
+        return true;
+    
+    IndexContainer* theContainer = this->FindIndexContainer(inContainer);
+    if (theContainer == NULL)
+        return true;
+    if (fNumEntries == fMaxEntries)
+        return false;
+    
+    // Still one run if nothing was added after this container's tags
+    if (theContainer->fNumEntries == 0)
+        theContainer->fFirstEntry = fNumEntries;
+    if ((theContainer->fNumEntries != kNotContiguous) && (theContainer->fFirstEntry + theContainer->fNumEntries == fNumEntries))
+        theContainer->fNumEntries++;
+    else
+        theContainer->fNumEntries = kNotContiguous;
+    
+    IndexEntry* theEntry = &fEntries[fNumEntries];
+    theEntry->fContainer = inContainer;
+    theEntry->fTag = inTag;
+    theEntry->fName = inTag->GetAttributeValue(kNameAttr);
+    theEntry->fHash = 0;
+    theEntry->fNext = kNoEntry;
+    if (theEntry->fName != NULL)
+    {
+        theEntry->fHash = HashName(theEntry->fName);
+        UInt32 theBucket = this->GetNameBucket(inContainer, theEntry->fHash);
+        theEntry->fNext = fNameBuckets[theBucket];
+        fNameBuckets[theBucket] = fNumEntries;
+    }
+    fNumEntries++;
+    return true;
+}
+
 /* ȡTag PREF,Tagֵ;򷵻Tag OBJECTEMPTY-OBJECTֵ;
 ûиTag,ͷǶTagܸ */
 UInt32 XMLPrefsParser::GetNumPrefValues(ContainerRef pref)
@@ -155,7 +374,7 @@ char* XMLPrefsParser::GetPrefValueByIndex(ContainerRef container, const UInt32 i
         *outDataType = NULL;
 
 	/* õָǶʽTag */
-    XMLTag* pref = container->GetEmbeddedTag(inPrefsIndex);
+    XMLTag* pref = GetPrefRefByIndex(container, inPrefsIndex);
     if (pref == NULL)
         return NULL;
         
@@ -216,6 +435,9 @@ ContainerRef XMLPrefsParser::GetObjectValue(ContainerRef pref, const UInt32 inVa
 ContainerRef XMLPrefsParser::GetPrefRefByName( ContainerRef container,
                                                     const char* inPrefName)
 {
+    if (this->UpdateIndex() && (this->FindIndexContainer(container) != NULL))
+        return this->FindIndexEntry(container, inPrefName, NULL);
+        
     return container->GetEmbeddedTagByAttr(kNameAttr, inPrefName);
 }
 
@@ -223,6 +445,17 @@ ContainerRef XMLPrefsParser::GetPrefRefByName( ContainerRef container,
 ContainerRef XMLPrefsParser::GetPrefRefByIndex( ContainerRef container,
                                                     const UInt32 inPrefsIndex)
 {
+    IndexContainer* theContainer = NULL;
+    if (this->UpdateIndex())
+        theContainer = this->FindIndexContainer(container);
+        
+    if ((theContainer != NULL) && (theContainer->fNumEntries != kNotContiguous))
+    {
+        if (inPrefsIndex >= theContainer->fNumEntries)
+            return NULL;
+        return fEntries[theContainer->fFirstEntry + inPrefsIndex].fTag;
+    }
+    
     return container->GetEmbeddedTag(inPrefsIndex);
 }
 
@@ -231,7 +464,7 @@ ContainerRef XMLPrefsParser::AddPref( ContainerRef container, char* inPrefName,
                                       char* inPrefDataType )
 {
 	/* ָNAMEֵΪinPrefNameindexΪ0Tag */
-    XMLTag* pref = container->GetEmbeddedTagByAttr(kNameAttr, inPrefName);
+    XMLTag* pref = GetPrefRefByName(container, inPrefName);
     if (pref != NULL)
         return pref;    // it already exists
     
@@ -250,6 +483,8 @@ ContainerRef XMLPrefsParser::AddPref( ContainerRef container, char* inPrefName,
     
 	/* ǶʽTag */
     container->AddEmbeddedTag(pref);
+    if (!this->AddIndexEntry(container, pref))
+        this->InvalidateIndex();
     
     return pref;
 }
@@ -294,6 +529,9 @@ void XMLPrefsParser::AddPrefValue( ContainerRef pref, char* inNewValue)
 /* ָTagΪOBJECT Tag */
 void XMLPrefsParser::AddNewObject( ContainerRef pref )
 {
+    // The pref becomes a container, or its prefs move down a level
+    this->InvalidateIndex();
+    
 	/* Ϊ"EMPTY-OBJECT",ΪOBJECT */
     if (!strcmp(pref->GetTagName(), kEmptyObject))
     {
@@ -364,6 +602,9 @@ void XMLPrefsParser::RemovePrefValue( ContainerRef pref, const UInt32 inValueInd
     UInt32 numValues = GetNumPrefValues(pref);
     if (inValueIndex >= numValues)
         return;
+    
+    // This deletes tags, or moves prefs up a level
+    this->InvalidateIndex();
         
     if (numValues == 1)
     {
@@ -406,6 +647,7 @@ void XMLPrefsParser::RemovePrefValue( ContainerRef pref, const UInt32 inValueInd
 /* ɾָXMLTag */
 void XMLPrefsParser::RemovePref( ContainerRef pref )
 {
+    this->InvalidateIndex();
     delete pref;
 }
 
@@ -420,6 +662,7 @@ int XMLPrefsParser::Parse()
         qtss_printf("%s\n", error);
         return -1;
     }
+    this->InvalidateIndex();
     
     
     
@@ -102,6 +102,70 @@ class XMLPrefsParser : public XMLParser
     private:
         
         XMLTag*     GetConfigurationTag();
+
+        //
+        // INDEX
+        //
+        // Startup and every reread look prefs up by name and by position
+        // for each module, which walking the tag lists makes quadratic. The
+        // index has, in one allocation, the tags under the server, the
+        // modules and the objects in file order, each container's as one
+        // run, and those with a NAME hashed by (container, name). It is
+        // built on the first lookup after a parse, follows added prefs and
+        // modules, and is rebuilt after anything is removed or moved.
+        
+        enum
+        {
+            kNoEntry            = 0xFFFFFFFF,   //UInt32
+            kNotContiguous      = 0xFFFFFFFF,   //UInt32, a container whose tags are not one run any more
+            kMinIndexEntries    = 64            //UInt32
+        };
+        
+        struct IndexEntry
+        {
+            ContainerRef    fContainer;
+            ContainerRef    fTag;
+            char*           fName;          // its NAME attribute, NULL if it has none
+            UInt32          fHash;
+            UInt32          fNext;          // in the bucket
+        };
+        
+        struct IndexContainer
+        {
+            ContainerRef    fContainer;
+            UInt32          fFirstEntry;
+            UInt32          fNumEntries;    // kNotContiguous once a tag went elsewhere
+            UInt32          fNext;          // in the bucket
+        };
+        
+        void            InvalidateIndex()   { fIndexValid = false; }
+        Bool16          UpdateIndex();
+        void            CountIndexTags(ContainerRef inTag, UInt32* ioNumEntries, UInt32* ioNumContainers);
+        void            IndexTags(ContainerRef inTag);
+        IndexContainer* FindIndexContainer(ContainerRef inContainer);
+        ContainerRef    FindIndexEntry(ContainerRef inContainer, const char* inName, const char* inTagName);
+        Bool16          AddIndexContainer(ContainerRef inContainer);
+        Bool16          AddIndexEntry(ContainerRef inContainer, ContainerRef inTag);
+        
+        static Bool16   IsIndexContainer(ContainerRef inTag);
+        static UInt32   HashName(const char* inName);
+        UInt32          GetNameBucket(ContainerRef inContainer, UInt32 inHash)
+                            { return (inHash ^ (UInt32)(((UInt32)inContainer >> 4) * 2654435761U)) & (fNumBuckets - 1); }
+        UInt32          GetContainerBucket(ContainerRef inContainer)
+                            { return (UInt32)(((UInt32)inContainer >> 4) * 2654435761U) & (fNumBuckets - 1); }
+        
+        char*           fIndex;             // all of the below
+        Bool16          fIndexValid;
+        UInt32          fNumBuckets;        // a power of two, for names and containers both
+        UInt32*         fNameBuckets;
+        UInt32*         fContainerBuckets;
+        IndexEntry*     fEntries;
+        UInt32          fNumEntries;
+        UInt32          fMaxEntries;
+        IndexContainer* fContainers;
+        UInt32          fNumContainers;
+        UInt32          fMaxContainers;
+        ContainerRef    fServerRef;
 };
 
 #endif //__XML_PREFS_PARSER__
@@ -80,6 +80,31 @@ QTSS_Error  QTSSCallbacks::QTSS_AddRole(QTSS_Role inRole)
     return theState->curModule->AddRole(inRole);
 }
 
+QTSS_Error  QTSSCallbacks::QTSS_AddRoleMethod(QTSS_Role inRole, QTSS_RTSPMethod inMethod)
+{
+    QTSS_ModuleState* theState = (QTSS_ModuleState*)OSThread::GetMainThreadData();
+    if (OSThread::GetCurrent() != NULL)
+        theState = (QTSS_ModuleState*)OSThread::GetCurrent()->GetThreadData();
+        
+    // Like the roles, the dispatch tables are built from these after the Register role
+    if ((theState == NULL) ||  (theState->curRole != QTSS_Register_Role))
+        return QTSS_OutOfState;
+        
+    return theState->curModule->AddRoleMethod(inRole, inMethod);
+}
+
+QTSS_Error  QTSSCallbacks::QTSS_AddRoleURLPrefix(QTSS_Role inRole, const char* inURLPrefix)
+{
+    QTSS_ModuleState* theState = (QTSS_ModuleState*)OSThread::GetMainThreadData();
+    if (OSThread::GetCurrent() != NULL)
+        theState = (QTSS_ModuleState*)OSThread::GetCurrent()->GetThreadData();
+        
+    if ((theState == NULL) ||  (theState->curRole != QTSS_Register_Role))
+        return QTSS_OutOfState;
+        
+    return theState->curModule->AddRoleURLPrefix(inRole, inURLPrefix);
+}
+
 
 
 QTSS_Error QTSSCallbacks::QTSS_LockObject(QTSS_Object inDictionary)
@@ -832,11 +857,10 @@ QTSS_Error  QTSSCallbacks::QTSS_Authenticate(const char* inAuthUserName, const c
             
     QTSS_Error theErr = QTSS_RequestFailed;
     
-    // There is only one module that is registered for the RTSP Authentication role
-    if (QTSServerInterface::GetNumModulesInRole(QTSSModule::kRTSPAthnRole) > 0)
-    {
-        theErr = QTSServerInterface::GetModule(QTSSModule::kRTSPAthnRole, 0)->CallDispatch(QTSS_RTSPAuthenticate_Role, &theAuthenticationParams);
-    }
+    // Only one module is invoked for the RTSP Authentication role, the first that takes the path
+    QTSSModule* theModule = QTSServerInterface::GetFirstModuleForPath(QTSSModule::kRTSPAthnRole, request->GetMethod(), request->GetValue(qtssRTSPReqFilePath));
+    if (theModule != NULL)
+        theErr = theModule->CallDispatch(QTSS_RTSPAuthenticate_Role, &theAuthenticationParams);
     
     // Reset the curTask to what it was before this role started
     if (theState != NULL)
@@ -871,9 +895,12 @@ QTSS_Error	QTSSCallbacks::QTSS_Authorize(QTSS_RTSPRequestObject inAuthRequestObj
     *outAuthUserAllowed = true;
     
     // Call all the modules that are registered for the RTSP Authorize Role 
-    for ( ; x < QTSServerInterface::GetNumModulesInRole(QTSSModule::kRTSPAuthRole); x++)
+    for ( ; x < QTSServerInterface::GetNumModulesInRole(QTSSModule::kRTSPAuthRole, request->GetMethod()); x++)
     {
-        theErr = QTSServerInterface::GetModule(QTSSModule::kRTSPAuthRole, x)->CallDispatch(QTSS_RTSPAuthorize_Role, &theParams);
+        QTSSModule* theModule = QTSServerInterface::GetModule(QTSSModule::kRTSPAuthRole, request->GetMethod(), x);
+        if (!theModule->RunsForPath(QTSSModule::kRTSPAuthRole, request->GetValue(qtssRTSPReqFilePath)))
+            continue;
+        theErr = theModule->CallDispatch(QTSS_RTSPAuthorize_Role, &theParams);
     
         // If any module sets allowed to false, exit the loop as authentication has been denied
         *outAuthUserAllowed = request->GetAllowed();    
@@ -37,6 +37,8 @@ class QTSSCallbacks
         // STARTUP ROUTINES
         
         static QTSS_Error   QTSS_AddRole(QTSS_Role inRole);
+        static QTSS_Error   QTSS_AddRoleMethod(QTSS_Role inRole, QTSS_RTSPMethod inMethod);
+        static QTSS_Error   QTSS_AddRoleURLPrefix(QTSS_Role inRole, const char* inURLPrefix);
 
         // DICTIONARY ROUTINES
         
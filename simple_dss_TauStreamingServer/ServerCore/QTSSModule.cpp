@@ -25,6 +25,7 @@ LastUpdate:  2010-08-16
 #include "QTSServerInterface.h"
 #include "OSArrayObjectDeleter.h"
 #include "OSMemory.h"
+#include "OS.h"
 #include "StringParser.h"
 #include "Socket.h"
 
@@ -33,6 +34,15 @@ Bool16  QTSSModule::sHasRTSPRequestModule = false;
 Bool16  QTSSModule::sHasOpenFileModule = false;
 Bool16  QTSSModule::sHasRTSPAuthenticateModule = false;
 
+// Names of the RoleIndex values, used in the latency histogram dumps
+char*   QTSSModule::sRoleNames[] =
+{
+    "Initialize", "Shutdown", "RTSPFilter", "RTSPRoute", "RTSPAuthenticate", "RTSPAuthorize",
+    "RTSPPreProcessor", "RTSPRequest", "RTSPPostProcessor", "RTSPSessionClosing", "RTPSendPackets",
+    "ClientSessionClosing", "RTCPProcess", "ErrorLog", "RereadPrefs", "OpenFile", "OpenFilePreProcess",
+    "AdviseFile", "ReadFile", "CloseFile", "RequestEventFile", "RTSPIncomingData", "StateChange", "Interval"
+};
+
 /* Ϣ,μQTSSDictionary.cppQTSSModule::Initialize() */
 /* QTSServerInterface::sAttributes[] */
 QTSSAttrInfoDict::AttrInfo  QTSSModule::sAttributes[] =
@@ -64,6 +74,8 @@ QTSSModule::QTSSModule(char* inName, char* inPath)
     fFragment(NULL),
     fDispatchFunc(NULL),
     fPrefs(NULL),
+    fPrefsVersionRead(0),
+    fServerPrefsVersionRead(0),
     fAttributes(NULL)
 {
 	/* öԪڶǱģʵ */
@@ -89,6 +101,10 @@ QTSSModule::QTSSModule(char* inName, char* inPath)
         this->SetValue(qtssModName, 0, inName, ::strlen(inName), QTSSDictionary::kDontObeyReadOnly);
                 
     ::memset(fRoleArray, 0, sizeof(fRoleArray));
+    ::memset(fRoleLatency, 0, sizeof(fRoleLatency));
+    ::memset(fRoleMethods, 0, sizeof(fRoleMethods));
+    ::memset(fRoleURLPrefixes, 0, sizeof(fRoleURLPrefixes));
+    ::memset(fNumRoleURLPrefixes, 0, sizeof(fNumRoleURLPrefixes));
     ::memset(&fModuleState, 0, sizeof(fModuleState));
 
 }
@@ -211,36 +227,12 @@ QTSS_Error  QTSSModule::AddRole(QTSS_Role inRole)
         return QTSS_RequestFailed;
 
 	/* ÿܵfRoleArray[kNumRoles] */
-    switch (inRole)
-    {
-        // Map actual QTSS Role names to our private enum values. Turn on the proper one in the role array 
-        case QTSS_Initialize_Role:          fRoleArray[kInitializeRole] = true;         break;
-        case QTSS_Shutdown_Role:            fRoleArray[kShutdownRole] = true;           break;
-        case QTSS_RTSPFilter_Role:          fRoleArray[kRTSPFilterRole] = true;         break;
-        case QTSS_RTSPRoute_Role:           fRoleArray[kRTSPRouteRole] = true;          break;
-        case QTSS_RTSPAuthenticate_Role:    fRoleArray[kRTSPAthnRole] = true;           break;
-        case QTSS_RTSPAuthorize_Role:       fRoleArray[kRTSPAuthRole] = true;           break;
-        case QTSS_RTSPPreProcessor_Role:    fRoleArray[kRTSPPreProcessorRole] = true;   break;
-        case QTSS_RTSPRequest_Role:         fRoleArray[kRTSPRequestRole] = true;        break;
-        case QTSS_RTSPPostProcessor_Role:   fRoleArray[kRTSPPostProcessorRole] = true;  break;
-        case QTSS_RTSPSessionClosing_Role:  fRoleArray[kRTSPSessionClosingRole] = true; break;
-        case QTSS_RTPSendPackets_Role:      fRoleArray[kRTPSendPacketsRole] = true;     break;
-        case QTSS_ClientSessionClosing_Role:fRoleArray[kClientSessionClosingRole] = true;break;
-        case QTSS_RTCPProcess_Role:         fRoleArray[kRTCPProcessRole] = true;        break;
-        case QTSS_ErrorLog_Role:            fRoleArray[kErrorLogRole] = true;           break;
-        case QTSS_RereadPrefs_Role:         fRoleArray[kRereadPrefsRole] = true;        break;
-        case QTSS_OpenFile_Role:            fRoleArray[kOpenFileRole] = true;           break;
-        case QTSS_OpenFilePreProcess_Role:  fRoleArray[kOpenFilePreProcessRole] = true; break;
-        case QTSS_AdviseFile_Role:          fRoleArray[kAdviseFileRole] = true;         break;
-        case QTSS_ReadFile_Role:            fRoleArray[kReadFileRole] = true;           break;
-        case QTSS_CloseFile_Role:           fRoleArray[kCloseFileRole] = true;          break;
-        case QTSS_RequestEventFile_Role:    fRoleArray[kRequestEventFileRole] = true;   break;
-        case QTSS_RTSPIncomingData_Role:    fRoleArray[kRTSPIncomingDataRole] = true;   break;      
-        case QTSS_StateChange_Role:         fRoleArray[kStateChangeRole] = true;        break;      
-        case QTSS_Interval_Role:            fRoleArray[kTimedIntervalRole] = true;      break;      
-        default:
-            return QTSS_BadArgument;
-    }
+    RoleIndex theIndex = QTSSModule::GetRoleIndex(inRole);
+    if (theIndex == kNumRoles)
+        return QTSS_BadArgument;
+    fRoleArray[theIndex] = true;
+    if (fRoleLatency[theIndex] == NULL)
+        fRoleLatency[theIndex] = NEW OSHistogram();
     
 	/*  */
     if (inRole == QTSS_RTSPRequest_Role)
@@ -301,3 +293,129 @@ SInt64 QTSSModule::Run()
 	
 	return 0;
   }  
+
+QTSSModule::RoleIndex QTSSModule::GetRoleIndex(QTSS_Role inRole)
+{
+    switch (inRole)
+    {
+        // Map actual QTSS Role names to our private enum values
+        case QTSS_Initialize_Role:          return kInitializeRole;
+        case QTSS_Shutdown_Role:            return kShutdownRole;
+        case QTSS_RTSPFilter_Role:          return kRTSPFilterRole;
+        case QTSS_RTSPRoute_Role:           return kRTSPRouteRole;
+        case QTSS_RTSPAuthenticate_Role:    return kRTSPAthnRole;
+        case QTSS_RTSPAuthorize_Role:       return kRTSPAuthRole;
+        case QTSS_RTSPPreProcessor_Role:    return kRTSPPreProcessorRole;
+        case QTSS_RTSPRequest_Role:         return kRTSPRequestRole;
+        case QTSS_RTSPPostProcessor_Role:   return kRTSPPostProcessorRole;
+        case QTSS_RTSPSessionClosing_Role:  return kRTSPSessionClosingRole;
+        case QTSS_RTPSendPackets_Role:      return kRTPSendPacketsRole;
+        case QTSS_ClientSessionClosing_Role:return kClientSessionClosingRole;
+        case QTSS_RTCPProcess_Role:         return kRTCPProcessRole;
+        case QTSS_ErrorLog_Role:            return kErrorLogRole;
+        case QTSS_RereadPrefs_Role:         return kRereadPrefsRole;
+        case QTSS_OpenFile_Role:            return kOpenFileRole;
+        case QTSS_OpenFilePreProcess_Role:  return kOpenFilePreProcessRole;
+        case QTSS_AdviseFile_Role:          return kAdviseFileRole;
+        case QTSS_ReadFile_Role:            return kReadFileRole;
+        case QTSS_CloseFile_Role:           return kCloseFileRole;
+        case QTSS_RequestEventFile_Role:    return kRequestEventFileRole;
+        case QTSS_RTSPIncomingData_Role:    return kRTSPIncomingDataRole;
+        case QTSS_StateChange_Role:         return kStateChangeRole;
+        case QTSS_Interval_Role:            return kTimedIntervalRole;
+        default:
+            return kNumRoles;
+    }
+}
+
+Bool16 QTSSModule::IsRequestRole(RoleIndex inIndex)
+{
+    switch (inIndex)
+    {
+        case kRTSPFilterRole:
+        case kRTSPRouteRole:
+        case kRTSPAthnRole:
+        case kRTSPAuthRole:
+        case kRTSPPreProcessorRole:
+        case kRTSPRequestRole:
+        case kRTSPPostProcessorRole:
+            return true;
+        default:
+            return false;
+    }
+}
+
+QTSS_Error QTSSModule::AddRoleMethod(QTSS_Role inRole, QTSS_RTSPMethod inMethod)
+{
+    RoleIndex theIndex = QTSSModule::GetRoleIndex(inRole);
+    if ((theIndex == kNumRoles) || !QTSSModule::IsRequestRole(theIndex) || !fRoleArray[theIndex])
+        return QTSS_BadArgument;
+    if (inMethod >= qtssNumMethods)
+        return QTSS_BadArgument;
+        
+    fRoleMethods[theIndex] |= 1 << inMethod;
+    return QTSS_NoErr;
+}
+
+QTSS_Error QTSSModule::AddRoleURLPrefix(QTSS_Role inRole, const char* inURLPrefix)
+{
+    RoleIndex theIndex = QTSSModule::GetRoleIndex(inRole);
+    if ((theIndex == kNumRoles) || !QTSSModule::IsRequestRole(theIndex) || !fRoleArray[theIndex])
+        return QTSS_BadArgument;
+    if ((inURLPrefix == NULL) || (inURLPrefix[0] != '/'))
+        return QTSS_BadArgument;
+    
+    // Only done while registering, so the array just grows by one
+    UInt32 theNumPrefixes = fNumRoleURLPrefixes[theIndex];
+    StrPtrLen* thePrefixes = NEW StrPtrLen[theNumPrefixes + 1];
+    for (UInt32 x = 0; x < theNumPrefixes; x++)
+        thePrefixes[x] = fRoleURLPrefixes[theIndex][x];
+    
+    StrPtrLen thePrefix((char*)inURLPrefix);
+    thePrefixes[theNumPrefixes].Set(thePrefix.GetAsCString(), thePrefix.Len);
+    
+    delete [] fRoleURLPrefixes[theIndex];
+    fRoleURLPrefixes[theIndex] = thePrefixes;
+    fNumRoleURLPrefixes[theIndex] = theNumPrefixes + 1;
+    return QTSS_NoErr;
+}
+
+Bool16 QTSSModule::MatchesURLPrefix(RoleIndex inIndex, StrPtrLen* inPath)
+{
+    if ((inPath == NULL) || (inPath->Ptr == NULL))
+        return false;
+        
+    for (UInt32 x = 0; x < fNumRoleURLPrefixes[inIndex]; x++)
+    {
+        StrPtrLen* thePrefix = &fRoleURLPrefixes[inIndex][x];
+        if ((inPath->Len >= thePrefix->Len) && (::memcmp(inPath->Ptr, thePrefix->Ptr, thePrefix->Len) == 0))
+            return true;
+    }
+    return false;
+}
+
+QTSS_Error  QTSSModule::CallDispatch(QTSS_Role inRole, QTSS_RoleParamPtr inParams)
+{
+    RoleIndex theIndex = QTSSModule::GetRoleIndex(inRole);
+    if ((theIndex == kNumRoles) || (fRoleLatency[theIndex] == NULL))
+        return (fDispatchFunc)(inRole, inParams);
+
+    SInt64 theStartTime = OS::Microseconds();
+    QTSS_Error theErr = (fDispatchFunc)(inRole, inParams);
+    fRoleLatency[theIndex]->AddSample(OS::Microseconds() - theStartTime);
+    return theErr;
+}
+
+void QTSSModule::FormatRoleLatency(StringFormatter* ioFormatter)
+{
+    StrPtrLen* theModuleName = this->GetValue(qtssModName);
+    for (RoleIndex x = 0; x < kNumRoles; x++)
+    {
+        if ((fRoleLatency[x] == NULL) || (fRoleLatency[x]->GetCount() == 0))
+            continue;
+
+        char theName[256];
+        qtss_snprintf(theName, sizeof(theName), "%.*s/%s", (int)theModuleName->Len, theModuleName->Ptr, sRoleNames[x]);
+        fRoleLatency[x]->Format(ioFormatter, theName);
+    }
+}
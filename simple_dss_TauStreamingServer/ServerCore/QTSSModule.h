@@ -30,6 +30,8 @@ LastUpdate:  2010-08-16
 #include "OSCodeFragment.h"
 #include "OSQueue.h"
 #include "StrPtrLen.h"
+#include "StringFormatter.h"
+#include "OSHistogram.h"
 
 class QTSSModule : public QTSSDictionary, public Task
 {
@@ -62,6 +64,14 @@ class QTSSModule : public QTSSDictionary, public Task
         // MODIFIERS
         void            SetPrefsDict(QTSSPrefs* inPrefs) { fPrefs = inPrefs; }
         void            SetAttributesDict(QTSSDictionary* inAttributes) { fAttributes = inAttributes; }
+
+        // The QTSSPrefs::GetVersion() of the module's and of the server's prefs
+        // when the module last read them, so QTSServer::RereadPrefsService only
+        // invokes modules whose prefs changed in the QTSS_RereadPrefs_Role
+        void            SetPrefsVersionsRead(UInt32 inPrefsVersion, UInt32 inServerPrefsVersion)
+                            { fPrefsVersionRead = inPrefsVersion; fServerPrefsVersionRead = inServerPrefsVersion; }
+        Bool16          PrefsVersionsChanged(UInt32 inPrefsVersion, UInt32 inServerPrefsVersion)
+                            { return (inPrefsVersion != fPrefsVersionRead) || (inServerPrefsVersion != fServerPrefsVersionRead); }
         
         // ACCESSORS
         
@@ -73,8 +83,8 @@ class QTSSModule : public QTSSDictionary, public Task
         
         // This calls into the module.
 		/* ָRole,Ӧ,ģķַ(ǶԷַİװ) */
-        QTSS_Error  CallDispatch(QTSS_Role inRole, QTSS_RoleParamPtr inParams)
-            {  return (fDispatchFunc)(inRole, inParams);    }
+        // The time each call takes is added to the module's latency histogram for the role.
+        QTSS_Error  CallDispatch(QTSS_Role inRole, QTSS_RoleParamPtr inParams);
         
 
         // These enums allow roles to be stored in a more optimized way
@@ -119,6 +129,33 @@ class QTSSModule : public QTSSDictionary, public Task
 		/* used in QTSServer::BuildModuleRoleArrays() */
         // This returns true if this module is supposed to run in the specified role.ָRoleǷModule?
         Bool16  RunsInRole(RoleIndex inIndex) { Assert(inIndex < kNumRoles); return fRoleArray[inIndex]; }
+
+        // Maps a QTSS role to its RoleIndex, returns kNumRoles for roles without one
+        static RoleIndex GetRoleIndex(QTSS_Role inRole);
+
+        // The roles invoked with an RTSP request, in which a module may narrow
+        // down the requests it takes with AddRoleMethod() and AddRoleURLPrefix()
+        static Bool16 IsRequestRole(RoleIndex inIndex);
+        
+        // See QTSS_AddRoleMethod() and QTSS_AddRoleURLPrefix() in QTSS.h
+        QTSS_Error  AddRoleMethod(QTSS_Role inRole, QTSS_RTSPMethod inMethod);
+        QTSS_Error  AddRoleURLPrefix(QTSS_Role inRole, const char* inURLPrefix);
+        
+        // Whether this module takes requests with inMethod in the role. used in
+        // QTSServer::BuildModuleRoleArrays() to precompile the per method module arrays
+        Bool16  RunsForMethod(RoleIndex inIndex, QTSS_RTSPMethod inMethod)
+                    { Assert(inIndex < kNumRoles); return (fRoleMethods[inIndex] == 0) || ((inMethod < qtssNumMethods) && ((fRoleMethods[inIndex] & (1 << inMethod)) != 0)); }
+        
+        // Whether this module takes requests for inPath in the role, checked as
+        // it is about to be invoked. Only modules that added URL prefixes look at the path.
+        Bool16  RunsForPath(RoleIndex inIndex, StrPtrLen* inPath)
+                    { Assert(inIndex < kNumRoles); return (fNumRoleURLPrefixes[inIndex] == 0) || this->MatchesURLPrefix(inIndex, inPath); }
+        Bool16  HasRoleURLPrefixes(RoleIndex inIndex)
+                    { Assert(inIndex < kNumRoles); return fNumRoleURLPrefixes[inIndex] > 0; }
+
+        // Appends one OSHistogram::Format line (in microseconds) for every role
+        // this module has been invoked in, used for qtssSvrModuleRoleLatency
+        void    FormatRoleLatency(StringFormatter* ioFormatter);
         
 		/********** ǳҪһ ***********/
         SInt64 Run();
@@ -130,12 +167,16 @@ class QTSSModule : public QTSSDictionary, public Task
     
 		/* Ӵ̼dll/.so,ָ(Ҫûȡļ·fPath,õģ)ںQTSS_MainEntryPointPtrָ */
         QTSS_Error LoadFromDisk(QTSS_MainEntryPointPtr* outEntrypoint);
+        
+        Bool16  MatchesURLPrefix(RoleIndex inIndex, StrPtrLen* inPath);
   
         char*                       fPath;/* ģļ· */
         Bool16                      fRoleArray[kNumRoles];/* ģЩɫflag,עʮҪ,μQTSSModule::AddRole() */
 		QTSS_ModuleState            fModuleState;/* μQTSSPrivate.h */
         QTSS_DispatchFuncPtr        fDispatchFunc;/* very important! ģķַָ,QTSSModule::SetupModule() */  
         QTSSPrefs*                  fPrefs;/* ModuleԤֵ */
+        UInt32                      fPrefsVersionRead;
+        UInt32                      fServerPrefsVersionRead;
         QTSSDictionary*             fAttributes; /* ģֵ */
 		OSCodeFragment*             fFragment;/* صƬ,ָΪ,Ϊstatic module,dynamic module */
 		OSQueueElem                 fQueueElem; /* ģĶԪ,ÿModuleΪһԪطŽModule */
@@ -148,6 +189,16 @@ class QTSSModule : public QTSSDictionary, public Task
      
 		/* Ϣ(6),μμQTSSModule.cpp */
         static QTSSAttrInfoDict::AttrInfo   sAttributes[]; 
+
+        // Per role latency of CallDispatch(), allocated by AddRole()
+        OSHistogram*                fRoleLatency[kNumRoles];
+        static char*                sRoleNames[kNumRoles];
+        
+        // Per role, a bit (1 << method) for each method added by AddRoleMethod(),
+        // 0 for all of them, and the prefixes added by AddRoleURLPrefix()
+        UInt32                      fRoleMethods[kNumRoles];
+        StrPtrLen*                  fRoleURLPrefixes[kNumRoles];
+        UInt32                      fNumRoleURLPrefixes[kNumRoles];
          
 };
 
@@ -113,6 +113,7 @@ QTSS_Callbacks  QTSServer::sCallbacks;
 
 /* used in QTSServer::Initialize(),ڸúл */
 XMLPrefsParser* QTSServer::sPrefsSource = NULL;
+OSMutex         QTSServer::sRereadPrefsMutex;
 //PrefsSource*    QTSServer::sMessagesSource = NULL;
 
 
@@ -123,11 +124,11 @@ QTSServer::~QTSServer()  //destructor
 	/* õ,refer to QTSServerInterface.h */
     OSMutexLocker serverlocker(this->GetServerObjectMutex());
     
-    // Grab the prefs mutex. This is to make sure we can't reread prefs
+    // Grab the reread prefs mutex. This is to make sure we can't reread prefs
     // WHILE shutting down, which would cause some weirdness for QTSS API
     // (some modules could get QTSS_RereadPrefs_Role after QTSS_Shutdown, which would be bad)
-	/* õԤֵ󻥳,ʹøû,ֹģرʱԤԤֵ,μQTSServer::RereadPrefsService() */
-    OSMutexLocker locker(this->GetPrefs()->GetMutex());
+	/* õԤԤֵ,ʹøû,ֹģرʱԤԤֵ,μQTSServer::RereadPrefsService() */
+    OSMutexLocker locker(&sRereadPrefsMutex);
 
 	/* module state߳˽ */
     QTSS_ModuleState theModuleState;
@@ -642,9 +643,13 @@ Bool16  QTSServer::SetupUDPSockets()
 {   
 	/* ͳƷϵIPַ,ӦRTP/RTCP Socket */
     UInt32 theNumAllocatedPairs = 0;
-    for (UInt32 theNumPairs = 0; theNumPairs < SocketUtils::GetNumIPAddrs(); theNumPairs++)
+    // Unicast streams are spread over the pairs of an address, see UDPSocketPool::GetUDPSocketPair
+    UInt32 thePairsPerAddr = fSrvrPrefs->GetRTPSocketPairsPerAddress();
+    if (thePairsPerAddr == 0)
+        thePairsPerAddr = 1;
+    for (UInt32 theNumPairs = 0; theNumPairs < SocketUtils::GetNumIPAddrs() * thePairsPerAddr; theNumPairs++)
     {
-        UDPSocketPair* thePair = fSocketPool->CreateUDPSocketPair(SocketUtils::GetIPAddr(theNumPairs), 0);/* default port is 0 */
+        UDPSocketPair* thePair = fSocketPool->CreateUDPSocketPair(SocketUtils::GetIPAddr(theNumPairs / thePairsPerAddr), 0);/* default port is 0 */
         if (thePair != NULL)
         {
             theNumAllocatedPairs++; //port pair increments by 1
@@ -850,6 +855,9 @@ void    QTSServer::InitCallbacks()
     
     sCallbacks.addr[kLockStdLibCallback] =                  (QTSS_CallbackProcPtr)QTSSCallbacks::QTSS_LockStdLib;
     sCallbacks.addr[kUnlockStdLibCallback] =                (QTSS_CallbackProcPtr)QTSSCallbacks::QTSS_UnlockStdLib;
+    
+    sCallbacks.addr[kAddRoleMethodCallback] =               (QTSS_CallbackProcPtr)QTSSCallbacks::QTSS_AddRoleMethod;
+    sCallbacks.addr[kAddRoleURLPrefixCallback] =            (QTSS_CallbackProcPtr)QTSSCallbacks::QTSS_AddRoleURLPrefix;
 }
 
 /* ָĿ¼·Win32ʽģ,˵,ȴԤֵȡmoduleĿ¼,ĩβ"\\*",ڸ·ϲļ,
@@ -974,6 +982,7 @@ Bool16 QTSServer::AddModule(QTSSModule* inModule)   // Add this module to the mo
     QTSSPrefs* thePrefs = NEW QTSSPrefs( sPrefsSource, inModule->GetValue(qtssModName), QTSSDictionaryMap::GetMap(QTSSDictionaryMap::kModulePrefsDictIndex), true);
     thePrefs->RereadPreferences();//ȡModuleԤֵ
     inModule->SetPrefsDict(thePrefs);//ΪModuleԤֵ
+    inModule->SetPrefsVersionsRead(thePrefs->GetVersion(), this->GetPrefs()->GetVersion());
         
     //
     // Add this module to the array of module (dictionaries)
@@ -1041,6 +1050,40 @@ void QTSServer::BuildModuleRoleArrays()
                 }
             }
         }
+        
+        sRoleHasURLPrefixes[x] = false;
+        for (UInt32 z = 0; z < sNumModulesInRole[x]; z++)
+        {
+            if (sModuleArray[x][z]->HasRoleURLPrefixes(x))
+                sRoleHasURLPrefixes[x] = true;
+        }
+        
+        // Precompile the modules of the role that take each method, so requests
+        // only go through the modules that want them. Without any module that
+        // added methods for the role, every method shares sModuleArray[x].
+        for (UInt32 y = 0; y <= qtssIllegalMethod; y++)
+        {
+            UInt32 theNumModules = 0;
+            for (UInt32 z = 0; z < sNumModulesInRole[x]; z++)
+            {
+                if (sModuleArray[x][z]->RunsForMethod(x, y))
+                    theNumModules++;
+            }
+            
+            sNumModulesForMethod[x][y] = theNumModules;
+            if (theNumModules == sNumModulesInRole[x])
+                sMethodModuleArray[x][y] = sModuleArray[x];
+            else if (theNumModules > 0)
+            {
+                UInt32 moduleIndex = 0;
+                sMethodModuleArray[x][y] = NEW QTSSModule*[theNumModules];
+                for (UInt32 z = 0; z < sNumModulesInRole[x]; z++)
+                {
+                    if (sModuleArray[x][z]->RunsForMethod(x, y))
+                        sMethodModuleArray[x][y][moduleIndex++] = sModuleArray[x][z];
+                }
+            }
+        }
     }
 }
 
@@ -1052,6 +1095,14 @@ void QTSServer::DestroyModuleRoleArrays()
     {
 		/* ÿroleӦmoduleΪ0 */
         sNumModulesInRole[x] = 0; 
+        sRoleHasURLPrefixes[x] = false;
+        for (UInt32 y = 0; y <= qtssIllegalMethod; y++)
+        {
+            if (sMethodModuleArray[x][y] != sModuleArray[x])
+                delete [] sMethodModuleArray[x][y];
+            sMethodModuleArray[x][y] = NULL;
+            sNumModulesForMethod[x][y] = 0;
+        }
 		/* ɾȥýɫӦModule(άָQTSSModule**) */
         if (sModuleArray[x] != NULL) 
             delete [] sModuleArray[x];
@@ -1232,15 +1283,16 @@ Bool16 RTSPListenerSocket::OverMaxConnections(UInt32 buffer)
 UDPSocketPair*  RTPSocketPool::ConstructUDPSocketPair()
 {
 	/* QTSServerInterfaceȡRTCPָ(עӸǿתΪ) */
-    Task* theTask = ((QTSServer*)QTSServerInterface::GetServer())->fRTCPTask;
+    RTCPTask* theTask = ((QTSServer*)QTSServerInterface::GetServer())->fRTCPTask;
     
     //construct a pair of UDP sockets, the lower one for RTP data (outgoing only, no demuxer
     //necessary), and one for RTCP data (incoming, so definitely need a demuxer).
     //These are nonblocking sockets that DON'T receive events (we are going to poll for data)
 	// They do receive events - we don't poll from them anymore
 	/* 𲽴UDPSocketPair,˿СⷢRTP,踴;˿ڴڽRTCP,һҪ,Ƿ͵. μUDPSocketPool.hSocket.hĹ캯 */
+    //The RTCP socket queues itself on the RTCPTask when it has data, see RTCPSocket
     return NEW UDPSocketPair(  NEW UDPSocket(theTask, Socket::kNonBlockingSocketType),
-                               NEW UDPSocket(theTask, UDPSocket::kWantsDemuxer | Socket::kNonBlockingSocketType)); //ᴴUDPDemuxerʵ
+                               NEW RTCPSocket(theTask, UDPSocket::kWantsDemuxer | Socket::kNonBlockingSocketType)); //ᴴUDPDemuxerʵ
 }
 
 /* ɾȥָ(,洴)һUDPSocketPairʵ */
@@ -1291,6 +1343,10 @@ void RTPSocketPool::SetUDPSocketOptions(UDPSocketPair* inPair)
         // For now, do not log an error, though we should enable this in the future.
        QTSSModuleUtils::LogError(qtssWarningVerbosity, qtssMsgSockBufSizesTooLarge,0, theRcvBufSizeStr);
     }
+
+    // RTCPTask only reads RTCP sockets that got a read event, so every new one
+    // has to wait for data from the start
+    inPair->GetSocketB()->RequestEvent(EV_RE);
 }
 
 /**************************  RTPSocketPoolĳԱ ***************************/
@@ -1314,27 +1370,54 @@ QTSS_Error QTSServer::RereadPrefsService(QTSS_ServiceFunctionArgsPtr /*inArgs*/)
 	// ȡԤֵָ(ʱѾȫ,ܰȫõԤֵ)
     QTSServerPrefs* thePrefs = theServer->GetPrefs();
     
-    // Grab the prefs mutex. We want to make sure that calls to RereadPrefsService
+    // Grab the reread prefs mutex. We want to make sure that calls to RereadPrefsService
     // are serialized. This also prevents the server from shutting down while in
     // this function, because the QTSServer destructor grabs this mutex as well.
-	// ԷԤֵ,ҲִֹܷRereadPrefsService()ʱ,ر,ΪQTSServerҲõԤֵ
-    OSMutexLocker locker(thePrefs->GetMutex());
+    // It is not the prefs mutex, so threads reading prefs are not held up
+    // while the listeners and modules are updated.
+	// ԤԤֵ,ҲִֹܷRereadPrefsService()ʱ,ر,ΪQTSServerҲõ
+    OSMutexLocker locker(&sRereadPrefsMutex);
     
     // Finally, check the server state again. The state may have changed
     // to qtssShuttingDownState or qtssFatalErrorState in this time, though
-    // at this point we have the prefs mutex, so we are guarenteed that the
+    // at this point we have the reread prefs mutex, so we are guarenteed that the
     // server can't actually shut down anymore
-	/* ѾץסԤֵ,ǻҪٴȷǰ״̬qtssRunningState,˳ */
+	/* ѾץסԤԤֵ,ǻҪٴȷǰ״̬qtssRunningState,˳ */
     if (theServer->GetServerState() != qtssRunningState)
         return QTSS_OutOfState;
     
-    // Ok, we're ready to reread preferences now.
-    // Reread preferences
-	/* xmlļиTagĺϷ */
-    sPrefsSource->Parse();
-	/* ȱб,Ԥֵļøָ,Ԥֵ,Ĭֵ,Ȼ֤ʽ,
-	RTP/RTCPͷӡѡ,־дر,󽫵ԤֵдxmlԤֵļ */
-    thePrefs->RereadServerPreferences(true);
+    {
+        // The server and module prefs all read the one parsed file, so this
+        // is done under the prefs mutex. Only prefs that differ from the file
+        // are set, so an unchanged pref is never rewritten under a reader.
+        OSMutexLocker prefsLocker(thePrefs->GetMutex());
+
+        // Ok, we're ready to reread preferences now.
+        // Reread preferences
+        /* xmlļиTagĺϷ */
+        sPrefsSource->Parse();
+        /* ȱб,Ԥֵļøָ,Ԥֵ,Ĭֵ,Ȼ֤ʽ,
+        RTP/RTCPͷӡѡ,־дر,󽫵ԤֵдxmlԤֵļ */
+        thePrefs->RereadServerPreferences(true);
+
+        /* ζеĸģԤֵ */
+        QTSSModule** theModule = NULL;
+        UInt32 theLen = 0;
+
+        // Go through each module's prefs object and have those reread as well
+        for (int y = 0; QTSServerInterface::GetServer()->GetValuePtr(qtssSvrModuleObjects, y, (void**)&theModule, &theLen) == QTSS_NoErr; y++)
+        {
+            Assert(theModule != NULL);
+            Assert(theLen == sizeof(QTSSModule*));
+            /* ÿmoduleԤֵ */
+            (*theModule)->GetPrefsDict()->RereadPreferences();
+
+#if DEBUG
+            theModule = NULL;
+            theLen = 0;
+#endif
+        }
+    }
     
     {
         // ȡĻ,Update listeners, ports, and IP addrs.
@@ -1345,31 +1428,19 @@ QTSS_Error QTSServer::RereadPrefsService(QTSS_ServiceFunctionArgsPtr /*inArgs*/)
         (void)((QTSServer*)theServer)->CreateListeners(true, thePrefs, 0);
     }
     
-    // Delete all the streams
-	/* ζеĸģԤֵ */
-    QTSSModule** theModule = NULL;
-    UInt32 theLen = 0;
-
-    // Go through each module's prefs object and have those reread as well
-    for (int y = 0; QTSServerInterface::GetServer()->GetValuePtr(qtssSvrModuleObjects, y, (void**)&theModule, &theLen) == QTSS_NoErr; y++)
-    {
-        Assert(theModule != NULL);
-        Assert(theLen == sizeof(QTSSModule*));
-        /* ÿmoduleԤֵ */
-        (*theModule)->GetPrefsDict()->RereadPreferences();
-
-#if DEBUG
-        theModule = NULL;
-        theLen = 0;
-#endif
-    }
-    
-    // Now that we are done rereading the prefs, invoke all modules in the RereadPrefs
-    // role so they can update their internal prefs caches.
-	/* ʹԤֵɫmoduleεQTSS_RereadPrefs_RoleȥڲԤֵ */
+    // Now that we are done rereading the prefs, invoke the modules in the RereadPrefs
+    // role so they can update their internal prefs caches. A module is only invoked
+    // if its own prefs or the server's changed since it last read them.
+	/* ʹԤֵɫmoduleεQTSS_RereadPrefs_RoleȥڲԤֵ,Ԥֵûб仯ģ鲻ص */
+    UInt32 theServerPrefsVersion = thePrefs->GetVersion();
     for (UInt32 x = 0; x < QTSServerInterface::GetNumModulesInRole(QTSSModule::kRereadPrefsRole); x++)
     {
         QTSSModule* theModule = QTSServerInterface::GetModule(QTSSModule::kRereadPrefsRole, x);
+        UInt32 theModulePrefsVersion = theModule->GetPrefsDict()->GetVersion();
+        if (!theModule->PrefsVersionsChanged(theModulePrefsVersion, theServerPrefsVersion))
+            continue;
+        
+        theModule->SetPrefsVersionsRead(theModulePrefsVersion, theServerPrefsVersion);
         (void)theModule->CallDispatch(QTSS_RereadPrefs_Role, NULL);
     }
     return QTSS_NoErr;
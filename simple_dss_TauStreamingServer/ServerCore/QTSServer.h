@@ -109,6 +109,9 @@ class QTSServer : public QTSServerInterface
         static XMLPrefsParser*  sPrefsSource;/* QTSServer::Initialize() */
         //static PrefsSource*     sMessagesSource;
         static QTSS_Callbacks   sCallbacks; //Module loading & unloading routines
+
+        // Serializes RereadPrefsService, and keeps it from running during shutdown
+        static OSMutex          sRereadPrefsMutex;
         
         // Sets up QTSS API callback routines   //callback routines ص
         void                    InitCallbacks();
@@ -153,6 +156,26 @@ public:
     }
 };
 
+class DumpLatencyTask : public Task
+{
+public:
+    virtual SInt64 Run()
+    {
+        QTSServerInterface::LogLatencyHistograms();
+        return -1;
+    }
+};
+
+class DumpTraceTask : public Task
+{
+public:
+    virtual SInt64 Run()
+    {
+        QTSServerInterface::DumpTraceBuffer();
+        return -1;
+    }
+};
+
 
 #endif // __QTSSERVER_H__
 
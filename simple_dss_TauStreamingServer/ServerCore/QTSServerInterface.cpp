@@ -18,12 +18,19 @@ LastUpdate:  2010-08-16
 #include "revision.h"
 #endif
 
+#include <unistd.h>
+
 #include "QTSServerInterface.h"
 #include "RTPSessionInterface.h"
 #include "RTPPacketResender.h"
 #include "RTSPProtocol.h"
 #include "OSRef.h"
 #include "UDPSocketPool.h"
+#include "RTSPSession.h"
+#include "RTPStream.h"
+#include "OSQueue.h"
+#include "OSArrayObjectDeleter.h"
+#include "OSTrace.h"
 
 
 // STATIC DATA
@@ -48,6 +55,9 @@ StrPtrLen                       QTSServerInterface::sPublicHeaderStr;//
 QTSSModule**            QTSServerInterface::sModuleArray[QTSSModule::kNumRoles];/* /ɾμQTSServer::BuildModuleRoleArrays()/DestroyModuleRoleArrays() */
 UInt32                  QTSServerInterface::sNumModulesInRole[QTSSModule::kNumRoles];/* עǶһ,μ QTSServerInterface::GetModule() */
 OSQueue                 QTSServerInterface::sModuleQueue;//ģɵĶ,ɲμQTSServer::AddModule()
+QTSSModule**            QTSServerInterface::sMethodModuleArray[QTSSModule::kNumRoles][qtssIllegalMethod + 1];
+UInt32                  QTSServerInterface::sNumModulesForMethod[QTSSModule::kNumRoles][qtssIllegalMethod + 1];
+Bool16                  QTSServerInterface::sRoleHasURLPrefixes[QTSSModule::kNumRoles];
 QTSSErrorLogStream      QTSServerInterface::sErrorLogStream;
 
 /* ConnectedUser,QTSSModule::sAttributes[] */
@@ -115,7 +125,10 @@ QTSSAttrInfoDict::AttrInfo  QTSServerInterface::sAttributes[] =
     /* 38  */ { "qtssSvrServerBuild",           NULL,   qtssAttrDataTypeCharArray,  qtssAttrModeRead | qtssAttrModePreempSafe },
     /* 39  */ { "qtssSvrServerPlatform",        NULL,   qtssAttrDataTypeCharArray,  qtssAttrModeRead | qtssAttrModePreempSafe },
     /* 40  */ { "qtssSvrRTSPServerComment",     NULL,   qtssAttrDataTypeCharArray,  qtssAttrModeRead | qtssAttrModePreempSafe },
-    /* 41  */ { "qtssSvrNumThinned",            NULL,   qtssAttrDataTypeSInt32,     qtssAttrModeRead | qtssAttrModeWrite  }
+    /* 41  */ { "qtssSvrNumThinned",            NULL,   qtssAttrDataTypeSInt32,     qtssAttrModeRead | qtssAttrModeWrite  },
+    /* 42  */ { "qtssSvrRTSPStateLatency",      GetRTSPStateLatency,    qtssAttrDataTypeCharArray,  qtssAttrModeRead },
+    /* 43  */ { "qtssSvrModuleRoleLatency",     GetModuleRoleLatency,   qtssAttrDataTypeCharArray,  qtssAttrModeRead },
+    /* 44  */ { "qtssSvrRTPSendStats",          GetRTPSendStats,        qtssAttrDataTypeCharArray,  qtssAttrModeRead }
 };
 
 /* kServerDictIndexkQTSSConnectedUserDictIndexֵ,DSSͷϢ"Server: DSS/5.5.3.7 (Build/489.8; Platform/Linux; Release/Darwin; )" */
@@ -181,9 +194,6 @@ QTSServerInterface::QTSServerInterface()
     fTotalRTPBytes(0),
     fTotalRTPPackets(0),
     fTotalRTPPacketsLost(0),
-    fPeriodicRTPBytes(0),
-    fPeriodicRTPPacketsLost(0),
-    fPeriodicRTPPackets(0),
     fCurrentRTPBandwidthInBits(0),
     fAvgRTPBandwidthInBits(0),
     fRTPPacketsPerSecond(0),
@@ -200,10 +210,6 @@ QTSServerInterface::QTSServerInterface()
     fSigTerm(false),
     fDebugLevel(0),   /* Ĭ϶0 */
     fDebugOptions(0), /* Ĭ϶0 */   
-    fMaxLate(0),
-    fTotalLate(0),
-    fCurrentMaxLate(0),
-    fTotalQuality(0),
     fNumThinned(0)
 {
 	/* ʼRolemodule arrayNumModulesInRole,עǶǰ,߽ϵ */
@@ -211,6 +217,12 @@ QTSServerInterface::QTSServerInterface()
     {
         sModuleArray[y] = NULL;//QTSSModule**
         sNumModulesInRole[y] = 0;
+        sRoleHasURLPrefixes[y] = false;
+        for (UInt32 z = 0; z <= qtssIllegalMethod; z++)
+        {
+            sMethodModuleArray[y][z] = NULL;
+            sNumModulesForMethod[y][z] = 0;
+        }
     }
 
 	/* kServerDictIndexֵֵ,ֱParam retrieval functions,˴δ */
@@ -266,6 +278,46 @@ void QTSServerInterface::LogError(QTSS_ErrorVerbosity inVerbosity, char* inBuffe
     }
 }
 
+void QTSServerInterface::LogLatencyHistograms()
+{
+    ResizeableStringFormatter theFormatter;
+    RTSPSession::FormatStateLatency(&theFormatter);
+    QTSServerInterface::FormatModuleRoleLatency(&theFormatter);
+    RTPStream::FormatSendStats(&theFormatter);
+    theFormatter.PutTerminator();
+
+    // one error log entry per histogram
+    char* theLine = theFormatter.GetBufPtr();
+    while (*theLine != '\0')
+    {
+        char* theEOL = ::strchr(theLine, '\n');
+        if (theEOL != NULL)
+            *theEOL = '\0';
+        QTSServerInterface::LogError(qtssMessageVerbosity, theLine);
+        if (theEOL == NULL)
+            break;
+        theLine = theEOL + 1;
+    }
+}
+
+void QTSServerInterface::DumpTraceBuffer()
+{
+    static StrPtrLen sTraceFileName("trace_dump");
+
+    StrPtrLenDel theLogDir(sServer->GetPrefs()->GetErrorLogDir());
+    ResizeableStringFormatter thePath(NULL, 0);
+    thePath.PutFilePath(&theLogDir, &sTraceFileName);
+    thePath.PutTerminator();
+
+    char theMessage[1024];
+    OS_Error theErr = OSTrace::DumpToFile(thePath.GetBufPtr());
+    if (theErr == OS_NoErr)
+        qtss_snprintf(theMessage, sizeof(theMessage), "Wrote trace buffer to %s", thePath.GetBufPtr());
+    else
+        qtss_snprintf(theMessage, sizeof(theMessage), "Cannot write trace buffer to %s: %s", thePath.GetBufPtr(), ::strerror(theErr));
+    QTSServerInterface::LogError(qtssMessageVerbosity, theMessage);
+}
+
 /* ǰRTPSession MapеRTPSession, ɱ¼ȥ֪ͨ߳ɱеRTP Session */
 void QTSServerInterface::KillAllRTPSessions()
 {
@@ -325,7 +377,7 @@ void QTSServerInterface::SetValueComplete(UInt32 inAttrIndex, QTSSDictionaryMap*
 /************************************* RTPStatsUpdaterTask ************************************/
 
 RTPStatsUpdaterTask::RTPStatsUpdaterTask()
-:   Task(), fLastBandwidthTime(0), fLastBandwidthAvg(0), fLastBytesSent(0), fLastTotalMP3Bytes(0)
+:   Task(), fStatsPath(NULL), fStatsPrefsVersion(0), fLastBandwidthTime(0), fLastBandwidthAvg(0), fLastBytesSent(0), fLastTotalMP3Bytes(0)
 {
     this->SetTaskName("RTPStatsUpdaterTask");
 	/* RTPStatsUpdaterTask̵ָ߳ */
@@ -375,6 +427,71 @@ Float32 RTPStatsUpdaterTask::GetCPUTimeInSeconds()
     return cpuTimeInSec;
 }
 
+/* Copies the server totals into the shared memory stats block read by ServerStatsReader, called with fMutex held */
+void RTPStatsUpdaterTask::PublishStats(QTSServerInterface* inServer)
+{
+    // only copy the pref again after the server prefs changed (reread, or set through the API)
+    UInt32 thePrefsVersion = inServer->GetPrefs()->GetVersion();
+    if ((fStatsPath == NULL) || (thePrefsVersion != fStatsPrefsVersion))
+    {
+        delete [] fStatsPath;
+        fStatsPath = inServer->GetPrefs()->GetStatsSharedMemoryFile();
+        fStatsPrefsVersion = thePrefsVersion;
+    }
+
+    if (fStatsPath[0] == '\0')
+    {
+        fStatsBlock.Close();
+        return;
+    }
+
+    // (re)create the block when the pref changes
+    if (!fStatsBlock.IsOpen() || (::strcmp(fStatsBlock.GetPath(), fStatsPath) != 0))
+    {
+        OS_Error theErr = fStatsBlock.Create(fStatsPath);
+        if (theErr != OS_NoErr)
+        {
+            // don't log the same failure every second
+            static OS_Error sLastErr = OS_NoErr;
+            if (theErr != sLastErr)
+            {
+                char theMessage[256];
+                qtss_snprintf(theMessage, sizeof(theMessage), "Could not create stats_shared_memory_file %s, error %ld",
+                                fStatsPath, theErr);
+                QTSServerInterface::LogError(qtssWarningVerbosity, theMessage);
+            }
+            sLastErr = theErr;
+            return;
+        }
+    }
+
+    QTSServerStats theStats;
+    theStats.fUpdateTimeUnixMilli = OS::TimeMilli_To_UnixTimeMilli(OS::Milliseconds());
+    theStats.fStartupTimeUnixMilli = inServer->fStartupTime_UnixMilli;
+    theStats.fServerPID = (UInt64)::getpid();
+    theStats.fServerState = inServer->fServerState;
+
+    theStats.fNumRTSPSessions = inServer->fNumRTSPSessions;
+    theStats.fNumRTSPHTTPSessions = inServer->fNumRTSPHTTPSessions;
+    theStats.fNumRTPSessions = inServer->fNumRTPSessions;
+    theStats.fNumRTPPlayingSessions = inServer->fNumRTPPlayingSessions;
+    theStats.fTotalRTPSessions = inServer->fTotalRTPSessions;
+
+    theStats.fCurBandwidthInBits = inServer->fCurrentRTPBandwidthInBits;
+    theStats.fAvgBandwidthInBits = inServer->fAvgRTPBandwidthInBits;
+    theStats.fRTPPacketsPerSecond = inServer->fRTPPacketsPerSecond;
+    theStats.fTotalRTPBytes = inServer->fTotalRTPBytes;
+    theStats.fTotalRTPPackets = inServer->fTotalRTPPackets;
+    theStats.fTotalRTPPacketsLost = inServer->fTotalRTPPacketsLost;
+
+    theStats.fCPUPercentX100 = (UInt64)(inServer->fCPUPercent * 100);
+    theStats.fMaxLateMsec = inServer->GetMaxLate();
+    theStats.fCurrentMaxLateMsec = inServer->GetCurrentMaxLate();
+    theStats.fNumThinned = inServer->fNumThinned;
+
+    fStatsBlock.Publish(&theStats);
+}
+
 /* ÿ1,ע4ݳԱֵ: */
 SInt64 RTPStatsUpdaterTask::Run()
 {
@@ -384,29 +501,20 @@ SInt64 RTPStatsUpdaterTask::Run()
     // All of this must happen atomically wrt dictionary values we are manipulating
     OSMutexLocker locker(&theServer->fMutex);
     
-    //First update total bytes. This must be done because total bytes is a 64 bit number,
-    //so no atomic functions can apply.
-    //
-    // NOTE: The line below is not thread safe on non-PowerPC platforms. This is
-    // because the fPeriodicRTPBytes variable is being manipulated from within an
-    // atomic_add. On PowerPC, assignments are atomic, so the assignment below is ok.
-    // On a non-PowerPC platform, the following would be thread safe:
-    //unsigned int periodicBytes = atomic_add(&theServer->fPeriodicRTPBytes, 0);
+    //First update total bytes. The sending threads each count into their own
+    //shard of the periodic counters, TakeAll() sums and clears the shards.
 
 	/********************** עĴͬ *********************************************/
 
-    unsigned int periodicBytes = theServer->fPeriodicRTPBytes;
-    (void)atomic_sub(&theServer->fPeriodicRTPBytes, periodicBytes);
+    UInt64 periodicBytes = (UInt64)theServer->fPeriodicRTPBytes.TakeAll();
     theServer->fTotalRTPBytes += periodicBytes;
     
     // Same deal for packet totals
-    unsigned int periodicPackets = theServer->fPeriodicRTPPackets;/* һ(λ)ڵRTP */
-    (void)atomic_sub(&theServer->fPeriodicRTPPackets, periodicPackets);
+    unsigned int periodicPackets = (unsigned int)theServer->fPeriodicRTPPackets.TakeAll();/* һ(λ)ڵRTP */
     theServer->fTotalRTPPackets += periodicPackets;
     
     // ..and for lost packet totals
-    unsigned int periodicPacketsLost = theServer->fPeriodicRTPPacketsLost;
-    (void)atomic_sub(&theServer->fPeriodicRTPPacketsLost, periodicPacketsLost);
+    UInt64 periodicPacketsLost = (UInt64)theServer->fPeriodicRTPPacketsLost.TakeAll();
     theServer->fTotalRTPPacketsLost += periodicPacketsLost;
 
 	/********************** עĴͬ ***********************************************/
@@ -556,6 +664,8 @@ SInt64 RTPStatsUpdaterTask::Run()
 		/**************** NOTE!! ********************/
     }
     
+    this->PublishStats(theServer);
+
     (void)this->GetEvents();//we must clear the event mask!
 	/* ֵ"total_bytes_update"Ϊ1s  */
     return theServer->GetPrefs()->GetTotalBytesUpdateTimeInSecs() * 1000;
@@ -638,6 +748,54 @@ void* QTSServerInterface::GetNumWastedBytes(QTSSDictionary* inServer, UInt32* ou
     return &theServer->fUDPWastageInBytes;  
 }
 
+void QTSServerInterface::FormatModuleRoleLatency(StringFormatter* ioFormatter)
+{
+    for (OSQueueIter theIter(&sModuleQueue); !theIter.IsDone(); theIter.Next())
+    {
+        QTSSModule* theModule = (QTSSModule*)theIter.GetCurrent()->GetEnclosingObject();
+        theModule->FormatRoleLatency(ioFormatter);
+    }
+}
+
+/* RTSPSession state machine latency histograms, formatted each time they are read */
+void* QTSServerInterface::GetRTSPStateLatency(QTSSDictionary* inServer, UInt32* outLen)
+{
+    QTSServerInterface* theServer = (QTSServerInterface*)inServer;
+    OSMutexLocker locker(&theServer->fMutex);
+
+    theServer->fRTSPStateLatency.Reset();
+    RTSPSession::FormatStateLatency(&theServer->fRTSPStateLatency);
+
+    *outLen = theServer->fRTSPStateLatency.GetCurrentOffset();
+    return theServer->fRTSPStateLatency.GetBufPtr();
+}
+
+/* Per module and role latency histograms, formatted each time they are read */
+void* QTSServerInterface::GetModuleRoleLatency(QTSSDictionary* inServer, UInt32* outLen)
+{
+    QTSServerInterface* theServer = (QTSServerInterface*)inServer;
+    OSMutexLocker locker(&theServer->fMutex);
+
+    theServer->fModuleRoleLatency.Reset();
+    QTSServerInterface::FormatModuleRoleLatency(&theServer->fModuleRoleLatency);
+
+    *outLen = theServer->fModuleRoleLatency.GetCurrentOffset();
+    return theServer->fModuleRoleLatency.GetBufPtr();
+}
+
+/* RTP send timing histograms and counters, formatted each time they are read */
+void* QTSServerInterface::GetRTPSendStats(QTSSDictionary* inServer, UInt32* outLen)
+{
+    QTSServerInterface* theServer = (QTSServerInterface*)inServer;
+    OSMutexLocker locker(&theServer->fMutex);
+
+    theServer->fRTPSendStats.Reset();
+    RTPStream::FormatSendStats(&theServer->fRTPSendStats);
+
+    *outLen = theServer->fRTPSendStats.GetCurrentOffset();
+    return theServer->fRTPSendStats.GetBufPtr();
+}
+
 /********************************* Param retrieval functions for ServerDict ********************************/
 
 /* Ȼȡʱ,뵱ǰʱ,Ϊʱ(ms),ٶȡֵءעһQTSSConnectedUserDict */
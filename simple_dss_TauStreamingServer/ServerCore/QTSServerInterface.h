@@ -26,9 +26,11 @@ LastUpdate:  2010-08-16
 #include "atomic.h"
 
 #include "OSMutex.h"
+#include "OSShardedCounter.h"
 #include "Task.h"
 #include "TCPListenerSocket.h"
 #include "ResizeableStringFormatter.h"
+#include "QTSServerStatsBlock.h"
 
 class UDPSocketPool;
 class QTSServerPrefs;
@@ -72,13 +74,13 @@ class QTSServerInterface : public QTSSDictionary
             
         //total rtp bytes sent by the server
         void            IncrementTotalRTPBytes(UInt32 bytes)
-            { (void)atomic_add(&fPeriodicRTPBytes, bytes); }
+            { fPeriodicRTPBytes.Add(bytes); }
         //total rtp packets sent by the server
         void            IncrementTotalPackets()
-            { (void)atomic_add(&fPeriodicRTPPackets, 1); }
+            { fPeriodicRTPPackets.Add(1); }
         //total rtp bytes reported as lost by the clients
         void            IncrementTotalRTPPacketsLost(UInt32 packets)
-            { (void)atomic_add(&fPeriodicRTPPacketsLost, packets); }
+            { fPeriodicRTPPacketsLost.Add(packets); }
                                         
         // Also increments current RTP session count
 		/* used in RTPSession::Activate() */
@@ -94,15 +96,14 @@ class QTSServerInterface : public QTSSDictionary
             
         /* ӳ */
         void            IncrementTotalLate(SInt64 milliseconds)
-           {    OSMutexLocker locker(&fMutex); 
-                fTotalLate += milliseconds;
-                if (milliseconds > fCurrentMaxLate) fCurrentMaxLate = milliseconds;
-                if (milliseconds > fMaxLate) fMaxLate = milliseconds;
+           {    fTotalLate.Add(milliseconds);
+                fCurrentMaxLate.Update(milliseconds);
+                fMaxLate.Update(milliseconds);
            }
         
 		/* qualitylevel */
         void            IncrementTotalQuality(SInt32 level)
-           { OSMutexLocker locker(&fMutex); fTotalQuality += level; }
+           { fTotalQuality.Add(level); }
            
         /* Ӵ(thinning) */   
         void            IncrementNumThinned(SInt32 inDifference)
@@ -110,11 +111,11 @@ class QTSServerInterface : public QTSSDictionary
        
 		// clear
         void            ClearTotalLate()
-           { OSMutexLocker locker(&fMutex); fTotalLate = 0;  }
+           { fTotalLate.Reset();  }
         void            ClearCurrentMaxLate()
-           { OSMutexLocker locker(&fMutex); fCurrentMaxLate = 0;  }
+           { fCurrentMaxLate.Reset();  }
         void            ClearTotalQuality()
-           { OSMutexLocker locker(&fMutex); fTotalQuality = 0;  }
+           { fTotalQuality.Reset();  }
      
 
         // ACCESSORS
@@ -148,10 +149,10 @@ class QTSServerInterface : public QTSSDictionary
         void                SetDebugLevel(UInt32 debugLevel)    { fDebugLevel = debugLevel; }
         void                SetDebugOptions(UInt32 debugOptions){ fDebugOptions = debugOptions; }
         
-        SInt64              GetMaxLate()                { return fMaxLate; };
-        SInt64              GetTotalLate()              { return fTotalLate; };
-        SInt64              GetCurrentMaxLate()         { return fCurrentMaxLate; };
-        SInt64              GetTotalQuality()           { return fTotalQuality; };
+        SInt64              GetMaxLate()                { return fMaxLate.Get(); };
+        SInt64              GetTotalLate()              { return fTotalLate.Get(); };
+        SInt64              GetCurrentMaxLate()         { return fCurrentMaxLate.Get(); };
+        SInt64              GetTotalQuality()           { return fTotalQuality.Get(); };
         SInt32              GetNumThinned()             { return fNumThinned; };
 
         // GLOBAL OBJECTS REPOSITORY(ȫֶ)
@@ -212,6 +213,40 @@ class QTSServerInterface : public QTSSDictionary
                     Assert(inIndex < sNumModulesInRole[inRole]);
                     return sModuleArray[inRole][inIndex];
                 }
+        
+        // The same for the modules that take requests with inMethod in a role,
+        // see QTSS_AddRoleMethod(). Any method that is not a known one is
+        // qtssIllegalMethod, taken only by the modules that added no method.
+        static UInt32       GetNumModulesInRole(QTSSModule::RoleIndex inRole, QTSS_RTSPMethod inMethod)
+                {
+                    Assert(inRole < QTSSModule::kNumRoles);
+                    return sNumModulesForMethod[inRole][(inMethod < qtssNumMethods) ? inMethod : qtssIllegalMethod];
+                }
+        static QTSSModule*  GetModule(QTSSModule::RoleIndex inRole, QTSS_RTSPMethod inMethod, UInt32 inIndex)
+                {
+                    Assert(inRole < QTSSModule::kNumRoles);
+                    if (inMethod >= qtssNumMethods)
+                        inMethod = qtssIllegalMethod;
+                    Assert(inIndex < sNumModulesForMethod[inRole][inMethod]);
+                    return sMethodModuleArray[inRole][inMethod][inIndex];
+                }
+        // Whether any module of the role added URL prefixes, so the path of the
+        // request needs to be looked at to pick its modules
+        static Bool16       RoleHasURLPrefixes(QTSSModule::RoleIndex inRole)
+                { Assert(inRole < QTSSModule::kNumRoles); return sRoleHasURLPrefixes[inRole]; }
+        // The first of them that also takes inPath, see QTSS_AddRoleURLPrefix().
+        // NULL if there is none. Used by the roles that invoke only one module.
+        static QTSSModule*  GetFirstModuleForPath(QTSSModule::RoleIndex inRole, QTSS_RTSPMethod inMethod, StrPtrLen* inPath)
+                {
+                    UInt32 theNumModules = GetNumModulesInRole(inRole, inMethod);
+                    for (UInt32 x = 0; x < theNumModules; x++)
+                    {
+                        QTSSModule* theModule = GetModule(inRole, inMethod, x);
+                        if (theModule->RunsForPath(inRole, inPath))
+                            return theModule;
+                    }
+                    return NULL;
+                }
 
         // ģ÷״̬
         // We need to override this. This is how we implement the QTSS_StateChange_Role
@@ -220,6 +255,14 @@ class QTSServerInterface : public QTSSDictionary
         // ERROR LOGGING
         // Invokes the error logging modules with some data
         static void     LogError(QTSS_ErrorVerbosity inVerbosity, char* inBuffer);
+
+        // Writes the qtssSvrRTSPStateLatency, qtssSvrModuleRoleLatency and
+        // qtssSvrRTPSendStats histograms to the error log, one line each (SIGUSR1)
+        static void     LogLatencyHistograms();
+
+        // Writes the OSTrace ring buffer to "trace_dump" in the error log
+        // folder (SIGUSR2)
+        static void     DumpTraceBuffer();
         
         // Returns the error log stream
         static QTSSErrorLogStream* GetErrorLogStream() { return &sErrorLogStream; }
@@ -273,6 +316,12 @@ class QTSServerInterface : public QTSSDictionary
         static UInt32                   sNumModulesInRole[QTSSModule::kNumRoles];
 		/* moduleɵĶ,ҪOSQueue.h/cpp */
         static OSQueue                  sModuleQueue;/* used in QTSServer::AddModule()  */
+        
+        // Per role and method, the modules of sModuleArray that take the method.
+        // Where that is all of them the array is sModuleArray's own.
+        static QTSSModule**             sMethodModuleArray[QTSSModule::kNumRoles][qtssIllegalMethod + 1];
+        static UInt32                   sNumModulesForMethod[QTSSModule::kNumRoles][qtssIllegalMethod + 1];
+        static Bool16                   sRoleHasURLPrefixes[QTSSModule::kNumRoles];
 
 		
         static QTSSErrorLogStream       sErrorLogStream;/* module̵Ĵ־ */
@@ -316,13 +365,12 @@ class QTSServerInterface : public QTSSDictionary
         //stores the total number of bytes lost (as reported by clients) since startup
         UInt64              fTotalRTPPacketsLost;
 
-        //because there is no 64 bit atomic add (for obvious reasons), we efficiently
-        //implement total byte counting by atomic adding to this variable, then every
-        //once in a while updating the sTotalBytes.
+        //every sending thread adds to its own shard of these, RTPStatsUpdaterTask
+        //moves them into the totals above once per update.
 		/* for calculate the above global quantities using theses temp variable,μRTPStatsUpdaterTask::Run() */
-        unsigned int        fPeriodicRTPBytes;
-        unsigned int        fPeriodicRTPPacketsLost;
-        unsigned int        fPeriodicRTPPackets;
+        OSShardedCounter    fPeriodicRTPBytes;
+        OSShardedCounter    fPeriodicRTPPacketsLost;
+        OSShardedCounter    fPeriodicRTPPackets;
         
         //stores the current served bandwidth in BITS per second
         UInt32              fCurrentRTPBandwidthInBits;
@@ -363,10 +411,10 @@ class QTSServerInterface : public QTSSDictionary
         
 
 		//late
-        SInt64              fMaxLate;
-        SInt64              fTotalLate;
-        SInt64              fCurrentMaxLate;
-        SInt64              fTotalQuality;
+        OSShardedMax        fMaxLate;
+        OSShardedCounter    fTotalLate;
+        OSShardedMax        fCurrentMaxLate;
+        OSShardedCounter    fTotalQuality;
         SInt32              fNumThinned;   //ܱ
 
         // Param retrieval functions for ServerDict, see QTSServerInterface::sAttributes[]ֵ
@@ -375,6 +423,16 @@ class QTSServerInterface : public QTSSDictionary
         static void* IsOutOfDescriptors(QTSSDictionary* inServer, UInt32* outLen);
         static void* GetNumUDPBuffers(QTSSDictionary* inServer, UInt32* outLen);
         static void* GetNumWastedBytes(QTSSDictionary* inServer, UInt32* outLen);
+        static void* GetRTSPStateLatency(QTSSDictionary* inServer, UInt32* outLen);
+        static void* GetModuleRoleLatency(QTSSDictionary* inServer, UInt32* outLen);
+        static void* GetRTPSendStats(QTSSDictionary* inServer, UInt32* outLen);
+
+        static void  FormatModuleRoleLatency(StringFormatter* ioFormatter);
+
+        // Storage for the latency histogram attributes, see the param retrieval functions
+        ResizeableStringFormatter   fRTSPStateLatency;
+        ResizeableStringFormatter   fModuleRoleLatency;
+        ResizeableStringFormatter   fRTPSendStats;
         
 		/* Ҫ̬: */
         static QTSServerInterface*  sServer; /* ָQTSServerInterfaceָ,ע÷,needed by RTPSession::run() */
@@ -392,7 +450,7 @@ class RTPStatsUpdaterTask : public Task
     
         // This class runs periodically(ֵΪ1s) to compute current totals & averages
         RTPStatsUpdaterTask();
-        virtual ~RTPStatsUpdaterTask() {}
+        virtual ~RTPStatsUpdaterTask() { delete [] fStatsPath; }
     
     private:
     
@@ -400,6 +458,12 @@ class RTPStatsUpdaterTask : public Task
         virtual SInt64 Run();
         RTPSessionInterface* GetNewestSession(OSRefTable* inRTPSessionMap);
         Float32 GetCPUTimeInSeconds();
+
+        // Copies the current totals into the stats_shared_memory_file block
+        void    PublishStats(QTSServerInterface* inServer);
+        QTSServerStatsBlock fStatsBlock;
+        char*               fStatsPath;         // stats_shared_memory_file as of fStatsPrefsVersion
+        UInt32              fStatsPrefsVersion;
         
 		/* ϴδʱ */
         SInt64 fLastBandwidthTime;
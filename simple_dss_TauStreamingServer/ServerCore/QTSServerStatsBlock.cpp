@@ -0,0 +1,148 @@
+/***************************************************************************
+
+Copyright (c) 2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 QTSServerStatsBlock.cpp
+Description: Live server statistics published in a shared memory mapped file,
+             written by RTPStatsUpdaterTask and read by ServerStatsReader.
+Comment:
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-19
+LastUpdate:  2026-10-19
+
+****************************************************************************/
+
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sched.h>
+
+#include "QTSServerStatsBlock.h"
+#include "OSMemory.h"
+
+OS_Error QTSServerStatsBlock::Create(char* inPath)
+{
+    OS_Error theErr = this->Map(inPath, true);
+    if (theErr != OS_NoErr)
+        return theErr;
+
+    // A reader that still has the file of a previous run mapped sees an
+    // odd sequence until the header is valid again
+    fSegment->fSequence |= 1;
+    __sync_synchronize();
+    fSegment->fMagic = kMagic;
+    fSegment->fVersion = kVersion;
+    fSegment->fStatsSize = sizeof(QTSServerStats);
+    ::memset(&fSegment->fStats, 0, sizeof(fSegment->fStats));
+    __sync_synchronize();
+    fSegment->fSequence++;
+    return OS_NoErr;
+}
+
+OS_Error QTSServerStatsBlock::Open(char* inPath)
+{
+    OS_Error theErr = this->Map(inPath, false);
+    if (theErr != OS_NoErr)
+        return theErr;
+
+    if ((fSegment->fMagic != kMagic) || (fSegment->fVersion > kVersion))
+    {
+        this->Close();
+        return EINVAL;
+    }
+    return OS_NoErr;
+}
+
+OS_Error QTSServerStatsBlock::Map(char* inPath, Bool16 inWrite)
+{
+    this->Close();
+
+    int theFile = ::open(inPath, inWrite ? (O_RDWR | O_CREAT) : O_RDONLY, 0644);
+    if (theFile == -1)
+        return errno;
+
+    // never shrink the file, readers may have it mapped
+    struct stat theStat;
+    if (::fstat(theFile, &theStat) == -1)
+    {
+        OS_Error theErr = errno;
+        ::close(theFile);
+        return theErr;
+    }
+    if ((UInt64)theStat.st_size < sizeof(QTSServerStatsSegment))
+    {
+        if (!inWrite || (::ftruncate(theFile, sizeof(QTSServerStatsSegment)) == -1))
+        {
+            OS_Error theErr = inWrite ? errno : EINVAL;
+            ::close(theFile);
+            return theErr;
+        }
+    }
+
+    void* theMap = ::mmap(NULL, sizeof(QTSServerStatsSegment), inWrite ? (PROT_READ | PROT_WRITE) : PROT_READ,
+                            MAP_SHARED, theFile, 0);
+    OS_Error theErr = (theMap == MAP_FAILED) ? errno : OS_NoErr;
+    ::close(theFile); // the mapping stays valid
+    if (theErr != OS_NoErr)
+        return theErr;
+
+    fSegment = (QTSServerStatsSegment*)theMap;
+    fPath = NEW char[::strlen(inPath) + 1];
+    ::strcpy(fPath, inPath);
+    return OS_NoErr;
+}
+
+void QTSServerStatsBlock::Close()
+{
+    if (fSegment != NULL)
+        (void)::munmap((void*)fSegment, sizeof(QTSServerStatsSegment));
+    fSegment = NULL;
+
+    delete [] fPath;
+    fPath = NULL;
+}
+
+void QTSServerStatsBlock::Publish(QTSServerStats* inStats)
+{
+    if (fSegment == NULL)
+        return;
+
+    fSegment->fSequence++;
+    __sync_synchronize();
+    ::memcpy(&fSegment->fStats, inStats, sizeof(QTSServerStats));
+    __sync_synchronize();
+    fSegment->fSequence++;
+}
+
+Bool16 QTSServerStatsBlock::Read(QTSServerStats* outStats)
+{
+    if (fSegment == NULL)
+        return false;
+
+    UInt32 theSize = fSegment->fStatsSize;
+    if (theSize > sizeof(QTSServerStats))
+        theSize = sizeof(QTSServerStats);
+
+    for (UInt32 theTry = 0; theTry < kMaxReadRetries; theTry++)
+    {
+        unsigned int theSequence = fSegment->fSequence;
+        if (theSequence & 1)
+        {
+            ::sched_yield();
+            continue;
+        }
+        __sync_synchronize();
+
+        ::memset(outStats, 0, sizeof(QTSServerStats));
+        ::memcpy(outStats, (void*)&fSegment->fStats, theSize);
+
+        __sync_synchronize();
+        if (fSegment->fSequence == theSequence)
+            return true;
+    }
+    return false;
+}
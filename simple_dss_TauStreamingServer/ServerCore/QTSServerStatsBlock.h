@@ -0,0 +1,112 @@
+/***************************************************************************
+
+Copyright (c) 2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 QTSServerStatsBlock.h
+Description: Live server statistics published in a shared memory mapped file,
+             written by RTPStatsUpdaterTask and read by ServerStatsReader.
+Comment:
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-19
+LastUpdate:  2026-10-19
+
+****************************************************************************/
+
+/*
+    The file holds one QTSServerStatsSegment. There is a single writer and
+    any number of readers, synchronized with a sequence lock: the writer
+    makes fSequence odd, copies the stats in and makes fSequence even again.
+    A reader copies the stats out and retries if fSequence was odd or
+    changed meanwhile, so readers never block the server.
+
+    Every value is 64 bit in native byte order. New fields are only ever
+    appended to QTSServerStats, fStatsSize tells a reader how many bytes the
+    writer filled in, fields beyond that read as 0. fVersion changes only
+    if existing fields change meaning.
+*/
+
+#ifndef __QTSSERVERSTATSBLOCK_H__
+#define __QTSSERVERSTATSBLOCK_H__
+
+#include <stddef.h>
+#include "OSHeaders.h"
+
+struct QTSServerStats
+{
+    SInt64  fUpdateTimeUnixMilli;       // when the writer last published
+    SInt64  fStartupTimeUnixMilli;
+    UInt64  fServerPID;
+    UInt64  fServerState;               // QTSS_ServerState
+
+    UInt64  fNumRTSPSessions;
+    UInt64  fNumRTSPHTTPSessions;
+    UInt64  fNumRTPSessions;
+    UInt64  fNumRTPPlayingSessions;
+    UInt64  fTotalRTPSessions;
+
+    UInt64  fCurBandwidthInBits;        // per second
+    UInt64  fAvgBandwidthInBits;        // per second, averaged over average_bandwidth_update
+    UInt64  fRTPPacketsPerSecond;
+    UInt64  fTotalRTPBytes;
+    UInt64  fTotalRTPPackets;
+    UInt64  fTotalRTPPacketsLost;
+
+    UInt64  fCPUPercentX100;            // CPU percent * 100
+    SInt64  fMaxLateMsec;
+    SInt64  fCurrentMaxLateMsec;
+    UInt64  fNumThinned;
+};
+
+struct QTSServerStatsSegment
+{
+    unsigned int            fMagic;
+    unsigned int            fVersion;
+    unsigned int            fStatsSize;     // sizeof(QTSServerStats) of the writer
+    volatile unsigned int   fSequence;      // odd while the writer is updating fStats
+    QTSServerStats          fStats;
+};
+
+class QTSServerStatsBlock
+{
+    public:
+
+        enum
+        {
+            kMagic          = 0x44535342,   //UInt32, "DSSB"
+            kVersion        = 1,            //UInt32
+            kMaxReadRetries = 1000          //UInt32
+        };
+
+        QTSServerStatsBlock() : fSegment(NULL), fPath(NULL) {}
+        ~QTSServerStatsBlock() { this->Close(); }
+
+        // Writer: creates inPath, or grows it to the block size, and maps it
+        // read-write. An existing larger file is never shrunk, since readers
+        // may have it mapped; the header and stats are reset instead.
+        OS_Error    Create(char* inPath);
+
+        // Reader: maps an existing file read only. Fails with EINVAL if
+        // it is not a stats block or a newer incompatible version.
+        OS_Error    Open(char* inPath);
+
+        void        Close();
+
+        Bool16      IsOpen()    { return fSegment != NULL; }
+        char*       GetPath()   { return fPath; }
+
+        // Only one thread may publish
+        void        Publish(QTSServerStats* inStats);
+
+        // Returns false if no consistent copy could be taken
+        Bool16      Read(QTSServerStats* outStats);
+
+    private:
+
+        OS_Error    Map(char* inPath, Bool16 inWrite);
+
+        QTSServerStatsSegment*  fSegment;
+        char*                   fPath;
+};
+
+#endif //__QTSSERVERSTATSBLOCK_H__
@@ -0,0 +1,274 @@
+/***************************************************************************
+
+Copyright (c) 2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 RTCPCompoundParser.cpp
+Description: Parses a compound RTCP packet sent by a client in one pass into
+             a fixed size summary, without allocating or copying the packet.
+Comment:
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-19
+LastUpdate:  2026-10-19
+
+****************************************************************************/
+
+#include <string.h>
+#include "RTCPCompoundParser.h"
+
+// Byte wise big endian reads, packet fields are not necessarily aligned
+static inline UInt32 GetUInt32At(UInt8* inPtr)
+{
+    return ((UInt32)inPtr[0] << 24) | ((UInt32)inPtr[1] << 16) | ((UInt32)inPtr[2] << 8) | (UInt32)inPtr[3];
+}
+
+static inline UInt16 GetUInt16At(UInt8* inPtr)
+{
+    return (UInt16)((inPtr[0] << 8) | inPtr[1]);
+}
+
+enum
+{
+    kRTCPHeaderSize         = 8,    // V/P/count/PT/length + SSRC
+    kReportBlockSize        = 24,
+    kAppNameOffset          = 8,
+    kAckSeqNumOffset        = 16,
+    kAckMaskOffset          = 20,
+    kQTSSVersionOffset      = 16,   // UInt16 version, UInt16 length in words
+    kQTSSDataOffset         = 20,
+    kQTSSItemHeaderSize     = 4,    // UInt16 type, UInt8 version, UInt8 length in bytes
+    kSupportedQTSSVersion   = 0,
+
+    kAckPacketType          = FOUR_CHARS_TO_INT('q', 't', 'a', 'k'),
+    kOldAckPacketType       = FOUR_CHARS_TO_INT('a', 'c', 'k', ' ')
+};
+
+Bool16 RTCPCompoundParser::Parse(UInt8* inData, UInt32 inLen, RTCPCompoundSummary* outSummary)
+{
+    // Only the counters are reset, the arrays are valid up to their counts
+    outSummary->fNumPackets = 0;
+    outSummary->fNumBytes = 0;
+    outSummary->fNumUnknownPackets = 0;
+    outSummary->fMalformed = false;
+    outSummary->fHasReceiverReport = false;
+    outSummary->fNumReportBlocks = 0;
+    outSummary->fNumAcks = 0;
+    outSummary->fNumAcksDropped = 0;
+    outSummary->fHasQTSSApp = false;
+
+    while (inLen > 0)
+    {
+        if (inLen < kRTCPHeaderSize)
+            break;
+
+        UInt32 theHeader = GetUInt32At(inData);
+        UInt32 theVersion = theHeader >> 30;
+        UInt32 theCount = (theHeader >> 24) & 0x1F;
+        UInt32 thePacketType = (theHeader >> 16) & 0xFF;
+        UInt32 thePacketLen = ((theHeader & 0xFFFF) * 4) + 4;
+
+        if ((theVersion != kSupportedRTCPVersion) || (thePacketLen > inLen) || (thePacketLen < kRTCPHeaderSize))
+            break;
+
+        Bool16 isOK = true;
+        switch (thePacketType)
+        {
+            case kReceiverPacketType:
+                isOK = ParseReceiverReport(inData, thePacketLen, theCount, outSummary);
+                break;
+
+            case kAPPPacketType:
+                if (IsAck(inData, thePacketLen))
+                    isOK = ParseAck(inData, thePacketLen, outSummary);
+                else
+                    isOK = ParseQTSSApp(inData, thePacketLen, theCount, outSummary);
+                break;
+
+            case kSDESPacketType:
+                break;
+
+            default:
+                outSummary->fNumUnknownPackets++;
+                break;
+        }
+        if (!isOK)
+            break;
+
+        outSummary->fNumPackets++;
+        outSummary->fNumBytes += thePacketLen;
+        inData += thePacketLen;
+        inLen -= thePacketLen;
+    }
+
+    outSummary->fMalformed = (inLen > 0);
+    return !outSummary->fMalformed;
+}
+
+Bool16 RTCPCompoundParser::ParseReceiverReport(UInt8* inPacket, UInt32 inPacketLen, UInt32 inCount, RTCPCompoundSummary* ioSummary)
+{
+    if (inPacketLen < kRTCPHeaderSize + (inCount * kReportBlockSize))
+        return false;
+
+    UInt32 theFractionLost = 0;
+    UInt32 theTotalLost = 0;
+    UInt64 theJitter = 0;
+
+    UInt8* theBlock = inPacket + kRTCPHeaderSize;
+    for (UInt32 x = 0; x < inCount; x++, theBlock += kReportBlockSize)
+    {
+        RTCPReportBlockSummary* theSummary = &ioSummary->fReportBlocks[x];
+        UInt32 theLost = GetUInt32At(theBlock + 4);
+
+        theSummary->fSourceID = GetUInt32At(theBlock);
+        theSummary->fFractionLost = theLost >> 24;
+        theSummary->fTotalLost = theLost & 0x00FFFFFF;
+        theSummary->fHighestSeqNumReceived = GetUInt32At(theBlock + 8);
+        theSummary->fJitter = GetUInt32At(theBlock + 12);
+        theSummary->fLastSenderReportTime = GetUInt32At(theBlock + 16);
+        theSummary->fLastSenderReportDelay = GetUInt32At(theBlock + 20);
+
+        theFractionLost += theSummary->fFractionLost;
+        theTotalLost += theSummary->fTotalLost;
+        theJitter += theSummary->fJitter;
+    }
+
+    ioSummary->fHasReceiverReport = true;
+    ioSummary->fReceiverReportPacket = inPacket;
+    ioSummary->fReceiverReportLen = inPacketLen;
+    ioSummary->fReceiverSSRC = GetUInt32At(inPacket + 4);
+    ioSummary->fNumReportBlocks = inCount;
+    ioSummary->fCumulativeFractionLost = (inCount > 0) ? theFractionLost / inCount : 0;
+    ioSummary->fCumulativeTotalLost = theTotalLost;
+    ioSummary->fCumulativeJitter = (inCount > 0) ? (UInt32)(theJitter / inCount) : 0;
+    return true;
+}
+
+Bool16 RTCPCompoundParser::IsAck(UInt8* inPacket, UInt32 inPacketLen)
+{
+    if (inPacketLen < kAckMaskOffset)
+        return false;
+
+    UInt32 theAppName = GetUInt32At(inPacket + kAppNameOffset);
+    return (theAppName == (UInt32)kAckPacketType) || (theAppName == (UInt32)kOldAckPacketType);
+}
+
+Bool16 RTCPCompoundParser::ParseAck(UInt8* inPacket, UInt32 inPacketLen, RTCPCompoundSummary* ioSummary)
+{
+    if (ioSummary->fNumAcks == kMaxAcks)
+    {
+        ioSummary->fNumAcksDropped++;
+        return true;
+    }
+
+    RTCPAckSummary* theAck = &ioSummary->fAcks[ioSummary->fNumAcks++];
+    theAck->fPacket = inPacket;
+    theAck->fPacketLen = inPacketLen;
+    theAck->fSeqNum = GetUInt16At(inPacket + kAckSeqNumOffset + 2);
+    theAck->fMask = inPacket + kAckMaskOffset;
+    theAck->fMaskSizeInBytes = inPacketLen - kAckMaskOffset;
+    return true;
+}
+
+Bool16 RTCPCompoundParser::ParseQTSSApp(UInt8* inPacket, UInt32 inPacketLen, UInt32 inCount, RTCPCompoundSummary* ioSummary)
+{
+    if ((inPacketLen < kQTSSDataOffset) || (inCount > 0))
+        return false;
+
+    UInt32 theVersionAndLen = GetUInt32At(inPacket + kQTSSVersionOffset);
+    UInt32 theDataLen = (theVersionAndLen & 0xFFFF) * 4;
+    if (((theVersionAndLen >> 16) != kSupportedQTSSVersion) || (theDataLen > inPacketLen - kQTSSDataOffset))
+        return false;
+
+    RTCPQTSSAppSummary* theApp = &ioSummary->fQTSSApp;
+    ::memset(theApp, 0, sizeof(RTCPQTSSAppSummary));
+    theApp->fOverbufferWindowSize = kUInt32_Max;
+
+    UInt8* theItem = inPacket + kQTSSDataOffset;
+    while (theDataLen >= kQTSSItemHeaderSize)
+    {
+        UInt32 theItemHeader = GetUInt32At(theItem);
+        UInt32 theItemType = theItemHeader >> 16;
+        UInt32 theItemLen = theItemHeader & 0xFF;
+        UInt8* theValue = theItem + kQTSSItemHeaderSize;
+
+        theDataLen -= kQTSSItemHeaderSize;
+        if (theItemLen > theDataLen)
+            break; // don't walk off the end of the packet
+
+        switch (theItemType)
+        {
+            case TW0_CHARS_TO_INT('r', 'r'):    // receiver bit rate
+                if (theItemLen >= 4)
+                    theApp->fReceiverBitRate = GetUInt32At(theValue);
+                break;
+            case TW0_CHARS_TO_INT('l', 't'):    // average late
+                if (theItemLen >= 2)
+                    theApp->fAverageLateMilliseconds = GetUInt16At(theValue);
+                break;
+            case TW0_CHARS_TO_INT('l', 's'):    // percent loss
+                if (theItemLen >= 2)
+                    theApp->fPercentPacketsLost = GetUInt16At(theValue);
+                break;
+            case TW0_CHARS_TO_INT('d', 'l'):    // buffer delay
+                if (theItemLen >= 2)
+                    theApp->fAverageBufferDelayMilliseconds = GetUInt16At(theValue);
+                break;
+            case TW0_CHARS_TO_INT(':', ')'):
+                theApp->fIsGettingBetter = true;
+                break;
+            case TW0_CHARS_TO_INT(':', '('):
+                theApp->fIsGettingWorse = true;
+                break;
+            case TW0_CHARS_TO_INT('e', 'y'):    // eyes, eyes active, eyes paused
+                if (theItemLen >= 4)
+                    theApp->fNumEyes = GetUInt32At(theValue);
+                if (theItemLen >= 8)
+                    theApp->fNumEyesActive = GetUInt32At(theValue + 4);
+                if (theItemLen >= 12)
+                    theApp->fNumEyesPaused = GetUInt32At(theValue + 8);
+                break;
+            case TW0_CHARS_TO_INT('p', 'r'):    // packets received
+                if (theItemLen >= 4)
+                    theApp->fTotalPacketsReceived = GetUInt32At(theValue);
+                break;
+            case TW0_CHARS_TO_INT('p', 'd'):    // packets dropped
+                if (theItemLen >= 2)
+                    theApp->fTotalPacketsDropped = GetUInt16At(theValue);
+                break;
+            case TW0_CHARS_TO_INT('p', 'l'):    // packets lost
+                if (theItemLen >= 2)
+                    theApp->fTotalPacketsLost = GetUInt16At(theValue);
+                break;
+            case TW0_CHARS_TO_INT('b', 'l'):    // buffer fill
+                if (theItemLen >= 2)
+                    theApp->fClientBufferFill = GetUInt16At(theValue);
+                break;
+            case TW0_CHARS_TO_INT('f', 'r'):    // frame rate
+                if (theItemLen >= 2)
+                    theApp->fFrameRate = GetUInt16At(theValue);
+                break;
+            case TW0_CHARS_TO_INT('x', 'r'):    // expected frame rate
+                if (theItemLen >= 2)
+                    theApp->fExpectedFrameRate = GetUInt16At(theValue);
+                break;
+            case TW0_CHARS_TO_INT('d', '#'):    // audio dry count
+                if (theItemLen >= 2)
+                    theApp->fAudioDryCount = GetUInt16At(theValue);
+                break;
+            case TW0_CHARS_TO_INT('o', 'b'):    // overbuffer window size
+                if (theItemLen >= 4)
+                    theApp->fOverbufferWindowSize = GetUInt32At(theValue);
+                break;
+            default:
+                break;
+        }
+
+        theItem = theValue + theItemLen;
+        theDataLen -= theItemLen;
+    }
+
+    ioSummary->fHasQTSSApp = true;
+    ioSummary->fQTSSAppPacket = inPacket;
+    ioSummary->fQTSSAppLen = inPacketLen;
+    return true;
+}
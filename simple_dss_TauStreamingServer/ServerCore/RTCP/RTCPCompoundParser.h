@@ -0,0 +1,139 @@
+/***************************************************************************
+
+Copyright (c) 2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 RTCPCompoundParser.h
+Description: Parses a compound RTCP packet sent by a client in one pass into
+             a fixed size summary, without allocating or copying the packet.
+Comment:
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-19
+LastUpdate:  2026-10-19
+
+****************************************************************************/
+
+#ifndef _RTCPCOMPOUNDPARSER_H_
+#define _RTCPCOMPOUNDPARSER_H_
+
+#include "OSHeaders.h"
+
+/*
+    RTCPCompoundParser::Parse() walks the RR, APP ('qtak' / 'ack ' acks and
+    the compressed 'QTSS' report) and SDES packets of a compound packet and
+    fills in an RTCPCompoundSummary, normally a local of the caller. Every
+    field is read with bounds checks against the length of its own packet,
+    so a summary can be trusted even if the packet was made up.
+
+    Acks keep pointing into the parsed buffer, which must therefore outlive
+    the summary.
+*/
+
+struct RTCPCompoundSummary;
+
+class RTCPCompoundParser
+{
+    public:
+
+        enum
+        {
+            kMaxReportBlocks    = 31,   //UInt32, RC is 5 bits
+            kMaxAcks            = 8     //UInt32, acks beyond this are counted in fNumAcksDropped
+        };
+
+        enum
+        {
+            kSupportedRTCPVersion   = 2,    //UInt32
+            kReceiverPacketType     = 201,  //UInt32
+            kSDESPacketType         = 202,  //UInt32
+            kAPPPacketType          = 204   //UInt32
+        };
+
+        // Returns false if a malformed packet was found. The summary
+        // still describes every well formed packet before it.
+        static Bool16   Parse(UInt8* inData, UInt32 inLen, RTCPCompoundSummary* outSummary);
+
+    private:
+
+        static Bool16   ParseReceiverReport(UInt8* inPacket, UInt32 inPacketLen, UInt32 inCount, RTCPCompoundSummary* ioSummary);
+        static Bool16   ParseAck(UInt8* inPacket, UInt32 inPacketLen, RTCPCompoundSummary* ioSummary);
+        static Bool16   ParseQTSSApp(UInt8* inPacket, UInt32 inPacketLen, UInt32 inCount, RTCPCompoundSummary* ioSummary);
+        static Bool16   IsAck(UInt8* inPacket, UInt32 inPacketLen);
+};
+
+struct RTCPReportBlockSummary
+{
+    UInt32  fSourceID;
+    UInt32  fFractionLost;          // in 1/256
+    UInt32  fTotalLost;
+    UInt32  fHighestSeqNumReceived;
+    UInt32  fJitter;
+    UInt32  fLastSenderReportTime;
+    UInt32  fLastSenderReportDelay; // in 1/65536 seconds
+};
+
+struct RTCPAckSummary
+{
+    UInt8*  fPacket;                // the whole APP packet, points into the parsed buffer
+    UInt32  fPacketLen;
+    UInt16  fSeqNum;
+    UInt8*  fMask;                  // the most significant bit of the first byte acks fSeqNum + 1
+    UInt32  fMaskSizeInBytes;
+
+    Bool16  IsNthBitEnabled(UInt32 inBitNumber)
+                { return (fMask[inBitNumber >> 3] & (0x80 >> (inBitNumber & 7))) != 0; }
+    UInt32  GetMaskSizeInBits()     { return fMaskSizeInBytes * 8; }
+};
+
+// Items of the compressed QTSS APP packet, see RTCPCompressedQTSSPacket
+struct RTCPQTSSAppSummary
+{
+    UInt32  fReceiverBitRate;
+    UInt16  fAverageLateMilliseconds;
+    UInt16  fPercentPacketsLost;
+    UInt16  fAverageBufferDelayMilliseconds;
+    Bool16  fIsGettingBetter;
+    Bool16  fIsGettingWorse;
+    UInt32  fNumEyes;
+    UInt32  fNumEyesActive;
+    UInt32  fNumEyesPaused;
+    UInt32  fOverbufferWindowSize;  // kUInt32_Max if the client did not send one
+    UInt32  fTotalPacketsReceived;
+    UInt16  fTotalPacketsDropped;
+    UInt16  fTotalPacketsLost;
+    UInt16  fClientBufferFill;
+    UInt16  fFrameRate;
+    UInt16  fExpectedFrameRate;
+    UInt16  fAudioDryCount;
+};
+
+struct RTCPCompoundSummary
+{
+    UInt32  fNumPackets;            // well formed packets, of any type
+    UInt32  fNumBytes;
+    UInt32  fNumUnknownPackets;
+    Bool16  fMalformed;
+
+    // The last receiver report of the compound packet
+    Bool16  fHasReceiverReport;
+    UInt8*  fReceiverReportPacket;
+    UInt32  fReceiverReportLen;
+    UInt32  fReceiverSSRC;
+    UInt32  fNumReportBlocks;
+    UInt32  fCumulativeFractionLost;    // average of all report blocks
+    UInt32  fCumulativeTotalLost;       // sum of all report blocks
+    UInt32  fCumulativeJitter;          // average of all report blocks
+    RTCPReportBlockSummary fReportBlocks[RTCPCompoundParser::kMaxReportBlocks];
+
+    UInt32  fNumAcks;
+    UInt32  fNumAcksDropped;
+    RTCPAckSummary fAcks[RTCPCompoundParser::kMaxAcks];
+
+    // The last compressed QTSS APP packet of the compound packet
+    Bool16  fHasQTSSApp;
+    UInt8*  fQTSSAppPacket;
+    UInt32  fQTSSAppLen;
+    RTCPQTSSAppSummary fQTSSApp;
+};
+
+#endif //_RTCPCOMPOUNDPARSER_H_
@@ -6,8 +6,8 @@ Copyright (c) 1999-2003 Apple Computer, Inc.  All Rights Reserved.
 
 FileName:	 RTCPTask.cpp
 Description: A task object that processes all incoming RTCP packets for the server, 
-             and passes each one onto the task for which it belongs, by goes through 
-			 all the UDPSockets in the RTPSocketPool.
+             and passes each one onto the task for which it belongs, by reading
+			 the RTCP sockets in the RTPSocketPool that have data.
 Comment:     copy from Darwin Streaming Server 5.5.5
 Author:		 taoyunxing@dadimedia.com
 Version:	 v1.0.0.1
@@ -25,83 +25,103 @@ LastUpdate:  2010-08-16
 #include "UDPSocketPool.h"
 
 
-SInt64 RTCPTask::Run()
+RTCPSocket::RTCPSocket(RTCPTask* inTask, UInt32 inSocketType)
+:   UDPSocket(inTask, inSocketType), fRTCPTask(inTask), fReadyElem()
+{
+    fReadyElem.SetEnclosingObject(this);
+}
+
+RTCPSocket::~RTCPSocket()
+{
+    // Wait for an event being processed and stop new ones, before leaving the queue
+    this->Cleanup();
+    fRTCPTask->RemoveReadySocket(this);
+}
+
+/* RTCPʱ,ԼRTCPTaskľ,ٴ¼ */
+void RTCPSocket::ProcessEvent(int /*eventBits*/)
 {
-    const UInt32 kMaxRTCPPacketSize = 2048;
-	/* RTCPĻС2048ֽ */
-    char thePacketBuffer[kMaxRTCPPacketSize];
-	/* ڴUDPSocketϵõһRTCP,䳤Ϊ0 */
-    StrPtrLen thePacket(thePacketBuffer, 0);
+    fRTCPTask->AddReadySocket(this);
+    fRTCPTask->Signal(Task::kReadEvent);
+}
+
+void RTCPTask::AddReadySocket(RTCPSocket* inSocket)
+{
+    OSMutexLocker locker(&fReadyMutex);
+    fReadyQueue.EnQueue(&inSocket->fReadyElem); // does nothing if it is already there
+}
+
+void RTCPTask::RemoveReadySocket(RTCPSocket* inSocket)
+{
+    OSMutexLocker locker(&fReadyMutex);
+    if (inSocket->fReadyElem.IsMemberOfAnyQueue())
+        fReadyQueue.Remove(&inSocket->fReadyElem);
+}
 
+SInt64 RTCPTask::Run()
+{
 	/* ȡӿ */
     QTSServerInterface* theServer = QTSServerInterface::GetServer();
     
-    //This task goes through all the UDPSockets in the RTPSocketPool, checking to see
-    //if they have data. If they do, it demuxes() the packets and sends the packet onto
-    //the proper RTP session.
+    //This task goes through the RTCP sockets that got a read event. It demuxes() their
+    //packets and sends each packet onto the proper RTP session.
     EventFlags events = this->GetEvents(); // get and clear events
     
-	//Must be done atomically wrt the socket pool.
+	//Must be done atomically wrt the socket pool, which deletes the sockets.
     if ( (events & Task::kReadEvent) || (events & Task::kIdleEvent) )
     {  
 	    /* õUDPSocketPoolĻ */
         OSMutexLocker locker(theServer->GetSocketPool()->GetMutex());
-		/* UDPSocketPoolеUDPSocketPairɵĶ,ֱյĶԪͣ */
-        for (OSQueueIter iter(theServer->GetSocketPool()->GetSocketQueue()); !iter.IsDone(); iter.Next())                 
+        while (true)
         {
-            UInt32 theRemoteAddr = 0; //Client˵IP
-            UInt16 theRemotePort = 0; //Client˵Ķ˿
-
-			/* õǰԪڵĶUDPSocketPai */
-            UDPSocketPair* thePair = (UDPSocketPair*)iter.GetCurrent()->GetEnclosingObject();
-            Assert(thePair != NULL);
-            
-			/* ÿUDPSocketPair,ȡUDPSocket,һȡRTCPǸSocketUDPDemuxer(һHashTable) */
-            for (UInt32 x = 0; x < 2; x++)
+            RTCPSocket* theSocket = NULL;
             {
-				UDPSocket* theSocket = NULL;
-				if (x == 0)
-					theSocket = thePair->GetSocketA(); //RTPUDPSocket
-				else
-					theSocket = thePair->GetSocketB(); //RTCPUDPSocket
-	             
-				/* ȡUDPSocketصUDPDemuxer */
-				UDPDemuxer* theDemuxer = theSocket->GetDemuxer();
-				if (theDemuxer == NULL) 
-					continue; //ضǷRTPUDPSocket,ûиUDPDemuxer,
-				else
-				{
-					/* ȡUDPDemuxerĻ, */
-					theDemuxer->GetMutex()->Lock();
-					while (true) //get all the outstanding packets for this socket
-					{
-						thePacket.Len = 0;
-						//Client˷ͻRTCP,ָRTCP,С2048ֽ
-						theSocket->RecvFrom(&theRemoteAddr, &theRemotePort, thePacket.Ptr,  kMaxRTCPPacketSize, &thePacket.Len);
-						/* û,Ͷ¼TaskThread */
-						if (thePacket.Len == 0) //no more packets on this socket!
-						{
-							theSocket->RequestEvent(EV_RE);   
-							break; //жwhileѭ
-						}
-                        
-						//if this socket has a demuxer(), find the target RTPStream
-						if (theDemuxer != NULL)
-						{
-							//ݣ临ȡӦRTPSession
-							RTPStream* theStream = (RTPStream*)theDemuxer->GetTask(theRemoteAddr, theRemotePort);
-							if (theStream != NULL)
-								// յRTCP
-								theStream->ProcessIncomingRTCPPacket(&thePacket);
-						}
-					}
-					/* ͷŻ */
-					theDemuxer->GetMutex()->Unlock();
-				}
-           }
-       }
+                OSMutexLocker readyLocker(&fReadyMutex);
+                OSQueueElem* theElem = fReadyQueue.DeQueue();
+                if (theElem == NULL)
+                    break;
+                theSocket = (RTCPSocket*)theElem->GetEnclosingObject();
+            }
+            this->ReadSocket(theSocket);
+        }
     }
      
     return 0; 
     
 }
+
+void RTCPTask::ReadSocket(RTCPSocket* inSocket)
+{
+	/* ȡUDPSocketصUDPDemuxer */
+    UDPDemuxer* theDemuxer = inSocket->GetDemuxer();
+    Assert(theDemuxer != NULL);
+
+	/* ȡUDPDemuxerĻ, */
+    OSMutexLocker locker(theDemuxer->GetMutex());
+    while (true) //get all the outstanding packets for this socket
+    {
+        UInt32 theNumPackets = 0;
+        (void)inSocket->RecvFromMultiple(fPacketBuffers, kMaxRTCPPacketSize, kPacketsPerRead,
+                                         fRemoteAddrs, fRemotePorts, fPacketLens, &theNumPackets);
+
+        for (UInt32 x = 0; x < theNumPackets; x++)
+        {
+            //find the target RTPStream
+            RTPStream* theStream = (RTPStream*)theDemuxer->GetTask(fRemoteAddrs[x], fRemotePorts[x]);
+            if (theStream != NULL)
+            {
+                StrPtrLen thePacket(&fPacketBuffers[x * kMaxRTCPPacketSize], fPacketLens[x]);
+                // յRTCP
+                theStream->ProcessIncomingRTCPPacket(&thePacket);
+            }
+        }
+
+        // A short read means the socket is empty. Wait for the next packet
+		/* ûи,Ͷ¼TaskThread */
+        if (theNumPackets < kPacketsPerRead)
+        {
+            inSocket->RequestEvent(EV_RE);
+            break;
+        }
+    }
+}
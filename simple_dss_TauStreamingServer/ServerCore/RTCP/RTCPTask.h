@@ -6,8 +6,8 @@ Copyright (c) 1999-2003 Apple Computer, Inc.  All Rights Reserved.
 
 FileName:	 RTCPTask.h
 Description: A task object that processes all incoming RTCP packets for the server, 
-             and passes each one onto the task for which it belongs, by goes through 
-			 all the UDPSockets in the RTPSocketPool.
+             and passes each one onto the task for which it belongs, by reading
+			 the RTCP sockets in the RTPSocketPool that have data.
 Comment:     copy from Darwin Streaming Server 5.5.5
 Author:		 taoyunxing@dadimedia.com
 Version:	 v1.0.0.1
@@ -22,17 +22,61 @@ LastUpdate:  2010-08-16
 #define __RTCP_TASK_H__
 
 #include "Task.h"
+#include "UDPSocket.h"
+#include "OSQueue.h"
+#include "OSMutex.h"
+
+class RTCPSocket;
 
 class RTCPTask : public Task
 {
     public:
-        //This task handles all incoming RTCP data. It just polls, so make sure
-        //to start the polling process by signalling a start event.
-        RTCPTask() : Task() {this->SetTaskName("RTCPTask"); this->Signal(Task::kStartEvent); }
+        //This task handles all incoming RTCP data. It only reads the RTCP sockets
+        //that got a read event since it last ran, see RTCPSocket.
+        RTCPTask() : Task(), fReadyMutex(), fReadyQueue() {this->SetTaskName("RTCPTask"); this->Signal(Task::kStartEvent); }
         virtual ~RTCPTask() {}
+
+        // Called from the event thread, and by a socket that goes away
+        void    AddReadySocket(RTCPSocket* inSocket);
+        void    RemoveReadySocket(RTCPSocket* inSocket);
     
     private:
+        enum
+        {
+            kMaxRTCPPacketSize  = 2048, //UInt32
+            kPacketsPerRead     = 16    //UInt32
+        };
+
         virtual SInt64 Run();
+
+        // Reads all the RTCP packets waiting on the socket
+        void    ReadSocket(RTCPSocket* inSocket);
+
+        OSMutex fReadyMutex;
+        OSQueue fReadyQueue;
+
+        char    fPacketBuffers[kPacketsPerRead * kMaxRTCPPacketSize];
+        UInt32  fRemoteAddrs[kPacketsPerRead];
+        UInt16  fRemotePorts[kPacketsPerRead];
+        UInt32  fPacketLens[kPacketsPerRead];
+};
+
+// The RTCP socket of an RTP socket pair. A read event on it puts it on the
+// ready queue of the RTCPTask, rather than just waking the task, so the
+// task reads the sockets that have packets and not every socket in the pool.
+class RTCPSocket : public UDPSocket
+{
+    public:
+        RTCPSocket(RTCPTask* inTask, UInt32 inSocketType);
+        virtual ~RTCPSocket();
+
+        virtual void ProcessEvent(int eventBits);
+
+    private:
+        RTCPTask*   fRTCPTask;
+        OSQueueElem fReadyElem;
+
+        friend class RTCPTask;
 };
 
 #endif //__RTCP_TASK_H__
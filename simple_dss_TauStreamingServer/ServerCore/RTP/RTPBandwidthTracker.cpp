@@ -34,43 +34,9 @@ void RTPBandwidthTracker::SetWindowSize( SInt32 clientWindowSize )
     // since this occurs before the stream starts to send
     //һ֪Client bufferС,ҪRTPBandwidthTracker::SetWindowSize()rwndС    
     fClientWindow = clientWindowSize;
-    fLastCongestionAdjust = 0;/* һӵʱ */
 
-	/* ΪRTPBandwidthTrackerຬRTPPacketResender */
-#if RTP_PACKET_RESENDER_DEBUGGING   
-    // test to see what happens w/o slow start at beginning
-    //if ( initSlowStart )
-    //  qtss_printf( "ack list initializing with slow start.\n" );
-    //else
-    //  qtss_printf( "ack list initializing at full speed.\n" );
-#endif
-     
-	/* ʹ㷨ȫ,ɸRTPBandwidthTrackerʵξ */
-    if ( fUseSlowStart )
-    {
-		/* ֵС,СΪ24*3/4=18Kbytes */
-        fSlowStartThreshold = clientWindowSize * 3 / 4;
-        
-		//TCP㷨ʱػ£öԷȷϳҪܳʱ䣬
-		//ı䣬cwndΪrwndһ룬TCPֻһĶεĳȡ
-        //
-        // This is a change to the standard TCP slow start algorithm(׼TCP㷨). What
-        // we found was that on high bitrate high latency networks (a DSL connection, perhaps),
-        // it took just too long for the ACKs to come in and for the window size to
-        // grow enough. So we cheat a bit.
-        fCongestionWindow = clientWindowSize / 2;
-        //fCongestionWindow = kMaximumSegmentSize;
-    }
-	//ʹ㷨,full speedȫssthreshcwndΪrwndС͵ֻҪrwndСͿˡ
-    else
-    {   
-        fSlowStartThreshold = clientWindowSize;
-        fCongestionWindow = clientWindowSize;
-    }
-    
-	//һ±,֤ssthreshСһMSS(1466ֽ),һ˵,ⲻܴﵽ
-    if ( fSlowStartThreshold < kMaximumSegmentSize )
-        fSlowStartThreshold = kMaximumSegmentSize;
+	/* ӵ㷨cwndssthreshĳʼֵ,μRTPCongestionController::SetClientWindow() */
+    fController->SetClientWindow(clientWindowSize, OS::Milliseconds());
 }
 
 /******************************** ע:úҪ,RTPPacketResender.cppж!! *****************************************/
@@ -84,7 +50,7 @@ void RTPBandwidthTracker::EmptyWindow( UInt32 bytesIncreased, Bool16 updateBytes
         return;
      
 	/* ȷ(congestion Window,Client Window) */
-    Assert(fClientWindow > 0 && fCongestionWindow > 0);
+    Assert(fClientWindow > 0 && fController->CongestionWindow() > 0);
     
 	//һbytesIncreased(ָµõȷϵֽ)СڵǰδõȷϵֽfBytesInList
 	//һִڵbytesIncreasedΪfBytesInList(ضϲֺ)
@@ -100,80 +66,34 @@ void RTPBandwidthTracker::EmptyWindow( UInt32 bytesIncreased, Bool16 updateBytes
     Assert(fBytesInList < ((UInt32)fClientWindow + 2000)); //mainly just to catch fBytesInList wrapping below 0
     
     // update the congestion window by the number of bytes just acknowledged.
-    //congestion Window(cwd)ʱ,ʹӵ,µõȷϵֽһ㷨·cwnd       
-    if ( fCongestionWindow >= fSlowStartThreshold )
-    {
-        // when we hit the slow start threshold, only increase the window for each window full of acks.
-		//cwndСssthresh,ӵ׶,karn㷨ñʽӦ: fCongestionWindow += bytesIncreased / fCongestionWindow;
-		//ڸʱص,ҪյԷȷҪϳʱ,˶Ը㷨һ,ԱcwndСƶ˷͵ʡ
-		/***************  ע㷨!  *************************/
-        fCongestionWindow += bytesIncreased * bytesIncreased / fCongestionWindow;
-		/***************  ע㷨!  *************************/
-    }
-    else
-        // This is a change to the standard TCP slow start algorithm. What
-        // we found was that on high bitrate high latency networks (a DSL connection, perhaps),
-        // it took just too long for the ACKs to come in and for the window size to grow enough. So we cheat a bit.
-        //֮׼TCP㷨,вͬ
-		//cwndСssthresh£ʹӵƣôkarn㷨һcwnd,Ack(ȷ)ֽ
-        fCongestionWindow += bytesIncreased;
+	// ӵ㷨µõȷϵֽcwnd,μRTPCongestionController::OnAck()
+    fController->OnAck(bytesIncreased, fBytesInList, OS::Milliseconds());
+}
 
-    
-	/* cwdвĿ,ҪʼȷcwdClient Window */
-    if ( fCongestionWindow > fClientWindow )
-        fCongestionWindow = fClientWindow;
-    
-//  qtss_printf("Window = %d, %d left\n", fCongestionWindow, fCongestionWindow-fBytesInList);
+/* ûеõȷ϶طݰ,ӴƳ,֪ͨӵ㷨(μRTPPacketResender::ResendDueEntries()) */
+void RTPBandwidthTracker::ExpireFromWindow( UInt32 inNumBytes )
+{
+    if (inNumBytes == 0)
+        return;
+
+    Assert(fClientWindow > 0 && fController->CongestionWindow() > 0);
+
+    if (fBytesInList < inNumBytes)
+        inNumBytes = fBytesInList;
+    fBytesInList -= inNumBytes;
+
+    fController->OnLoss(inNumBytes, OS::Milliseconds());
 }
 
-/* ÿ250ms,һ㷨,µssthreshcwndĴС(С1466ֽ)ÿѭطݰ(μRTPPacketResender::ResendDueEntries())󣬼ʱʱ򱻵á */
+/* ÿѭطݰ(μRTPPacketResender::ResendDueEntries())󣬼ʱʱ򱻵,ӵ㷨µssthreshcwndĴС */
 void RTPBandwidthTracker::AdjustWindowForRetransmit()
 {
     // this assert hits ȷ͵ûյȷAckݵָΧ
     Assert(fBytesInList < ((UInt32)fClientWindow + 2000)); //mainly just to catch fBytesInList wrapping below 0
 
-    // slow start says that we should reduce the new ss threshold to 1/2
-    // of where started getting errors ( the current congestion window size )        
-    // so, we get a burst of re-transmit because our RTO was mis-estimated
-    // it doesn't seem like we should lower the threshold for each one.
-    // it seems like we should just lower it when we first enter the re-transmit "state" 
-//  if ( !fIsRetransmitting )
-//      fSlowStartThreshold = fCongestionWindow/2;
-    
-    // make sure that it is at least 1 packet
-	// ֤ssthreshСһ(RTP)ݰĳ1466ֽ
-    if ( fSlowStartThreshold < kMaximumSegmentSize )
-        fSlowStartThreshold = kMaximumSegmentSize;
-
-	//ٴڱļ
-    // start the full window segemnt counter over again.
-    fSlowStartByteCount = 0;
-    
-	/* ȡǰʱ */
-    SInt64 theTime = OS::Milliseconds();
-
-	/* TCP㷨УssthreshΪǰcwndһ룬cwndĴСΪһݰĳȣﲻô
-	Ҫط£250msһssthreshcwndСRTPBandwidthTracker::SetWindowSize() */
-    if (theTime - fLastCongestionAdjust > 250)
-    {
-		/* עRTPBandwidthTracker::SetWindowSize(),Client WindowΪcongest window */
-        fSlowStartThreshold = fCongestionWindow * 3 / 4;
-        fCongestionWindow = fCongestionWindow / 2;	
-        fLastCongestionAdjust = theTime;/* ʱϴӵʱ  */
-    }
+    // the controller decides how far to back off, Reno halves the window at most every 250ms
+    fController->OnRetransmitTimeout(OS::Milliseconds());
 
-/*
-    if ( fSlowStartThreshold < fCongestionWindow )
-        fCongestionWindow = fSlowStartThreshold/2;
-    else
-        fCongestionWindow = fCongestionWindow /2;
-*/  
-      
-	//ϱʽʾ״ãcwndԽԽСﱣ֤cwndССһRTPݰС
-    if ( fCongestionWindow < kMaximumSegmentSize )
-        fCongestionWindow = kMaximumSegmentSize;
-
-    // qtss_printf("Congestion window now %d\n", fCongestionWindow);
 	/* ڿش */
     fIsRetransmitting = true;
 }
@@ -183,8 +103,12 @@ void RTPBandwidthTracker::AdjustWindowForRetransmit()
 /* £ҪRTO㣺һǵյһȷݰҸðһηͳɹͽð
 ͵յȷϵʱΪһRTOƵμRTPPacketResender::AckPacketĳݰһαط
 ˳ʱʱʱûյAck,ϴιƵRTO1.5Ϊ¸RTOƵμRTPPacketResender::ResendDueEntries() */
-void RTPBandwidthTracker::AddToRTTEstimate( SInt32 rttSampleMSecs )
+void RTPBandwidthTracker::AddToRTTEstimate( SInt32 rttSampleMSecs, Bool16 inIsMeasured )
 {
+	/* ֻʵʲRTTŽӵ㷨,طʱ1.5RTOֵ */
+    if (inIsMeasured)
+        fController->OnRTTSample(rttSampleMSecs, OS::Milliseconds());
+
 //  qtss_printf("%d ", rttSampleMSecs);
 //  static int count = 0;
 //  if ((count++ % 10) == 0) qtss_printf("\n");
@@ -238,12 +162,13 @@ void RTPBandwidthTracker::UpdateStats()
 {
 	/* cwndĴ1 */
     fNumStatsSamples++;
+    SInt32 theCongestionWindow = fController->CongestionWindow();
     
 	/* С congestion WindowsС */
-    if (fMaxCongestionWindowSize < fCongestionWindow)
-        fMaxCongestionWindowSize = fCongestionWindow;
-    if (fMinCongestionWindowSize > fCongestionWindow)
-        fMinCongestionWindowSize = fCongestionWindow;
+    if (fMaxCongestionWindowSize < theCongestionWindow)
+        fMaxCongestionWindowSize = theCongestionWindow;
+    if (fMinCongestionWindowSize > theCongestionWindow)
+        fMinCongestionWindowSize = theCongestionWindow;
      
 	/* ¼fUnadjustedRTOСֵ */
     if (fMaxRTO < fUnadjustedRTO)
@@ -252,7 +177,7 @@ void RTPBandwidthTracker::UpdateStats()
         fMinRTO = fUnadjustedRTO;
 
 	/* ۼcongestion WindowsܴС */
-    fTotalCongestionWindowSize += fCongestionWindow;
+    fTotalCongestionWindowSize += theCongestionWindow;
 	/* ۼfUnadjustedRTOܴС */
     fTotalRTO += fUnadjustedRTO;
 }
@@ -264,7 +189,7 @@ void RTPBandwidthTracker::UpdateAckTimeout(UInt32 bitsSentInInterval, SInt64 int
 	/* յӰǰBitrate,Ҫ೤congestion Window */
     UInt32 unadjustedTimeout = 0;
     if (bitsSentInInterval > 0)
-        unadjustedTimeout = (UInt32) ((intervalLengthInMsec * fCongestionWindow) / bitsSentInInterval);
+        unadjustedTimeout = (UInt32) ((intervalLengthInMsec * fController->CongestionWindow()) / bitsSentInInterval);
 
     // If we wait that long, that's too long because we need to actually wait for the ack to arrive.
     // So, subtract 1/2 the rto - the last ack timeout
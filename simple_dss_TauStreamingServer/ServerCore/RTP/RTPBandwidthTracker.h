@@ -20,23 +20,21 @@ LastUpdate:  2010-08-16
 #define __RTP_BANDWIDTH_TRACKER_H__
 
 #include "OSHeaders.h"
+#include "RTPCongestionController.h"
 
 class RTPBandwidthTracker
 {
     public:
 
-        RTPBandwidthTracker(Bool16 inUseSlowStart)
+        RTPBandwidthTracker(Bool16 inUseSlowStart, UInt32 inCongestionControl = RTPCongestionController::kReno)
          :  fRunningAverageMSecs(0),
             fRunningMeanDevationMSecs(0),
             fCurRetransmitTimeout( kMinRetransmitIntervalMSecs ),/* 先设为600ms */
             fUnadjustedRTO( kMinRetransmitIntervalMSecs ),/* 先设为600ms */
-            fCongestionWindow(kMaximumSegmentSize),/* 先设置为1466,一个RTP Packet的大小 */
-            fSlowStartThreshold(0),/* 设置参见RTPBandwidthTracker::SetWindowSize(),在1466字节和client窗口大小之间 */
-            fSlowStartByteCount(0),
+            fController(RTPCongestionController::Create(inCongestionControl, inUseSlowStart)),/* 拥塞控制算法,由预设值决定 */
             fClientWindow(0),/* 注意初始值为0, used in RTPBandwidthTracker::SetWindowSize() */
             fBytesInList(0), /* RTPStream中发送但未得到确认的字节数,暂设为0 */
             fAckTimeout(kMinAckTimeout),   /* 先初始化为20ms */
-            fUseSlowStart(inUseSlowStart), /* 由入参来设置是否使用慢启动算法? */
             fMaxCongestionWindowSize(0),
             fMinCongestionWindowSize(1000000),
             fMaxRTO(0),
@@ -46,7 +44,7 @@ class RTPBandwidthTracker
             fNumStatsSamples(0)
         {}
         
-        ~RTPBandwidthTracker() {}
+        ~RTPBandwidthTracker() { delete fController; }
         
         // Initialization - give the client's window size.
         void SetWindowSize(SInt32 clientWindowSize);
@@ -58,6 +56,10 @@ class RTPBandwidthTracker
         // When data is acked, let the tracker know how much
         // data was acked so it can adjust the window
         void EmptyWindow(UInt32 inNumBytes, Bool16 updateBytesInList = true);
+
+        // When data expires without being acked, let the tracker know
+        // so it can take it out of the window
+        void ExpireFromWindow(UInt32 inNumBytes);
         
         // When retransmitting a packet, call this function so
         // the tracker can adjust the window sizes and back off.
@@ -65,18 +67,20 @@ class RTPBandwidthTracker
 
 		// Each RTT sample you get, let the tracker know what it is so it can keep a good running average.
 		/* 对给定的入参样本,用Karn算法计算RTO */
-		void AddToRTTEstimate( SInt32 rttSampleMSecs );
+		// inIsMeasured is false for the guesses made when a packet is resent.
+		void AddToRTTEstimate( SInt32 rttSampleMSecs, Bool16 inIsMeasured = true );
         
         // ACCESSORS
 		/* 准备好接收Client Ack了吗? */
-        const Bool16 ReadyForAckProcessing()    { return (fClientWindow > 0 && fCongestionWindow > 0); } // see RTPBandwidthTracker::EmptyWindow for requirements
+        const Bool16 ReadyForAckProcessing()    { return (fClientWindow > 0 && fController->CongestionWindow() > 0); } // see RTPBandwidthTracker::EmptyWindow for requirements
         /* 是否需要流控?当RTPStream中发送但未得到确认的字节数超过阻塞窗的大小时,采用流控 */
-		const Bool16 IsFlowControlled()         { return ( (SInt32)fBytesInList >= fCongestionWindow ); }
+		const Bool16 IsFlowControlled()         { return ( (SInt32)fBytesInList >= fController->CongestionWindow() ); }
 
         const SInt32 ClientWindowSize()         { return fClientWindow; }
         const UInt32 BytesInList()              { return fBytesInList; }
-        const SInt32 CongestionWindow()         { return fCongestionWindow; }
-        const SInt32 SlowStartThreshold()       { return fSlowStartThreshold; }
+        const SInt32 CongestionWindow()         { return fController->CongestionWindow(); }
+        const SInt32 SlowStartThreshold()       { return fController->SlowStartThreshold(); }
+        RTPCongestionController* GetCongestionController() { return fController; }
 
         const SInt32 RunningAverageMSecs()      { return fRunningAverageMSecs / 8; }  // fRunningAverageMSecs is stored scaled up 8x
         const SInt32 RunningMeanDevationMSecs() { return fRunningMeanDevationMSecs/ 4; } // fRunningMeanDevationMSecs is stored scaled up 4x
@@ -86,7 +90,7 @@ class RTPBandwidthTracker
         
 		/* 获取当前传输比特率 */
 		const SInt32 GetCurrentBandwidthInBps()
-            { return (fUnadjustedRTO > 0) ? (fCongestionWindow * 1000) / fUnadjustedRTO : 0; }
+            { return (fUnadjustedRTO > 0) ? (fController->CongestionWindow() * 1000) / fUnadjustedRTO : 0; }
 
 		/* 获取Client的ack timeout,在20--100之间 */
         inline const UInt32 RecommendedClientAckTimeout() { return fAckTimeout; }
@@ -135,11 +139,7 @@ class RTPBandwidthTracker
 		Bool16  fIsRetransmitting;    // are we in the re-transmit 'state' ( started resending, but have yet to send 'new' data) //是否正处于重传状态?参见RTPBandwidthTracker::AdjustWindowForRetransmit()
         
         // Tracking our window sizes
-        SInt64  fLastCongestionAdjust;  //上次拥塞调整时间,参见RTPBandwidthTracker::AdjustWindowForRetransmit()
-        SInt32  fCongestionWindow;      // implentation of VJ congestion avoidance  //当前服务器端拥塞窗口大小
-        SInt32  fSlowStartThreshold;    // point at which we stop adding to the window for each ack, and add to the window for each window full of acks // 慢启动门限
-		SInt32  fSlowStartByteCount;    // counts window a full of acks when past ss(slow start) thresh //?? 超过慢启动阈值后,满窗口报文计数,参见RTPBandwidthTracker::AdjustWindowForRetransmit()
-		Bool16  fUseSlowStart;          //使用慢启动算法ss(slow start) algorithm吗?
+        RTPCongestionController* fController; // owns the congestion window, see RTPCongestionController.h
 
 		
         /*********** NOTE:这个量非常重要!! ***************/
@@ -0,0 +1,406 @@
+/***************************************************************************
+
+Copyright (c) 2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 RTPCongestionController.cpp
+Description: Congestion control algorithms for reliable UDP, plugged into
+             RTPBandwidthTracker: the original Reno like window, a delay
+             based LEDBAT like window and a BBR like rate based model.
+Comment:
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-19
+LastUpdate:  2026-10-19
+
+****************************************************************************/
+
+#include "RTPCongestionController.h"
+#include <string.h>
+#include "OSMemory.h"
+
+static const char* sCongestionControllerNames[RTPCongestionController::kNumTypes] = { "reno", "ledbat", "bbr" };
+
+RTPCongestionController* RTPCongestionController::Create(UInt32 inType, Bool16 inUseSlowStart)
+{
+    switch (inType)
+    {
+        case kLEDBAT:   return NEW RTPLEDBATController(inUseSlowStart);
+        case kBBR:      return NEW RTPBBRController();
+        default:        return NEW RTPRenoController(inUseSlowStart);
+    }
+}
+
+UInt32 RTPCongestionController::GetTypeFromName(StrPtrLen* inName)
+{
+    for (UInt32 x = 0; x < kNumTypes; x++)
+    {
+        if (inName->EqualIgnoreCase(sCongestionControllerNames[x], ::strlen(sCongestionControllerNames[x])))
+            return x;
+    }
+    return kNumTypes;
+}
+
+const char* RTPCongestionController::GetTypeName(UInt32 inType)
+{
+    if (inType >= kNumTypes)
+        return "unknown";
+    return sCongestionControllerNames[inType];
+}
+
+void RTPCongestionController::ClampWindow()
+{
+    if (fCongestionWindow > fClientWindow)
+        fCongestionWindow = fClientWindow;
+    if (fCongestionWindow < kMaximumSegmentSize)
+        fCongestionWindow = kMaximumSegmentSize;
+}
+
+/******************************** RTPRenoController ********************************/
+
+void RTPRenoController::SetClientWindow(SInt32 inClientWindow, SInt64 inCurTime)
+{
+    fClientWindow = inClientWindow;
+    fLastCongestionAdjust = 0;
+
+    if (fUseSlowStart)
+    {
+        // This is a change to the standard TCP slow start algorithm. What
+        // we found was that on high bitrate high latency networks (a DSL connection, perhaps),
+        // it took just too long for the ACKs to come in and for the window size to
+        // grow enough. So we cheat a bit.
+        fSlowStartThreshold = inClientWindow * 3 / 4;
+        fCongestionWindow = inClientWindow / 2;
+    }
+    else
+    {
+        fSlowStartThreshold = inClientWindow;
+        fCongestionWindow = inClientWindow;
+    }
+
+    if (fSlowStartThreshold < kMaximumSegmentSize)
+        fSlowStartThreshold = kMaximumSegmentSize;
+}
+
+void RTPRenoController::OnAck(UInt32 inNumBytes, UInt32 /*inBytesInFlight*/, SInt64 /*inCurTime*/)
+{
+    // update the congestion window by the number of bytes just acknowledged.
+    if (fCongestionWindow >= fSlowStartThreshold)
+    {
+        // when we hit the slow start threshold, only increase the window for each window full of acks.
+        // (standard congestion avoidance would add inNumBytes * MSS / cwnd, this grows faster on purpose)
+        fCongestionWindow += inNumBytes * inNumBytes / fCongestionWindow;
+    }
+    else
+        // This is a change to the standard TCP slow start algorithm. What
+        // we found was that on high bitrate high latency networks (a DSL connection, perhaps),
+        // it took just too long for the ACKs to come in and for the window size to grow enough. So we cheat a bit.
+        fCongestionWindow += inNumBytes;
+
+    if (fCongestionWindow > fClientWindow)
+        fCongestionWindow = fClientWindow;
+}
+
+void RTPRenoController::OnLoss(UInt32 inNumBytes, SInt64 inCurTime)
+{
+    // Expired packets open the window like acked ones, as DSS always did
+    this->OnAck(inNumBytes, 0, inCurTime);
+}
+
+void RTPRenoController::OnRetransmitTimeout(SInt64 inCurTime)
+{
+    // make sure that it is at least 1 packet
+    if (fSlowStartThreshold < kMaximumSegmentSize)
+        fSlowStartThreshold = kMaximumSegmentSize;
+
+    // Resends come in bursts because the RTO was mis-estimated, so back off
+    // once per burst rather than for each resent packet
+    if (inCurTime - fLastCongestionAdjust > kAdjustIntervalMSecs)
+    {
+        fSlowStartThreshold = fCongestionWindow * 3 / 4;
+        fCongestionWindow = fCongestionWindow / 2;
+        fLastCongestionAdjust = inCurTime;
+    }
+
+    if (fCongestionWindow < kMaximumSegmentSize)
+        fCongestionWindow = kMaximumSegmentSize;
+}
+
+/******************************** RTPLEDBATController ********************************/
+
+RTPLEDBATController::RTPLEDBATController(Bool16 inUseSlowStart)
+:   fUseSlowStart(inUseSlowStart),
+    fBaseDelayIndex(0),
+    fBaseDelayIntervalStart(0),
+    fNumCurrentDelays(0),
+    fLastDecrease(0)
+{
+    for (UInt32 x = 0; x < kNumBaseDelays; x++)
+        fBaseDelays[x] = -1;
+    for (UInt32 y = 0; y < kNumCurrentDelays; y++)
+        fCurrentDelays[y] = -1;
+}
+
+void RTPLEDBATController::SetClientWindow(SInt32 inClientWindow, SInt64 inCurTime)
+{
+    fClientWindow = inClientWindow;
+    fSlowStartThreshold = inClientWindow;
+    fCongestionWindow = fUseSlowStart ? inClientWindow / 2 : inClientWindow;
+    fBaseDelayIntervalStart = inCurTime;
+    this->ClampWindow();
+}
+
+void RTPLEDBATController::OnRTTSample(SInt32 inRTTMSecs, SInt64 inCurTime)
+{
+    if (inCurTime - fBaseDelayIntervalStart >= kBaseDelayIntervalMSecs)
+    {
+        fBaseDelayIndex = (fBaseDelayIndex + 1) % kNumBaseDelays;
+        fBaseDelays[fBaseDelayIndex] = -1;
+        fBaseDelayIntervalStart = inCurTime;
+    }
+    if ((fBaseDelays[fBaseDelayIndex] < 0) || (inRTTMSecs < fBaseDelays[fBaseDelayIndex]))
+        fBaseDelays[fBaseDelayIndex] = inRTTMSecs;
+
+    fCurrentDelays[fNumCurrentDelays % kNumCurrentDelays] = inRTTMSecs;
+    fNumCurrentDelays++;
+}
+
+SInt32 RTPLEDBATController::GetQueuingDelayMSecs()
+{
+    SInt32 theBaseDelay = -1;
+    for (UInt32 x = 0; x < kNumBaseDelays; x++)
+    {
+        if ((fBaseDelays[x] >= 0) && ((theBaseDelay < 0) || (fBaseDelays[x] < theBaseDelay)))
+            theBaseDelay = fBaseDelays[x];
+    }
+
+    SInt32 theCurrentDelay = -1;
+    for (UInt32 y = 0; y < kNumCurrentDelays; y++)
+    {
+        if ((fCurrentDelays[y] >= 0) && ((theCurrentDelay < 0) || (fCurrentDelays[y] < theCurrentDelay)))
+            theCurrentDelay = fCurrentDelays[y];
+    }
+
+    if ((theBaseDelay < 0) || (theCurrentDelay < 0))
+        return 0;
+    return theCurrentDelay - theBaseDelay;
+}
+
+void RTPLEDBATController::OnAck(UInt32 inNumBytes, UInt32 /*inBytesInFlight*/, SInt64 /*inCurTime*/)
+{
+    if (fNumCurrentDelays == 0)
+        return; // no delay measured yet, keep the initial window
+
+    // cwnd += GAIN * off_target * bytes_acked * MSS / cwnd, off_target = (TARGET - queuing delay) / TARGET
+    SInt64 theOffTarget = kTargetMSecs - this->GetQueuingDelayMSecs();
+    SInt64 theDelta = (kGainPercent * theOffTarget * (SInt64)inNumBytes * kMaximumSegmentSize)
+                        / (100 * kTargetMSecs * (SInt64)fCongestionWindow);
+
+    fCongestionWindow += (SInt32)theDelta;
+    this->ClampWindow();
+}
+
+void RTPLEDBATController::Decrease(SInt64 inCurTime)
+{
+    // At most once per round trip
+    SInt32 theRTT = 0;
+    for (UInt32 x = 0; x < kNumCurrentDelays; x++)
+    {
+        if (fCurrentDelays[x] > theRTT)
+            theRTT = fCurrentDelays[x];
+    }
+    if (inCurTime - fLastDecrease <= theRTT)
+        return;
+
+    fCongestionWindow /= 2;
+    fLastDecrease = inCurTime;
+    this->ClampWindow();
+}
+
+void RTPLEDBATController::OnLoss(UInt32 /*inNumBytes*/, SInt64 inCurTime)
+{
+    this->Decrease(inCurTime);
+}
+
+void RTPLEDBATController::OnRetransmitTimeout(SInt64 inCurTime)
+{
+    this->Decrease(inCurTime);
+}
+
+/******************************** RTPBBRController ********************************/
+
+// ProbeBW gain cycle: probe for more bandwidth, drain the queue it built, cruise
+UInt32 RTPBBRController::sPacingGainPercents[kNumPacingGains] = { 125, 75, 100, 100, 100, 100, 100, 100 };
+
+RTPBBRController::RTPBBRController()
+:   fState(kStartup),
+    fMaxBandwidth(0),
+    fRound(0),
+    fMinRTT(-1),
+    fMinRTTStamp(0),
+    fProbeRTTDone(0),
+    fDelivered(0),
+    fRoundStartDelivered(0),
+    fRoundStart(0),
+    fFullBandwidth(0),
+    fFullBandwidthCount(0),
+    fPacingGainPercent(kHighGainPercent),
+    fCwndGainPercent(kHighGainPercent),
+    fCycleIndex(0),
+    fCycleStart(0)
+{
+    for (UInt32 x = 0; x < kBandwidthRounds; x++)
+        fBandwidths[x] = 0;
+}
+
+void RTPBBRController::SetClientWindow(SInt32 inClientWindow, SInt64 inCurTime)
+{
+    fClientWindow = inClientWindow;
+    fSlowStartThreshold = inClientWindow;
+    fCongestionWindow = inClientWindow / 2; // until there is a model
+    fRoundStart = inCurTime;
+    this->ClampWindow();
+}
+
+UInt32 RTPBBRController::GetBDP()
+{
+    return (UInt32)(((UInt64)fMaxBandwidth * (UInt64)fMinRTT) / 1000);
+}
+
+UInt32 RTPBBRController::GetPacingRateInBytesPerSec()
+{
+    return (UInt32)(((UInt64)fMaxBandwidth * fPacingGainPercent) / 100);
+}
+
+void RTPBBRController::OnRTTSample(SInt32 inRTTMSecs, SInt64 inCurTime)
+{
+    Bool16 isExpired = (fMinRTT >= 0) && (inCurTime - fMinRTTStamp > kMinRTTWindowMSecs);
+    if (isExpired || (fMinRTT < 0) || (inRTTMSecs <= fMinRTT))
+    {
+        fMinRTT = inRTTMSecs;
+        fMinRTTStamp = inCurTime;
+    }
+
+    // The min RTT did not drop for a while, so drain the pipe briefly to
+    // measure it without our own queue in the way
+    if (isExpired && (fState != kProbeRTT))
+    {
+        fState = kProbeRTT;
+        fPacingGainPercent = 100;
+        fProbeRTTDone = inCurTime + kProbeRTTMSecs;
+    }
+}
+
+void RTPBBRController::EnterProbeBW(SInt64 inCurTime)
+{
+    fState = kProbeBW;
+    fCwndGainPercent = kCwndGainPercent;
+    fCycleIndex = 0;
+    fCycleStart = inCurTime;
+    fPacingGainPercent = sPacingGainPercents[fCycleIndex];
+}
+
+void RTPBBRController::OnAck(UInt32 inNumBytes, UInt32 inBytesInFlight, SInt64 inCurTime)
+{
+    fDelivered += inNumBytes;
+
+    // A round ends after one min RTT, each round gives one delivery rate sample
+    SInt64 theRoundLength = (fMinRTT > 10) ? fMinRTT : 10;
+    SInt64 theElapsed = inCurTime - fRoundStart;
+    if (theElapsed >= theRoundLength)
+    {
+        UInt32 theRate = (UInt32)(((fDelivered - fRoundStartDelivered) * 1000) / (UInt64)theElapsed);
+        fRound++;
+        fBandwidths[fRound % kBandwidthRounds] = theRate;
+        fMaxBandwidth = 0;
+        for (UInt32 x = 0; x < kBandwidthRounds; x++)
+        {
+            if (fBandwidths[x] > fMaxBandwidth)
+                fMaxBandwidth = fBandwidths[x];
+        }
+        fRoundStart = inCurTime;
+        fRoundStartDelivered = fDelivered;
+
+        // Startup ends when the bandwidth stops growing by 25% per round
+        if (fState == kStartup)
+        {
+            if ((UInt64)fMaxBandwidth * 100 >= (UInt64)fFullBandwidth * 125)
+            {
+                fFullBandwidth = fMaxBandwidth;
+                fFullBandwidthCount = 0;
+            }
+            else if (++fFullBandwidthCount >= kFullBandwidthRounds)
+            {
+                fState = kDrain;
+                fPacingGainPercent = (100 * 100) / kHighGainPercent;
+            }
+        }
+    }
+
+    switch (fState)
+    {
+        case kDrain:
+            if (inBytesInFlight <= this->GetBDP())
+                this->EnterProbeBW(inCurTime);
+            break;
+
+        case kProbeBW:
+            if ((fMinRTT >= 0) && (inCurTime - fCycleStart > fMinRTT))
+            {
+                fCycleIndex = (fCycleIndex + 1) % kNumPacingGains;
+                fCycleStart = inCurTime;
+                fPacingGainPercent = sPacingGainPercents[fCycleIndex];
+            }
+            break;
+
+        case kProbeRTT:
+            if (inCurTime >= fProbeRTTDone)
+            {
+                if (fFullBandwidthCount >= kFullBandwidthRounds)
+                    this->EnterProbeBW(inCurTime);
+                else
+                {
+                    fState = kStartup;
+                    fPacingGainPercent = kHighGainPercent;
+                }
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    this->UpdateWindow(inBytesInFlight);
+}
+
+void RTPBBRController::UpdateWindow(UInt32 /*inBytesInFlight*/)
+{
+    if (fState == kProbeRTT)
+    {
+        fCongestionWindow = kMinWindowSegments * kMaximumSegmentSize;
+        this->ClampWindow();
+        return;
+    }
+
+    if ((fMaxBandwidth == 0) || (fMinRTT < 0))
+        return; // no model yet, keep the initial window
+
+    UInt64 theWindow = ((UInt64)this->GetBDP() * fCwndGainPercent) / 100;
+    if (theWindow < kMinWindowSegments * kMaximumSegmentSize)
+        theWindow = kMinWindowSegments * kMaximumSegmentSize;
+    if (theWindow > (UInt64)fClientWindow)
+        theWindow = fClientWindow;
+
+    fCongestionWindow = (SInt32)theWindow;
+    this->ClampWindow();
+}
+
+void RTPBBRController::OnLoss(UInt32 /*inNumBytes*/, SInt64 /*inCurTime*/)
+{
+    // Loss is not a congestion signal for the model
+}
+
+void RTPBBRController::OnRetransmitTimeout(SInt64 /*inCurTime*/)
+{
+    // Neither is a retransmit, a path that really got slower shows up as
+    // lower delivery rate samples within kBandwidthRounds round trips
+}
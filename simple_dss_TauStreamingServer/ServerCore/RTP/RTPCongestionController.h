@@ -0,0 +1,237 @@
+/***************************************************************************
+
+Copyright (c) 2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 RTPCongestionController.h
+Description: Congestion control algorithms for reliable UDP, plugged into
+             RTPBandwidthTracker: the original Reno like window, a delay
+             based LEDBAT like window and a BBR like rate based model.
+Comment:
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-19
+LastUpdate:  2026-10-19
+
+****************************************************************************/
+
+#ifndef __RTP_CONGESTION_CONTROLLER_H__
+#define __RTP_CONGESTION_CONTROLLER_H__
+
+#include "OSHeaders.h"
+#include "StrPtrLen.h"
+
+/*
+    RTPBandwidthTracker keeps the bytes in flight and the Karn / Jacobson
+    retransmit timeout, and asks its controller for the congestion window.
+    Controllers only see events, each with the current time passed in, so
+    CongestionSimulator can replay a trace through them without a clock.
+
+    The algorithm is chosen by the reliable_udp_congestion_control pref when
+    a session is created; changing the pref affects new sessions only.
+*/
+
+class RTPCongestionController
+{
+    public:
+
+        enum
+        {
+            kReno       = 0,    //UInt32
+            kLEDBAT     = 1,    //UInt32
+            kBBR        = 2,    //UInt32
+            kNumTypes   = 3     //UInt32
+        };
+
+        enum
+        {
+            kMaximumSegmentSize = 1466  //UInt32, same as RTPBandwidthTracker
+        };
+
+        static RTPCongestionController* Create(UInt32 inType, Bool16 inUseSlowStart);
+
+        // Returns kNumTypes if inName is none of "reno", "ledbat" and "bbr"
+        static UInt32   GetTypeFromName(StrPtrLen* inName);
+        static const char*  GetTypeName(UInt32 inType);
+
+        RTPCongestionController()
+            : fCongestionWindow(kMaximumSegmentSize), fSlowStartThreshold(0), fClientWindow(0) {}
+        virtual ~RTPCongestionController() {}
+
+        virtual UInt32  GetType() = 0;
+
+        // The client's buffer size, known before the stream starts sending
+        virtual void    SetClientWindow(SInt32 inClientWindow, SInt64 inCurTime) = 0;
+
+        // inNumBytes were acked, inBytesInFlight is what is still unacked
+        virtual void    OnAck(UInt32 inNumBytes, UInt32 inBytesInFlight, SInt64 inCurTime) = 0;
+
+        // inNumBytes expired without being acked
+        virtual void    OnLoss(UInt32 inNumBytes, SInt64 inCurTime) = 0;
+
+        // A packet was resent because its retransmit timeout passed
+        virtual void    OnRetransmitTimeout(SInt64 inCurTime) = 0;
+
+        // Round trip time of a packet acked after its first send
+        virtual void    OnRTTSample(SInt32 inRTTMSecs, SInt64 inCurTime) {}
+
+        // Bytes per second to pace at, 0 if the controller is window based only
+        virtual UInt32  GetPacingRateInBytesPerSec() { return 0; }
+
+        SInt32          CongestionWindow()      { return fCongestionWindow; }
+        SInt32          SlowStartThreshold()    { return fSlowStartThreshold; }
+        SInt32          ClientWindow()          { return fClientWindow; }
+
+    protected:
+
+        // Keeps the window between one segment and the client window
+        void            ClampWindow();
+
+        SInt32  fCongestionWindow;
+        SInt32  fSlowStartThreshold;
+        SInt32  fClientWindow;
+};
+
+// The original DSS algorithm: slow start and Reno like congestion avoidance
+// on acks, halving the window at most every kAdjustIntervalMSecs on resends.
+class RTPRenoController : public RTPCongestionController
+{
+    public:
+
+        RTPRenoController(Bool16 inUseSlowStart)
+            : fUseSlowStart(inUseSlowStart), fLastCongestionAdjust(0) {}
+        virtual ~RTPRenoController() {}
+
+        virtual UInt32  GetType()   { return kReno; }
+        virtual void    SetClientWindow(SInt32 inClientWindow, SInt64 inCurTime);
+        virtual void    OnAck(UInt32 inNumBytes, UInt32 inBytesInFlight, SInt64 inCurTime);
+        virtual void    OnLoss(UInt32 inNumBytes, SInt64 inCurTime);
+        virtual void    OnRetransmitTimeout(SInt64 inCurTime);
+
+    private:
+
+        enum
+        {
+            kAdjustIntervalMSecs = 250  //UInt32
+        };
+
+        Bool16  fUseSlowStart;
+        SInt64  fLastCongestionAdjust;
+};
+
+// Delay based, after RFC 6817. The RTT above the lowest RTT seen recently is
+// taken as queuing delay, and the window grows while it is below kTargetMSecs
+// and shrinks above it, so the stream backs off before the bottleneck queue
+// overflows instead of after.
+class RTPLEDBATController : public RTPCongestionController
+{
+    public:
+
+        RTPLEDBATController(Bool16 inUseSlowStart);
+        virtual ~RTPLEDBATController() {}
+
+        virtual UInt32  GetType()   { return kLEDBAT; }
+        virtual void    SetClientWindow(SInt32 inClientWindow, SInt64 inCurTime);
+        virtual void    OnAck(UInt32 inNumBytes, UInt32 inBytesInFlight, SInt64 inCurTime);
+        virtual void    OnLoss(UInt32 inNumBytes, SInt64 inCurTime);
+        virtual void    OnRetransmitTimeout(SInt64 inCurTime);
+        virtual void    OnRTTSample(SInt32 inRTTMSecs, SInt64 inCurTime);
+
+        SInt32          GetQueuingDelayMSecs();
+
+    private:
+
+        enum
+        {
+            kTargetMSecs            = 100,      //UInt32
+            kGainPercent            = 100,      //UInt32
+            kNumBaseDelays          = 10,       //UInt32, one per kBaseDelayIntervalMSecs
+            kBaseDelayIntervalMSecs = 60000,    //UInt32
+            kNumCurrentDelays       = 4         //UInt32
+        };
+
+        void    Decrease(SInt64 inCurTime);
+
+        Bool16  fUseSlowStart;
+        SInt32  fBaseDelays[kNumBaseDelays];    // lowest RTT of each interval, -1 if none
+        UInt32  fBaseDelayIndex;
+        SInt64  fBaseDelayIntervalStart;
+        SInt32  fCurrentDelays[kNumCurrentDelays];
+        UInt32  fNumCurrentDelays;
+        SInt64  fLastDecrease;
+};
+
+// Rate based, after BBR v1. Estimates the bottleneck bandwidth as the max
+// delivery rate of the last kBandwidthRounds round trips and the propagation
+// delay as the min RTT of the last kMinRTTWindowMSecs, and keeps about
+// kCwndGainPercent of their product in flight. Losses do not shrink the
+// window, so random loss on a mobile path does not collapse throughput.
+class RTPBBRController : public RTPCongestionController
+{
+    public:
+
+        RTPBBRController();
+        virtual ~RTPBBRController() {}
+
+        virtual UInt32  GetType()   { return kBBR; }
+        virtual void    SetClientWindow(SInt32 inClientWindow, SInt64 inCurTime);
+        virtual void    OnAck(UInt32 inNumBytes, UInt32 inBytesInFlight, SInt64 inCurTime);
+        virtual void    OnLoss(UInt32 inNumBytes, SInt64 inCurTime);
+        virtual void    OnRetransmitTimeout(SInt64 inCurTime);
+        virtual void    OnRTTSample(SInt32 inRTTMSecs, SInt64 inCurTime);
+        virtual UInt32  GetPacingRateInBytesPerSec();
+
+        UInt32          GetState()                  { return fState; }
+        UInt32          GetBandwidthInBytesPerSec() { return fMaxBandwidth; }
+        SInt32          GetMinRTTMSecs()            { return fMinRTT; }
+
+        enum
+        {
+            kStartup    = 0,    //UInt32
+            kDrain      = 1,    //UInt32
+            kProbeBW    = 2,    //UInt32
+            kProbeRTT   = 3     //UInt32
+        };
+
+    private:
+
+        enum
+        {
+            kHighGainPercent        = 289,      //UInt32, 2/ln(2)
+            kCwndGainPercent        = 200,      //UInt32
+            kBandwidthRounds        = 10,       //UInt32
+            kMinRTTWindowMSecs      = 10000,    //UInt32
+            kProbeRTTMSecs          = 200,      //UInt32
+            kFullBandwidthRounds    = 3,        //UInt32
+            kNumPacingGains         = 8,        //UInt32
+            kMinWindowSegments      = 4         //UInt32
+        };
+
+        UInt32  GetBDP();
+        void    UpdateWindow(UInt32 inBytesInFlight);
+        void    EnterProbeBW(SInt64 inCurTime);
+
+        UInt32  fState;
+        UInt32  fBandwidths[kBandwidthRounds];  // max delivery rate of each round
+        UInt32  fMaxBandwidth;
+        UInt32  fRound;
+
+        SInt32  fMinRTT;                        // -1 until the first sample
+        SInt64  fMinRTTStamp;
+        SInt64  fProbeRTTDone;
+
+        UInt64  fDelivered;                     // bytes acked so far
+        UInt64  fRoundStartDelivered;
+        SInt64  fRoundStart;
+
+        UInt32  fFullBandwidth;
+        UInt32  fFullBandwidthCount;
+
+        UInt32  fPacingGainPercent;
+        UInt32  fCwndGainPercent;
+        UInt32  fCycleIndex;
+        SInt64  fCycleStart;
+
+        static UInt32 sPacingGainPercents[kNumPacingGains];
+};
+
+#endif // __RTP_CONGESTION_CONTROLLER_H__
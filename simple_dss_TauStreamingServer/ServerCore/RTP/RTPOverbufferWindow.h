@@ -41,6 +41,9 @@ class RTPOverbufferWindow
         
         // This may be negative! ȡoverbufferʣռС
         SInt32  AvailableSpaceInWindow() { return fWindowSize - fBytesSentSinceLastReport; }
+
+        // Bytes sent ahead of time that are still in the window
+        SInt32  GetBytesInWindow() { return fBytesSentSinceLastReport; }
         
         // The window size may be changed at any time
 		/* ʹڴС,:RTPStream::Setup()ΪkUInt32_Max,RTPStream::ProcessIncomingRTCPPacket()
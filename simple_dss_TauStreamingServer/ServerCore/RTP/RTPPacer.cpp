@@ -0,0 +1,113 @@
+/***************************************************************************
+
+Copyright (c) 2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 RTPPacer.cpp
+Description: Per stream token bucket that spreads the RTP packets of a stream
+             out at a little above its media rate, instead of letting a whole
+             frame or send ahead burst leave in one go.
+Comment:
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-19
+LastUpdate:  2026-10-19
+
+****************************************************************************/
+
+#include "RTPPacer.h"
+
+// Below this a stream that fell behind never catches up
+const Float32 RTPPacer::kMinGain = 1.25;
+
+RTPPacer::RTPPacer()
+:   fGain(kMinGain),
+    fUseTxTime(false),
+    fMediaRate(0),
+    fRateWindowStart(-1),
+    fRateWindowBytes(0),
+    fPacingRate(0),
+    fTokens(kMinBurstBytes),
+    fLastRefill(-1)
+{}
+
+void RTPPacer::SetGain(Float32 inGain)
+{
+    fGain = inGain;
+    if (fGain < kMinGain)
+        fGain = kMinGain;
+}
+
+void RTPPacer::Refill(SInt64 inCurTime)
+{
+    SInt64 theBurst = ((SInt64)fPacingRate * kBurstMSecs) / 1000;
+    if (theBurst < kMinBurstBytes)
+        theBurst = kMinBurstBytes;
+
+    if ((fLastRefill == -1) || (fPacingRate == 0) || (inCurTime < fLastRefill))
+    {
+        fTokens = theBurst;
+        fLastRefill = inCurTime;
+        return;
+    }
+
+    // Only move fLastRefill by whole bytes, so frequent checks don't lose the remainders
+    SInt64 theNewTokens = ((SInt64)fPacingRate * (inCurTime - fLastRefill)) / 1000000;
+    if (theNewTokens == 0)
+        return;
+
+    fTokens += theNewTokens;
+    if (fTokens > theBurst)
+        fTokens = theBurst;
+    fLastRefill = inCurTime;
+}
+
+SInt64 RTPPacer::CheckTransmitTime(SInt64 inCurTime, UInt32 inLen, UInt32 inRateCap, UInt32* outTxTimeDelay)
+{
+    *outTxTimeDelay = 0;
+
+    // Unpaced until the media rate is known
+    UInt32 theRate = (UInt32)((Float32)fMediaRate * fGain);
+    if ((inRateCap > 0) && (inRateCap < theRate))
+        theRate = inRateCap;
+    fPacingRate = theRate;
+
+    this->Refill(inCurTime);
+    if ((fPacingRate == 0) || (fTokens >= (SInt64)inLen))
+        return -1;
+
+    SInt64 theWait = (((SInt64)inLen - fTokens) * 1000000) / fPacingRate + 1;
+    if (fUseTxTime && (theWait <= kTxTimeHorizonUSecs))
+    {
+        *outTxTimeDelay = (UInt32)theWait;
+        return -1;
+    }
+    return theWait;
+}
+
+void RTPPacer::AddPacket(SInt64 inTransmitTime, UInt32 inLen)
+{
+    fTokens -= inLen;
+
+    // A seek back or a pause restarts the measurement instead of skewing it
+    if ((fRateWindowStart == -1) || (inTransmitTime < fRateWindowStart)
+        || (inTransmitTime - fRateWindowStart > 2 * kRateWindowMSecs))
+    {
+        fRateWindowStart = inTransmitTime;
+        fRateWindowBytes = 0;
+    }
+
+    fRateWindowBytes += inLen;
+
+    SInt64 theSpan = inTransmitTime - fRateWindowStart;
+    if (theSpan < kRateWindowMSecs)
+        return;
+
+    UInt32 theSample = (UInt32)(((SInt64)fRateWindowBytes * 1000) / theSpan);
+    if (fMediaRate == 0)
+        fMediaRate = theSample;
+    else
+        fMediaRate = (3 * fMediaRate + theSample) / 4;
+
+    fRateWindowStart = inTransmitTime;
+    fRateWindowBytes = 0;
+}
@@ -0,0 +1,90 @@
+/***************************************************************************
+
+Copyright (c) 2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 RTPPacer.h
+Description: Per stream token bucket that spreads the RTP packets of a stream
+             out at a little above its media rate, instead of letting a whole
+             frame or send ahead burst leave in one go.
+Comment:
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-19
+LastUpdate:  2026-10-19
+
+****************************************************************************/
+
+#ifndef __RTP_PACER_H__
+#define __RTP_PACER_H__
+
+#include "OSHeaders.h"
+
+/*
+    RTPOverbufferWindow still decides how far ahead of its transmit time a
+    packet may go; the pacer only decides how closely packets that may go
+    follow each other. The rate is the media rate of the stream, measured
+    from the transmit times of the packets written, times a gain, so that
+    a stream that fell behind can catch up. For reliable UDP a controller
+    with a pacing rate of its own (BBR) caps it.
+
+    Times passed in are in microseconds. A packet that has to wait makes
+    RTPStream::Write return QTSS_WouldBlock with a wakeup time a msec or
+    two away, which the session's Task honors through the timer slots of
+    its TaskThread, see Task::UseTimerSlots.
+*/
+
+class RTPPacer
+{
+    public:
+
+        enum
+        {
+            kMinBurstBytes          = 3000,     //UInt32, two full packets
+            kBurstMSecs             = 2,        //UInt32
+            kRateWindowMSecs        = 1000,     //UInt32, of media time
+            kTxTimeHorizonUSecs     = 10000     //UInt32
+        };
+
+        RTPPacer();
+        ~RTPPacer() {}
+
+        // Multiplies the measured media rate, at least kMinGain
+        void    SetGain(Float32 inGain);
+
+        // Lets CheckTransmitTime hand short waits to the kernel, see UDPSocket::EnableTxTime
+        void    SetUseTxTime(Bool16 inUseTxTime)    { fUseTxTime = inUseTxTime; }
+
+        // Returns -1 if the packet may be sent now, else the usecs to wait.
+        // With txtime on, a wait within kTxTimeHorizonUSecs returns -1 and
+        // the wait in outTxTimeDelay, for the packet to be sent with it.
+        // inRateCap is a pacing rate to stay below, 0 if none.
+        SInt64  CheckTransmitTime(SInt64 inCurTime, UInt32 inLen, UInt32 inRateCap, UInt32* outTxTimeDelay);
+
+        // Call for every packet sent, paced or not
+        void    AddPacket(SInt64 inTransmitTime, UInt32 inLen);
+
+        // 0 until a whole kRateWindowMSecs of media was written
+        UInt32  GetMediaRateInBytesPerSec()     { return fMediaRate; }
+        UInt32  GetPacingRateInBytesPerSec()    { return fPacingRate; }
+
+    private:
+
+        static const Float32 kMinGain;
+
+        void    Refill(SInt64 inCurTime);
+
+        Float32 fGain;
+        Bool16  fUseTxTime;
+
+        // Media rate, over windows of packet transmit times
+        UInt32  fMediaRate;
+        SInt64  fRateWindowStart;       // -1 before the first packet
+        UInt32  fRateWindowBytes;
+
+        // Token bucket, in bytes. Goes negative when a packet is sent with a txtime
+        UInt32  fPacingRate;
+        SInt64  fTokens;
+        SInt64  fLastRefill;            // -1 before the first check
+};
+
+#endif // __RTP_PACER_H__
@@ -20,6 +20,7 @@ LastUpdate:  2010-08-16
 #include "RTPStream.h"
 #include "atomic.h"
 #include "OSMutex.h"
+#include "OSTrace.h"
 
 #if RTP_PACKET_RESENDER_DEBUGGING
 #include "QTSSRollingLog.h"
@@ -308,7 +309,7 @@ RTPResenderEntry*   RTPPacketResender::GetEmptyEntry(UInt16 inSeqNum, UInt32 inP
         delete [] fPacketArray;
 		/* ԭش */
         fPacketArray = tempArray;
-        qtss_printf("NewArray size=%ld packetsInList=%ld\n",fPacketArraySize, fPacketsInList);
+        OS_TRACE(RESEND, Info, "NewArray size=%lu packetsInList=%lu\n", fPacketArraySize, fPacketsInList);
     }
 
 	/* 統ǰԪظûдﵽشԪشС(64) */
@@ -334,7 +335,7 @@ RTPResenderEntry*   RTPPacketResender::GetEmptyEntry(UInt16 inSeqNum, UInt32 inP
         else
             fLastUsed = 0; /*  */
             
-        qtss_printf("array is full = %lu reusing index=%lu\n",fPacketsInList,fLastUsed);
+        OS_TRACE(RESEND, Warning, "array is full = %lu reusing index=%lu\n", fPacketsInList, fLastUsed);
 		/* θõشEmptyEntry,Ҫôشͷ,Ҫôβ */
         theEntry = &fPacketArray[fLastUsed];
 		/* Ƴð,BufferPoolȳĻ,ճλ */
@@ -478,7 +479,7 @@ void RTPPacketResender::AckPacket( UInt16 inSeqNum, SInt64& inCurTimeInMsec )
 #endif
 		/* ڲش,յAckشĸ,1 */
         fNumAcksForMissingPackets++;
-        qtss_printf("Ack for missing packet: %d\n", inSeqNum);
+        OS_TRACE(RESEND, Debug, "Ack for missing packet: %d\n", inSeqNum);
          
         // hmm.. we -should not have- closed down the window in this case so reopen it a bit as we normally would.
         // ǹر(Ӧ),ʱͨ,´
@@ -494,7 +495,7 @@ void RTPPacketResender::AckPacket( UInt16 inSeqNum, SInt64& inCurTimeInMsec )
         // for duplicate acks, use 1.5x the cur RTO as the RTT sample
         // fRTTEstimator.AddToEstimate( fRTTEstimator.CurRetransmitTimeout() * 3 / 2 );
         // this results in some very very big RTO's since the dupes come in batches of maybe 10 or more!
-        qtss_printf("Got ack for expired packet %d\n", inSeqNum);
+        OS_TRACE(RESEND, Debug, "Got ack for expired packet %d\n", inSeqNum);
     }
     else /* ҵյӦAckش */
     {
@@ -515,7 +516,7 @@ void RTPPacketResender::AckPacket( UInt16 inSeqNum, SInt64& inCurTimeInMsec )
             // fRTTEstimator.AddToEstimate( theEntry->fPacketRTTDuration.DurationInMilliseconds() );
 			// עյAckĵǰʱ-ش͵ʱ(شRTPʱĵǰʱ)
             fBandwidthTracker->AddToRTTEstimate( (SInt32) ( inCurTimeInMsec - theEntry->fAddedTime ) );
-            qtss_printf("Got ack for packet %d RTT = %qd\n", inSeqNum, inCurTimeInMsec - theEntry->fAddedTime);
+            OS_TRACE(RESEND, Verbose, "Got ack for packet %d RTT = %" _64BITARG_ "d\n", inSeqNum, inCurTimeInMsec - theEntry->fAddedTime);
         }
         else /* һشյAckİ,ʹӡʾϢ */
         {
@@ -579,12 +580,12 @@ void RTPPacketResender::ResendDueEntries()
 				/* ڰ1 */
                 fNumExpired++;
                 //qtss_printf("Packet expired: %d\n", ((UInt16*)thePacket)[1]);
+                OS_TRACE(RESEND, Debug, "Expired packet %d\n", theEntry->fSeqNum);
 
-				/* cwdڴС,µǰδõȷϵֽfBytesInList */
-                fBandwidthTracker->EmptyWindow(theEntry->fPacketSize);
+				/* ӴƳð,Ѷ֪ͨӵ㷨 */
+                fBandwidthTracker->ExpireFromWindow(theEntry->fPacketSize);
 				/* ݰɾð, */
                 this->RemovePacket(packetIndex);
-                qtss_printf("Expired packet %d\n", theEntry->fSeqNum);
 
 				/* һش */
                 continue;
@@ -593,7 +594,7 @@ void RTPPacketResender::ResendDueEntries()
             // Resend this packet
 			/* û(ûǰRTO),udp SocketشðClient */
             fSocket->SendTo(fDestAddr, fDestPort, theEntry->fPacketData, theEntry->fPacketSize);
-            qtss_printf("Packet resent: %d\n", ((UInt16*)theEntry->fPacketData)[1]);
+            OS_TRACE(RESEND, Verbose, "Packet resent: %d\n", ((UInt16*)theEntry->fPacketData)[1]);
 
 			/* ðطĴ1 */
             theEntry->fNumResends++;
@@ -604,7 +605,7 @@ void RTPPacketResender::ResendDueEntries()
        	
             fNumResends++;//طݰܴ1
             numResends ++;/* resend loop count */
-            qtss_printf("resend loop numResends=%ld packet theEntry->fNumResends=%ld stream fNumResends=\n",numResends,theEntry->fNumResends++, fNumResends);
+            OS_TRACE(RESEND, Verbose, "resend loop numResends=%ld packet theEntry->fNumResends=%lu stream fNumResends=%lu\n", numResends, theEntry->fNumResends, fNumResends);
                         
             // ok -- lets try this.. add 1.5x of the INITIAL duration since the last send to the rto estimator
             // since we won't get an ack on this packet this should keep us from exponentially increasing due o a one time increase 
@@ -613,9 +614,9 @@ void RTPPacketResender::ResendDueEntries()
             
 			/* ״شð,Karn㷨RTT */
             if ( theEntry->fNumResends == 1 )
-                fBandwidthTracker->AddToRTTEstimate( (SInt32) ((theEntry->fOrigRetransTimeout  * 3) / 2 ));
+                fBandwidthTracker->AddToRTTEstimate( (SInt32) ((theEntry->fOrigRetransTimeout  * 3) / 2 ), false );
             
-            qtss_printf("Retransmitted packet %d\n", theEntry->fSeqNum);
+            OS_TRACE(RESEND, Verbose, "Retransmitted packet %d\n", theEntry->fSeqNum);
 
 			//·ʱ,Աifѭʹ
             theEntry->fAddedTime = curTime;
@@ -16,6 +16,7 @@ LastUpdate:  2010-08-16
 
 
 #include "RTPSession.h"
+#include "RTPSessionGroup.h"
 #include "RTSPProtocol.h" 
 
 #include "QTSServerInterface.h"
@@ -37,13 +38,17 @@ RTPSession::RTPSession() :
     fClosingReason(qtssCliSesCloseClientTeardown),/* 默认是Client自己关闭的,设置另见RTPSession::Run() */
     fCurrentModule(0),
     fModuleDoingAsyncStuff(false),
-    fLastBandwidthTrackerStatsUpdate(0)
+    fLastBandwidthTrackerStatsUpdate(0),
+    fGroup(NULL),
+    fGroupElem(this)
 {
 #if DEBUG
     fActivateCalled = false;
 #endif
 
     this->SetTaskName("RTPSession"); /* inherited from Task::SetTaskName() */
+    // Pacing waits are a msec or two, too short for the timer heap, see RTPPacer
+    this->UseTimerSlots(QTSServerInterface::GetServer()->GetPrefs()->IsRTPPacingEnabled());
 	/* set QTSS module state vars,进一步设置另见RTPSession::Run() */
     fModuleState.curModule = NULL;
     fModuleState.curTask = this;
@@ -52,6 +57,8 @@ RTPSession::RTPSession() :
 
 RTPSession::~RTPSession()
 {
+    Assert(!fGroupElem.IsMemberOfAnyHeap());
+
     // Delete all the streams
     RTPStream** theStream = NULL;
     UInt32 theLen = 0;
@@ -413,8 +420,13 @@ QTSS_Error  RTPSession::Play(RTSPRequestInterface* request, QTSS_PlayFlags inFla
 #endif
 
 	/* after set some parama, a rtp session task is about to start */
-	//发信号启动该RTP Session任务
-    this->Signal(Task::kStartEvent);
+    // Many sessions can share one Task for sending packets, see RTPSessionGroup
+    if ((fGroup == NULL) && QTSServerInterface::GetServer()->GetPrefs()->IsRTPSessionGroupsEnabled())
+        fGroup = RTPSessionGroup::GetGroup();
+    if (fGroup != NULL)
+        fGroup->Schedule(this, fNextSendPacketsTime);
+    else
+        this->Signal(Task::kStartEvent);//发信号启动该RTP Session任务
     
     return QTSS_NoErr;
 }
@@ -631,6 +643,10 @@ SInt64 RTPSession::Run()
 				return kCantGetMutexIdleTime; /* 10 */
 			}
 	        
+			// Nothing can Play this session any more, so its group can let it go
+			if (fGroup != NULL)
+				fGroup->Remove(this);
+
 			// The ClientSessionClosing role is allowed to do async stuff
 			fModuleState.curTask = this;
 
@@ -684,80 +700,91 @@ SInt64 RTPSession::Run()
     if ((fState == qtssPausedState) || (fModule == NULL))
         return 0;
      
+	/****************** CASE: Return 0, the group sends the packets ****************************************************/
+    // Any other event puts the session back into its group, see RTPSessionGroup
+    if (fGroup != NULL)
+    {
+        fGroup->Schedule(this, OS::Milliseconds());
+        return 0;
+    }
+
 	/****************** CASE: Return any positive value ************************************************************************/
     //Make sure to grab the session mutex here, to protect the module against RTSP requests coming in while it's sending packets
+	/* 锁定该RTPSession并设置QTSS_SendPackets_Params准备send packets */
+    OSMutexLocker locker(&fSessionMutex);
+    //just make sure we haven't been scheduled before our scheduled play
+    //time. If so, reschedule ourselves for the proper time. (if client
+    //sends a play while we are already playing, this may occur)
+	/* obtain the current time to send RTP packets */
+	//设定数据包发送时间，防止被提前发送,刷新QTSS_RTPSendPackets_Params中的当前时间戳
+    theParams.rtpSendPacketsParams.inCurrentTime = OS::Milliseconds();
+    return this->SendPackets(&theParams);
+}
+
+/* 未到发送时间时处理重传,否则调用发包模块的QTSS_RTPSendPackets_Role,返回下次发包的时间间隔. 调用者须已锁定fSessionMutex */
+SInt64 RTPSession::SendPackets(QTSS_RoleParams* ioParams)
+{
+	/* fNextSendPacketsTime see RTPSessionInterface.h,表示send Packets的绝对时间戳 */
+	//未到发送时间时处理重传和设置等待发包的时间
+    if (fNextSendPacketsTime > ioParams->rtpSendPacketsParams.inCurrentTime)
     {
-		/* 锁定该RTPSession并设置QTSS_SendPackets_Params准备send packets */
-        OSMutexLocker locker(&fSessionMutex);
-
-        //just make sure we haven't been scheduled before our scheduled play
-        //time. If so, reschedule ourselves for the proper time. (if client
-        //sends a play while we are already playing, this may occur)
-		/* obtain the current time to send RTP packets */
-		//设定数据包发送时间，防止被提前发送,刷新QTSS_RTPSendPackets_Params中的当前时间戳
-        theParams.rtpSendPacketsParams.inCurrentTime = OS::Milliseconds();
-		/* fNextSendPacketsTime see RTPSessionInterface.h,表示send Packets的绝对时间戳 */
-		//未到发送时间时处理重传和设置等待发包的时间
-        if (fNextSendPacketsTime > theParams.rtpSendPacketsParams.inCurrentTime)
-        {
-			/* 重传RTPStream的二维数组 */
-            RTPStream** retransStream = NULL;
-            UInt32 retransStreamLen = 0;
-
-            // Send retransmits if we need to
-			/* 先查找该RTPSession的重传流类,为该RTPSession的每个RTPStream设置重传 */
-            for (int streamIter = 0; this->GetValuePtr(qtssCliSesStreamObjects, streamIter, (void**)&retransStream, &retransStreamLen) == QTSS_NoErr; streamIter++)
-				if (retransStream && *retransStream)
-                    (*retransStream)->SendRetransmits(); 
-            
-			//计算还需多长时间才可运行。
-			/*outNextPacketTime是间隔时间，以毫秒为单位。在这个角色返回之前，模块需要设定一个合适
-			  的outNextPacketTime值，这个值是当前时刻inCurrentTime和服务器再次为当前会话调用QTSS_RTPSendPackets_Role
-			  角色的时刻fNextSendPacketsTime之间的时间间隔。*/
-			/*  为重传包设置重传的时间间隔,隔这么多时间后就发送该重传包 */
-            theParams.rtpSendPacketsParams.outNextPacketTime = fNextSendPacketsTime - theParams.rtpSendPacketsParams.inCurrentTime;
-        }
-        else /* retransmit scheduled data normally */
-        {   /* 下一个送包时间已过? 马上开始发包了 */        
-    #if RTPSESSION_DEBUGGING
-            qtss_printf("RTPSession %ld: about to call SendPackets\n",(SInt32)this);
-    #endif
-			/* fLastBandwidthTrackerStatsUpdate see RTPSession.h,是否我们忘记更新状态了? */
-			/* 假如更新间隔超过1000毫秒,立即获取最新的BandWidth */
-            if ((theParams.rtpSendPacketsParams.inCurrentTime - fLastBandwidthTrackerStatsUpdate) > 1000)
-				/* GetBandwidthTracker() see RTPSessionInterface.h,  UpdateStats() see RTPBandwidthTracker.h */
-                this->GetBandwidthTracker()->UpdateStats();
+		/* 重传RTPStream的二维数组 */
+        RTPStream** retransStream = NULL;
+        UInt32 retransStreamLen = 0;
+
+        // Send retransmits if we need to
+		/* 先查找该RTPSession的重传流类,为该RTPSession的每个RTPStream设置重传 */
+        for (int streamIter = 0; this->GetValuePtr(qtssCliSesStreamObjects, streamIter, (void**)&retransStream, &retransStreamLen) == QTSS_NoErr; streamIter++)
+			if (retransStream && *retransStream)
+                (*retransStream)->SendRetransmits(); 
         
-			//下次运行时间的缺省值为0,不管怎样,马上将该包发送出去
-			/* 将送包时间间隔设置为0,准备发包 */
-            theParams.rtpSendPacketsParams.outNextPacketTime = 0;
-            // Async event registration is definitely allowed from this role.
-			/* 不用接受可以发包的通知了 */
-            fModuleState.eventRequested = false;
-			
-            /* make assure that there is a QTSSModule, here we use QTSSFileModule */
-			/* 因为我们马上要调用这个模块发包 */
-			/* 试问:它是如何获知QTSSModule是哪个模块的?它的调用在RTSPSession::Run()中的kPreprocessingRequest
-			和kProcessingRequest等;设置用SetPacketSendingModule(),得到用GetPacketSendingModule() */
-			Assert(fModule != NULL);
-
-			/* 调用QTSSFileModuleDispatch(), refer to QTSSFileModule.cpp */
-			/* QTSS_RTPSendPackets_Role角色的责任是向客户端发送媒体数据，并告诉服务器什么时候模块(只能是QTSSFileModule)的QTSS_RTPSendPackets_Role角色应该再次被调用。*/
-            (void)fModule->CallDispatch(QTSS_RTPSendPackets_Role, &theParams);
-    #if RTPSESSION_DEBUGGING
-            qtss_printf("RTPSession %ld: back from sendPackets, nextPacketTime = %"_64BITARG_"d\n",(SInt32)this, theParams.rtpSendPacketsParams.outNextPacketTime);
-    #endif
-
-            //make sure not to get deleted accidently!
-			/* 送完这个包后再设置下次送包的正确的时间间隔 */
-			/* make sure that the returned value is nonnegative, otherwise will be deleted by TaskTheread  */
-            if (theParams.rtpSendPacketsParams.outNextPacketTime < 0)
-                theParams.rtpSendPacketsParams.outNextPacketTime = 0;
-			/* fNextSendPacketsTime see RTPSessionInterface.h */
-			/* QTSS_RTPSendPackets_Params中重要的时间关系 */
-			/* 紧接着设置下次送包的绝对时间戳 吗 */
-            fNextSendPacketsTime = theParams.rtpSendPacketsParams.inCurrentTime + theParams.rtpSendPacketsParams.outNextPacketTime;
-        }     
+		//计算还需多长时间才可运行。
+		/*outNextPacketTime是间隔时间，以毫秒为单位。在这个角色返回之前，模块需要设定一个合适
+		  的outNextPacketTime值，这个值是当前时刻inCurrentTime和服务器再次为当前会话调用QTSS_RTPSendPackets_Role
+		  角色的时刻fNextSendPacketsTime之间的时间间隔。*/
+		/*  为重传包设置重传的时间间隔,隔这么多时间后就发送该重传包 */
+        ioParams->rtpSendPacketsParams.outNextPacketTime = fNextSendPacketsTime - ioParams->rtpSendPacketsParams.inCurrentTime;
+    }
+    else /* retransmit scheduled data normally */
+    {   /* 下一个送包时间已过? 马上开始发包了 */        
+#if RTPSESSION_DEBUGGING
+        qtss_printf("RTPSession %ld: about to call SendPackets\n",(SInt32)this);
+#endif
+		/* fLastBandwidthTrackerStatsUpdate see RTPSession.h,是否我们忘记更新状态了? */
+		/* 假如更新间隔超过1000毫秒,立即获取最新的BandWidth */
+        if ((ioParams->rtpSendPacketsParams.inCurrentTime - fLastBandwidthTrackerStatsUpdate) > 1000)
+			/* GetBandwidthTracker() see RTPSessionInterface.h,  UpdateStats() see RTPBandwidthTracker.h */
+            this->GetBandwidthTracker()->UpdateStats();
+    
+		//下次运行时间的缺省值为0,不管怎样,马上将该包发送出去
+		/* 将送包时间间隔设置为0,准备发包 */
+        ioParams->rtpSendPacketsParams.outNextPacketTime = 0;
+        // Async event registration is definitely allowed from this role.
+		/* 不用接受可以发包的通知了 */
+        fModuleState.eventRequested = false;
+		
+        /* make assure that there is a QTSSModule, here we use QTSSFileModule */
+		/* 因为我们马上要调用这个模块发包 */
+		/* 试问:它是如何获知QTSSModule是哪个模块的?它的调用在RTSPSession::Run()中的kPreprocessingRequest
+		和kProcessingRequest等;设置用SetPacketSendingModule(),得到用GetPacketSendingModule() */
+		Assert(fModule != NULL);
+
+		/* 调用QTSSFileModuleDispatch(), refer to QTSSFileModule.cpp */
+		/* QTSS_RTPSendPackets_Role角色的责任是向客户端发送媒体数据，并告诉服务器什么时候模块(只能是QTSSFileModule)的QTSS_RTPSendPackets_Role角色应该再次被调用。*/
+        (void)fModule->CallDispatch(QTSS_RTPSendPackets_Role, ioParams);
+#if RTPSESSION_DEBUGGING
+        qtss_printf("RTPSession %ld: back from sendPackets, nextPacketTime = %"_64BITARG_"d\n",(SInt32)this, ioParams->rtpSendPacketsParams.outNextPacketTime);
+#endif
+
+        //make sure not to get deleted accidently!
+		/* 送完这个包后再设置下次送包的正确的时间间隔 */
+		/* make sure that the returned value is nonnegative, otherwise will be deleted by TaskTheread  */
+        if (ioParams->rtpSendPacketsParams.outNextPacketTime < 0)
+            ioParams->rtpSendPacketsParams.outNextPacketTime = 0;
+		/* fNextSendPacketsTime see RTPSessionInterface.h */
+		/* QTSS_RTPSendPackets_Params中重要的时间关系 */
+		/* 紧接着设置下次送包的绝对时间戳 吗 */
+        fNextSendPacketsTime = ioParams->rtpSendPacketsParams.inCurrentTime + ioParams->rtpSendPacketsParams.outNextPacketTime;
     }
     
     // Make sure the duration between calls to Run() isn't greater than the max retransmit delay interval.发送间隔(50毫秒)<=重传间隔(仅针对RUDP,默认500毫秒)
@@ -772,11 +799,31 @@ SInt64 RTPSession::Run()
     // the standard interval between wakeups.
 	/* adjust the time to wake up  */
 	/* in general,theRetransDelayInMsec is bigger than  theSendInterval 必要时缩短下一个包到来的时间间隔 */
-    if (theParams.rtpSendPacketsParams.outNextPacketTime > (theRetransDelayInMsec + theSendInterval))
-        theParams.rtpSendPacketsParams.outNextPacketTime = theRetransDelayInMsec;
+    if (ioParams->rtpSendPacketsParams.outNextPacketTime > (theRetransDelayInMsec + theSendInterval))
+        ioParams->rtpSendPacketsParams.outNextPacketTime = theRetransDelayInMsec;
     
-    Assert(theParams.rtpSendPacketsParams.outNextPacketTime >= 0);//we'd better not get deleted accidently!
+    Assert(ioParams->rtpSendPacketsParams.outNextPacketTime >= 0);//we'd better not get deleted accidently!
 	/* return the next desired runtime  */
-    return theParams.rtpSendPacketsParams.outNextPacketTime;
+    return ioParams->rtpSendPacketsParams.outNextPacketTime;
 }
 
+/* 由RTPSessionGroup代替Run()调用,会话互斥锁被RTSP请求占用时稍后重试 */
+SInt64 RTPSession::SendPacketsInGroup(SInt64 inCurrentTime)
+{
+    if ((fState == qtssPausedState) || (fModule == NULL))
+        return 0;
+
+    if (!fSessionMutex.TryLock())
+        return RTPSessionGroup::kBusyRetryMSecs;
+
+    QTSS_RoleParams theParams;
+    theParams.rtpSendPacketsParams.inClientSession = this;
+    theParams.rtpSendPacketsParams.inCurrentTime = inCurrentTime;
+
+    // Some callbacks look for this struct in the thread object
+    OSThreadDataSetter theSetter(&fModuleState, NULL);
+    SInt64 theTimeout = this->SendPackets(&theParams);
+
+    fSessionMutex.Unlock();
+    return theTimeout;
+}
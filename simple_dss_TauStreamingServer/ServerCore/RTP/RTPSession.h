@@ -24,6 +24,7 @@ LastUpdate:  2010-08-16
 #include "RTPStream.h"
 #include "QTSSModule.h"
 
+class RTPSessionGroup;
 
 class RTPSession : public RTPSessionInterface
 {
@@ -96,6 +97,13 @@ class RTPSession : public RTPSessionInterface
         //where timeouts, deletion conditions get processed
 		/* inherited from Task class */
         virtual SInt64  Run();
+
+        // Calls the QTSS_RTPSendPackets_Role if it is time, with the session mutex
+        // held by the caller. Returns msecs until the next call, 0 to wait for an event
+        SInt64          SendPackets(QTSS_RoleParams* ioParams);
+
+        // Called by fGroup instead of Run, see RTPSessionGroup
+        SInt64          SendPacketsInGroup(SInt64 inCurrentTime);
         
         // Utility function used by Play
         UInt32 PowerOf2Floor(UInt32 inNumToFloor);
@@ -146,6 +154,12 @@ class RTPSession : public RTPSessionInterface
 		/* needed by RTPSession::run() */
 		/* record the last bandwidth */
         SInt64              fLastBandwidthTrackerStatsUpdate;
+
+        // Set on the first Play with enable_rtp_session_groups
+        RTPSessionGroup*    fGroup;
+        OSHeapElem          fGroupElem;
+
+        friend class RTPSessionGroup;
 };
 
 #endif //_RTPSESSION_H_
@@ -0,0 +1,114 @@
+/***************************************************************************
+
+Copyright (c) 2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 RTPSessionGroup.cpp
+Description: A Task that sends the packets of many RTPSessions, running every
+             session that is due in one pass instead of scheduling each one
+             through its own Task.
+Comment:
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-19
+LastUpdate:  2026-10-19
+
+****************************************************************************/
+
+#include "RTPSessionGroup.h"
+#include "RTPSession.h"
+#include "OS.h"
+#include "OSMemory.h"
+#include "atomic.h"
+
+RTPSessionGroup**   RTPSessionGroup::sGroups = NULL;
+UInt32              RTPSessionGroup::sNumGroups = 0;
+unsigned int        RTPSessionGroup::sGroupPicker = 0;
+
+void RTPSessionGroup::Initialize(UInt32 inNumGroups)
+{
+    Assert(sGroups == NULL);
+    Assert(inNumGroups > 0);
+
+    sGroups = NEW RTPSessionGroup*[inNumGroups];
+    for (UInt32 x = 0; x < inNumGroups; x++)
+        sGroups[x] = NEW RTPSessionGroup();
+    sNumGroups = inNumGroups;
+}
+
+RTPSessionGroup* RTPSessionGroup::GetGroup()
+{
+    if (sNumGroups == 0)
+        return NULL;
+
+    unsigned int theGroup = atomic_add(&sGroupPicker, 1);
+    return sGroups[theGroup % sNumGroups];
+}
+
+RTPSessionGroup::RTPSessionGroup()
+:   Task(), fMutex(), fHeap()
+{
+    this->SetTaskName("RTPSessionGroup");
+    this->UseTimerSlots(true);
+}
+
+void RTPSessionGroup::Schedule(RTPSession* inSession, SInt64 inTime)
+{
+    OSHeapElem* theElem = &inSession->fGroupElem;
+    Bool16 isHead = false;
+    {
+        OSMutexLocker locker(&fMutex);
+        if (theElem->IsMemberOfAnyHeap())
+            (void)fHeap.Remove(theElem);
+        theElem->SetValue(inTime);
+        fHeap.Insert(theElem);
+        isHead = (fHeap.PeekMin() == theElem);
+    }
+
+    // The group sleeps until its earliest session is due, so it has to rerun
+    // whenever this one becomes the earliest, not only when it was empty
+    if (isHead)
+        this->Signal(Task::kUpdateEvent);
+}
+
+void RTPSessionGroup::Remove(RTPSession* inSession)
+{
+    OSMutexLocker locker(&fMutex);
+    if (inSession->fGroupElem.IsMemberOfAnyHeap())
+        (void)fHeap.Remove(&inSession->fGroupElem);
+}
+
+SInt64 RTPSessionGroup::Run()
+{
+    (void)this->GetEvents();
+
+    // Sessions only block on this while a pass is running, never the other way
+    // round: a session whose mutex is held is skipped and retried
+    OSMutexLocker locker(&fMutex);
+
+    SInt64 theCurrentTime = OS::Milliseconds();
+    UInt32 theNumSessions = 0;
+    while ((fHeap.PeekMin() != NULL) && (fHeap.PeekMin()->GetValue() <= theCurrentTime))
+    {
+        OSHeapElem* theElem = fHeap.ExtractMin();
+        RTPSession* theSession = (RTPSession*)theElem->GetEnclosingObject();
+
+        // 0 means the session waits for an event, as when a Task returns 0
+        SInt64 theTimeout = theSession->SendPacketsInGroup(theCurrentTime);
+        if (theTimeout > 0)
+        {
+            theElem->SetValue(theCurrentTime + theTimeout);
+            fHeap.Insert(theElem);
+        }
+
+        if ((++theNumSessions % kTimeRefreshSessions) == 0)
+            theCurrentTime = OS::Milliseconds();
+    }
+
+    if (fHeap.PeekMin() == NULL)
+        return 0;
+
+    SInt64 theWait = fHeap.PeekMin()->GetValue() - OS::Milliseconds();
+    if (theWait < 1)
+        theWait = 1;
+    return theWait;
+}
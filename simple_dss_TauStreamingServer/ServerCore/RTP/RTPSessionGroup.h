@@ -0,0 +1,81 @@
+/***************************************************************************
+
+Copyright (c) 2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 RTPSessionGroup.h
+Description: A Task that sends the packets of many RTPSessions, running every
+             session that is due in one pass instead of scheduling each one
+             through its own Task.
+Comment:
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-19
+LastUpdate:  2026-10-19
+
+****************************************************************************/
+
+#ifndef __RTP_SESSION_GROUP_H__
+#define __RTP_SESSION_GROUP_H__
+
+#include "Task.h"
+#include "OSHeap.h"
+#include "OSMutex.h"
+
+class RTPSession;
+
+/*
+    With enable_rtp_session_groups, RTPSession::Play puts the session in one
+    of the groups, picked round robin, rather than signalling the session.
+    The group keeps its sessions in a heap ordered by the time they next want
+    to send, and its Run calls the QTSS_RTPSendPackets_Role of every session
+    that is due, with the session mutex held, exactly as RTPSession::Run
+    would. The Task queue, the thread wakeup and the global task lock are
+    paid once per pass rather than once per session.
+
+    A session still runs as its own Task for everything else: teardown,
+    timeouts and events requested by modules. Those wake the session, which
+    hands the packet sending back to its group.
+*/
+
+class RTPSessionGroup : public Task
+{
+    public:
+
+        // Creates the groups, one per task thread. Call after TaskThreadPool::AddThreads
+        static void             Initialize(UInt32 inNumGroups);
+
+        // NULL before Initialize
+        static RTPSessionGroup* GetGroup();
+
+        RTPSessionGroup();
+        virtual ~RTPSessionGroup() {}
+
+        // Adds the session, or moves it, to send packets at inTime (msecs)
+        void    Schedule(RTPSession* inSession, SInt64 inTime);
+
+        // Call before deleting the session
+        void    Remove(RTPSession* inSession);
+
+        enum
+        {
+            kBusyRetryMSecs     = 1     //UInt32, the session mutex was held by an RTSP request
+        };
+
+    private:
+
+        enum
+        {
+            kTimeRefreshSessions    = 32    //UInt32
+        };
+
+        virtual SInt64  Run();
+
+        OSMutex         fMutex;
+        OSHeap          fHeap;
+
+        static RTPSessionGroup**    sGroups;
+        static UInt32               sNumGroups;
+        static unsigned int         sGroupPicker;
+};
+
+#endif // __RTP_SESSION_GROUP_H__
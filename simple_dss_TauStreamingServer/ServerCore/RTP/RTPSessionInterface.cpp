@@ -118,7 +118,8 @@ RTPSessionInterface::RTPSessionInterface()
     fMovieAverageBitRate(0),
     fTeardownReason(0),
     fUniqueID(0),
-    fTracker(QTSServerInterface::GetServer()->GetPrefs()->IsSlowStartEnabled()),/* 使用预设慢启动 */
+    fTracker(QTSServerInterface::GetServer()->GetPrefs()->IsSlowStartEnabled(),
+             QTSServerInterface::GetServer()->GetPrefs()->GetCongestionControl()),/* 使用预设慢启动 */
 	fOverbufferWindow(QTSServerInterface::GetServer()->GetPrefs()->GetSendIntervalInMsec(),kUInt32_Max, QTSServerInterface::GetServer()->GetPrefs()->GetMaxSendAheadTimeInSecs(),QTSServerInterface::GetServer()->GetPrefs()->GetOverbufferRate()),/* 初始化OverbufferWindow类对象 */
     fAuthScheme(QTSServerInterface::GetServer()->GetPrefs()->GetAuthScheme()),/* 使用预设认证格式 */
     fAuthQop(RTSPSessionInterface::kNoQop),
@@ -175,7 +175,7 @@ class RTPSessionInterface : public QTSSDictionary, public Task
 		
         // Used by RTPStream to increment the RTCP packet and byte counts.
 		/* 用于RTCP包 */
-        void            IncrTotalRTCPPacketsRecv()         { fTotalRTCPPacketsRecv++; }
+        void            IncrTotalRTCPPacketsRecv(UInt32 cnt) { fTotalRTCPPacketsRecv += cnt; }
         UInt32          GetTotalRTCPPacketsRecv()          { return fTotalRTCPPacketsRecv; }
         void            IncrTotalRTCPBytesRecv(UInt16 cnt) { fTotalRTCPBytesRecv += cnt; }
         UInt32          GetTotalRTCPBytesRecv()            { return fTotalRTCPBytesRecv; }
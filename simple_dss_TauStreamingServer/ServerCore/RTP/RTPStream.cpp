@@ -28,12 +28,14 @@ LastUpdate:  2010-08-16
 #include "QTSSModuleUtils.h"
 #include "QTSServerInterface.h"
 #include "OS.h"
+#include "OSTrace.h"
 
 #include "RTPStream.h"
 #include "RTCPPacket.h"
 #include "RTCPAPPPacket.h"
 #include "RTCPAckPacket.h"
 #include "RTCPSRPacket.h"
+#include "RTCPCompoundParser.h"
 
 
 
@@ -87,7 +89,13 @@ QTSSAttrInfoDict::AttrInfo  RTPStream::sAttributes[] =
     /* 35 */ { "qtssRTPStrPacketCountInRTCPInterval",       NULL,   qtssAttrDataTypeUInt32, qtssAttrModeRead | qtssAttrModePreempSafe  },
     /* 36 */ { "qtssRTPStrSvrRTPPort",              NULL,   qtssAttrDataTypeUInt16, qtssAttrModeRead | qtssAttrModePreempSafe  },
     /* 37 */ { "qtssRTPStrClientRTPPort",           NULL,   qtssAttrDataTypeUInt16, qtssAttrModeRead | qtssAttrModePreempSafe  },
-    /* 38 */ { "qtssRTPStrNetworkMode",             NULL,   qtssAttrDataTypeUInt32, qtssAttrModeRead | qtssAttrModePreempSafe  }
+    /* 38 */ { "qtssRTPStrNetworkMode",             NULL,   qtssAttrDataTypeUInt32, qtssAttrModeRead | qtssAttrModePreempSafe  },
+    /* 39 */ { "qtssRTPStrLatePackets",             NULL,   qtssAttrDataTypeUInt32, qtssAttrModeRead | qtssAttrModePreempSafe  },
+    /* 40 */ { "qtssRTPStrMaxLateMsec",             NULL,   qtssAttrDataTypeUInt32, qtssAttrModeRead | qtssAttrModePreempSafe  },
+    /* 41 */ { "qtssRTPStrQualityLevelChanges",     NULL,   qtssAttrDataTypeUInt32, qtssAttrModeRead | qtssAttrModePreempSafe  },
+    /* 42 */ { "qtssRTPStrOverbufferBlocks",        NULL,   qtssAttrDataTypeUInt32, qtssAttrModeRead | qtssAttrModePreempSafe  },
+    /* 43 */ { "qtssRTPStrFlowControlledPackets",   NULL,   qtssAttrDataTypeUInt32, qtssAttrModeRead | qtssAttrModePreempSafe  },
+    /* 44 */ { "qtssRTPStrPacedBlocks",             NULL,   qtssAttrDataTypeUInt32, qtssAttrModeRead | qtssAttrModePreempSafe  }
 
 };
 
@@ -113,6 +121,19 @@ char *RTPStream::TCP    = "TCP";
 
 QTSS_ModuleState RTPStream::sRTCPProcessModuleState = { NULL, 0, NULL, false };
 
+//server wide send timing statistics
+OSHistogram         RTPStream::sSendLatenessMsec;
+OSHistogram         RTPStream::sSendEarlinessMsec;
+OSHistogram         RTPStream::sOverbufferBytes;
+OSShardedCounter    RTPStream::sLatePackets;
+OSShardedCounter    RTPStream::sStalePacketsDropped;
+OSShardedCounter    RTPStream::sQualityLevelChanges;
+OSShardedCounter    RTPStream::sOverbufferBlocks;
+OSShardedCounter    RTPStream::sFlowControlledPackets;
+OSShardedCounter    RTPStream::sPacedBlocks;
+OSShardedCounter    RTPStream::sSessionLockBusy;
+OSShardedCounter    RTPStream::sSendWouldBlock;
+
 //set RTPStream attributes array
 void    RTPStream::Initialize()
 {
@@ -199,6 +220,14 @@ RTPStream::RTPStream(UInt32 inSSRC, RTPSessionInterface* inSession)
     fStalePacketsDropped(0),
     fLastCurrentPacketDelay(0),
     fWaitOnLevelAdjustment(true),//等待Level control
+    fLatePackets(0),
+    fMaxLateMsec(0),
+    fQualityLevelChanges(0),
+    fOverbufferBlocks(0),
+    fFlowControlledPackets(0),
+    fPacedBlocks(0),
+    fPacketsSinceStatsSample(0),
+    fUsePacing(false),
     fBufferDelay(3.0),//缓冲延迟3s ?
     fLateToleranceInSec(0),//注意这个量十分重要,从RTSP request的RTSP头"x-RTP-Options: late-tolerance=3"得到,默认1.5,参见 RTPStream::Setup()
     fCurrentAckTimeout(0),
@@ -262,6 +291,12 @@ RTPStream::RTPStream(UInt32 inSSRC, RTPSessionInterface* inSession)
     this->SetVal(qtssRTPStrSvrRTPPort,          &fLocalRTPPort,         sizeof(fLocalRTPPort));
     this->SetVal(qtssRTPStrClientRTPPort,       &fRemoteRTPPort,        sizeof(fRemoteRTPPort));
     this->SetVal(qtssRTPStrNetworkMode,         &fNetworkMode,          sizeof(fNetworkMode));
+    this->SetVal(qtssRTPStrLatePackets,         &fLatePackets,          sizeof(fLatePackets));
+    this->SetVal(qtssRTPStrMaxLateMsec,         &fMaxLateMsec,          sizeof(fMaxLateMsec));
+    this->SetVal(qtssRTPStrQualityLevelChanges, &fQualityLevelChanges,  sizeof(fQualityLevelChanges));
+    this->SetVal(qtssRTPStrOverbufferBlocks,    &fOverbufferBlocks,     sizeof(fOverbufferBlocks));
+    this->SetVal(qtssRTPStrFlowControlledPackets, &fFlowControlledPackets, sizeof(fFlowControlledPackets));
+    this->SetVal(qtssRTPStrPacedBlocks,         &fPacedBlocks,          sizeof(fPacedBlocks));
     
     
 }
@@ -313,6 +348,12 @@ void RTPStream::SetQualityLevel(SInt32 level)
 	//假如服务器预设值不让瘦化,直接设置quality level为最高级别0
     if (QTSServerInterface::GetServer()->GetPrefs()->DisableThinning())
         level = 0;
+
+    if (level != this->GetQualityLevel())
+    {
+        fQualityLevelChanges++;
+        sQualityLevelChanges.Add(1);
+    }
         
     if (fTransportType == qtssRTPTransportTypeUDP)
         fQualityLevel = level;
@@ -556,6 +597,23 @@ QTSS_Error RTPStream::Setup(RTSPRequestInterface* request, QTSS_AddStreamFlags i
     // Record the Server RTP port
     fLocalRTPPort = fSockets->GetSocketA()->GetLocalPort();
 
+    // TCP is paced by the RTSP connection itself
+    QTSServerPrefs* thePrefs = QTSServerInterface::GetServer()->GetPrefs();
+    fUsePacing = thePrefs->IsRTPPacingEnabled() && (fTransportType != qtssRTPTransportTypeTCP);
+    if (fUsePacing)
+    {
+        fPacer.SetGain(thePrefs->GetOverbufferRate());
+        if ((fTransportType == qtssRTPTransportTypeUDP) && thePrefs->GetRTPPacingUseTxTime())
+        {
+            UDPSocket* theSocket = fSockets->GetSocketA();
+            OS_Error theErr = theSocket->IsTxTimeEnabled() ? OS_NoErr : theSocket->EnableTxTime();
+            if (theErr == OS_NoErr)
+                fPacer.SetUseTxTime(true);
+            else
+                OS_TRACE(RTP, Warning, "RTPStream::Setup SO_TXTIME not available (err=%ld), pacing with timers only\n", theErr);
+        }
+    }
+
     //finally, register with the demuxer to get RTCP packets from the proper address
 	// 确保能得到接收RTCP包的UDPSocket的复用器类UDPDemux
     Assert(fSockets->GetSocketB()->GetDemuxer() != NULL);
@@ -799,10 +857,11 @@ QTSS_Error RTPStream::ReliableRTPWrite(void* inBuffer, UInt32 inLen, const SInt6
 	/* 遍历所有的RTPStream,丢包重传 */
     for (int streamIter = 0; fSession->GetValuePtr(qtssCliSesStreamObjects, streamIter, (void**)&retransStream, &retransStreamLen) == QTSS_NoErr; streamIter++)
     {
-        qtss_printf("Resending packets for stream: %d\n",(*retransStream)->fTrackID);
-        qtss_printf("RTPStream::ReliableRTPWrite. Calling ResendDueEntries\n");
         if (retransStream != NULL && *retransStream != NULL)	
+        {
+            OS_TRACE(RESEND, Debug, "RTPStream::ReliableRTPWrite resending packets for stream: %lu\n", (*retransStream)->fTrackID);
             (*retransStream)->fResender.ResendDueEntries();/* 对整个丢包队列,重传 */
+        }
     }
     
     if ( !fSawFirstPacket )
@@ -822,7 +881,7 @@ QTSS_Error RTPStream::ReliableRTPWrite(void* inBuffer, UInt32 inLen, const SInt6
 	/* 假如当前RTPStream中发送但未得到确认的字节数超过阻塞窗的大小时,使用流控,立即返回QTSS_WouldBlock,参见RTPBandwidthTracker.h */
     if ( fResender.IsFlowControlled() )
     {   
-        qtss_printf("Flow controlled\n");
+        OS_TRACE(RTP, Debug, "Flow controlled\n");
 #if DEBUG
 		/* 更新流控开始时间 */
         if (fFlowControlStartedMsec == 0)
@@ -962,6 +1021,7 @@ Bool16 RTPStream::UpdateQualityLevel(const SInt64& inTransmitTime, const SInt64&
             if (inCurrentPacketDelay > fDropAllPacketsForThisStreamDelay)
             {	
                 fStalePacketsDropped++;//丢弃过时包的数量加1
+                sStalePacketsDropped.Add(1);
                 return false; // We should not send this packet,一定不能发送这个包
             }
         }
@@ -1028,7 +1088,10 @@ QTSS_Error  RTPStream::Write(void* inBuffer, UInt32 inLen, UInt32* outLenWritten
 	/* 尝试获取互斥锁,不能获得,直接返回EAGAIN */
     Assert(fSession != NULL);
     if (!fSession->GetSessionMutex()->TryLock())
+    {
+        sSessionLockBusy.Add(1);
         return EAGAIN;
+    }
 
     QTSS_Error err = QTSS_NoErr;
 	/* 获取当前系统时间,对计算包的延迟时间,制定送包策略非常重要! */
@@ -1081,6 +1144,8 @@ QTSS_Error  RTPStream::Write(void* inBuffer, UInt32 inLen, UInt32* outLenWritten
         if ( fTransportType == qtssRTPTransportTypeTCP )// write out in interleave format on the RTSP TCP channel
         {
             err = this->InterleavedWrite( thePacket->packetData, inLen, outLenWritten, fRTCPChannel );
+            if (err == QTSS_WouldBlock)
+                thePacket->suggestedWakeupTime = -1; // the interleaved queue is full, retry after the flow control probe interval
         }
         else if ( inLen > 0 )
         {
@@ -1105,26 +1170,63 @@ QTSS_Error  RTPStream::Write(void* inBuffer, UInt32 inLen, UInt32* outLenWritten
 #if RTP_PACKET_RESENDER_DEBUGGING
             fResender.logprintf("Overbuffer window full. Num bytes in overbuffer: %d. Wakeup time: %qd\n",fSession->GetOverbufferWindow()->AvailableSpaceInWindow(), thePacket->packetTransmitTime);
 #endif
-            qtss_printf("Overbuffer window full. Returning: %qd\n", thePacket->suggestedWakeupTime - theTime);//在等待多少毫秒后返回
+            OS_TRACE(RTP, Debug, "Overbuffer window full. Returning: %qd\n", thePacket->suggestedWakeupTime - theTime);//在等待多少毫秒后返回
+
+            fOverbufferBlocks++;
+            sOverbufferBlocks.Add(1);
             
             fSession->GetSessionMutex()->Unlock();// Make sure to unlock the mutex
             return QTSS_WouldBlock;
         }
 
+        // The overbuffer window lets this packet go, the pacer decides how soon after the last one
+        UInt32 theTxTimeDelay = 0;
+        if (fUsePacing)
+        {
+            UInt32 theRateCap = (fTracker != NULL) ? fTracker->GetCongestionController()->GetPacingRateInBytesPerSec() : 0;
+            SInt64 thePacingWait = fPacer.CheckTransmitTime(OS::Microseconds(), inLen, theRateCap, &theTxTimeDelay);
+            if (thePacingWait != -1)
+            {
+                thePacket->suggestedWakeupTime = theTime + ((thePacingWait + 999) / 1000);
+                fPacedBlocks++;
+                sPacedBlocks.Add(1);
+
+                fSession->GetSessionMutex()->Unlock();// Make sure to unlock the mutex
+                return QTSS_WouldBlock;
+            }
+        }
+
+        // A TCP client also gets this packet only after what is queued on its RTSP connection
+        if ((fTransportType == qtssRTPTransportTypeTCP) && (fSession->GetRTSPSession() != NULL))
+            theCurrentPacketDelay += fSession->GetRTSPSession()->GetInterleavedDelayMSecs();
+
         // Check to make sure our quality level is correct. This function also tells us whether this packet is just too old to send
 		/* 根据当前包的参数,依据服务器瘦化算法和服务器预设值,来判断是否发送该包,并更新quality level相应参数,发送返回true,丢弃返回false */
         if (this->UpdateQualityLevel(thePacket->packetTransmitTime, theCurrentPacketDelay, theTime, inLen))
         {
             if ( fTransportType == qtssRTPTransportTypeTCP )    // write out in interleave format on the RTSP TCP channel
-                err = this->InterleavedWrite( thePacket->packetData, inLen, outLenWritten, fRTPChannel );       
+            {
+                err = this->InterleavedWrite( thePacket->packetData, inLen, outLenWritten, fRTPChannel );
+                if (err == QTSS_WouldBlock)
+                    thePacket->suggestedWakeupTime = -1; // the interleaved queue is full, retry after the flow control probe interval
+            }
             else if ( fTransportType == qtssRTPTransportTypeReliableUDP )//用RUDP写
                 err = this->ReliableRTPWrite( thePacket->packetData, inLen, theCurrentPacketDelay );
             else if ( inLen > 0 )//使用UDPSocket::SendTo()写
-                (void)fSockets->GetSocketA()->SendTo(fRemoteAddr, fRemoteRTPPort, thePacket->packetData, inLen);
+            {
+                // as before a failed UDP send still counts as sent, but full socket buffers get counted
+                if (fSockets->GetSocketA()->SendToLater(fRemoteAddr, fRemoteRTPPort, thePacket->packetData, inLen, theTxTimeDelay) == EAGAIN)
+                    sSendWouldBlock.Add(1);
+            }
             
             if (err == QTSS_NoErr)
 				/* 若成功发送,就打印rtp包 */
                 PrintPacketPrefEnabled( (char*) thePacket->packetData, inLen, (SInt32) RTPStream::rtp);
+            else
+            {
+                fFlowControlledPackets++;
+                sFlowControlledPackets.Add(1);
+            }
         
             if (err == 0)
             {
@@ -1180,6 +1282,8 @@ QTSS_Error  RTPStream::Write(void* inBuffer, UInt32 inLen, UInt32* outLenWritten
             // Update statistics if we were actually able to send the data (don't
             // update if the socket is flow controlled or some such thing)    
             fSession->GetOverbufferWindow()->AddPacketToWindow(inLen); //对当前送出的RTP包,用当前包大小更新RTPOverbufferWindow类的相关量
+            if (fUsePacing)
+                fPacer.AddPacket(thePacket->packetTransmitTime, inLen);
             fSession->UpdatePacketsSent(1);   //更新该RTPSession送出的总包数
             fSession->UpdateBytesSent(inLen); //更新该RTPSession送出的总字节数
             QTSServerInterface::GetServer()->IncrementTotalRTPBytes(inLen); //累计服务器送出的RTP字节总数
@@ -1187,6 +1291,24 @@ QTSS_Error  RTPStream::Write(void* inBuffer, UInt32 inLen, UInt32* outLenWritten
             QTSServerInterface::GetServer()->IncrementTotalLate(theCurrentPacketDelay); //累计总延迟
             QTSServerInterface::GetServer()->IncrementTotalQuality(this->GetQualityLevel());
 
+            // send timing statistics, negative delays are early packets
+            if (++fPacketsSinceStatsSample >= kSendStatsSampleInterval)
+            {
+                fPacketsSinceStatsSample = 0;
+                if (theCurrentPacketDelay < 0)
+                    sSendEarlinessMsec.AddSample(-theCurrentPacketDelay);
+                else
+                    sSendLatenessMsec.AddSample(theCurrentPacketDelay);
+                sOverbufferBytes.AddSample(fSession->GetOverbufferWindow()->GetBytesInWindow());
+            }
+            if (theCurrentPacketDelay > 0)
+            {
+                fLatePackets++;
+                sLatePackets.Add(1);
+                if (theCurrentPacketDelay > (SInt64)fMaxLateMsec)
+                    fMaxLateMsec = (theCurrentPacketDelay > (SInt64)0xFFFFFFFF) ? 0xFFFFFFFF : (UInt32)theCurrentPacketDelay;
+            }
+
             // Record the RTP timestamp for RTCPs
 			/* 记录已经发送出的上个RTP packet的timestamp */
             UInt32* timeStampP = (UInt32*)(thePacket->packetData);
@@ -1297,7 +1419,6 @@ void RTPStream::ProcessIncomingInterleavedData(UInt8 inChannelNum, RTSPSessionIn
 compound RTCP 包,设置rtcpProcessParams,逐个调用注册QTSSModule::kRTCPProcessRole的模块,解锁 */
 void RTPStream::ProcessIncomingRTCPPacket(StrPtrLen* inPacket)
 {
-    StrPtrLen currentPtr(*inPacket);
     SInt64 curTime = OS::Milliseconds(); /* 获取当前时间 */
 
     // Modules are guarenteed atomic access to the session. Also, the RTSP Session accessed
@@ -1316,214 +1437,134 @@ void RTPStream::ProcessIncomingRTCPPacket(StrPtrLen* inPacket)
     if (fSession->GetRTSPSession() != NULL)
         fSession->GetRTSPSession()->RefreshTimeout();
      
-	/* 逐个解析一个compound RTCP包的单个RTCP包,要解析两次,第一次解析通常RTCP包的合法性并得出具体类型,第二次解析具体RTCP包的合法性 */
-    while ( currentPtr.Len > 0 )
+    // Parse all packets of the compound packet in one pass. Everything before a
+    // malformed packet is still processed, but the modules don't see the packet.
+    RTCPCompoundSummary theSummary;
+    (void)RTCPCompoundParser::Parse((UInt8*)inPacket->Ptr, inPacket->Len, &theSummary);
+
+    // Increment our RTCP Packet and byte counters for the session.      
+	/* 对合法的RTCP包,增加包总数和字节总数 */
+    fSession->IncrTotalRTCPPacketsRecv(theSummary.fNumPackets);
+    fSession->IncrTotalRTCPBytesRecv((UInt16)theSummary.fNumBytes);
+
+    if (theSummary.fNumUnknownPackets > 0)
+        OS_TRACE(RTP, Debug, "RTPStream::ProcessIncomingRTCPPacket %lu unknown RTCP packets\n", theSummary.fNumUnknownPackets);
+
+	/************************************ 对RR包 ************************************/
+    if (theSummary.fHasReceiverReport)
     {
-        /*
-            Due to the variable-type nature of RTCP packets, this is a bit unusual...
-            We initially treat the packet as a generic RTCPPacket in order to determine its'
-            actual packet type.  Once that is figgered out, we treat it as its' actual packet type
-        */
-        RTCPPacket rtcpPacket;
-		/* 假如RTCP包格式不对,就解锁并立即返回 */
-        if (!rtcpPacket.ParsePacket((UInt8*)currentPtr.Ptr, currentPtr.Len))
-        {  
-			fSession->GetSessionMutex()->Unlock();
-            return;//abort if we discover a malformed RTCP packet
+        this->PrintPacketPrefEnabled((char*)theSummary.fReceiverReportPacket, theSummary.fReceiverReportLen, RTPStream::rtcpRR);
+
+        // Set the Client SSRC based on latest RTCP
+        fClientSSRC = theSummary.fReceiverSSRC;
+        fFractionLostPackets = theSummary.fCumulativeFractionLost;
+        fJitter = theSummary.fCumulativeJitter;
+        
+        UInt32 curTotalLostPackets = theSummary.fCumulativeTotalLost;
+        
+        // Workaround for client problem.  Sometimes it appears to report a bogus lost packet count.
+        // Since we can't have lost more packets than we sent, ignore the packet if that seems to be the case
+        if (curTotalLostPackets - fTotalLostPackets <= fPacketCount - fLastPacketCount)
+        {
+            // if current value is less than the old value, that means that the packets are out of order
+            //  just wait for another packet that arrives in the right order later and for now, do nothing
+            if (curTotalLostPackets > fTotalLostPackets)
+            {   
+                //increment the server total by the new delta
+                QTSServerInterface::GetServer()->IncrementTotalRTPPacketsLost(curTotalLostPackets - fTotalLostPackets);
+				fCurPacketsLostInRTCPInterval = curTotalLostPackets - fTotalLostPackets;
+                OS_TRACE(RTP, Debug, "fCurPacketsLostInRTCPInterval = %lu\n", fCurPacketsLostInRTCPInterval);
+                fTotalLostPackets = curTotalLostPackets;
+            }
+            else if(curTotalLostPackets == fTotalLostPackets)
+            {
+                fCurPacketsLostInRTCPInterval = 0;
+                OS_TRACE(RTP, Debug, "fCurPacketsLostInRTCPInterval set to 0\n");
+            }
+            
+            fPacketCountInRTCPInterval = fPacketCount - fLastPacketCount;			
+            fLastPacketCount = fPacketCount;
         }
 
-        // Increment our RTCP Packet and byte counters for the session.      
-		/* 对合法的RTCP包,增加包总数和字节总数 */
-        fSession->IncrTotalRTCPPacketsRecv();
-        fSession->IncrTotalRTCPBytesRecv( (SInt16) currentPtr.Len);
+        OS_TRACE(RTP, Verbose, "RR ssrc=%lu reports=%lu frac_lost=%lu tot_lost=%lu jitter=%lu\n",
+                    theSummary.fReceiverSSRC, theSummary.fNumReportBlocks, theSummary.fCumulativeFractionLost,
+                    theSummary.fCumulativeTotalLost, theSummary.fCumulativeJitter);
+    }
+
+	/************************************ 对Ack包 ************************************/
+    if (theSummary.fNumAcks > 0)
+    {
+        // this stream must be ready to receive acks.  Between RTSP setup and sending of first packet on stream we must protect against a bad ack.
+        if (NULL != fTracker && false == fTracker->ReadyForAckProcessing())
+        {   
+            fSession->GetSessionMutex()->Unlock();
+            return;//abort if we receive an ack when we haven't sent anything.
+        }
 
-		/* 对RTCP包分情形讨论:RR/APP/Ack/SDES */
-        switch (rtcpPacket.GetPacketType())
+        for (UInt32 ackIndex = 0; ackIndex < theSummary.fNumAcks; ackIndex++)
         {
-			/************************************ 对RR包 ************************************/
-            case RTCPPacket::kReceiverPacketType:
-            {
-                RTCPReceiverPacket receiverPacket;
-				/* 假如RR包格式不对,就解锁并立即返回 */
-                if (!receiverPacket.ParseReceiverReport((UInt8*)currentPtr.Ptr, currentPtr.Len))
-                {   fSession->GetSessionMutex()->Unlock();
-                    return;//abort if we discover a malformed receiver report
-                }
+            RTCPAckSummary* theAck = &theSummary.fAcks[ackIndex];
+            this->PrintPacketPrefEnabled((char*)theAck->fPacket, theAck->fPacketLen, RTPStream::rtcpACK);
 
-                this->PrintPacketPrefEnabled(currentPtr.Ptr,  currentPtr.Len, RTPStream::rtcpRR);
-        
-                // Set the Client SSRC based on latest RTCP
-				/* 基于最新的RTCP包更新Client SSRC */
-                fClientSSRC = rtcpPacket.GetPacketSSRC();
+            // Only check for ack packets if we are using Reliable UDP
+            if (fTransportType != qtssRTPTransportTypeReliableUDP)
+                continue;
 
-				/* 解析出RR包中的下面两个域fraction lost\interarrival jitter */
-                fFractionLostPackets = receiverPacket.GetCumulativeFractionLostPackets();
-                fJitter = receiverPacket.GetCumulativeJitter();
-                
-				/* 解析出RR包中的cumulative number of packets lost,获取此时间间隔的丢包数 */
-                UInt32 curTotalLostPackets = receiverPacket.GetCumulativeTotalLostPackets();
-                
-                // Workaround for client problem.  Sometimes it appears to report a bogus lost packet count.
-                // Since we can't have lost more packets than we sent, ignore the packet if that seems to be the case
-				/* 假如丢包数不超过发送的RTP包(事实就是这样) */
-                if (curTotalLostPackets - fTotalLostPackets <= fPacketCount - fLastPacketCount)
-                {
-                    // if current value is less than the old value, that means that the packets are out of order
-                    //  just wait for another packet that arrives in the right order later and for now, do nothing
-					/* 当前丢的RTP包更多了 */
-                    if (curTotalLostPackets > fTotalLostPackets)
-                    {   
-                        //increment the server total by the new delta
-						/* 记录下丢包数 */
-                        QTSServerInterface::GetServer()->IncrementTotalRTPPacketsLost(curTotalLostPackets - fTotalLostPackets);
-                        /* 在一个RTCP间隔内的当前丢包数 */
-						fCurPacketsLostInRTCPInterval = curTotalLostPackets - fTotalLostPackets;
-                        qtss_printf("fCurPacketsLostInRTCPInterval = %d\n", fCurPacketsLostInRTCPInterval);				
-                        fTotalLostPackets = curTotalLostPackets; /* 及时更新 */
-                    }
-                    else if(curTotalLostPackets == fTotalLostPackets)
-                    {
-						/* 数据发送平稳,丢包变化不大 */
-                        fCurPacketsLostInRTCPInterval = 0;
-                        qtss_printf("fCurPacketsLostInRTCPInterval set to 0\n");
-                    }
-                    
-                    /* 在此RTCP时间间隔内发送的RTP包总数 */                
-                    fPacketCountInRTCPInterval = fPacketCount - fLastPacketCount;			
-                    fLastPacketCount = fPacketCount;/* 及时更新 */
-                }
+            fResender.AckPacket(theAck->fSeqNum, curTime);
+            OS_TRACE(RESEND, Debug, "Got ack: %lu\n", (UInt32)theAck->fSeqNum);
 
-#ifdef DEBUG_RTCP_PACKETS
-				/* 打印出该RTCP包 */
-                receiverPacket.Dump();
-#endif
-            }
-            break;
-            
-			/************************************************** 对APP包(ACK/RTCPCompressedQTSSPacket) *******************************************/
-            case RTCPPacket::kAPPPacketType:
-            {   
-                //
-                // Check and see if this is an Ack packet. If it is, update the UDP Resender
-                RTCPAckPacket theAckPacket;
-                UInt8* packetBuffer = rtcpPacket.GetPacketBuffer();
-				/* 获取Ack包的长度 */
-                UInt32 packetLen = (rtcpPacket.GetPacketLength() * 4) + RTCPPacket::kRTCPHeaderSizeInBytes;
-                
-                /* 假如该Ack包合法 */
-                if (theAckPacket.ParseAckPacket(packetBuffer, packetLen))
+            UInt32 theMaskSizeInBits = theAck->GetMaskSizeInBits();
+            for (UInt32 maskCount = 0; maskCount < theMaskSizeInBits; maskCount++)
+            {
+                if (theAck->IsNthBitEnabled(maskCount))
                 {
-			   // this stream must be ready to receive acks.  Between RTSP setup and sending of first packet on stream we must protect against a bad ack.
-                    if (NULL != fTracker && false == fTracker->ReadyForAckProcessing())
-                    {   
-						/* 当RTPBandwidthTracker没有准备好接收Ack包时,它来了,就解锁返回 */
-						fSession->GetSessionMutex()->Unlock();
-                        return;//abort if we receive an ack when we haven't sent anything.
-                    }
-                    
-					//打印出该Ack包
-                    this->PrintPacketPrefEnabled( (char*)packetBuffer,  packetLen, RTPStream::rtcpACK);
-
-                    // Only check for ack packets if we are using Reliable UDP
-					/* 仅对RUDP传输方式,检查ACK包 */
-                    if (fTransportType == qtssRTPTransportTypeReliableUDP)
-                    {
-						/* 获得序列号 */
-                        UInt16 theSeqNum = theAckPacket.GetAckSeqNum();
-						/* 依据Ack包,处理重传包队列 */
-                        fResender.AckPacket(theSeqNum, curTime);
-                        qtss_printf("Got ack: %d\n",theSeqNum);
-                        
-						/* 分析Ack包的Mask位,遍历32bit,得到是否收到其它指定的序列号的Ack包,进而处理其对应的RTP包,是否重发或丢弃? */
-                        for (UInt16 maskCount = 0; maskCount < theAckPacket.GetAckMaskSizeInBits(); maskCount++)
-                        {
-                            if (theAckPacket.IsNthBitEnabled(maskCount))
-                            {
-                                fResender.AckPacket( theSeqNum + maskCount + 1, curTime);
-                                qtss_printf("Got ack in mask: %d\n",theSeqNum + maskCount + 1);
-                            }
-                        }             
-                    }
-                }
-                else //它不是APP包,假设它是the qtss APP packet
-                {   
-                   this->PrintPacketPrefEnabled( (char*) packetBuffer, packetLen, RTPStream::rtcpAPP);
-                   
-                    // If it isn't an ACK, assume its the qtss APP packet
-                    RTCPCompressedQTSSPacket compressedQTSSPacket;
-					/* 假如the qtss APP packet包格式不对,就解锁并立即返回 */
-                    if (!compressedQTSSPacket.ParseCompressedQTSSPacket((UInt8*)currentPtr.Ptr, currentPtr.Len))
-                    {  
-						fSession->GetSessionMutex()->Unlock();
-                        return;//abort if we discover a malformed app packet
-                    }
-                    
-                    fReceiverBitRate =      compressedQTSSPacket.GetReceiverBitRate();
-                    fAvgLateMsec =          compressedQTSSPacket.GetAverageLateMilliseconds();
-                    
-                    fPercentPacketsLost =   compressedQTSSPacket.GetPercentPacketsLost();
-                    fAvgBufDelayMsec =      compressedQTSSPacket.GetAverageBufferDelayMilliseconds();
-                    fIsGettingBetter = (UInt16)compressedQTSSPacket.GetIsGettingBetter();
-                    fIsGettingWorse = (UInt16)compressedQTSSPacket.GetIsGettingWorse();
-                    fNumEyes =              compressedQTSSPacket.GetNumEyes();
-                    fNumEyesActive =        compressedQTSSPacket.GetNumEyesActive();
-                    fNumEyesPaused =        compressedQTSSPacket.GetNumEyesPaused();
-                    fTotalPacketsRecv =     compressedQTSSPacket.GetTotalPacketReceived();
-                    fTotalPacketsDropped =  compressedQTSSPacket.GetTotalPacketsDropped();
-                    fTotalPacketsLost =     compressedQTSSPacket.GetTotalPacketsLost();
-                    fClientBufferFill =     compressedQTSSPacket.GetClientBufferFill();
-                    fFrameRate =            compressedQTSSPacket.GetFrameRate();
-                    fExpectedFrameRate =    compressedQTSSPacket.GetExpectedFrameRate();
-                    fAudioDryCount =        compressedQTSSPacket.GetAudioDryCount();
-                    
-//                  if (fPercentPacketsLost == 0)
-//                  {
-//                      qtss_printf("***\n");
-//                      fCurPacketsLostInRTCPInterval = 0;
-//                  }
-                    
-                    // Update our overbuffer window size to match what the client is telling us
-					/* 对UDP传输方式,依据客户端告诉的值,设置OverbufferWindow大小 */
-                    if (fTransportType != qtssRTPTransportTypeUDP)
-                    {
-                        qtss_printf("Setting over buffer to %d\n", compressedQTSSPacket.GetOverbufferWindowSize());
-                        fSession->GetOverbufferWindow()->SetWindowSize(compressedQTSSPacket.GetOverbufferWindowSize());
-                    }
-                    
-#ifdef DEBUG_RTCP_PACKETS
-                compressedQTSSPacket.Dump();//先打印出RTCP包头,再打印出存贮在mDumpArray中的所有数据
-#endif
+                    fResender.AckPacket((UInt16)(theAck->fSeqNum + maskCount + 1), curTime);
+                    OS_TRACE(RESEND, Debug, "Got ack in mask: %lu\n", (UInt32)(UInt16)(theAck->fSeqNum + maskCount + 1));
                 }
             }
-            break;
-            
-			/********************* 对SDES包 **************************************/
-            case RTCPPacket::kSDESPacketType:
-            {
-#ifdef DEBUG_RTCP_PACKETS
-                SourceDescriptionPacket sedsPacket;
-				/* 假如SDES包格式不对,就解锁并立即返回 */
-                if (!sedsPacket.ParsePacket((UInt8*)currentPtr.Ptr, currentPtr.Len))
-                {   
-					fSession->GetSessionMutex()->Unlock();
-                    return;//abort if we discover a malformed app packet
-                }
+        }
 
-                sedsPacket.Dump();
-#endif
-            }
-            break;
-            
-            default:
-               WarnV(false, "Unknown RTCP Packet Type");
-            break;
-        
-        } //switch
+        if (theSummary.fNumAcksDropped > 0)
+            OS_TRACE(RESEND, Warning, "RTPStream::ProcessIncomingRTCPPacket dropped %lu acks\n", theSummary.fNumAcksDropped);
+    }
+
+	/************************************ 对QTSS APP包 ************************************/
+    if (theSummary.fHasQTSSApp)
+    {
+        RTCPQTSSAppSummary* theApp = &theSummary.fQTSSApp;
+        this->PrintPacketPrefEnabled((char*)theSummary.fQTSSAppPacket, theSummary.fQTSSAppLen, RTPStream::rtcpAPP);
+
+        fReceiverBitRate =      theApp->fReceiverBitRate;
+        fAvgLateMsec =          theApp->fAverageLateMilliseconds;
+        fPercentPacketsLost =   theApp->fPercentPacketsLost;
+        fAvgBufDelayMsec =      theApp->fAverageBufferDelayMilliseconds;
+        fIsGettingBetter =      (UInt16)theApp->fIsGettingBetter;
+        fIsGettingWorse =       (UInt16)theApp->fIsGettingWorse;
+        fNumEyes =              theApp->fNumEyes;
+        fNumEyesActive =        theApp->fNumEyesActive;
+        fNumEyesPaused =        theApp->fNumEyesPaused;
+        fTotalPacketsRecv =     theApp->fTotalPacketsReceived;
+        fTotalPacketsDropped =  theApp->fTotalPacketsDropped;
+        fTotalPacketsLost =     theApp->fTotalPacketsLost;
+        fClientBufferFill =     theApp->fClientBufferFill;
+        fFrameRate =            theApp->fFrameRate;
+        fExpectedFrameRate =    theApp->fExpectedFrameRate;
+        fAudioDryCount =        theApp->fAudioDryCount;
         
-        /* 将指针移到RTCP包的结尾 */
-        currentPtr.Ptr += (rtcpPacket.GetPacketLength() * 4 ) + 4;
-        currentPtr.Len -= (rtcpPacket.GetPacketLength() * 4 ) + 4;
-    } //  while
+        // Update our overbuffer window size to match what the client is telling us
+		/* 对非UDP传输方式,依据客户端告诉的值,设置OverbufferWindow大小 */
+        if (fTransportType != qtssRTPTransportTypeUDP)
+        {
+            OS_TRACE(RTP, Debug, "Setting over buffer to %lu\n", theApp->fOverbufferWindowSize);
+            fSession->GetOverbufferWindow()->SetWindowSize(theApp->fOverbufferWindowSize);
+        }
+    }
+
+    if (theSummary.fMalformed)
+    {
+        fSession->GetSessionMutex()->Unlock();
+        return;//abort if we discover a malformed RTCP packet
+    }
 
     // Invoke the RTCP modules, allowing them to process this packet
 	/* 设置rtcpProcessParams,让流控模块处理 */
@@ -1532,6 +1573,7 @@ void RTPStream::ProcessIncomingRTCPPacket(StrPtrLen* inPacket)
     theParams.rtcpProcessParams.inClientSession = fSession;
     theParams.rtcpProcessParams.inRTCPPacketData = inPacket->Ptr;
     theParams.rtcpProcessParams.inRTCPPacketDataLen = inPacket->Len;
+    theParams.rtcpProcessParams.inRTCPSummary = &theSummary;
     
     // We don't allow async events from this role, so just set an empty module state.
 	/* 将Module状态设置为线程私有数据 */
@@ -1546,6 +1588,22 @@ void RTPStream::ProcessIncomingRTCPPacket(StrPtrLen* inPacket)
     fSession->GetSessionMutex()->Unlock();
 }
 
+void RTPStream::FormatSendStats(StringFormatter* ioFormatter)
+{
+    sSendLatenessMsec.Format(ioFormatter, "rtp_send_lateness_msec");
+    sSendEarlinessMsec.Format(ioFormatter, "rtp_send_earliness_msec");
+    sOverbufferBytes.Format(ioFormatter, "rtp_overbuffer_bytes");
+
+    char theLine[512];
+    qtss_snprintf(theLine, sizeof(theLine), "rtp_send_counters late=%" _64BITARG_ "d stale_dropped=%" _64BITARG_ "d quality_changes=%" _64BITARG_ "d"
+                    " overbuffer_blocked=%" _64BITARG_ "d paced=%" _64BITARG_ "d flow_controlled=%" _64BITARG_ "d"
+                    " session_lock_busy=%" _64BITARG_ "d send_eagain=%" _64BITARG_ "d\n",
+                    sLatePackets.Get(), sStalePacketsDropped.Get(), sQualityLevelChanges.Get(),
+                    sOverbufferBlocks.Get(), sPacedBlocks.Get(), sFlowControlledPackets.Get(),
+                    sSessionLockBusy.Get(), sSendWouldBlock.Get());
+    ioFormatter->Put(theLine);
+}
+
 /* 依据fTransportType,返回字符串"UDP",或"RUDP",或"TCP",或"no-type" */
 char* RTPStream::GetStreamTypeStr()
 {
@@ -1573,7 +1631,7 @@ char* RTPStream::GetStreamTypeStr()
 }
 
 /* 打印指定的RTP信息 */
-void RTPStream::PrintRTP(char* packetBuff, UInt32 inLen)
+void RTPStream::PrintRTP(char* packetBuff, UInt32 inLen, char* inTypeStr)
 {
     /* 获取RTP包的seqnum\timestamp\ssrc */
     UInt16 sequence = ntohs( ((UInt16*)packetBuff)[1]);
@@ -1592,19 +1650,18 @@ void RTPStream::PrintRTP(char* packetBuff, UInt32 inLen)
       
     /* 获取RTPStrPayloadName */ 
     StrPtrLen   *payloadStr = this->GetValue(qtssRTPStrPayloadName);
-	/* 打印该PayLoad name */
+    StrPtrLen   thePayloadName("?");
     if (payloadStr && payloadStr->Len > 0)
-        payloadStr->PrintStr();
-    else
-        qtss_printf("?");
-
-    
-     qtss_printf(" H_ssrc=%ld H_seq=%u H_ts=%lu seq_count=%lu ts_secs=%.3f \n", ssrc, sequence, timestamp, fPacketCount +1, rtpTimeInSecs );
+        thePayloadName = *payloadStr;
 
+    // packet_header_printf_options is the switch for these, so they bypass the rtp trace level
+    OSTrace::Record(OSTrace::kRTP, OSTrace::kInfo, "<send sess=%lu: RTP %s xmit_sec=%.3f %s size=%lu %.*s H_ssrc=%lu H_seq=%u H_ts=%lu seq_count=%lu ts_secs=%.3f\n",
+                    this->fSession->GetUniqueID(), this->GetStreamTypeStr(), this->GetStreamStartTimeSecs(), inTypeStr, inLen,
+                    (int)thePayloadName.Len, thePayloadName.Ptr, ssrc, sequence, timestamp, fPacketCount + 1, rtpTimeInSecs);
 }
 
 /* 打印出指定的RTCPSR包 */
-void RTPStream::PrintRTCPSenderReport(char* packetBuff, UInt32 inLen)
+void RTPStream::PrintRTCPSenderReport(char* packetBuff, UInt32 inLen, char* inTypeStr)
 {
 
     char timebuffer[kTimeStrSize];    
@@ -1641,14 +1698,16 @@ void RTPStream::PrintRTCPSenderReport(char* packetBuff, UInt32 inLen)
     theReport++;
     UInt32 bytecount = ntohl(*theReport);          
     
-	/* 获取并打印该RTPStream的负载类型 */
+	/* 获取该RTPStream的负载类型 */
     StrPtrLen   *payloadStr = this->GetValue(qtssRTPStrPayloadName);
+    StrPtrLen   thePayloadName("?");
     if (payloadStr && payloadStr->Len > 0)
-        payloadStr->PrintStr();
-    else
-        qtss_printf("?");
+        thePayloadName = *payloadStr;
 
-    qtss_printf(" H_ssrc=%lu H_bytes=%lu H_ts=%lu H_pckts=%lu ts_secs=%.3f H_ntp=%s", ssrc,bytecount, timestamp, packetcount, theTimeInSecs, ::qtss_ctime( &theTime,timebuffer,sizeof(timebuffer)) );
+    OSTrace::Record(OSTrace::kRTP, OSTrace::kInfo, "<send sess=%lu: SR %s xmit_sec=%.3f %s size=%lu %.*s H_ssrc=%lu H_bytes=%lu H_ts=%lu H_pckts=%lu ts_secs=%.3f H_ntp=%s",
+                    this->fSession->GetUniqueID(), this->GetStreamTypeStr(), this->GetStreamStartTimeSecs(), inTypeStr, inLen,
+                    (int)thePayloadName.Len, thePayloadName.Ptr, ssrc, bytecount, timestamp, packetcount, theTimeInSecs,
+                    ::qtss_ctime(&theTime, timebuffer, sizeof(timebuffer)));
  }
 
 /* 引用了RTPStream::PrintRTP()和RTPStream::PrintRTCPSenderReport() */
@@ -1675,16 +1734,14 @@ void RTPStream::PrintPacket(char *inBuffer, UInt32 inLen, SInt32 inType)
         case RTPStream::rtp:
            if (QTSServerInterface::GetServer()->GetPrefs()->PrintRTPHeaders())
            {
-                qtss_printf("<send sess=%lu: RTP %s xmit_sec=%.3f %s size=%lu ", this->fSession->GetUniqueID(), this->GetStreamTypeStr(), this->GetStreamStartTimeSecs(), theType, inLen);
-                PrintRTP(inBuffer, inLen);
+                PrintRTP(inBuffer, inLen, theType);
            }
         break;
          
         case RTPStream::rtcpSR:
             if (QTSServerInterface::GetServer()->GetPrefs()->PrintSRHeaders())
             {
-                qtss_printf("<send sess=%lu: SR %s xmit_sec=%.3f %s size=%lu ", this->fSession->GetUniqueID(), this->GetStreamTypeStr(), this->GetStreamStartTimeSecs(), theType, inLen);
-                PrintRTCPSenderReport(inBuffer, inLen);
+                PrintRTCPSenderReport(inBuffer, inLen, theType);
             }
         break;
         
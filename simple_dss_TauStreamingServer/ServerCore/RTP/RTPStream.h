@@ -31,6 +31,9 @@ LastUpdate:  2010-08-16
 #include "RTSPRequestInterface.h"
 #include "RTPSessionInterface.h"
 #include "RTPPacketResender.h"/* 丢包重传类 */
+#include "OSHistogram.h"
+#include "OSShardedCounter.h"
+#include "RTPPacer.h"
 
 
 class RTPStream : public QTSSDictionary, public UDPDemuxerTask //注意RTPStream作为哈希表元
@@ -40,6 +43,10 @@ class RTPStream : public QTSSDictionary, public UDPDemuxerTask //注意RTPStream
         // Initializes dictionary resources
         static void Initialize();
 
+        // Appends the server wide send timing histograms and counters
+        // (lateness and earliness, overbuffer occupancy, thinning, flow control)
+        static void FormatSendStats(StringFormatter* ioFormatter);
+
         //
         // CONSTRUCTOR / DESTRUCTOR
         
@@ -256,6 +263,19 @@ class RTPStream : public QTSSDictionary, public UDPDemuxerTask //注意RTPStream
         UInt32      fStalePacketsDropped;              //扔掉过时包总数
         SInt64      fLastCurrentPacketDelay;           //上次的发包延时值
         Bool16      fWaitOnLevelAdjustment;             //是否等待级别调整?
+
+        // Send timing statistics, see qtssRTPStrLatePackets and friends
+        UInt32      fLatePackets;
+        UInt32      fMaxLateMsec;
+        UInt32      fQualityLevelChanges;
+        UInt32      fOverbufferBlocks;
+        UInt32      fFlowControlledPackets;
+        UInt32      fPacedBlocks;
+        UInt32      fPacketsSinceStatsSample;
+
+        // Spreads out the packets the overbuffer window lets through, see enable_rtp_pacing
+        RTPPacer    fPacer;
+        Bool16      fUsePacing;
               
 		/* 每发送一个数据包DSS都会调整一次播放质量，函数返回值表示当前包是否应该发送. fLateToleranceInSec为
 		上一步得到的客户端延时，如果客户端没有通过SETUP设置则默认值为1.5秒。参见RTPStream::SetThinningParams()/Setup() */
@@ -289,6 +309,25 @@ class RTPStream : public QTSSDictionary, public UDPDemuxerTask //注意RTPStream
         static StrPtrLen                    sChannelNums[];
         static QTSS_ModuleState             sRTCPProcessModuleState;
 
+        // Server wide send timing statistics, updated without locking. The counters
+        // are sharded per task thread, the histograms only get one sample every
+        // kSendStatsSampleInterval packets of a stream.
+        enum
+        {
+            kSendStatsSampleInterval = 16   //UInt32
+        };
+        static OSHistogram                  sSendLatenessMsec;
+        static OSHistogram                  sSendEarlinessMsec;
+        static OSHistogram                  sOverbufferBytes;
+        static OSShardedCounter             sLatePackets;
+        static OSShardedCounter             sStalePacketsDropped;
+        static OSShardedCounter             sQualityLevelChanges;
+        static OSShardedCounter             sOverbufferBlocks;
+        static OSShardedCounter             sFlowControlledPackets;
+        static OSShardedCounter             sPacedBlocks;
+        static OSShardedCounter             sSessionLockBusy;   // Write() found the session locked
+        static OSShardedCounter             sSendWouldBlock;    // the UDP socket send returned EAGAIN
+
 		//protocol TYPE str
         static char *noType;
         static char *UDP;
@@ -306,8 +345,8 @@ class RTPStream : public QTSSDictionary, public UDPDemuxerTask //注意RTPStream
         Float32 GetStreamStartTimeSecs() { return (Float32) ((OS::Milliseconds() - this->fSession->GetSessionCreateTime())/1000.0); }
        
 		void PrintPacket(char *inBuffer, UInt32 inLen, SInt32 inType); 
-        void PrintRTP(char* packetBuff, UInt32 inLen);
-        void PrintRTCPSenderReport(char* packetBuff, UInt32 inLen);
+        void PrintRTP(char* packetBuff, UInt32 inLen, char* inTypeStr);
+        void PrintRTCPSenderReport(char* packetBuff, UInt32 inLen, char* inTypeStr);
 inline  void PrintPacketPrefEnabled(char *inBuffer,UInt32 inLen, SInt32 inType) { if (QTSServerInterface::GetServer()->GetPrefs()->PacketHeaderPrintfsEnabled() ) this->PrintPacket(inBuffer,inLen, inType); }
 
         /* QTSSFileModule::SendPackets() encounter error */
@@ -0,0 +1,179 @@
+/***************************************************************************
+
+Copyright (c) 2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 RTSPInterleavedQueue.cpp
+Description: Per RTSP connection send queue of interleaved RTP/RTCP packets,
+             written out with writev and bounded in bytes.
+Comment:
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-19
+LastUpdate:  2026-10-19
+
+****************************************************************************/
+
+#include "RTSPInterleavedQueue.h"
+#include "OS.h"
+#include "OSMemory.h"
+
+#include <errno.h>
+
+RTSPInterleavedQueue::RTSPInterleavedQueue(TCPSocket* inSocket, UInt32 inMaxBytes)
+:   fMutex(),
+    fSocket(inSocket),
+    fMaxBytes(inMaxBytes),
+    fEntries(NEW Entry[kMaxPackets]),
+    fHead(0),
+    fNumPackets(0),
+    fQueuedBytes(0),
+    fHeadBytesSent(0),
+    fDrainRate(0),
+    fRateWindowStart(-1),
+    fRateWindowBytes(0)
+{}
+
+RTSPInterleavedQueue::~RTSPInterleavedQueue()
+{
+    while (fNumPackets > 0)
+        this->PopHead();
+    delete [] fEntries;
+}
+
+QTSS_Error RTSPInterleavedQueue::Push(UInt8 inChannel, void* inData, UInt32 inLen, UInt32 inBytesSent)
+{
+    OSMutexLocker locker(&fMutex);
+
+    UInt32 theFramedLen = kHeaderSize + inLen;
+
+    // An empty queue takes a packet of any size, so that one bigger than fMaxBytes still goes
+    if ((fNumPackets == kMaxPackets) || ((fNumPackets > 0) && (fQueuedBytes + theFramedLen > fMaxBytes)))
+        return QTSS_WouldBlock;
+
+    // Only the packet at the head can have been partly written
+    Assert((inBytesSent == 0) || (fNumPackets == 0));
+    Assert(inBytesSent < theFramedLen);
+
+    Entry* theEntry = &fEntries[(fHead + fNumPackets) % kMaxPackets];
+    theEntry->fHeader[0] = '$';
+    theEntry->fHeader[1] = (char)inChannel;
+    UInt16 theNetLen = htons((UInt16)inLen);
+    ::memcpy(&theEntry->fHeader[2], &theNetLen, 2);
+    theEntry->fData = NEW char[inLen];
+    ::memcpy(theEntry->fData, inData, inLen);
+    theEntry->fLen = inLen;
+    theEntry->fQueueTime = OS::Milliseconds();
+
+    if (fNumPackets == 0)
+        fHeadBytesSent = inBytesSent;
+    fNumPackets++;
+    fQueuedBytes += theFramedLen - inBytesSent;
+    return QTSS_NoErr;
+}
+
+void RTSPInterleavedQueue::PopHead()
+{
+    Assert(fNumPackets > 0);
+    delete [] fEntries[fHead].fData;
+    fEntries[fHead].fData = NULL;
+    fHead = (fHead + 1) % kMaxPackets;
+    fNumPackets--;
+    fHeadBytesSent = 0;
+}
+
+QTSS_Error RTSPInterleavedQueue::Send(Bool16 inHeadOnly)
+{
+    OSMutexLocker locker(&fMutex);
+
+    if (fNumPackets == 0)
+        return QTSS_NoErr;
+
+    struct iovec theVec[kMaxIOVecs];
+    UInt32 theNumVecs = 0;
+    UInt32 theNumPackets = inHeadOnly ? 1 : fNumPackets;
+    if (theNumPackets > kMaxIOVecs / 2)
+        theNumPackets = kMaxIOVecs / 2;
+
+    for (UInt32 x = 0; x < theNumPackets; x++)
+    {
+        Entry* theEntry = &fEntries[(fHead + x) % kMaxPackets];
+        UInt32 theSkip = (x == 0) ? fHeadBytesSent : 0;
+
+        if (theSkip < kHeaderSize)
+        {
+            theVec[theNumVecs].iov_base = &theEntry->fHeader[theSkip];
+            theVec[theNumVecs].iov_len = kHeaderSize - theSkip;
+            theNumVecs++;
+            theSkip = 0;
+        }
+        else
+            theSkip -= kHeaderSize;
+
+        theVec[theNumVecs].iov_base = theEntry->fData + theSkip;
+        theVec[theNumVecs].iov_len = theEntry->fLen - theSkip;
+        theNumVecs++;
+    }
+
+    UInt32 theLenSent = 0;
+    QTSS_Error theErr = fSocket->WriteV(theVec, theNumVecs, &theLenSent);
+    this->UpdateDrainRate(theLenSent, OS::Milliseconds());
+    if (theErr != QTSS_NoErr)
+        return theErr;
+
+    fQueuedBytes -= theLenSent;
+    while (theLenSent > 0)
+    {
+        UInt32 theHeadLeft = kHeaderSize + fEntries[fHead].fLen - fHeadBytesSent;
+        if (theLenSent < theHeadLeft)
+        {
+            fHeadBytesSent += theLenSent;
+            break;
+        }
+        theLenSent -= theHeadLeft;
+        this->PopHead();
+    }
+
+    if (fNumPackets == 0)
+        fRateWindowStart = -1;
+    return QTSS_NoErr;
+}
+
+void RTSPInterleavedQueue::UpdateDrainRate(UInt32 inBytesSent, SInt64 inCurTime)
+{
+    if (fRateWindowStart == -1)
+    {
+        fRateWindowStart = inCurTime;
+        fRateWindowBytes = 0;
+    }
+    fRateWindowBytes += inBytesSent;
+
+    SInt64 theSpan = inCurTime - fRateWindowStart;
+    if (theSpan < kRateWindowMSecs)
+        return;
+
+    UInt32 theSample = (UInt32)(((SInt64)fRateWindowBytes * 1000) / theSpan);
+    if (fDrainRate == 0)
+        fDrainRate = theSample;
+    else
+        fDrainRate = (3 * fDrainRate + theSample) / 4;
+
+    fRateWindowStart = inCurTime;
+    fRateWindowBytes = 0;
+}
+
+UInt32 RTSPInterleavedQueue::GetDelayMSecs()
+{
+    OSMutexLocker locker(&fMutex);
+
+    if (fNumPackets == 0)
+        return 0;
+
+    SInt64 theDelay = OS::Milliseconds() - fEntries[fHead].fQueueTime;
+    if (fDrainRate > 0)
+    {
+        SInt64 theDrainTime = ((SInt64)fQueuedBytes * 1000) / fDrainRate;
+        if (theDrainTime > theDelay)
+            theDelay = theDrainTime;
+    }
+    return (theDelay > 0) ? (UInt32)theDelay : 0;
+}
@@ -0,0 +1,104 @@
+/***************************************************************************
+
+Copyright (c) 2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 RTSPInterleavedQueue.h
+Description: Per RTSP connection send queue of interleaved RTP/RTCP packets,
+             written out with writev and bounded in bytes.
+Comment:
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-19
+LastUpdate:  2026-10-19
+
+****************************************************************************/
+
+#ifndef __RTSP_INTERLEAVED_QUEUE_H__
+#define __RTSP_INTERLEAVED_QUEUE_H__
+
+#include "OSHeaders.h"
+#include "OSMutex.h"
+#include "TCPSocket.h"
+#include "QTSS.h"
+
+/*
+    RTSPSessionInterface::InterleavedWrite writes a packet straight to the
+    socket when nothing is queued ahead of it. Whatever the socket does
+    not take, from the unsent part of that packet on, waits here rather
+    than being dropped, and goes out ahead of newer packets the next time
+    the queue is sent.
+
+    The queue is bounded in bytes. A packet that does not fit is refused
+    with QTSS_WouldBlock, so the sender retries it later. GetDelayMSecs
+    tells the sender how long a packet queued now would wait, which
+    RTPStream counts as lateness and thins the stream by.
+
+    The queue has a lock of its own, so packets can be queued while the
+    RTSP session is busy with a request. Sending them needs the RTSP
+    session mutex, so that they never cut into an RTSP response, see
+    RTSPResponseStream::FlushInterleaved.
+*/
+
+class RTSPInterleavedQueue
+{
+    public:
+
+        enum
+        {
+            kHeaderSize         = 4,    //UInt32, '$' + channel + 2 bytes length
+            kMaxPackets         = 1024, //UInt32
+            kMaxIOVecs          = 64,   //UInt32, packets per writev, 2 iovecs each
+            kRateWindowMSecs    = 100   //UInt32
+        };
+
+        RTSPInterleavedQueue(TCPSocket* inSocket, UInt32 inMaxBytes);
+        ~RTSPInterleavedQueue();
+
+        // QTSS_WouldBlock if the packet does not fit. inBytesSent is how much
+        // of the framed packet, header included, was already written
+        QTSS_Error  Push(UInt8 inChannel, void* inData, UInt32 inLen, UInt32 inBytesSent = 0);
+
+        // Writes as much as the socket takes. With inHeadOnly, stops after the
+        // packet that was partly written. Returns EAGAIN if nothing could be
+        // written, QTSS_NoErr otherwise, or the socket error
+        QTSS_Error  Send(Bool16 inHeadOnly);
+
+        Bool16      IsEmpty()           { return fNumPackets == 0; }
+        Bool16      IsMidPacket()       { return fHeadBytesSent > 0; }
+        UInt32      GetQueuedBytes()    { return fQueuedBytes; }
+
+        // How long a packet queued now would wait, from the measured drain
+        // rate, or from the age of the oldest packet until there is one
+        UInt32      GetDelayMSecs();
+
+    private:
+
+        struct Entry
+        {
+            char    fHeader[kHeaderSize];
+            char*   fData;      // a copy of the packet
+            UInt32  fLen;
+            SInt64  fQueueTime;
+        };
+
+        void        PopHead();
+        void        UpdateDrainRate(UInt32 inBytesSent, SInt64 inCurTime);
+
+        OSMutex     fMutex;
+        TCPSocket*  fSocket;
+        UInt32      fMaxBytes;
+
+        // Ring of kMaxPackets entries
+        Entry*      fEntries;
+        UInt32      fHead;
+        UInt32      fNumPackets;
+        UInt32      fQueuedBytes;       // framed, less what was sent of the head
+        UInt32      fHeadBytesSent;
+
+        // Drain rate, measured only while there is a backlog
+        UInt32      fDrainRate;         // bytes per sec, 0 until measured
+        SInt64      fRateWindowStart;   // -1 when not backlogged
+        UInt32      fRateWindowBytes;
+};
+
+#endif // __RTSP_INTERLEAVED_QUEUE_H__
@@ -24,6 +24,7 @@ LastUpdate:  2010-08-16
 #include "OSMemory.h"
 #include "OSArrayObjectDeleter.h"
 #include "OS.h"
+#include "OSThread.h"
 #include "base64.h"
 
 #include <errno.h>
@@ -86,15 +87,9 @@ QTSS_Error RTSPRequestStream::ReadRequest()
 				/* μRTSPRequestStream::DecodeIncomingData() */
                 //Assert(fEncodedBytesRemaining < 4);
                 
-                // The right position is at fRetreatBytes offset in the request buffer. The reason for this is:
-                //  1) We need to find a place in the request buffer where we know we have enough space to store
-                //  fEncodedBytesRemaining. fRetreatBytes + fEncodedBytesRemaining will always be less than
-                //  kRequestBufferSize because all this data must have been in the same request buffer, together, at one point.
-                //
-                //  2) We need to make sure that there is always more data in the RequestBuffer than in the decoded
-                //  request buffer, otherwise we could overrun(޶) the decoded request buffer (we bounds check on the encoded
-                //  buffer, not the decoded buffer). Leaving fRetreatBytes as empty space in the request buffer ensures
-                //  that this principle is maintained. 
+                // The right position is at fRetreatBytes offset in the request buffer, right after the
+                // decoded retreat bytes, as DecodeIncomingData decodes in place and expects the encoded
+                // data to start where the decoded data ends.
                 ::memmove(&fRequestBuffer[fRetreatBytes], &fRequestBuffer[fCurOffset - fEncodedBytesRemaining], fEncodedBytesRemaining);
                 fCurOffset = fRetreatBytes + fEncodedBytesRemaining;
                 Assert(fCurOffset < kRequestBufferSizeInBytes);
@@ -155,12 +150,17 @@ QTSS_Error RTSPRequestStream::ReadRequest()
 				/* ɹʱ,ȷʣµδ4ֽ,μRTSPRequestStream::DecodeIncomingData() */
                 if (decodeErr == QTSS_NoErr)
                     Assert(fEncodedBytesRemaining < 4);
+
+                // The decoded data took the place of the encoded data it came from
+                fCurOffset = fRequest.Len + fEncodedBytesRemaining;
             }
             else
+            {
                 fRequest.Len += newOffset;
+                fCurOffset += newOffset;
+            }
 
             Assert(fRequest.Len < kRequestBufferSizeInBytes);
-            fCurOffset += newOffset;
         }
 		/* һҪﵽ! */
         Assert(newOffset > 0);
@@ -204,10 +204,10 @@ QTSS_Error RTSPRequestStream::ReadRequest()
         {
 			/* RTSPResponseStream::WriteV() */
 			/* õǰGTMʱ,ʽΪ"Mon, 04 Nov 1996 21:42:17 GMT" */
-            DateBuffer theDate;
-            DateTranslator::UpdateDateBuffer(&theDate, 0); // get the current GMT date and time
+            DateBuffer theLocalDate;
+            DateBuffer* theDate = OSThread::GetCurrentDate(&theLocalDate); // the current GMT date and time
 			/* OS::StartTimeMilli_Int()ʾж೤ʱ? */
-			qtss_printf("\n\n#C->S:\n#time: ms=%lu date=%s\n", (UInt32) OS::StartTimeMilli_Int(), theDate.GetDateBuffer());
+			qtss_printf("\n\n#C->S:\n#time: ms=%lu date=%s\n", (UInt32) OS::StartTimeMilli_Int(), theDate->GetDateBuffer());
 
 			/* TCPSocket,ͻȡӡϢ */
             if (fSocket != NULL)    
@@ -365,73 +365,31 @@ QTSS_Error RTSPRequestStream::Read(void* ioBuffer, UInt32 inBufLen, UInt32* outL
     return theErr;
 }
 
-/* Base64decode()decodeָ,bitϵֵdecode */
+/* Base64decode_quanta()͵decodeָ,4ֽڲdecode */
 QTSS_Error RTSPRequestStream::DecodeIncomingData(char* inSrcData, UInt32 inSrcDataLen)
 {
 	/* ȷûʧ */
     Assert(fRetreatBytes == 0);
-    
-    if (fRequest.Ptr == &fRequestBuffer[0])
-    {
-        fRequest.Ptr = NEW char[kRequestBufferSizeInBytes];
-        fRequest.Len = 0;
-    }
-    
-    // We always decode up through the last chunk of 4.
-	/* bitϵֵ(<=3) */
-    fEncodedBytesRemaining = inSrcDataLen & 3;
-    
-    // Let our friendly Base64Decode function know this by NULL terminating at that point
-	/* Ҫֽ */
-    UInt32 bytesToDecode = inSrcDataLen - fEncodedBytesRemaining;
-	/* Ҫõ */
-    char endChar = inSrcData[bytesToDecode];
-	/* "\0"ΪBase64decode()֪ */
-    inSrcData[bytesToDecode] = '\0';
-    
-	/* ͳƽıֽ(ʹbitΪ0) */
-    UInt32 encodedBytesConsumed = 0;
-    
-    // Loop until the whole load is decoded
-    while (encodedBytesConsumed < bytesToDecode)
-    {
-		/* ɺ,4ı,ȻҲ */
-        Assert((encodedBytesConsumed & 3) == 0);
-		/* Ȼ! */
-        Assert((bytesToDecode & 3) == 0);
 
-		/* ڶеbase64 decode,ٽݴ浽һ,decodeֽ */
-        UInt32 bytesDecoded = Base64decode(fRequest.Ptr + fRequest.Len, inSrcData + encodedBytesConsumed);
+    // The encoded data starts where the decoded data ends, and is decoded in place
+    Assert(inSrcData == fRequest.Ptr + fRequest.Len);
 
-        // If bytesDecoded is 0, we will end up being in an endless loop. The
-        // base64 must be corrupt, so let's just return an error and abort
-		/* Ϻ0,һƻ,뷵error˳ѭ */
-        if (bytesDecoded == 0)
-        {
-            //Assert(0);
-            return QTSS_BadArgument;
-        }
-        
-		/** ʱ³ **/
-        fRequest.Len += bytesDecoded;
+    // We always decode up through the last chunk of 4.
+    UInt32 bytesToDecode = inSrcDataLen & ~3;
+    int encodedBytesConsumed = 0;
+    fRequest.Len += Base64decode_quanta(fRequest.Ptr + fRequest.Len, inSrcData, bytesToDecode, &encodedBytesConsumed);
+    Assert(fRequest.Len < kRequestBufferSizeInBytes);
 
-        // Assuming the stream is valid, the # of encoded bytes we just consumed is
-        // 4/3rds of the number of decoded bytes returned by the decode function Base64decode(),
-        // rounded up() to the nearest multiple of 4.
-        encodedBytesConsumed += (bytesDecoded / 3) * 4;
-		/* ܱ3 */
-        if ((bytesDecoded % 3) > 0)
-            encodedBytesConsumed += 4;
-        
+    // The base64 must be corrupt. Everything up to that point is processed, the rest is dropped
+    if ((UInt32)encodedBytesConsumed < bytesToDecode)
+    {
+        fEncodedBytesRemaining = 0;
+        return QTSS_BadArgument;
     }
-    
-    // Make sure to replace the sacred endChar
-    inSrcData[bytesToDecode] = endChar;
 
-    Assert(fRequest.Len < kRequestBufferSizeInBytes);
-	/* ȷŽҪֽڴ */
-    Assert(encodedBytesConsumed == bytesToDecode);
-    
+    // Keep the incomplete chunk right after the decoded data
+    fEncodedBytesRemaining = inSrcDataLen - bytesToDecode;
+    ::memmove(fRequest.Ptr + fRequest.Len, inSrcData + bytesToDecode, fEncodedBytesRemaining);
     return QTSS_NoErr;
 }
 
@@ -38,8 +38,7 @@ public:
 	//μRTSPSessionInterface::RTSPSessionInterface()
     RTSPRequestStream(TCPSocket* sock);
     
-    // We may have to delete this memory if it was allocated due to base64 decoding
-    ~RTSPRequestStream() { if (fRequest.Ptr != &fRequestBuffer[0]) delete [] fRequest.Ptr; }
+    ~RTSPRequestStream() {}
 
     //ReadRequest
     //This function will not block.
@@ -92,8 +91,8 @@ private:
         kRequestBufferSizeInBytes = 2048        //UInt32
     };
     
-    // Base64 decodes into fRequest.Ptr, updates fRequest.Len, and returns the amount
-    // of data left undecoded in inSrcData
+    // Base64 decodes inSrcData, which starts at the end of fRequest, in place, updates
+    // fRequest.Len, and leaves the data left undecoded right after it in fEncodedBytesRemaining
 	/* Base64decode()decodeָ,bitϵֵdecode */
     QTSS_Error              DecodeIncomingData(char* inSrcData, UInt32 inSrcDataLen);
 
@@ -22,6 +22,7 @@ LastUpdate:  2010-08-16
 
 #include "RTSPResponseStream.h"
 #include "OS.h"
+#include "OSThread.h"
 #include "OSMemory.h"
 #include "OSArrayObjectDeleter.h"
 #include "StringTranslator.h"
@@ -41,9 +42,23 @@ QTSS_Error RTSPResponseStream::WriteV(iovec* inVec, UInt32 inNumVectors, UInt32
     UInt32 theLengthSent = 0;
 	/* ʣdataֽ */
     UInt32 amtInBuffer = this->GetCurrentOffset() - fBytesSentInBuffer;
+
+    // A packet the interleaved queue left half written goes first, or nothing goes
+    Bool16 isBlocked = false;
+    if ((fInterleavedQueue != NULL) && fInterleavedQueue->IsMidPacket())
+    {
+        theErr = fInterleavedQueue->Send(true);
+        isBlocked = fInterleavedQueue->IsMidPacket();
+        if (isBlocked && (theErr == QTSS_NoErr))
+            theErr = EAGAIN;
+    }
     
 	/* bufferлʣ,ͰSocketдRTSP Response */
-    if (amtInBuffer > 0)
+    if (isBlocked)
+    {
+        // theLengthSent stays 0, inSendType decides what happens to the data
+    }
+    else if (amtInBuffer > 0)
     {
 
         // There is some data in the output buffer. Make sure to send that
@@ -61,9 +76,9 @@ QTSS_Error RTSPResponseStream::WriteV(iovec* inVec, UInt32 inNumVectors, UInt32
 		{
 			/* RTSPRequestStream::ReadRequest() */
 			/* õǰGTMʱ,ʽΪ"Mon, 04 Nov 1996 21:42:17 GMT",ӡЩϢ */
-            DateBuffer theDate;			
-            DateTranslator::UpdateDateBuffer(&theDate, 0); // get the current GMT date and time
- 			qtss_printf("\n#S->C:\n#time: ms=%lu date=%s\n", (UInt32) OS::StartTimeMilli_Int(), theDate.GetDateBuffer() );
+            DateBuffer theLocalDate;
+            DateBuffer* theDate = OSThread::GetCurrentDate(&theLocalDate); // the current GMT date and time
+ 			qtss_printf("\n#S->C:\n#time: ms=%lu date=%s\n", (UInt32) OS::StartTimeMilli_Int(), theDate->GetDateBuffer() );
  			
 			/* ÿ,дӡ䱻'\n''\r'ָ(C-String)'\n''\r' */
 			for (UInt32 i =0; i < inNumVectors; i++)
@@ -187,13 +202,21 @@ QTSS_Error RTSPResponseStream::Flush()
     UInt32 amtInBuffer = this->GetCurrentOffset() - fBytesSentInBuffer;
     if (amtInBuffer > 0)
     {
+        // A packet the interleaved queue left half written goes first
+        if ((fInterleavedQueue != NULL) && fInterleavedQueue->IsMidPacket())
+        {
+            (void)fInterleavedQueue->Send(true);
+            if (fInterleavedQueue->IsMidPacket())
+                return EAGAIN;
+        }
+
 		/*********** дӡʣݵϢ,עӡϢǴ **************/
         if (fPrintRTSP)
         {
-            DateBuffer theDate;
-            DateTranslator::UpdateDateBuffer(&theDate, 0); // get the current GMT date and time
+            DateBuffer theLocalDate;
+            DateBuffer* theDate = OSThread::GetCurrentDate(&theLocalDate); // the current GMT date and time
 
- 			qtss_printf("\n#S->C:\n#time: ms=%lu date=%s\n", (UInt32) OS::StartTimeMilli_Int(), theDate.GetDateBuffer() );
+ 			qtss_printf("\n#S->C:\n#time: ms=%lu date=%s\n", (UInt32) OS::StartTimeMilli_Int(), theDate->GetDateBuffer() );
 			StrPtrLen str(this->GetBufPtr() + fBytesSentInBuffer, amtInBuffer);
 			str.PrintStrEOL();
         }
@@ -225,3 +248,57 @@ QTSS_Error RTSPResponseStream::Flush()
     }
     return QTSS_NoErr;
 }
+
+QTSS_Error RTSPResponseStream::WriteInterleaved(UInt8 inChannel, void* inData, UInt32 inLen)
+{
+    Assert(fInterleavedQueue != NULL);
+
+    QTSS_Error theErr = this->FlushInterleaved();
+    if ((theErr != QTSS_NoErr) && (theErr != EAGAIN))
+        return theErr;
+
+    // Only queue the packet when something is waiting ahead of it
+    if (!fInterleavedQueue->IsEmpty() || (this->GetCurrentOffset() > fBytesSentInBuffer))
+        return fInterleavedQueue->Push(inChannel, inData, inLen);
+
+    char theHeader[RTSPInterleavedQueue::kHeaderSize];
+    theHeader[0] = '$';
+    theHeader[1] = (char)inChannel;
+    UInt16 theNetLen = htons((UInt16)inLen);
+    ::memcpy(&theHeader[2], &theNetLen, 2);
+
+    iovec theVec[2];
+    theVec[0].iov_base = theHeader;
+    theVec[0].iov_len = sizeof(theHeader);
+    theVec[1].iov_base = (char*)inData;
+    theVec[1].iov_len = inLen;
+
+    UInt32 theLengthSent = 0;
+    theErr = fSocket->WriteV(theVec, 2, &theLengthSent);
+    if ((theErr != QTSS_NoErr) && (theErr != EAGAIN))
+        return theErr;
+
+    if (theLengthSent > 0)
+        fTimeoutTask->RefreshTimeout();
+    if (theLengthSent == sizeof(theHeader) + inLen)
+        return QTSS_NoErr;
+
+    // The queue is empty, so it takes the rest of the packet whatever its size
+    return fInterleavedQueue->Push(inChannel, inData, inLen, theLengthSent);
+}
+
+QTSS_Error RTSPResponseStream::FlushInterleaved()
+{
+    Assert(fInterleavedQueue != NULL);
+
+    // Flush finishes the half written packet before the buffered responses
+    QTSS_Error theErr = this->Flush();
+    if (theErr != QTSS_NoErr)
+        return theErr;
+
+    UInt32 theQueuedBytes = fInterleavedQueue->GetQueuedBytes();
+    theErr = fInterleavedQueue->Send(false);
+    if (fInterleavedQueue->GetQueuedBytes() < theQueuedBytes)
+        fTimeoutTask->RefreshTimeout();
+    return theErr;
+}
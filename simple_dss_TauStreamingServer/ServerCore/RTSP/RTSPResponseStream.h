@@ -26,6 +26,7 @@ LastUpdate:  2010-08-16
 #include "TCPSocket.h"
 #include "TimeoutTask.h"
 #include "QTSS.h"
+#include "RTSPInterleavedQueue.h"
 
 
 
@@ -39,7 +40,8 @@ class RTSPResponseStream : public ResizeableStringFormatter
 		//μRTSPSessionInterface::RTSPSessionInterface()
         RTSPResponseStream(TCPSocket* inSocket, TimeoutTask* inTimeoutTask)
             :   ResizeableStringFormatter(fOutputBuf, kOutputBufferSizeInBytes),
-                fSocket(inSocket), fBytesSentInBuffer(0), fTimeoutTask(inTimeoutTask),fPrintRTSP(false) {}
+                fSocket(inSocket), fBytesSentInBuffer(0), fTimeoutTask(inTimeoutTask),fPrintRTSP(false),
+                fInterleavedQueue(NULL) {}
         
         virtual ~RTSPResponseStream() {}
 
@@ -73,6 +75,19 @@ class RTSPResponseStream : public ResizeableStringFormatter
         // Flushes(ˢ) any buffered data to the socket. If all data could be sent,
         // this returns QTSS_NoErr, otherwise, it returns EWOULDBLOCK
         QTSS_Error Flush();
+
+        // Interleaved RTP/RTCP goes through a queue when there is one. The queue
+        // belongs to the caller. WriteV and Flush finish a packet the queue
+        // left half written before anything else goes out
+        void                    SetInterleavedQueue(RTSPInterleavedQueue* inQueue) { fInterleavedQueue = inQueue; }
+        RTSPInterleavedQueue*   GetInterleavedQueue()   { return fInterleavedQueue; }
+
+        // Writes the packet straight to the socket if nothing waits ahead of it,
+        // and queues what the socket does not take. QTSS_WouldBlock if the queue is full
+        QTSS_Error WriteInterleaved(UInt8 inChannel, void* inData, UInt32 inLen);
+
+        // Sends buffered responses and queued packets, in the order they were started
+        QTSS_Error FlushInterleaved();
         
 		/* ǷӡRTSPϢ? */
         void        ShowRTSP(Bool16 enable) {fPrintRTSP = enable; }     
@@ -95,6 +110,7 @@ class RTSPResponseStream : public ResizeableStringFormatter
         UInt32                  fBytesSentInBuffer;
         TimeoutTask*            fTimeoutTask;
         Bool16                  fPrintRTSP;     // debugging printfs
+        RTSPInterleavedQueue*   fInterleavedQueue;
         
         friend class RTSPRequestInterface;
 };
@@ -17,8 +17,6 @@ LastUpdate:  2011-07-03
 
 
 
-#define __RTSP_HTTP_DEBUG__ 1
-#define __RTSP_HTTP_VERBOSE__ 1
 #define __RTSP_AUTHENTICATION_DEBUG__ 1
 
 #include "RTSPSession.h"
@@ -34,6 +32,9 @@ LastUpdate:  2011-07-03
 #include "UserAgentParser.h"
 #include "base64.h"
 #include "md5digest.h"
+#include "OS.h"
+#include "OSTrace.h"
+#include "StringTranslator.h"
 
 #include <unistd.h>
 #include <errno.h>
@@ -41,44 +42,17 @@ LastUpdate:  2011-07-03
 
 
 
-#if __RTSP_HTTP_DEBUG__
-    #define HTTP_TRACE(s) qtss_printf(s);
-    #define HTTP_TRACE_SPL(s) PrintfStrPtrLen(s);
-    #define HTTP_TRACE_ONE(s, one ) qtss_printf(s, one);
-    #define HTTP_TRACE_TWO(s, one, two ) qtss_printf(s, one, two);
-#else
-    #define HTTP_TRACE(s);
-    #define HTTP_TRACE_SPL(s);
-    #define HTTP_TRACE_ONE(s, one );
-    #define HTTP_TRACE_TWO(s, one, two );
-#endif
-
-#if __RTSP_HTTP_VERBOSE__
-    #define HTTP_VTRACE(s) qtss_printf(s);
-    #define HTTP_VTRACE_SPL(s) PrintfStrPtrLen(s);
-    #define HTTP_VTRACE_ONE(s, one ) qtss_printf(s, one);
-    #define HTTP_VTRACE_TWO(s, one, two ) qtss_printf(s, one, two);
-#else
-    #define HTTP_VTRACE(s);
-    #define HTTP_VTRACE_SPL(s);
-    #define HTTP_VTRACE_ONE(s, one );
-    #define HTTP_VTRACE_TWO(s, one, two );
-#endif
+// RTSP over HTTP tunnel trace points, rtsp subsystem of OSTrace: HTTP_TRACE
+// at level debug, HTTP_VTRACE at level verbose
+#define HTTP_TRACE(s) OS_TRACE(RTSP, Debug, s);
+#define HTTP_TRACE_SPL(s) OS_TRACE(RTSP, Debug, "%.*s\n", (int)(s)->Len, (s)->Ptr);
+#define HTTP_TRACE_ONE(s, one ) OS_TRACE(RTSP, Debug, s, one);
+#define HTTP_TRACE_TWO(s, one, two ) OS_TRACE(RTSP, Debug, s, one, two);
 
-
-
-#if  __RTSP_HTTP_DEBUG__ || __RTSP_HTTP_VERBOSE__
-
-/*  ӡָStrPtrLen  */
-static void PrintfStrPtrLen( StrPtrLen *splRequest )
-{
-    char    buff[1024];  
-    memcpy( buff, splRequest->Ptr, splRequest->Len );   
-    buff[ splRequest->Len] = 0;  
-    HTTP_TRACE_ONE( "%s\n", buff )
-    //qtss_printf( "%s\n", buff );
-}
-#endif
+#define HTTP_VTRACE(s) OS_TRACE(RTSP, Verbose, s);
+#define HTTP_VTRACE_SPL(s) OS_TRACE(RTSP, Verbose, "%.*s\n", (int)(s)->Len, (s)->Ptr);
+#define HTTP_VTRACE_ONE(s, one ) OS_TRACE(RTSP, Verbose, s, one);
+#define HTTP_VTRACE_TWO(s, one, two ) OS_TRACE(RTSP, Verbose, s, one, two);
 
 //hack stuff
 //qtssClientSessionObjectType see RTSPSession::RTSPSession()
@@ -106,6 +80,26 @@ StrPtrLen   RTSPSession::sHTTPResponseHeaderPtr(sHTTPResponseHeaderBuf, kMaxHTTP
 char        RTSPSession::sHTTPResponseNoServerHeaderBuf[kMaxHTTPResponseLen];//300
 StrPtrLen   RTSPSession::sHTTPResponseNoServerHeaderPtr(sHTTPResponseNoServerHeaderBuf, kMaxHTTPResponseLen);
 
+OSHistogram RTSPSession::sStateLatency[kNumStates];
+OSHistogram RTSPSession::sParseLatency;
+char*       RTSPSession::sStateNames[kNumStates] =
+{
+    "ReadingRequest", "FilteringRequest", "RoutingRequest", "AuthenticatingRequest", "AuthorizingRequest",
+    "PreprocessingRequest", "ProcessingRequest", "SendingResponse", "PostProcessingRequest", "CleaningUp",
+    "WaitingToBindHTTPTunnel", "SocketHasBeenBoundIntoHTTPTunnel", "HTTPFilteringRequest", "ReadingFirstRequest",
+    "HaveNonTunnelMessage"
+};
+
+// Charges the time spent in one call of RTSPSession::Run() to the states it was spent in
+class RTSPSessionStateTimer
+{
+    public:
+        RTSPSessionStateTimer(RTSPSession* inSession) : fSession(inSession) { fSession->StartStateTimer(); }
+        ~RTSPSessionStateTimer() { fSession->UpdateStateTimer(); }
+    private:
+        RTSPSession* fSession;
+};
+
 // stock reponse with place holder for server header and optional "x-server-ip-address" header ( %s%s%s for  "x-server-ip-address" + ip address + \r\n )
 // the optional version must be generated at runtime to include a valid IP address for the actual interface
 char*       RTSPSession::sHTTPResponseFormatStr =  "HTTP/1.0 200 OK\r\n%s%s%s%s\r\nConnection: close\r\nDate: Thu, 19 Aug 1982 18:30:00 GMT\r\nCache-Control: no-store\r\nPragma: no-cache\r\nContent-Type: application/x-rtsp-tunnelled\r\n\r\n";
@@ -141,9 +135,14 @@ RTSPSession::RTSPSession( Bool16 doReportHTTPConnectionAddress )
   fFoundValidAccept( false),
   fDoReportHTTPConnectionAddress(doReportHTTPConnectionAddress),//ȷ,ǷClientipַ?
   fCurrentModule(0),
-  fState(kReadingFirstRequest) /* RTSPSession״̬ĳʼ״̬,ע˴ֵRTSPSession::Run()Ҫʹ */
+  fFilterMethod(qtssIllegalMethod),
+  fState(kReadingFirstRequest), /* RTSPSession״̬ĳʼ״̬,ע˴ֵRTSPSession::Run()Ҫʹ */
+  fStateStartTime(0),
+  fVisitedStates(0),
+  fTimedState(kReadingFirstRequest)
 {
     this->SetTaskName("RTSPSession");
+    ::memset(fStateLatency, 0, sizeof(fStateLatency));
 
     // must guarantee this map is present
     Assert(sHTTPProxyTunnelMap != NULL);
@@ -234,6 +233,7 @@ SInt64 RTSPSession::Run()
     // Some callbacks look for this struct in the thread object
 	// 趨ǰModule ״̬
     OSThreadDataSetter theSetter(&fModuleState, NULL);
+    RTSPSessionStateTimer theStateTimer(this);
         
     //check for a timeout or a kill. If so, just consider the session dead
     if ((events & Task::kTimeoutEvent) || (events & Task::kKillEvent))
@@ -256,6 +256,7 @@ SInt64 RTSPSession::Run()
             case kReadingFirstRequest:
             {
 				HTTP_TRACE( "RTSPSession::Run kReadingFirstRequest\n" )
+                this->UpdateStateTimer();
                 if ((err = fInputStream.ReadRequest()) == QTSS_NoErr)
                 {
 					/* RequestStreamQTSS_NoErr ζѾ
@@ -302,6 +303,7 @@ SInt64 RTSPSession::Run()
             case kHTTPFilteringRequest:
             {    
                 HTTP_TRACE( "RTSPSession::Run kHTTPFilteringRequest\n" )
+                this->UpdateStateTimer();
             
                 fState = kHaveNonTunnelMessage; // assume it's not a tunnel setup message
                                                 // prefilter will set correct tunnel state if it is.
@@ -326,6 +328,7 @@ SInt64 RTSPSession::Run()
             case kWaitingToBindHTTPTunnel:
 
 				HTTP_TRACE( "RTSPSession::Run kWaitingToBindHTTPTunnel\n" )
+                this->UpdateStateTimer();
                 //flush the GET response, if it's there
                 err = fOutputStream.Flush();
                 if (err == EAGAIN)
@@ -340,6 +343,7 @@ SInt64 RTSPSession::Run()
             case kSocketHasBeenBoundIntoHTTPTunnel:
 
                 HTTP_TRACE( "RTSPSession::Run kSocketHasBeenBoundIntoHTTPTunnel\n" )
+                this->UpdateStateTimer();
                 // DMS - Can this execute either? I don't think so... this one
                 // we may not need...
                 
@@ -352,6 +356,7 @@ SInt64 RTSPSession::Run()
             case kReadingRequest:
             {
 				HTTP_TRACE( "RTSPSession::Run kReadingRequest\n" )
+                this->UpdateStateTimer();
 				/* ȡdataʱҪ,ԷPOST */
                 // We should lock down the session while reading in data,
                 // because we can't snarf up a POST while reading.
@@ -369,7 +374,9 @@ SInt64 RTSPSession::Run()
                     //+rt use the socket that reads the data, may be different now.
 					/* ٴevent */
                     fInputSocketP->RequestEvent(EV_RE);
-                    return 0;
+
+                    // Between requests, this sends what interleaved RTP left queued
+                    return this->SendInterleavedQueue();
                 }
                 
 				/* ,ϵ */
@@ -407,6 +414,7 @@ SInt64 RTSPSession::Run()
             case kHaveNonTunnelMessage:
             {   
 				HTTP_TRACE( "RTSPSession::Run kHaveNonTunnelMessage\n" )
+                this->UpdateStateTimer();
                 // should only get here when fInputStream has a full message built.
                 /* õһRTSP request bufferʼַ */
                 Assert( fInputStream.GetRequestBuffer() );
@@ -469,6 +477,7 @@ SInt64 RTSPSession::Run()
             case kFilteringRequest:
             {
 				HTTP_TRACE( "RTSPSession::Run kFilteringRequest\n" )
+                this->UpdateStateTimer();
                 // We received something so auto refresh
                 // The need to auto refresh is because the api doesn't allow a module to refresh at this point
                 // 
@@ -499,11 +508,24 @@ SInt64 RTSPSession::Run()
                 theFilterParams.rtspFilterParams.outNewRequest = &theReplacedRequest;
                 
                 // Invoke filter modules
-				/* ͳעkRTSPFilterRoleModule */
-                numModules = QTSServerInterface::GetNumModulesInRole(QTSSModule::kRTSPFilterRole);
+                QTSS_RTSPMethod theFilterMethod = qtssIllegalMethod;
+                StrPtrLen theFilterPath;
+                this->GetRequestLineMethodAndPath(&theFilterMethod, &theFilterPath);
+                if (fCurrentModule == 0)
+                    fFilterMethod = theFilterMethod;
+				/* ͳעkRTSPFilterRoleҴmethodModule */
+                numModules = QTSServerInterface::GetNumModulesInRole(QTSSModule::kRTSPFilterRole, fFilterMethod);
 				/* Եǰעģ,ûRTSPResponseʱeventʱ,д */
                 for (; (fCurrentModule < numModules) && ((!fRequest->HasResponseBeenSent()) || fModuleState.eventRequested); fCurrentModule++)
                 {
+					/* ȡָŵעkRTSPFilterRoleModule */
+					/**************** NOTE ********************************/
+                    theModule = QTSServerInterface::GetModule(QTSSModule::kRTSPFilterRole, fFilterMethod, fCurrentModule);
+                    // The method is checked again in case an earlier module replaced the request
+                    if (!theModule->RunsForMethod(QTSSModule::kRTSPFilterRole, theFilterMethod) ||
+                        !theModule->RunsForPath(QTSSModule::kRTSPFilterRole, &theFilterPath))
+                        continue;
+                    
                     fModuleState.eventRequested = false;
                     fModuleState.idleTime = 0;
                     if (fModuleState.globalLockRequested )
@@ -512,9 +534,6 @@ SInt64 RTSPSession::Run()
                         fModuleState.isGlobalLocked = true;
                     }
                     
-					/* ȡָŵעkRTSPFilterRoleModule */
-					/**************** NOTE ********************************/
-                    theModule = QTSServerInterface::GetModule(QTSSModule::kRTSPFilterRole, fCurrentModule);
 					/* ømodule */
                     (void)theModule->CallDispatch(QTSS_RTSPFilter_Role, &theFilterParams);
                     fModuleState.isGlobalLocked = false;
@@ -541,6 +560,7 @@ SInt64 RTSPSession::Run()
                         fRequest->SetVal(qtssRTSPReqFullRequest, theReplacedRequest, ::strlen(theReplacedRequest));
                         oldReplacedRequest = theReplacedRequest;
                         theReplacedRequest = NULL;
+                        this->GetRequestLineMethodAndPath(&theFilterMethod, &theFilterPath);
                     }
                     
                 }
@@ -586,8 +606,9 @@ SInt64 RTSPSession::Run()
             case kRoutingRequest:
             {
 				HTTP_TRACE( "RTSPSession::Run kRoutingRequest\n" )
+                this->UpdateStateTimer();
                 // Invoke router modules
-                numModules = QTSServerInterface::GetNumModulesInRole(QTSSModule::kRTSPRouteRole);
+                numModules = QTSServerInterface::GetNumModulesInRole(QTSSModule::kRTSPRouteRole, fRequest->GetMethod());
                 {
                     // Manipulation of the RTPSession from the point of view of
                     // a module is guaranteed to be atomic by the API.
@@ -596,6 +617,11 @@ SInt64 RTSPSession::Run()
                     
                     for (; (fCurrentModule < numModules) && ((!fRequest->HasResponseBeenSent()) || fModuleState.eventRequested); fCurrentModule++)
                     {  
+						/* ȡָŵעkRTSPRouteRoleModule */
+                        theModule = QTSServerInterface::GetModule(QTSSModule::kRTSPRouteRole, fRequest->GetMethod(), fCurrentModule);
+                        if (!theModule->RunsForPath(QTSSModule::kRTSPRouteRole, fRequest->GetValue(qtssRTSPReqFilePath)))
+                            continue;
+                        
                         fModuleState.eventRequested = false;
                         fModuleState.idleTime = 0;
                         if (fModuleState.globalLockRequested )
@@ -603,8 +629,6 @@ SInt64 RTSPSession::Run()
                             fModuleState.isGlobalLocked = true;
                         } 
                         
-						/* ȡָŵעkRTSPRouteRoleModule */
-                        theModule = QTSServerInterface::GetModule(QTSSModule::kRTSPRouteRole, fCurrentModule);
 						/* ømodule */
                         (void)theModule->CallDispatch(QTSS_RTSPRoute_Role, &fRoleParams);
                         fModuleState.isGlobalLocked = false;
@@ -665,6 +689,7 @@ SInt64 RTSPSession::Run()
             case kAuthenticatingRequest:
             {
 				HTTP_TRACE( "RTSPSession::Run kAuthenticatingRequest\n" )
+                this->UpdateStateTimer();
                 /* õclient͵RTSP method */
                 QTSS_RTSPMethod method = fRequest->GetMethod();
                 if (method != qtssIllegalMethod) do  
@@ -706,7 +731,8 @@ SInt64 RTSPSession::Run()
             
                 fModuleState.eventRequested = false;
                 fModuleState.idleTime = 0;
-                if (QTSServerInterface::GetNumModulesInRole(QTSSModule::kRTSPAthnRole) > 0)
+                theModule = QTSServerInterface::GetFirstModuleForPath(QTSSModule::kRTSPAthnRole, fRequest->GetMethod(), fRequest->GetValue(qtssRTSPReqFilePath));
+                if (theModule != NULL)
                 {
                     if (fModuleState.globalLockRequested )
                     {   
@@ -715,7 +741,6 @@ SInt64 RTSPSession::Run()
                     } 
 
 					/* õAuthorize module */
-                    theModule = QTSServerInterface::GetModule(QTSSModule::kRTSPAthnRole, 0);
 					/* Authorize module */
                     (void)theModule->CallDispatch(QTSS_RTSPAuthenticate_Role, &theAuthenticationParams);
                     fModuleState.isGlobalLocked = false;
@@ -747,8 +772,9 @@ SInt64 RTSPSession::Run()
             case kAuthorizingRequest:
             {
 				HTTP_TRACE( "RTSPSession::Run kAuthorizingRequest\n" )
+                this->UpdateStateTimer();
                 // Invoke authorization modules
-                numModules = QTSServerInterface::GetNumModulesInRole(QTSSModule::kRTSPAuthRole);
+                numModules = QTSServerInterface::GetNumModulesInRole(QTSSModule::kRTSPAuthRole, fRequest->GetMethod());
 
                 Bool16      allowed = true; 
                 QTSS_Error  theErr = QTSS_NoErr;
@@ -766,6 +792,11 @@ SInt64 RTSPSession::Run()
 				/* ѭModule */
                 for (; (fCurrentModule < numModules) && ((!fRequest->HasResponseBeenSent()) || fModuleState.eventRequested); fCurrentModule++)
                 {
+					/* õAuthorize module */
+                    theModule = QTSServerInterface::GetModule(QTSSModule::kRTSPAuthRole, fRequest->GetMethod(), fCurrentModule);
+                    if (!theModule->RunsForPath(QTSSModule::kRTSPAuthRole, fRequest->GetValue(qtssRTSPReqFilePath)))
+                        continue;
+                    
                     fModuleState.eventRequested = false;
                     fModuleState.idleTime = 0;
                     if (fModuleState.globalLockRequested )
@@ -773,8 +804,6 @@ SInt64 RTSPSession::Run()
                         fModuleState.isGlobalLocked = true;
                     } 
                     
-					/* õAuthorize module */
-                    theModule = QTSServerInterface::GetModule(QTSSModule::kRTSPAuthRole, fCurrentModule);
 					/* Authorize module */
                     (void)theModule->CallDispatch(QTSS_RTSPAuthorize_Role, &fRoleParams);
                     fModuleState.isGlobalLocked = false;
@@ -872,9 +901,10 @@ SInt64 RTSPSession::Run()
             case kPreprocessingRequest:
             {
 				HTTP_TRACE( "RTSPSession::Run kPreprocessingRequest\n" )
+                this->UpdateStateTimer();
                 // Invoke preprocessor modules
 				/* õעkRTSPPreProcessorRoleModule */
-                numModules = QTSServerInterface::GetNumModulesInRole(QTSSModule::kRTSPPreProcessorRole);
+                numModules = QTSServerInterface::GetNumModulesInRole(QTSSModule::kRTSPPreProcessorRole, fRequest->GetMethod());
                 {
                     // Manipulation of the RTPSession from the point of view of
                     // a module is guarenteed to be atomic by the API.
@@ -883,6 +913,11 @@ SInt64 RTSPSession::Run()
                         
                     for (; (fCurrentModule < numModules) && ((!fRequest->HasResponseBeenSent()) || fModuleState.eventRequested); fCurrentModule++)
                     {
+						/* õעkRTSPPreProcessorRoleģ鲢 */
+                        theModule = QTSServerInterface::GetModule(QTSSModule::kRTSPPreProcessorRole, fRequest->GetMethod(), fCurrentModule);
+                        if (!theModule->RunsForPath(QTSSModule::kRTSPPreProcessorRole, fRequest->GetValue(qtssRTSPReqFilePath)))
+                            continue;
+                        
                         fModuleState.eventRequested = false;
                         fModuleState.idleTime = 0;
                         if (fModuleState.globalLockRequested )
@@ -890,8 +925,6 @@ SInt64 RTSPSession::Run()
                             fModuleState.isGlobalLocked = true;
                         } 
                         
-						/* õעkRTSPPreProcessorRoleģ鲢 */
-                        theModule = QTSServerInterface::GetModule(QTSSModule::kRTSPPreProcessorRole, fCurrentModule);
                         (void)theModule->CallDispatch(QTSS_RTSPPreProcessor_Role, &fRoleParams);
                         fModuleState.isGlobalLocked = false;
 
@@ -926,12 +959,14 @@ SInt64 RTSPSession::Run()
             case kProcessingRequest:
             {
 				HTTP_TRACE( "RTSPSession::Run kProcessingRequest\n" )
+                this->UpdateStateTimer();
                 // If no preprocessor sends a response, move onto the request processing module. It
                 // is ALWAYS supposed to send a response, but if it doesn't, we have a canned error
                 // to send back.
                 fModuleState.eventRequested = false;
                 fModuleState.idleTime = 0;
-                if (QTSServerInterface::GetNumModulesInRole(QTSSModule::kRTSPRequestRole) > 0)
+                theModule = QTSServerInterface::GetFirstModuleForPath(QTSSModule::kRTSPRequestRole, fRequest->GetMethod(), fRequest->GetValue(qtssRTSPReqFilePath));
+                if (theModule != NULL)
                 {
                     // Manipulation of the RTPSession from the point of view of
                     // a module is guarenteed to be atomic by the API.
@@ -945,7 +980,6 @@ SInt64 RTSPSession::Run()
 
 					/************************NOTE!! *******************************************/
 					/* ȡעQTSSModule::kRTSPRequestRoleModule,ֻQTSSFileModule */
-                    theModule = QTSServerInterface::GetModule(QTSSModule::kRTSPRequestRole, 0);
 					/* øMoudule */
                     (void)theModule->CallDispatch(QTSS_RTSPRequest_Role, &fRoleParams);
                     fModuleState.isGlobalLocked = false;
@@ -993,6 +1027,7 @@ SInt64 RTSPSession::Run()
             case kPostProcessingRequest:
             {
 				HTTP_TRACE( "RTSPSession::Run kPostProcessingRequest\n" )
+                this->UpdateStateTimer();
                 // Post process the request *before* sending the response. Therefore, we
                 // will post process regardless of whether the client actually gets our response
                 // or not.
@@ -1006,7 +1041,7 @@ SInt64 RTSPSession::Run()
                     // Invoke postprocessor modules only if there is an RTP session. We do NOT want
                     // postprocessors running when filters or syntax errors have occurred in the request!
 					/* עkRTSPPostProcessorRoleģĿ */
-                    numModules = QTSServerInterface::GetNumModulesInRole(QTSSModule::kRTSPPostProcessorRole);
+                    numModules = QTSServerInterface::GetNumModulesInRole(QTSSModule::kRTSPPostProcessorRole, fRequest->GetMethod());
                     {
                         // Manipulation of the RTPSession from the point of view of
                         // a module is guarenteed to be atomic by the API.
@@ -1033,6 +1068,11 @@ SInt64 RTSPSession::Run()
                     
                         for (; (fCurrentModule < numModules) ||  (fModuleState.eventRequested) ; fCurrentModule++)
                         {
+							/* õעkRTSPPostProcessorRoleModule */
+                            theModule = QTSServerInterface::GetModule(QTSSModule::kRTSPPostProcessorRole, fRequest->GetMethod(), fCurrentModule);
+                            if (!theModule->RunsForPath(QTSSModule::kRTSPPostProcessorRole, fRequest->GetValue(qtssRTSPReqFilePath)))
+                                continue;
+                            
                             fModuleState.eventRequested = false;
                             fModuleState.idleTime = 0;
                             if (fModuleState.globalLockRequested )
@@ -1040,8 +1080,6 @@ SInt64 RTSPSession::Run()
                                 fModuleState.isGlobalLocked = true;
                             } 
                             
-							/* õעkRTSPPostProcessorRoleModule */
-                            theModule = QTSServerInterface::GetModule(QTSSModule::kRTSPPostProcessorRole, fCurrentModule);
                             (void)theModule->CallDispatch(QTSS_RTSPPostProcessor_Role, &fRoleParams);
                             fModuleState.isGlobalLocked = false;
                             
@@ -1068,6 +1106,7 @@ SInt64 RTSPSession::Run()
             case kSendingResponse:
             {
 				HTTP_TRACE( "RTSPSession::Run kSendingResponse\n" )
+                this->UpdateStateTimer();
                 // Sending the RTSP response consists of making sure the
                 // RTSP request output buffer is completely flushed() to the socket.
                 Assert(fRequest != NULL);
@@ -1119,6 +1158,7 @@ SInt64 RTSPSession::Run()
             case kCleaningUp:
             {
 				HTTP_TRACE( "RTSPSession::Run kCleaningUp\n" )
+                this->UpdateStateTimer();
                 // Cleaning up consists of making sure we've read all the incoming Request Body
                 // data off of the socket
                 if (this->GetRemainingReqBodyLen() > 0)
@@ -1188,15 +1228,7 @@ Bool16 RTSPSession::ParseProxyTunnelHTTP()
     {
         fHTTPMethod = kHTTPMethodUnknown;
     
-    #if __RTSP_HTTP_DEBUG__ 
-        {
-			/* ӡȡRTSP Request */
-            char    buff[1024];     
-            memcpy( buff, splRequest->Ptr, splRequest->Len );    
-            buff[ splRequest->Len] = 0;    
-            HTTP_VTRACE( buff )
-        }
-    #endif
+        HTTP_VTRACE_SPL( splRequest )
 
 		/* ȡRTSP Request */
         StrPtrLen       theParsedData;
@@ -1292,17 +1324,7 @@ Bool16 RTSPSession::ParseProxyTunnelHTTP()
                     {   
                         parser.ConsumeUntil( &hTTPAcceptHeader, StringParser::sEOLMask );           
                         
-                        #if __RTSP_HTTP_DEBUG__ 
-                        {
-                            char    buff[1024];
-                            
-                            memcpy( buff, hTTPAcceptHeader.Ptr, hTTPAcceptHeader.Len );
-                            
-                            buff[ hTTPAcceptHeader.Len] = 0;
-                            
-                            HTTP_VTRACE_ONE( "client will accept: %s\n", buff )
-                        }
-                        #endif
+                        OS_TRACE(RTSP, Verbose, "client will accept: %.*s\n", (int)hTTPAcceptHeader.Len, hTTPAcceptHeader.Ptr);
                             
                         // we really don't need to check thisif ( theParsedData.EqualIgnoreCase( kAcceptData, kAcceptDataLen ) ) 
                         {   fFoundValidAccept = true;
@@ -1670,13 +1692,67 @@ Bool16 RTSPSession::ParseOptionsResponse()
 	return (theProtocol.Equal(sRTSPStr));
 }
 
+/* full requestȡmethod·(ȥURL"rtsp://host"),kRTSPFilterRoleѡModule */
+void RTSPSession::GetRequestLineMethodAndPath(QTSS_RTSPMethod* outMethod, StrPtrLen* outPath)
+{
+    *outMethod = qtssIllegalMethod;
+    outPath->Set(NULL, 0);
+    
+    StrPtrLen* theFullRequest = fRequest->GetValue(qtssRTSPReqFullRequest);
+    if ((theFullRequest->Ptr == NULL) || (theFullRequest->Len == 0))
+        return;
+    
+    StringParser theParser(theFullRequest);
+    StrPtrLen theMethod;
+    theParser.ConsumeWord(&theMethod);
+    if (theMethod.Len > 0)
+        *outMethod = RTSPProtocol::GetMethod(theMethod);
+    
+    // the path only matters to filters that added URL prefixes
+    if (!QTSServerInterface::RoleHasURLPrefixes(QTSSModule::kRTSPFilterRole))
+        return;
+    
+    theParser.ConsumeWhitespace();
+    theParser.ConsumeUntilWhitespace(outPath);
+    if ((outPath->Len > 0) && (outPath->Ptr[0] != '/'))
+    {
+        // <protocol>://<host-addr>/<path>, or "*"
+        StringParser theURLParser(outPath);
+        theURLParser.ConsumeUntil(NULL, ':');
+        theURLParser.Expect(':');
+        theURLParser.Expect('/');
+        theURLParser.Expect('/');
+        theURLParser.ConsumeUntil(NULL, '/');
+        theURLParser.ConsumeLength(outPath, theURLParser.GetDataRemaining());
+    }
+
+    // drop the query string and decode the path the way RTSPRequest::ParseURI()
+    // does, so the prefixes match filters the same as the later roles
+    StringParser thePathParser(outPath);
+    thePathParser.ConsumeUntil(outPath, '?');
+    SInt32 theBytesWritten = -1;
+    if (outPath->Len > 0)
+        theBytesWritten = StringTranslator::DecodeURL(outPath->Ptr, outPath->Len,
+                                                fFilterPath, kMaxFilterPathSizeInBytes);
+    if ((theBytesWritten < 0) || (theBytesWritten == kMaxFilterPathSizeInBytes))
+    {
+        // undecodable or too long, only filters without prefixes run
+        outPath->Set(NULL, 0);
+        return;
+    }
+    StringTranslator::DecodePath(fFilterPath, theBytesWritten);
+    outPath->Set(fFilterPath, theBytesWritten);
+}
+
 /* ȽClientfull RTSP Request,ͬMethods,ҶӦRTP Session,ûо½һRTP Session.Play Requestthinning parameters */
 void RTSPSession::SetupRequest()
 {
     //
     // First parse the request
 	/* ȴclientȡfull RTSP Request,ĵһк,Response headerRequest headerͬ,ȡRequested File path */
+    SInt64 theParseStartTime = OS::Microseconds();
     QTSS_Error theErr = fRequest->Parse();
+    sParseLatency.AddSample(OS::Microseconds() - theParseStartTime);
 	/* ,ֱӷ */
     if (theErr != QTSS_NoErr)
         return;
@@ -2308,3 +2384,43 @@ void RTSPSession::HandleIncomingDataPacket()
     }
     fCurrentModule = 0;
 }
+
+void RTSPSession::StartStateTimer()
+{
+    fStateStartTime = OS::Microseconds();
+    fTimedState = fState;
+}
+
+// Called on entry to every state of Run() and when Run() returns
+void RTSPSession::UpdateStateTimer()
+{
+    SInt64 theCurrentTime = OS::Microseconds();
+    fStateLatency[fTimedState] += theCurrentTime - fStateStartTime;
+    fVisitedStates |= 1 << fTimedState;
+
+    // Leaving kCleaningUp means the request is done, one sample per state it went through
+    if ((fTimedState == kCleaningUp) && (fState != kCleaningUp))
+    {
+        for (UInt32 x = 0; x < kNumStates; x++)
+        {
+            if (fVisitedStates & (1 << x))
+                sStateLatency[x].AddSample(fStateLatency[x]);
+            fStateLatency[x] = 0;
+        }
+        fVisitedStates = 0;
+    }
+
+    fTimedState = fState;
+    fStateStartTime = theCurrentTime;
+}
+
+void RTSPSession::FormatStateLatency(StringFormatter* ioFormatter)
+{
+    for (UInt32 x = 0; x < kNumStates; x++)
+    {
+        if (sStateLatency[x].GetCount() > 0)
+            sStateLatency[x].Format(ioFormatter, sStateNames[x]);
+    }
+    if (sParseLatency.GetCount() > 0)
+        sParseLatency.Format(ioFormatter, "RTSPRequest::Parse");
+}
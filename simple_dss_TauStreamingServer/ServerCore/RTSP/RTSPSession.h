@@ -24,6 +24,8 @@ LastUpdate:  2010-08-16
 #include "RTSPRequest.h"
 #include "RTPSession.h"
 #include "TimeoutTask.h"
+#include "StringFormatter.h"
+#include "OSHistogram.h"
 
 class RTSPSession : public RTSPSessionInterface
 {
@@ -35,6 +37,10 @@ class RTSPSession : public RTSPSessionInterface
         // Call this before using this object
         static void Initialize();
 
+        // Appends one OSHistogram::Format line (in microseconds) per state of the
+        // Run() state machine plus one for RTSPRequest::Parse(), used for qtssSvrRTSPStateLatency
+        static void FormatStateLatency(StringFormatter* ioFormatter);
+
 		//see if playing due to the RTP session status
 		/* used in RTSPRequest::ParseURI() */
         Bool16 IsPlaying() {if (fRTPSession == NULL) return false; if (fRTPSession->GetSessionState() == qtssPlayingState) return true; return false; }
@@ -157,7 +163,8 @@ class RTSPSession : public RTSPSessionInterface
             kSocketHasBeenBoundIntoHTTPTunnel = 11,         // POST side after attachment by GET side ( its dying )
             kHTTPFilteringRequest = 12,                     // after kReadingRequest, enter this state
             kReadingFirstRequest = 13,                      // ״̬ʼ̬initial state - the only time we look for an HTTP tunnel
-            kHaveNonTunnelMessage = 14                  // we've looked at the message, and its not an HTTP tunnle message
+            kHaveNonTunnelMessage = 14,                 // we've looked at the message, and its not an HTTP tunnle message
+            kNumStates = 15
         };
         
 		/* RTSP Session state machine, def see enum above  */
@@ -169,6 +176,37 @@ class RTSPSession : public RTSPSessionInterface
         QTSS_RoleParams     fRoleParams;//module param blocks for roles.
         QTSS_ModuleState    fModuleState;
         
+        // The filter role runs before the request is parsed, so its modules are
+        // picked by the method of the request line, kept in fFilterMethod while
+        // they run in case one of them replaces the request. The path is decoded
+        // into fFilterPath, which is as long as the file path buffer of the request,
+        // and only when a filter module added URL prefixes
+        enum
+        {
+            kMaxFilterPathSizeInBytes = 256     //Uint32
+        };
+        void                GetRequestLineMethodAndPath(QTSS_RTSPMethod* outMethod, StrPtrLen* outPath);
+        QTSS_RTSPMethod     fFilterMethod;
+        char                fFilterPath[kMaxFilterPathSizeInBytes];
+
+        // Per state latency. Run() adds the time it spends in each state to
+        // fStateLatency, once a request has been cleaned up the totals are added
+        // to sStateLatency, so one request is one sample per state it went through.
+        // Time spent waiting for events between Run() calls is not counted.
+        void    StartStateTimer();
+        void    UpdateStateTimer();
+
+        SInt64              fStateLatency[kNumStates];
+        SInt64              fStateStartTime;
+        UInt32              fVisitedStates;     // bit per state
+        UInt32              fTimedState;
+
+        static OSHistogram  sStateLatency[kNumStates];
+        static OSHistogram  sParseLatency;
+        static char*        sStateNames[kNumStates];
+
+        friend class RTSPSessionStateTimer;
+        
         QTSS_Error SetupAuthLocalPath(RTSPRequest *theRTSPRequest);
         
         
@@ -86,6 +86,8 @@ RTSPSessionInterface::RTSPSessionInterface()
     fInputStream(&fSocket),//ʼRTSPRequestStream
     fOutputStream(&fSocket, &fTimeoutTask),//ʼRTSPResponseStream
     fSessionMutex(),
+    fInterleavedQueue(NULL),
+    fInterleavedSendPending(0),
     fTCPCoalesceBuffer(NULL),
     fNumInCoalesceBuffer(0),
     fSocket(NULL, Socket::kNonBlockingSocketType),//ʼSocket
@@ -134,6 +136,7 @@ RTSPSessionInterface::~RTSPSessionInterface()
     
 	/* ɾƴϻ棬עķRTSPSessionInterface::GetTwoChannelNumbers() */
     delete [] fTCPCoalesceBuffer;
+    delete fInterleavedQueue;
     
     for (UInt8 x = 0; x < (fCurChannelNum >> 1); x++)
         delete [] fChNumToSessIDMap[x].Ptr;
@@ -223,6 +226,14 @@ UInt8 RTSPSessionInterface::GetTwoChannelNumbers(StrPtrLen* inRTSPSessionID)
     if (fTCPCoalesceBuffer != NULL)
         fTCPCoalesceBuffer = new char[kTCPCoalesceBufferSize];//1450
 
+    // SETUP holds the session mutex, so no interleaved write is under way
+    UInt32 theQueueBytes = QTSServerInterface::GetServer()->GetPrefs()->GetInterleavedSendQueueBytes();
+    if ((fInterleavedQueue == NULL) && (theQueueBytes > 0))
+    {
+        fInterleavedQueue = NEW RTSPInterleavedQueue(&fSocket, theQueueBytes);
+        fOutputStream.SetInterleavedQueue(fInterleavedQueue);
+    }
+
     // Allocate 2 channel numbers
 	/* ȡǰchannel */
     UInt8 theChannelNum = fCurChannelNum;
@@ -275,6 +286,9 @@ StrPtrLen*  RTSPSessionInterface::GetSessionIDForChannelNum(UInt8 inChannelNum)
 QTSS_Error RTSPSessionInterface::InterleavedWrite(void* inBuffer, UInt32 inLen, UInt32* outLenWritten, unsigned char channel)
 {
     /* 绺еݳΪ0 */
+    if (fInterleavedQueue != NULL)
+        return this->QueuedInterleavedWrite(inBuffer, inLen, outLenWritten, channel);
+
     if ( inLen == 0 && fNumInCoalesceBuffer == 0 )
     {   if (outLenWritten != NULL)
 			*outLenWritten = 0;
@@ -398,6 +412,57 @@ QTSS_Error RTSPSessionInterface::InterleavedWrite(void* inBuffer, UInt32 inLen,
     return err;  
 }
 
+QTSS_Error RTSPSessionInterface::QueuedInterleavedWrite(void* inBuffer, UInt32 inLen, UInt32* outLenWritten, unsigned char channel)
+{
+    QTSS_Error err = QTSS_NoErr;
+
+    // Without the session mutex the packet can still be queued, behind the
+    // response being written
+    if (this->GetSessionMutex()->TryLock())
+    {
+        if (inLen > 0)
+            err = fOutputStream.WriteInterleaved(channel, inBuffer, inLen);
+        else
+            err = fOutputStream.FlushInterleaved();
+        this->GetSessionMutex()->Unlock();
+    }
+    else if (inLen > 0)
+        err = fInterleavedQueue->Push(channel, inBuffer, inLen);
+
+    // Whatever the socket did not take is queued
+    if (err == EAGAIN)
+        err = QTSS_NoErr;
+
+    // Nobody may write on this connection for a while, so the RTSPSession sends the rest
+    if (!fInterleavedQueue->IsEmpty() && compare_and_store(0, 1, &fInterleavedSendPending))
+        this->Signal(Task::kUpdateEvent);
+
+    if (outLenWritten != NULL)
+        *outLenWritten = (err == QTSS_NoErr) ? inLen : 0;
+    return err;
+}
+
+SInt64 RTSPSessionInterface::SendInterleavedQueue()
+{
+    if (fInterleavedQueue == NULL)
+        return 0;
+
+    // Cleared first, so a packet queued from now on signals again
+    fInterleavedSendPending = 0;
+
+    if (this->GetSessionMutex()->TryLock())
+    {
+        (void)fOutputStream.FlushInterleaved();
+        this->GetSessionMutex()->Unlock();
+    }
+
+    if (fInterleavedQueue->IsEmpty())
+        return 0;
+
+    fInterleavedSendPending = 1;
+    return kInterleavedRetryMSecs;
+}
+
 /*
     take the TCP socket away from a RTSP session that's
     waiting to be snarfed.
@@ -22,6 +22,7 @@ LastUpdate:  2010-08-16
 
 #include "RTSPRequestStream.h"
 #include "RTSPResponseStream.h"
+#include "RTSPInterleavedQueue.h"
 #include "Task.h"
 #include "QTSS.h"
 #include "QTSSDictionary.h"
@@ -99,6 +100,10 @@ public:
 	/* ýдRTP/RTCPݽRTPStream */
     QTSS_Error  InterleavedWrite(void* inBuffer, UInt32 inLen, UInt32* outLenWritten, unsigned char channel);
 
+    // How long a packet passed to InterleavedWrite now would wait in the
+    // interleaved queue, 0 without one. See RTSPInterleavedQueue
+    UInt32      GetInterleavedDelayMSecs()  { return (fInterleavedQueue != NULL) ? fInterleavedQueue->GetDelayMSecs() : 0; }
+
 	// OPTIONS request
 	void		SaveOutputStream();
 	void		RevertOutputStream();
@@ -164,6 +169,21 @@ protected:
         , kTCPCoalesceDirectWriteSize = 0 // if > this # bytes, bypass(ƿƴ) coalescing and make a direct write
         , kInteleaveHeaderSize = 4  //RTPInterleaveHeader size: '$ '+ 1 byte ch ID + 2 bytes length
     };
+    // Replaces the coalesce buffer when interleaved_send_queue_bytes is not 0,
+    // created with the first channel numbers
+    RTSPInterleavedQueue*   fInterleavedQueue;
+    unsigned int            fInterleavedSendPending;    // the RTSPSession was signalled to send the queue
+    enum
+    {
+        kInterleavedRetryMSecs = 10     //UInt32
+    };
+
+    // RTSPSession::Run calls this between requests. Returns the msecs until
+    // the next try, 0 once the queue is empty
+    SInt64      SendInterleavedQueue();
+
+    QTSS_Error  QueuedInterleavedWrite(void* inBuffer, UInt32 inLen, UInt32* outLenWritten, unsigned char channel);
+
     char*       fTCPCoalesceBuffer;
 	/* fTCPCoalesceBufferĳ,μRTSPSessionInterface::InterleavedWrite() */
     SInt32      fNumInCoalesceBuffer;
@@ -25,6 +25,7 @@ LastUpdate:  2010-08-16
 #include "OS.h"
 #include "OSMemory.h"
 #include "OSThread.h"
+#include "OSTrace.h"
 #include "OSArrayObjectDeleter.h"
 #include "SafeStdLib.h"
 #include "Socket.h"
@@ -37,6 +38,8 @@ LastUpdate:  2010-08-16
 #include "QTSServerInterface.h"
 #include "QTSServer.h"
 #include "QTSSRollingLog.h"
+#include "RTPStream.h"
+#include "RTPSessionGroup.h"
 
 
 //ȫ־̬
@@ -68,6 +71,7 @@ QTSS_ServerState StartServer(XMLPrefsParser* inPrefsSource,/* PrefsSource* inMes
     OS::Initialize();
 	/* ͬһ̹߳TLS洢,ȡthread index */
     OSThread::Initialize();
+    OSTrace::Initialize();
     /* һevent thread,̼߳ */
     Socket::Initialize();
 	/* ݱ͵Socket,ȡIP Address List;ָСIPAddrInfoArray,óIP address,
@@ -145,6 +149,7 @@ QTSS_ServerState StartServer(XMLPrefsParser* inPrefsSource,/* PrefsSource* inMes
 		/* TimeoutTaskThreadעһͨTaskʵ,IdleThread޹أ,IdleTask::Initialize() */
         TimeoutTask::Initialize();     // The TimeoutTask mechanism is task based, we therefore must do this after adding task threads
                                        // this be done before starting the sockets and server tasks
+        RTPSessionGroup::Initialize(numThreads);
      }
 
 	/**************************NOTE: Server׶,ԵCPU4߳.תִн׶ *************************************/
@@ -235,6 +240,34 @@ void CleanPid(Bool16 force)
     }
 }
 
+/* Writes the RTP send timing snapshot (see qtssSvrRTPSendStats) to the "rtp_send_stats" file in the error log dir */
+void LogRTPSendStats()
+{
+    static StrPtrLen statsFileNameStr("rtp_send_stats");
+
+    StrPtrLenDel pathStr(sServer->GetPrefs()->GetErrorLogDir());
+    ResizeableStringFormatter pathBuffer(NULL,0);
+    pathBuffer.PutFilePath(&pathStr,&statsFileNameStr);
+    pathBuffer.PutTerminator();
+
+    ResizeableStringFormatter theStats;
+    RTPStream::FormatSendStats(&theStats);
+    theStats.PutTerminator();
+
+    char theDateBuffer[QTSSRollingLog::kMaxDateBufferSizeInBytes];
+    (void) QTSSRollingLog::FormatDate(theDateBuffer, false);
+
+    // overwritten every interval, like the server_status file
+    char*   filePath = pathBuffer.GetBufPtr();
+    FILE*   statsFile = ::fopen(filePath, "w");
+    if (statsFile != NULL)
+    {
+        ::chmod(filePath, 0640);
+        qtss_fprintf(statsFile, "#%s\n%s", theDateBuffer, theStats.GetBufPtr());
+        ::fclose(statsFile);
+    }
+}
+
 /* ָʽstateFile */
 void LogStatus(QTSS_ServerState theServerState)
 {
@@ -316,6 +349,8 @@ void LogStatus(QTSS_ServerState theServerState)
 	/* ʹstateFileʱOS::UnixTime_Secs() */
     if (interval == 0 || (OS::UnixTime_Secs() % interval) > 0 ) 
         return;
+
+    LogRTPSendStats();
     
     // If the total number of RTSP sessions is 0  then we 
     // might not need to update the "server_status" file.
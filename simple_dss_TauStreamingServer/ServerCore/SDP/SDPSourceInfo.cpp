@@ -180,14 +180,15 @@ char* SDPSourceInfo::GetLocalSDP(UInt32* newSDPLen)
     
 	/* theSDPStrǴsdpݵĶ */
     StrPtrLen theSDPStr(localSDP);
-    SDPContainer rawSDPContainer; 
-	/* нsdpݵĺϷ,Ϸsdpз뵱ǰеһ,󷵻ܵĺϷԼ(ȻﲻҪ,Voidʾ) */
-    (void) rawSDPContainer.SetSDPBuffer( &theSDPStr ); 
-	/*ָ˳sdp,ͷĸظзһ,Ҫγ󲿷:fSessionHeadersfMediaHeaders*/
-    SDPLineSorter sortedSDP(&rawSDPContainer);
+    ResizeableStringFormatter theSortedSDP(NULL, 0);
+	/* ָ˳sdp,ͷĸͬзһ,γSessionMedia󲿷 */
+    (void) SDPLineSorter::SortSDP(&theSDPStr, &theSortedSDP);
 
 	/* õкõsdpеһcopy */
-    return sortedSDP.GetSortedSDPCopy(); // return a new copy of the sorted SDP
+    char* theSortedSDPCopy = NEW char[theSortedSDP.GetBytesWritten() + 1];
+    ::memcpy(theSortedSDPCopy, theSortedSDP.GetBufPtr(), theSortedSDP.GetBytesWritten());
+    theSortedSDPCopy[theSortedSDP.GetBytesWritten()] = 0;
+    return theSortedSDPCopy; // return a new copy of the sorted SDP
 }
 
 /***************************ADDED by taoyx***********************************/
@@ -474,4 +474,166 @@ char* SDPLineSorter::GetSortedSDPCopy()
 	return fullbuffCopy;
 }
 
+/* position of a line type in sSessionOrderedLines, -1 for m and the types that are not valid */
+static SInt32 GetSessionLineOrder(char inType)
+{
+    switch (inType)
+    {
+        case 'v': return 0;
+        case 'o': return 1;
+        case 's': return 2;
+        case 'i': return 3;
+        case 'u': return 4;
+        case 'e': return 5;
+        case 'p': return 6;
+        case 'c': return 7;
+        case 'b': return 8;
+        case 't': return 9;
+        case 'r': return 10;
+        case 'z': return 11;
+        case 'k': return 12;
+        case 'a': return 13;
+    }
+    return -1;
+}
+
+/* the line at *ioPos as StringParser::GetThruEOL() gives it, *ioPos is moved past its eol */
+static inline void GetNextLine(char** ioPos, char* inEnd, StrPtrLen* outLine)
+{
+    char* theStart = *ioPos;
+    char* theEOL = theStart;
+    while ((theEOL < inEnd) && (*theEOL != '\r') && (*theEOL != '\n'))
+        theEOL++;
 
+    outLine->Set(theStart, (UInt32)(theEOL - theStart));
+    if (theEOL < inEnd)
+    {
+        if ((*theEOL == '\r') && (theEOL + 1 < inEnd) && (theEOL[1] == '\n'))
+            theEOL++;
+        theEOL++;
+    }
+    *ioPos = theEOL;
+}
+
+/* the session lines before inEnd in sSessionOrderedLines order, inFirstLines holds the first
+   line of each type. Only t, r and a lines can repeat, the others of those are found by looking
+   on from the first one */
+static void WriteSessionLines(char* inEnd, StrPtrLen* inFirstLines, ResizeableStringFormatter* outSDP)
+{
+    for (SInt32 theOrder = 0; theOrder < SDPLineSorter::kNumSessionLineTypes; theOrder++)
+    {
+        StrPtrLen* theFirstLine = &inFirstLines[theOrder];
+        if (theFirstLine->Ptr == NULL)
+            continue;
+
+        outSDP->Put(*theFirstLine);
+        outSDP->Put(SDPLineSorter::sEOL);
+
+        char theType = theFirstLine->Ptr[0];
+        if ((theType != 't') && (theType != 'r') && (theType != 'a'))
+            continue;
+
+        char* thePos = theFirstLine->Ptr + theFirstLine->Len;
+        StrPtrLen theLine;
+        while (thePos < inEnd)
+        {
+            ::GetNextLine(&thePos, inEnd, &theLine);
+            if ((theLine.Len > 0) && (theLine.Ptr[0] == theType))
+            {
+                outSDP->Put(theLine);
+                outSDP->Put(SDPLineSorter::sEOL);
+            }
+        }
+    }
+}
+
+Bool16 SDPLineSorter::SortSDP(StrPtrLen* inSDP, ResizeableStringFormatter* outSDP, Float32 adjustMediaBandwidthPercent)
+{
+    Assert(inSDP != NULL);
+    Assert(outSDP != NULL);
+
+    StrPtrLen theFirstLines[kNumSessionLineTypes];
+    Bool16 isValid = true;
+    Bool16 inMedia = false;
+    UInt32 theNumLines = 0;
+
+    char* thePos = inSDP->Ptr;
+    char* theSDPEnd = inSDP->Ptr + inSDP->Len;
+    StrPtrLen theLine;
+    while (thePos < theSDPEnd)
+    {
+        ::GetNextLine(&thePos, theSDPEnd, &theLine);
+
+        // The checks of SDPContainer::Parse(): once a line fails the rest is
+        // not looked at, but the media lines are still copied out
+        if (isValid)
+        {
+            char* theField = theLine.Ptr;
+            char* theLineEnd = theLine.Ptr + theLine.Len;
+            while ((theField < theLineEnd) && (StringParser::sWhitespaceMask[(UInt8)*theField] == 0))
+                theField++;
+            UInt32 theFieldLen = (UInt32)(theLineEnd - theField);
+
+            if ((theFieldLen == 0) || (theField[0] == '\0'))
+            {
+                // blank lines only go out among the media lines
+            }
+            else if ((theFieldLen < 2) || (theField[1] != '=')
+                        || ((GetSessionLineOrder(theField[0]) < 0) && (theField[0] != 'm'))
+                        || ((theFieldLen > 2) && (StringParser::sWhitespaceMask[(UInt8)theField[2]] == 0)))
+            {
+                isValid = false;
+                if (!inMedia)
+                {
+                    ::WriteSessionLines(theLine.Ptr, theFirstLines, outSDP);
+                    break;
+                }
+            }
+            else if (!inMedia)
+            {
+                theNumLines++;
+
+                // the type is the line's first char, even if that is whitespace
+                if (theLine.Ptr[0] == 'm')
+                {
+                    ::WriteSessionLines(theLine.Ptr, theFirstLines, outSDP);
+                    inMedia = true;
+                }
+                else
+                {
+                    SInt32 theOrder = GetSessionLineOrder(theLine.Ptr[0]);
+                    if ((theOrder >= 0) && (theFirstLines[theOrder].Ptr == NULL))
+                        theFirstLines[theOrder] = theLine;
+                }
+            }
+        }
+
+        if (!inMedia)
+            continue;
+
+        if ((theLine.Len > 0) && ('b' == theLine.Ptr[0]) && (1.0 != adjustMediaBandwidthPercent))
+        {
+            StringParser bLineParser(&theLine);
+            bLineParser.ConsumeUntilDigit();
+            UInt32 bandwidth = (UInt32) (.5 + (adjustMediaBandwidthPercent * (Float32) bLineParser.ConsumeInteger() ) );
+            if (bandwidth < 1)
+                bandwidth = 1;
+
+            char bandwidthStr[10];
+            qtss_snprintf(bandwidthStr,sizeof(bandwidthStr) -1, "%lu", bandwidth);
+            bandwidthStr[sizeof(bandwidthStr) -1] = 0;
+
+            outSDP->Put(sMaxBandwidthTag);
+            outSDP->Put(bandwidthStr);
+        }
+        else
+            outSDP->Put(theLine);
+
+        outSDP->Put(sEOL);
+    }
+
+    if (isValid && !inMedia)
+        ::WriteSessionLines(theSDPEnd, theFirstLines, outSDP);
+
+    return (Bool16)(isValid && (theNumLines > 0));
+}
@@ -151,6 +151,12 @@ public:
 
 	/* get sorted sdp line copy */
 	char* GetSortedSDPCopy();
+
+	/* SDPContainer::SetSDPBuffer(), this sorter and GetSortedSDPCopy() in one pass over inSDP:
+	   the same checks and the same sorted lines, put in outSDP with nothing copied in between.
+	   Returns false if inSDP is not valid, outSDP then has what the sorter makes of the lines
+	   before the bad one. used in QTSSFileModule::DoDescribe() */
+	static Bool16 SortSDP(StrPtrLen* inSDP, ResizeableStringFormatter* outSDP, Float32 adjustMediaBandwidthPercent = 1.0);
 	
 	/*****************************************************************************************************/
 	//
@@ -188,6 +194,8 @@ public:
 	/* SDPContainer::Parse() */
 	static char sSessionOrderedLines[];// = "vosiuepcbtrzka"; // chars are order dependent: declared by rfc 2327
 	static char sessionSingleLines[];//  = "vosiuepcbzk";    // return only 1 of each of these session field types
+
+	enum { kNumSessionLineTypes = 14 }; // strlen(sSessionOrderedLines)
 	
 	/* the following  both see SDPUtils.cpp */
 	/* spd line stop char */
@@ -99,6 +99,34 @@ void sigcatcher (int sig, int /*sinfo */ , struct sigcontext * /*sctxt */ )
 		}
 	}
 
+	// SIGUSR1 means we should write the RTSP latency histograms to the error log
+	if (sig == SIGUSR1)
+	{
+		if (sendtochild (sig, myPID))
+		{
+			return;
+		}
+		else
+		{
+			DumpLatencyTask *task = new DumpLatencyTask;
+			task->Signal (Task::kStartEvent);
+		}
+	}
+
+	// SIGUSR2 means we should write the trace ring buffer to a file in the error log folder
+	if (sig == SIGUSR2)
+	{
+		if (sendtochild (sig, myPID))
+		{
+			return;
+		}
+		else
+		{
+			DumpTraceTask *task = new DumpTraceTask;
+			task->Signal (Task::kStartEvent);
+		}
+	}
+
 	//Try to shut down gracefully the first time, shutdown forcefully the next time
 	if (sig == SIGINT)			// kill the child only
 	{
@@ -203,6 +231,8 @@ int main (int argc, char *argv[])
 
 	(void)::sigaction (SIGPIPE, &act, NULL);
 	(void)::sigaction (SIGHUP, &act, NULL);
+	(void)::sigaction (SIGUSR1, &act, NULL);
+	(void)::sigaction (SIGUSR2, &act, NULL);
 	(void)::sigaction (SIGINT, &act, NULL);
 	(void)::sigaction (SIGTERM, &act, NULL);
 	(void)::sigaction (SIGQUIT, &act, NULL);
@@ -452,6 +482,8 @@ int main (int argc, char *argv[])
 	//为守护进程的子进程也设置信号处理方式
 	(void)::sigaction (SIGPIPE, &act, NULL);
 	(void)::sigaction (SIGHUP, &act, NULL);
+	(void)::sigaction (SIGUSR1, &act, NULL);
+	(void)::sigaction (SIGUSR2, &act, NULL);
 	(void)::sigaction (SIGINT, &act, NULL);
 	(void)::sigaction (SIGTERM, &act, NULL);
 	(void)::sigaction (SIGQUIT, &act, NULL);
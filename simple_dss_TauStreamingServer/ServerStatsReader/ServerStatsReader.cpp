@@ -0,0 +1,126 @@
+/***************************************************************************
+
+Copyright (c) 2010-2020 DADI ORISTAR  TECHNOLOGY DEVELOPMENT(BEIJING)CO.,LTD
+
+FileName:	 ServerStatsReader.cpp
+Description: Prints the live server statistics the streaming server publishes
+             in its stats_shared_memory_file, without talking to the server.
+Comment:
+Author:		 taoyunxing@dadimedia.com
+Version:	 v1.0.0.1
+CreateDate:	 2026-10-19
+LastUpdate:  2026-10-19
+
+****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "SafeStdLib.h"
+#include "OSHeaders.h"
+#include "defaultPaths.h"
+#include "QTSServerStatsBlock.h"
+
+static char* sDefaultStatsFile = DEFAULTPATHS_PID_DIR PLATFORM_SERVER_BIN_NAME ".stats";
+
+static void Usage(char* inProgName)
+{
+    qtss_printf("usage: %s [-f statsfile] [-i seconds [-n count]]\n", inProgName);
+    qtss_printf("  -f  stats_shared_memory_file of the server (default: %s)\n", sDefaultStatsFile);
+    qtss_printf("  -i  print one line every <seconds> instead of all values once\n");
+    qtss_printf("  -n  stop after <count> lines (default: run until interrupted)\n");
+}
+
+static void PrintAll(QTSServerStats* inStats)
+{
+    qtss_printf("update_time_unix_msec %" _64BITARG_ "d\n", inStats->fUpdateTimeUnixMilli);
+    qtss_printf("startup_time_unix_msec %" _64BITARG_ "d\n", inStats->fStartupTimeUnixMilli);
+    qtss_printf("server_pid %" _64BITARG_ "u\n", inStats->fServerPID);
+    qtss_printf("server_state %" _64BITARG_ "u\n", inStats->fServerState);
+    qtss_printf("rtsp_sessions %" _64BITARG_ "u\n", inStats->fNumRTSPSessions);
+    qtss_printf("rtsp_http_sessions %" _64BITARG_ "u\n", inStats->fNumRTSPHTTPSessions);
+    qtss_printf("rtp_sessions %" _64BITARG_ "u\n", inStats->fNumRTPSessions);
+    qtss_printf("rtp_playing_sessions %" _64BITARG_ "u\n", inStats->fNumRTPPlayingSessions);
+    qtss_printf("rtp_total_sessions %" _64BITARG_ "u\n", inStats->fTotalRTPSessions);
+    qtss_printf("cur_bandwidth_bits %" _64BITARG_ "u\n", inStats->fCurBandwidthInBits);
+    qtss_printf("avg_bandwidth_bits %" _64BITARG_ "u\n", inStats->fAvgBandwidthInBits);
+    qtss_printf("rtp_packets_per_sec %" _64BITARG_ "u\n", inStats->fRTPPacketsPerSecond);
+    qtss_printf("rtp_total_bytes %" _64BITARG_ "u\n", inStats->fTotalRTPBytes);
+    qtss_printf("rtp_total_packets %" _64BITARG_ "u\n", inStats->fTotalRTPPackets);
+    qtss_printf("rtp_total_packets_lost %" _64BITARG_ "u\n", inStats->fTotalRTPPacketsLost);
+    qtss_printf("cpu_percent %" _64BITARG_ "u.%02" _64BITARG_ "u\n", inStats->fCPUPercentX100 / 100, inStats->fCPUPercentX100 % 100);
+    qtss_printf("max_late_msec %" _64BITARG_ "d\n", inStats->fMaxLateMsec);
+    qtss_printf("cur_max_late_msec %" _64BITARG_ "d\n", inStats->fCurrentMaxLateMsec);
+    qtss_printf("num_thinned %" _64BITARG_ "u\n", inStats->fNumThinned);
+}
+
+static void PrintLine(QTSServerStats* inStats, Bool16 inPrintHeader)
+{
+    if (inPrintHeader)
+        qtss_printf("%14s %10s %10s %10s %10s %10s %10s %8s\n",
+                    "Time", "RTSP", "HTTP", "RTP", "Playing", "kBits/Sec", "Pkts/Sec", "CPU%");
+
+    qtss_printf("%14" _64BITARG_ "d %10" _64BITARG_ "u %10" _64BITARG_ "u %10" _64BITARG_ "u %10" _64BITARG_ "u %10" _64BITARG_ "u %10" _64BITARG_ "u %5" _64BITARG_ "u.%02" _64BITARG_ "u\n",
+                    inStats->fUpdateTimeUnixMilli / 1000, inStats->fNumRTSPSessions, inStats->fNumRTSPHTTPSessions,
+                    inStats->fNumRTPSessions, inStats->fNumRTPPlayingSessions, inStats->fCurBandwidthInBits / 1024,
+                    inStats->fRTPPacketsPerSecond, inStats->fCPUPercentX100 / 100, inStats->fCPUPercentX100 % 100);
+    ::fflush(stdout);
+}
+
+int main(int argc, char * argv[])
+{
+    char*   theStatsFile = sDefaultStatsFile;
+    UInt32  theInterval = 0;
+    UInt32  theCount = 0;
+
+    int ch;
+    while ((ch = getopt(argc, argv, "f:i:n:h")) != EOF)
+    {
+        switch (ch)
+        {
+            case 'f':
+                theStatsFile = optarg;
+                break;
+            case 'i':
+                theInterval = ::atoi(optarg);
+                break;
+            case 'n':
+                theCount = ::atoi(optarg);
+                break;
+            default:
+                Usage(argv[0]);
+                return 1;
+        }
+    }
+
+    QTSServerStatsBlock theBlock;
+    OS_Error theErr = theBlock.Open(theStatsFile);
+    if (theErr != OS_NoErr)
+    {
+        qtss_fprintf(stderr, "%s: cannot open %s: %s\n", argv[0], theStatsFile, ::strerror(theErr));
+        return 1;
+    }
+
+    QTSServerStats theStats;
+    for (UInt32 theLine = 0; (theCount == 0) || (theLine < theCount); theLine++)
+    {
+        if (!theBlock.Read(&theStats))
+        {
+            qtss_fprintf(stderr, "%s: %s is being rewritten too often to read\n", argv[0], theStatsFile);
+            return 1;
+        }
+
+        if (theInterval == 0)
+        {
+            PrintAll(&theStats);
+            break;
+        }
+
+        PrintLine(&theStats, (theLine % 20) == 0);
+        ::sleep(theInterval);
+    }
+
+    return 0;
+}